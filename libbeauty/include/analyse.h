@@ -6,21 +6,11 @@ struct relocation_s {
 	uint64_t index; /* Index into the external_entry_point or data */
 };
 
-struct mid_start_s {
-	uint64_t mid_start;
-	uint64_t valid;
-};
-
 extern int tidy_inst_log(struct self_s *self);
 extern int find_node_from_inst(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, int inst);
 extern int node_mid_start_add(struct control_flow_node_s *node, struct node_mid_start_s *node_mid_start, int path, int step);
 extern int path_loop_check(struct path_s *paths, int path, int step, int node, int limit);
-extern int merge_path_into_loop(struct path_s *paths, struct loop_s *loop, int path);
-extern int build_control_flow_loops(struct self_s *self, struct path_s *paths, int *paths_size, struct loop_s *loops, int *loop_size);
-extern int build_control_flow_loops_multi_exit(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct loop_s *loops, int loops_size);
-extern int build_control_flow_loops_node_members(struct self_s *self,
-	struct control_flow_node_s *nodes, int nodes_size,
-	struct loop_s *loops, int *loops_size);
+extern int build_control_flow_loop_forest(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct loop_s **loops, int *loops_size);
 extern int print_control_flow_loops(struct self_s *self, struct loop_s *loops, int *loops_size);
 extern int add_path_to_node(struct control_flow_node_s *node, int path);
 extern int add_looped_path_to_node(struct control_flow_node_s *node, int path);
@@ -43,8 +33,61 @@ extern int register_label(struct external_entry_point_s *entry_point, uint64_t v
 	struct memory_s *value, struct label_redirect_s *label_redirect, struct label_s *labels);
 extern int scan_for_labels_in_function_body(struct self_s *self, struct external_entry_point_s *entry_point,
 			 int start, int end, struct label_redirect_s *label_redirect, struct label_s *labels);
-extern int search_back_local_reg_stack(struct self_s *self, uint64_t mid_start_size, struct mid_start_s *mid_start, int reg_stack, uint64_t indirect_init_value, uint64_t indirect_offset_value, uint64_t *size, int *search_back_seen, uint64_t **inst_list);
+extern int def_use_build(struct self_s *self, struct external_entry_point_s *external_entry_point);
+extern void def_use_free(struct external_entry_point_s *external_entry_point);
+extern struct def_use_s *def_use_of_inst(struct self_s *self, int inst);
+extern struct def_use_list_s *def_use_find_def(struct def_use_s *def_use, int reg_stack,
+	uint64_t init_value, uint64_t offset_value);
+extern int def_use_reaching(struct self_s *self, struct def_use_s *def_use, int reg_stack,
+	uint64_t init_value, uint64_t offset_value, int inst, uint64_t *size, uint64_t **inst_list);
+
+#define DATAFLOW_FORWARD 0
+#define DATAFLOW_BACKWARD 1
+extern int reg_set_next(struct reg_set_s *set, int dense);
+extern int reg_dataflow_solve(struct control_flow_node_s *nodes, int nodes_size, int direction,
+	struct reg_set_s *gen, struct reg_set_s *kill, struct reg_set_s *in, struct reg_set_s *out);
+extern int build_node_reg_liveness(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size);
+extern int *build_node_reg_reach(struct control_flow_node_s *nodes, int nodes_size);
+
+extern int inst_log_hot_build(struct self_s *self);
+extern int inst_log_hot_update(struct self_s *self, int inst);
+extern int inst_log_hot_free(struct self_s *self);
+
+extern int flag_reach_build(struct self_s *self);
+extern int flag_reach_update(struct self_s *self, int inst);
+extern int flag_reach_out(struct self_s *self, int inst);
+extern int flag_reach_producer(struct self_s *self, int inst);
+extern int flag_reach_first_prev(struct self_s *self, int inst);
+extern int flag_reach_free(struct self_s *self);
+
+extern int flag_dependency_grow(struct self_s *self, int size);
+extern int inst_edit_insert_before(struct self_s *self, int inst, int *new_inst);
+extern int inst_edit_insert_after(struct self_s *self, int inst, int *new_inst);
+extern int inst_edit_changed(struct self_s *self, int inst);
+extern int inst_edit_delete(struct self_s *self, int inst);
+extern int inst_edit_commit(struct self_s *self);
+extern int inst_edit_free(struct self_s *self);
+
+extern int label_redirect_reserve(struct external_entry_point_s *external_entry_point, int size);
+extern int label_redirect_init(struct label_redirect_s *label_redirect, uint64_t id);
+extern uint64_t label_redirect_find(struct label_redirect_s *label_redirect, uint64_t id);
+extern int label_redirect_union(struct label_redirect_s *label_redirect, uint64_t dst, uint64_t src);
+extern int label_redirect_canonicalize(struct external_entry_point_s *external_entry_point);
+
+extern int inst_node_set_function(struct self_s *self, int function);
+extern int inst_node_copy(struct self_s *self, int inst, int from);
+extern int inst_node_function(struct self_s *self, int inst);
+extern int inst_node_free(struct self_s *self);
+
+extern int call_graph_build(struct self_s *self);
+extern int call_graph_target(struct self_s *self, int inst);
+extern int call_graph_summarise(struct self_s *self, int threads);
+extern struct function_summary_s *call_graph_summary(struct self_s *self, int function);
+extern int call_graph_free(struct self_s *self);
 
+extern int is_member_of_loop(struct control_flow_node_s *nodes, int loop_node, int test_node);
+extern int ast_reset(struct ast_s *ast);
+extern int build_function_ast(struct self_s *self, struct external_entry_point_s *external_entry_point, struct ast_s *ast);
 
 
 #endif /* ANALYSE_H */
@@ -51,6 +51,8 @@ int external_entry_points_init_bfl(struct external_entry_point_s *external_entry
 uint32_t bf_relocated_code(void *handle_void, uint8_t *base_address, uint64_t offset, uint64_t size, struct reloc_table_s **reloc_table_entry);
 uint32_t bf_relocated_data(void *handle_void, uint64_t offset, uint64_t size);
 int bf_find_relocation_rodata(void *handle_void, uint64_t index, int *relocation_area, uint64_t *relocation_index);
+int bf_read_relocation_rodata_table(void *handle_void, uint64_t index, uint64_t stride, int max,
+	int *relocation_area, uint64_t *relocation_index);
 int bf_link_reloc_table_code_to_external_entry_point(void *handle, struct external_entry_point_s *external_entry_points);
 int bf_print_symtab(void *handle_void);
 int bf_init_section_number_mapping(void *handle_void, int **section_number_mapping);
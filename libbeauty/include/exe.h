@@ -7,6 +7,18 @@ extern struct memory_s *search_store(
         struct memory_s *memory, uint64_t index, int size);
 extern struct memory_s *add_new_store(
 	struct memory_s *memory, uint64_t index, int size);
+extern int resolve_operand_handlers(struct inst_log_entry_s *inst);
+extern struct process_state_snapshot_s *process_state_snapshot(
+	struct process_state_s *process_state);
+extern int process_state_restore(struct process_state_s *process_state,
+	struct process_state_snapshot_s *snapshot);
+extern void process_state_snapshot_get(struct process_state_snapshot_s *snapshot);
+extern void process_state_snapshot_put(struct process_state_snapshot_s *snapshot);
+extern struct memory_used_s *memory_used_init(uint64_t size);
+extern void memory_used_free(struct memory_used_s *memory_used);
+extern int memory_used_get(struct memory_used_s *memory_used, uint64_t offset);
+extern int memory_used_set(struct memory_used_s *memory_used, uint64_t offset,
+	int bytes_used, int inst_log);
 
 //extern instructions_t instructions;
 extern uint8_t *inst;
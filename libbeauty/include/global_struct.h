@@ -46,18 +46,58 @@ struct reloc_table_s {
 	const char	*symbol_name;
 };
 
+/* Which .text offsets have been executed.
+ * The pages are only allocated when an offset in them is first used,
+ * so each function only pays for the part of .text it runs through.
+ */
+#define MEMORY_USED_PAGE_BITS 12
+#define MEMORY_USED_PAGE_SIZE (1 << MEMORY_USED_PAGE_BITS)
+#define MEMORY_USED_PAGE_MASK (MEMORY_USED_PAGE_SIZE - 1)
+
+struct memory_used_page_s {
+	int value[MEMORY_USED_PAGE_SIZE]; /* See memory_used_get() */
+};
+
+struct memory_used_s {
+	uint64_t size; /* The size of the .text section */
+	uint64_t pages_size;
+	struct memory_used_page_s **pages;
+};
+
 struct process_state_s {
 	struct memory_s *memory_text;
 	struct memory_s *memory_stack;
 	struct memory_s *memory_reg;
 	struct memory_s *memory_data;
-	int *memory_used;
+	struct memory_used_s *memory_used;
+	struct store_cow_s *cow;	/* Only while there are snapshots. See process_state_snapshot() */
+};
+
+/* A set of registers, one bit per register.
+ * The register numbers are sparse (REG_AX is 0x08, REG_TMP3 0x1a0), so the bits
+ * are the dense numbers of reg_dense_index[], and a set is a single word.
+ * Dense number 0 is every register the decoders do not use. It is never iterated.
+ */
+#define REG_DENSE_MAX 64
+#define REG_DENSE(reg) (((reg) < MAX_REG) ? reg_dense_index[(reg)] : 0)
+#define REG_SET_WORDS ((REG_DENSE_MAX + 63) / 64)
+#define REG_SET_ADD(set, reg) ((set)->word[REG_DENSE(reg) >> 6] |= (1ULL << (REG_DENSE(reg) & 63)))
+#define REG_SET_TEST(set, reg) (((set)->word[REG_DENSE(reg) >> 6] >> (REG_DENSE(reg) & 63)) & 1)
+#define REG_SET_TEST_DENSE(set, dense) (((set)->word[(dense) >> 6] >> ((dense) & 63)) & 1)
+
+struct reg_set_s {
+	uint64_t word[REG_SET_WORDS];
 };
 
 struct loop_s {
 	int head; /* The associated loop_head node */
 	int nest;
 	int multi_exit; /* 0 = unknown amount of exits, 1 = single exit, 2 = multi-exit loop */
+	int parent; /* Index of the enclosing loop. -1 = outermost */
+	int depth; /* 1 = outermost */
+	int last; /* Index of the last loop nested inside this one */
+	int irreducible; /* 1 = entered other than through the head */
+	int follow; /* The node where the exits of the loop meet. 0 = none */
 	int size;
 	int *list;
 };
@@ -99,9 +139,10 @@ struct node_link_s {
 	int elasticity;
 };
 
+/* Indexed by REG_DENSE(reg). Whether the register is read before it is written
+ * in the node (SRC first), or written first (DST first), is in reg_use and reg_def.
+ */
 struct node_used_register_s {
-	/* If SRC and DST in same instruction, set SRC first in seen. */
-	int seen; /* 0 = Not seen, 1 = SRC first, 2 = DST first */
 	int size; /* The size of the register seen */
 	/* Points to last src in the block */
 	int src;  /* Set when the register is used by the node. Points to instruction */
@@ -169,7 +210,10 @@ struct ast_type_index_s {
 /* renaming the variable within the log entries would take too long. */
 /* so use log entry value_id -> redirect -> label_s */
 struct label_redirect_s {
-	uint64_t redirect;
+	uint64_t redirect;	/* The label to use. See label_redirect_canonicalize() */
+	uint64_t parent;	/* Union-find. 0 if never given a label */
+	uint64_t rank;
+	uint64_t label;		/* Only at a root. The label the whole set uses */
 } ;
 
 struct label_s {
@@ -213,6 +257,7 @@ struct control_flow_node_s {
 	int next_size;
 	struct node_link_s *link_next;
 	int dominator; /* Node that dominates this node */
+	int post_dominator; /* Node that post dominates this node, with the loop edges taken out. 0 = the function exit */
 	int type; /* 0 =  Normal, 1 =  Part of a loop, 2 = normal if statement */
 	int loop_head; /* 0 = Normal, 1 = Loop head */
 	int if_tail; /* 0 = no tail, > 0 points to the tail of the if...then...else */
@@ -222,17 +267,55 @@ struct control_flow_node_s {
 	int *looped_path; /* The list of paths that touch this node */
 	int member_of_loop_size; /* Number of member_of_loop entries in the list */
 	int *member_of_loop; /* The list of member_of_loop entries. One entry for each loop this node belongs to */
+	int loop; /* The innermost loop this node is in, as loops[] index + 1. 0 = none */
+	int loop_last; /* Only set on a loop head. loops[].last + 1 of its loop */
 	struct ast_type_index_s parent; /* This is filled in once the AST is being built */
 	int depth; /* Where abouts in a graph does it go. 1 = Top of graph, 10 = 10th step down */
 	int multi_exit; /* 0 = unknown amount of exits, 1 = single exit, 2 = multi-exit loop */
-	struct node_used_register_s *used_register;
+	struct node_used_register_s *used_register; /* REG_DENSE_MAX entries */
+	struct reg_set_s reg_use; /* Registers read before they are written in this node. SRC first */
+	struct reg_set_s reg_def; /* Registers written in this node. DST first if not in reg_use */
+	struct reg_set_s reg_live_in;
+	struct reg_set_s reg_live_out;
+	struct reg_set_s reg_avail_in; /* Registers written, or given a phi, on some path to this node */
 	int phi_size;
 	struct phi_s *phi;
 };
 
+struct def_use_list_s {
+	int size;
+	int max;
+	int *list; /* inst_log entries */
+};
+
+struct def_use_stack_slot_s {
+	uint64_t init_value;
+	uint64_t offset_value;
+	struct def_use_list_s def;
+};
+
+/* Where each register and stack slot is written (def) and each register read (use),
+ * for one function.
+ */
+struct def_use_s {
+	struct def_use_list_s reg_def[MAX_REG];
+	struct def_use_list_s reg_use[MAX_REG];
+	int stack_slot_size;
+	struct def_use_stack_slot_s *stack_slot; /* Sorted by init_value, offset_value */
+	/* Scratch for def_use_reaching(), indexed by inst - seen_base over the
+	 * function's instructions. Stamped with epoch, so never cleared */
+	int seen_base;
+	int seen_size;
+	uint32_t *seen;
+	uint32_t *def_mark;
+	uint32_t epoch;
+	int stack_size;
+	int *stack;
+};
+
 struct external_entry_point_s {
 	int valid;
-	int type; /* 1: Internal, 2: External */
+	int type; /* 1: Internal, 2: External, 3: Internal, served from the summary cache */
 	int section_offset;
 	int section_id;
 	int section_index;
@@ -264,8 +347,9 @@ struct external_entry_point_s {
 	/* FIXME: add function return type and param types */
 	struct label_redirect_s *label_redirect;
 	struct label_s *labels;
+	int label_redirect_size; /* Entries allocated, in both label_redirect and labels */
 	int variable_id;
-	int *search_back_seen;
+	struct def_use_s *def_use; /* Built once the SSA labels are assigned */
 };
 
 /* Memory and Registers are a list of accessed stores. */
@@ -334,9 +418,50 @@ struct memory_s {
 	int *next;
 };
 
+/* A snapshot of the reg, stack and data stores taken when a branch is queued.
+ * The reg store is small, so it is copied whole when the snapshot is taken.
+ * The stack and data stores are shared with the snapshots, STORE_PAGE_SIZE
+ * entries a page. A page is only copied when it is first written after a
+ * snapshot, and that copy is shared by every snapshot taken since the page
+ * was last saved. Restoring copies back only the pages the snapshot saved.
+ * One snapshot is shared by every entry_point_s queued at the same branch,
+ * so it is reference counted.
+ */
+#define STORE_PAGE_SHIFT 5
+#define STORE_PAGE_SIZE (1 << STORE_PAGE_SHIFT)
+#define STORE_COW_STACK 0
+#define STORE_COW_DATA 1
+#define STORE_COW_MAX 2
+
+struct store_page_s {
+	int refcount;		/* Snapshots holding it */
+	int page;		/* Entry page * STORE_PAGE_SIZE of the store */
+	struct memory_s entry[STORE_PAGE_SIZE];
+};
+
+struct store_cow_s {
+	int generation;		/* Snapshots taken */
+	int *page_generation[STORE_COW_MAX];	/* The generation each page was last saved in */
+	struct process_state_snapshot_s *live;	/* Newest first */
+};
+
+struct process_state_snapshot_s {
+	int refcount;
+	int generation;
+	struct process_state_s *process_state;
+	struct process_state_snapshot_s *live_next;
+	/* The reg store is small, so it is copied */
+	int memory_reg_size;
+	struct memory_s *memory_reg;
+	/* The stack and data pages written since, as they were */
+	int saved_size[STORE_COW_MAX];
+	int saved_max[STORE_COW_MAX];
+	struct store_page_s **saved[STORE_COW_MAX];
+};
+
 struct entry_point_s {
 	int used;
-	/* FIXME: Is this enough, or will full register backup be required */
+	/* ESP, EBP and EIP to resume with. */
 	uint64_t esp_init_value;
 	uint64_t esp_offset_value;
 	uint64_t ebp_init_value;
@@ -344,6 +469,8 @@ struct entry_point_s {
 	uint64_t eip_init_value;
 	uint64_t eip_offset_value;
 	uint64_t previous_instuction;
+	/* State of the other regs and the stack at the branch. NULL if none */
+	struct process_state_snapshot_s *snapshot;
 };
 
 struct operand_s {
@@ -399,6 +526,15 @@ struct instruction_s {
 	struct operand_s dstA; /* E.g. A */
 } ;
 
+struct self_s;
+struct inst_log_entry_s;
+
+/* Operand access handlers. See resolve_operand_handlers() */
+typedef int (*get_value_fn_t)(struct self_s *self, struct process_state_s *process_state,
+	struct operand_s *source, struct memory_s *destination, int info_id);
+typedef int (*put_value_fn_t)(struct self_s *self, struct process_state_s *process_state,
+	struct inst_log_entry_s *inst);
+
 struct inst_log_entry_s {
 	struct instruction_s instruction;	/* The instruction */
 	int prev_size;
@@ -408,10 +544,196 @@ struct inst_log_entry_s {
 	struct memory_s value1;		/* First input value */
 	struct memory_s value2;		/* Second input value */
 	struct memory_s value3;		/* Result */
-	int node_start;			/* Is this instruction the start of a node 0 == No, 1 == Yes */
-	int node_member;		/* The node this instrustion is a member off */
-	int node_end;			/* Is this instruction the end of a node 0 == No, 1 == Yes */
+	/* node_start, node_member and node_end are in the inst_log_hot_s table */
 	void *extension;		/* Instruction specific extention */
+	get_value_fn_t get_srcA;	/* Operand access handlers for the instruction */
+	get_value_fn_t get_srcB;
+	get_value_fn_t get_dstA;
+	put_value_fn_t put_dstA;
+};
+
+/* Compact copy of an operand_s. Only what the analysis passes scan. */
+struct operand_hot_s {
+	int store;
+	int indirect;
+	uint64_t index;
+	int value_size;
+};
+
+struct instruction_hot_s {
+	int opcode;
+	int flags;
+	struct operand_hot_s srcA;
+	struct operand_hot_s srcB;
+	struct operand_hot_s dstA;
+};
+
+/* The hot fields of the inst_log_entry_s table, held as dense arrays indexed by inst_log.
+ * The symbolic values (value1, value2, value3) stay in inst_log_entry_s.
+ * Only prev[0] and next[0] are copied. For more, use inst_log_entry_s.
+ * The node fields are only held here. build_control_flow_nodes() sets them.
+ */
+struct inst_log_hot_s {
+	int size;		/* Entries allocated */
+	struct instruction_hot_s *instruction;
+	int *prev_size;
+	int *prev;
+	int *next_size;
+	int *next;
+	uint8_t *node_start;	/* Is this instruction the start of a node 0 == No, 1 == Yes */
+	int *node_member;	/* The node this instruction is a member of */
+	uint8_t *node_end;	/* Is this instruction the end of a node 0 == No, 1 == Yes */
+};
+
+/* The node fields of an inst_log entry. 0 until build_control_flow_nodes() */
+#define INST_LOG_HOT_FIELD(self, field, inst) \
+	(((self)->inst_log_hot && ((inst) < (self)->inst_log_hot->size)) ? \
+		(self)->inst_log_hot->field[(inst)] : 0)
+#define INST_LOG_NODE_START(self, inst) INST_LOG_HOT_FIELD(self, node_start, inst)
+#define INST_LOG_NODE_MEMBER(self, inst) INST_LOG_HOT_FIELD(self, node_member, inst)
+#define INST_LOG_NODE_END(self, inst) INST_LOG_HOT_FIELD(self, node_end, inst)
+
+/* Reaching flags table. See src/analyse/flag_reach.c */
+#define FLAG_REACH_NONE 0
+#define FLAG_REACH_JOIN -1
+struct flag_reach_s {
+	int size;		/* Entries allocated */
+	int *producer;		/* Per inst: the flag setting inst live on entry */
+	int *queue;		/* Scratch for the work list, kept between updates */
+	int *stack;
+	uint8_t *in_list;
+};
+
+/* Instruction to function index. See src/analyse/inst_node.c */
+struct inst_node_s {
+	int size;		/* Entries allocated */
+	int *function;		/* Per inst: external_entry_points[] index + 1. 0 = none */
+};
+
+/* What a call to a function does to the registers, including the functions it calls */
+struct function_summary_s {
+	int valid;
+	int params_size;	/* The first params_size of reg_params_order[] are params */
+	struct reg_set_s params;
+	struct reg_set_s clobber;	/* Registers written on some path */
+	struct reg_set_s ret;		/* Registers read by a RET */
+};
+
+/* Call graph and its strongly connected components. See src/analyse/call_graph.c
+ * All per function arrays are indexed by external_entry_points[] index.
+ */
+struct call_graph_s {
+	int size;
+	int *callee_start;	/* size + 1 entries. callee[callee_start[f] .. callee_start[f + 1]) */
+	int *callee;
+	int *scc;		/* Per function: its SCC */
+	int scc_size;
+	int *scc_start;		/* scc_size + 1 entries, into scc_member */
+	int *scc_member;	/* SCCs in bottom-up order, callees before callers */
+	int *scc_level;		/* 0 = calls no other SCC. SCCs of the same level are independent */
+	int level_size;
+	struct function_summary_s *summary;
+};
+
+/* On disk cache of the results of each function. See src/analyse/summary_cache.c */
+#define SUMMARY_CACHE_DATA 0	/* The memory_data lines at the top of the .c file */
+#define SUMMARY_CACHE_C 1	/* The C text of the function */
+#define SUMMARY_CACHE_LLVM 2	/* The LLVM bitcode of the function. Only with --llvm */
+#define SUMMARY_CACHE_TEXTS 3
+
+struct summary_cache_entry_s {
+	uint64_t key;
+	struct function_summary_s summary;
+	uint64_t callee_offset;	/* Into the blob. The keys of the functions in this file it calls */
+	uint64_t callees;
+	uint64_t label_offset;	/* Into the blob. The param labels, then the local labels */
+	uint64_t params;
+	uint64_t locals;
+	uint64_t text_offset[SUMMARY_CACHE_TEXTS];	/* Into the blob */
+	uint64_t text_size[SUMMARY_CACHE_TEXTS];
+};
+
+/* A function analysed in this run, to be written out */
+struct summary_cache_new_s {
+	int valid;		/* Set once its C output is written */
+	struct function_summary_s summary;
+	int callees;
+	uint64_t *callee;
+	int params;
+	int locals;
+	struct label_s *label;
+	char *text[SUMMARY_CACHE_TEXTS];
+	uint64_t text_size[SUMMARY_CACHE_TEXTS];
+};
+
+struct summary_cache_s {
+	char *path;
+	void *map;
+	size_t map_size;
+	uint64_t entries;
+	struct summary_cache_entry_s *entry;	/* Points into map. Sorted by key */
+	uint8_t *blob;				/* Points into map */
+	uint64_t blob_size;
+	int llvm;				/* Entries must have the bitcode */
+	uint64_t *key;				/* Per function: hash of its bytes and relocations. 0 = not known */
+	struct summary_cache_entry_s **hit;	/* Per function: its entry, if served from the cache */
+	struct summary_cache_new_s *added;	/* Per function */
+	int hits;
+	int misses;
+};
+
+/* Batched inst_log edits. See src/analyse/inst_edit.c */
+#define INST_EDIT_INSERT_BEFORE 1
+#define INST_EDIT_INSERT_AFTER 2
+#define INST_EDIT_CHANGED 3
+#define INST_EDIT_DELETE 4
+struct inst_edit_entry_s {
+	int type;
+	int inst;
+	int new_inst;
+};
+
+struct inst_edit_entry_point_s {
+	int inst;		/* The external_entry_points inst_log */
+	int entry;		/* The external_entry_points index */
+};
+
+struct inst_edit_s {
+	int size;
+	int max;
+	struct inst_edit_entry_s *list;
+	int entry_points_size;
+	struct inst_edit_entry_point_s *entry_points; /* Sorted by inst. Only built if a commit needs it */
+};
+
+/* Per phase timing and counters. See src/analyse/stats.c */
+#define STATS_COUNTER_INSTRUCTIONS 0
+#define STATS_COUNTER_NODES 1
+#define STATS_COUNTER_PATHS 2
+#define STATS_COUNTER_PHIS 3
+#define STATS_COUNTER_LABELS 4
+#define STATS_COUNTER_MAX 5
+struct stats_record_s {
+	const char *phase;
+	int function;		/* external_entry_points[] index. -1 = the whole program */
+	int tid;		/* Kernel thread id of the thread that called stats_begin() */
+	int done;		/* stats_end() has been called */
+	uint64_t wall_start;	/* ns since stats_open() */
+	uint64_t wall_end;
+	uint64_t cpu_start;	/* ns of process CPU time, or thread CPU time for a function */
+	uint64_t cpu_end;
+	long rss_start;		/* Peak RSS in KB */
+	long rss_end;
+	uint64_t counter[STATS_COUNTER_MAX];
+};
+
+struct stats_s {
+	uint64_t wall_base;
+	uint64_t cpu_base;
+	int size;
+	int max;
+	struct stats_record_s *record;
+	int lock;		/* Taken with __sync_lock_test_and_set() */
 };
 
 struct self_s {
@@ -424,6 +746,7 @@ struct self_s {
 	size_t rodata_size;
 	uint8_t *rodata;
 	struct inst_log_entry_s *inst_log_entry;
+	struct inst_log_hot_s *inst_log_hot;
 	struct external_entry_point_s *external_entry_points;
 	struct relocation_s *relocations;
 	struct entry_point_s *entry_point; /* This is used to hold return values from process block */
@@ -431,9 +754,16 @@ struct self_s {
 	int nodes_size;
 	struct control_flow_node_s *nodes;
 	int flag_dependency_size;
+	int flag_dependency_max;	/* Entries allocated */
 	int *flag_dependency;
 	int *flag_dependency_opcode;
 	int *flag_result_users;
+	struct flag_reach_s *flag_reach;
+	struct inst_edit_s *inst_edit;
+	struct inst_node_s *inst_node;
+	struct call_graph_s *call_graph;
+	struct summary_cache_s *summary_cache;
+	struct stats_s *stats;
 };
 
 #endif /* GLOBAL_STRUCT_H */
@@ -1,7 +1,19 @@
+/* The pass list used for "default". See llvm_export_module() */
+#define LLVM_PASSES_DEFAULT "sroa,early-cse,instcombine,simplifycfg,dce"
+
+/* The export workers started by llvm_export_begin(). See llvm_ir.cpp */
+struct llvm_export_s;
+
 #ifdef __cplusplus
 extern "C" int llvm_export(struct self_s *self);
+extern "C" int llvm_export_module(struct self_s *self, const char *filename, int threads, const char *passes);
+extern "C" struct llvm_export_s *llvm_export_begin(struct self_s *self, const char *filename, int threads, const char *passes);
+extern "C" int llvm_export_submit(struct llvm_export_s *exporter, int function);
+extern "C" int llvm_export_end(struct llvm_export_s *exporter);
 #else
 extern int llvm_export(struct self_s *self);
+extern int llvm_export_module(struct self_s *self, const char *filename, int threads, const char *passes);
+extern struct llvm_export_s *llvm_export_begin(struct self_s *self, const char *filename, int threads, const char *passes);
+extern int llvm_export_submit(struct llvm_export_s *exporter, int function);
+extern int llvm_export_end(struct llvm_export_s *exporter);
 #endif
-
-
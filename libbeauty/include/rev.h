@@ -39,8 +39,31 @@
 #define DEBUG_ANALYSE 6
 #define DEBUG_ANALYSE_PATHS 7
 #define DEBUG_ANALYSE_PHI 8
+#define DEBUG_MODULE_MAX 9
 
-void debug_print(int module, int level, const char *format, ...) __attribute__((__format__ (printf, 3, 4)));
+/* debug_print() calls above DEBUG_LEVEL_MAX are compiled out, arguments and all.
+ * Build with -DDEBUG_LEVEL_MAX=0 for no debug output at all.
+ * Below that, debug_level[module] is the level for each module at run time,
+ * and a call above it does not evaluate its arguments either.
+ * A module outside debug_level[] is not looked up. It goes straight to
+ * debug_print_out(), which reports it.
+ * Each driver defines debug_level[] and debug_print_out().
+ */
+#ifndef DEBUG_LEVEL_MAX
+#define DEBUG_LEVEL_MAX 1
+#endif
+
+extern int debug_level[DEBUG_MODULE_MAX];
+void debug_print_out(int module, int level, const char *format, ...) __attribute__((__format__ (printf, 3, 4)));
+
+#define debug_print(module, level, ...) \
+	do { \
+		if (((level) <= DEBUG_LEVEL_MAX) && \
+			(((unsigned int)(module) >= DEBUG_MODULE_MAX) || \
+			((level) <= debug_level[(module)]))) { \
+			debug_print_out((module), (level), __VA_ARGS__); \
+		} \
+	} while (0)
 
 #include <dis.h>
 #include <exe.h>
@@ -61,16 +84,22 @@ void debug_print(int module, int level, const char *format, ...) __attribute__((
 #define REG_PARAMS_ORDER_MAX 6
 /* RDI, RSI, RDX, RCX, R08, R09  */
 extern int reg_params_order[];
+extern const uint8_t reg_dense_index[MAX_REG];
+extern const int reg_dense_reg[REG_DENSE_MAX];
 
 struct extension_call_s {
 	int params_size;
 	int *params;
 };
 
+/* Growable output buffer. See string_init() */
+#define STRING_INIT_SIZE 1024
+#define STRING_FLUSH_SIZE 0x10000
 struct string_s {
-	char string[1024];
+	char *string;
 	int len;
-	int max;
+	int max;	/* Bytes allocated */
+	int fd;		/* Where string_flush() writes to. -1 = keep in memory */
 };
 
 /* Params order:
@@ -100,6 +129,7 @@ struct ast_entry_s {
 	int sub_index;
 	int node;
 	int node_end; // Node to end at.
+	int loop; // The loop, as loops[] index + 1, the container is in. 0 = none
 };
 
 struct ast_type_parent_s {
@@ -112,6 +142,7 @@ struct ast_container_s {
 	int start_node;
 	int sub_type; /* 0 = normal container, 1 = loop container */
 	int length; /* Number of objects. */
+	int max; /* Number of objects allocated */
 	struct ast_type_index_s *object; /* Array of objects */
 };
 
@@ -193,18 +224,31 @@ struct ast_s {
 	int loop_container_size;
 	int loop_then_else_size;
 	int entry_size;
+	/* Entries allocated in each table */
+	int container_max;
+	int if_then_else_max;
+	int if_then_goto_max;
+	int loop_max;
+	int loop_container_max;
+	int loop_then_else_max;
+	int entry_max;
 };
 
 extern int execute_instruction(struct self_s *self, struct process_state_s *process_state, struct inst_log_entry_s *inst);
 extern int process_block(struct self_s *self, struct process_state_s *process_state, uint64_t inst_log_prev, uint64_t eip_offset_limit);
 int output_function_body(struct self_s *self, struct process_state_s *process_state,
-			 int fd, int start, int end, struct label_redirect_s *label_redirect, struct label_s *labels);
-uint32_t output_function_name(int fd,
+			 struct string_s *string, int start, int end, struct label_redirect_s *label_redirect, struct label_s *labels);
+uint32_t output_function_name(struct string_s *string,
 		struct external_entry_point_s *external_entry_point);
 int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
-			 int fd, int inst_number, struct label_redirect_s *label_redirect, struct label_s *labels, const char *cr);
+			 struct string_s *string, int inst_number, struct label_redirect_s *label_redirect, struct label_s *labels, const char *cr);
 uint32_t relocated_data(void *handle, uint64_t offset, uint64_t size);
 extern int print_inst(struct self_s *self, struct instruction_s *instruction, int instruction_number, struct label_s *labels);
+extern int string_init(struct string_s *string, int fd);
+extern int string_cat(struct string_s *string, char *src, int src_length);
+extern int string_printf(struct string_s *string, const char *format, ...) __attribute__((__format__ (printf, 2, 3)));
+extern int string_flush(struct string_s *string);
+extern int string_free(struct string_s *string);
 extern int write_inst(struct self_s *self, struct string_s *string, struct instruction_s *instruction, int instruction_number, struct label_s *labels);
 extern int print_inst_short(struct self_s *self, struct instruction_s *instruction);
 extern int disassemble(struct self_s *self, struct dis_instructions_s *dis_instructions, uint8_t *base_address, uint64_t buffer_size, uint64_t offset);
@@ -213,6 +257,8 @@ extern void disassemble_callback_end(struct self_s *self);
 
 #include <bfl.h>
 #include <analyse.h>
+#include <stats.h>
+#include <summary_cache.h>
 #include <llvm.h>
 #include <output.h>
 
@@ -0,0 +1,39 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+/* Also called from the LLVM export threads */
+#ifdef __cplusplus
+extern "C" int stats_open(struct self_s *self);
+extern "C" int stats_begin(struct self_s *self, const char *phase, int function);
+extern "C" int stats_end(struct self_s *self, int record);
+extern "C" int stats_write_json(struct self_s *self, const char *path);
+extern "C" int stats_write_trace(struct self_s *self, const char *path);
+extern "C" int stats_close(struct self_s *self);
+#else
+extern int stats_open(struct self_s *self);
+extern int stats_begin(struct self_s *self, const char *phase, int function);
+extern int stats_end(struct self_s *self, int record);
+extern int stats_write_json(struct self_s *self, const char *path);
+extern int stats_write_trace(struct self_s *self, const char *path);
+extern int stats_close(struct self_s *self);
+#endif
+
+#endif /* STATS_H */
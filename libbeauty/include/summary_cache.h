@@ -0,0 +1,43 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef SUMMARY_CACHE_H
+#define SUMMARY_CACHE_H
+
+#define SUMMARY_CACHE_FNV_BASIS 0xcbf29ce484222325ULL
+#define SUMMARY_CACHE_FNV_PRIME 0x100000001b3ULL
+
+/* The text calls are also made from the LLVM export threads */
+#ifdef __cplusplus
+extern "C" int summary_cache_text(struct self_s *self, int function, int text, const char **data, size_t *size);
+extern "C" int summary_cache_set_text(struct self_s *self, int function, int text, const char *data, size_t size);
+#else
+extern uint64_t summary_cache_hash(uint64_t hash, const void *data, size_t size);
+extern uint64_t summary_cache_hash_relocs(uint64_t hash, struct reloc_table_s *reloc_table, int reloc_table_size);
+extern int summary_cache_open(struct self_s *self, const char *path, int llvm);
+extern int summary_cache_keys(struct self_s *self, uint64_t base, uint8_t *code, size_t code_size,
+	struct reloc_table_s *reloc_table, int reloc_table_size);
+extern int summary_cache_select(struct self_s *self);
+extern int summary_cache_summaries(struct self_s *self);
+extern int summary_cache_text(struct self_s *self, int function, int text, const char **data, size_t *size);
+extern int summary_cache_set_text(struct self_s *self, int function, int text, const char *data, size_t size);
+extern int summary_cache_add(struct self_s *self, int function);
+extern int summary_cache_close(struct self_s *self);
+#endif
+
+#endif /* SUMMARY_CACHE_H */
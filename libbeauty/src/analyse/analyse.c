@@ -103,12 +103,17 @@ int find_node_from_inst(struct self_s *self, struct control_flow_node_s *nodes,
 {
 	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
 	struct inst_log_entry_s *inst_log1;
+	struct inst_log_hot_s *hot = self->inst_log_hot;
 	int found = 0;
 
+	/* build_control_flow_nodes() sets node_member on every instruction of a node */
+	if (hot && (inst > 0) && (inst < hot->size) && hot->node_member[inst]) {
+		return hot->node_member[inst];
+	}
 	do {
 		inst_log1 = &inst_log_entry[inst];
-		if (inst_log1->node_start) {
-			found = inst_log1->node_member;
+		if (INST_LOG_NODE_START(self, inst)) {
+			found = INST_LOG_NODE_MEMBER(self, inst);
 			break;
 		}
 		if (0 == inst_log1->prev_size) {
@@ -191,186 +196,382 @@ int path_loop_check(struct path_s *paths, int path, int step, int node, int limi
 }
 
 
-int merge_path_into_loop(struct path_s *paths, struct loop_s *loop, int path)
-{
-	int step;
-	int tmp;
-	int found;
-	int n;
-	int *list = loop->list;
-
-	debug_print(DEBUG_ANALYSE, 1, "trying to merge path %d into loop\n", path);
-
-	loop->head = paths[path].loop_head;
-	step = paths[path].path_size - 1; /* convert size to index */
-	if (paths[path].path[step] != loop->head) {
-		debug_print(DEBUG_ANALYSE, 1, "merge_path failed path 0x%x != head 0x%x\n", paths[path].path[step], loop->head);
-		exit(1);
-	}
-	while (1) {
-		step--;
-		if (step < 0) {
-			/* If path_prev == path, we have reached the beginning of the path list */
-			if (paths[path].path_prev != path) {
-				tmp = paths[path].path_prev;
-				step = paths[path].path_prev_index;
-				path = tmp;
-			} else {
-				debug_print(DEBUG_ANALYSE, 1, "No loop\n");
-				return 0;
-			}
-		}
-		found = 0;
-		for (n = 0; n  < loop->size; n++) {
-			if (list[n] == paths[path].path[step]) {
-				found = 1;
-				break;	
-			}
-		}
-		if (!found) {
-			debug_print(DEBUG_ANALYSE, 1, "Merge: adding 0x%x\n",  paths[path].path[step]);
-			tmp = paths[path].path[step];
-			list[loop->size] = tmp;
-			loop->size++;
-		}
+struct loop_forest_list_s {
+	int size;
+	int max;
+	int *list;
+};
 
-		if (paths[path].path[step] == loop->head) {
-			debug_print(DEBUG_ANALYSE, 1, "Start of merge Loop found\n");
-			break;
+static void loop_forest_list_add(struct loop_forest_list_s *list, int value)
+{
+	if (list->size >= list->max) {
+		list->max = list->max ? list->max * 2 : 4;
+		list->list = realloc(list->list, list->max * sizeof(int));
+		if (!list->list) {
+			debug_print(DEBUG_ANALYSE, 1, "loop_forest_list_add: realloc failed\n");
+			exit(1);
 		}
 	}
-	debug_print(DEBUG_ANALYSE, 1, "merged head = 0x%x, size = 0x%x\n", loop->head, loop->size);
-	return 0;
+	list->list[list->size] = value;
+	list->size++;
 }
 
+static int loop_forest_find(int *union_find, int n)
+{
+	int root = n;
+	int tmp;
 
-/* This is used to merge all the nodes of a loop with a particular loop_head */
-/* It is then used to detect which node prev/next links exit the loop */
-/* Work then then be done to scan the loops, and if only one loop_head exists in the loop, it is a single loop. */
-/* If more than one loop_head exists in the loop, then it is a nested loop, or a disjointed loop */
+	while (union_find[root] != root) {
+		root = union_find[root];
+	}
+	/* Path compression */
+	while (union_find[n] != root) {
+		tmp = union_find[n];
+		union_find[n] = root;
+		n = tmp;
+	}
+	return root;
+}
 
-int build_control_flow_loops(struct self_s *self, struct path_s *paths, int *paths_size, struct loop_s *loops, int *loop_size)
+/* Build the loop nesting forest of a function, using Havlak's algorithm.
+ * This is near linear in the size of the CFG, and also finds the irreducible
+ * loops, the ones with more than one entry.
+ * The CFG is walked depth first from node 1, and everything below works
+ * on the pre-order numbers of that walk. A node "v" is a descendant of "w"
+ * if number[w] <= number[v] <= last[number[w]].
+ * The loops[] table is allocated here, and is in pre-order of the loop tree,
+ * so the loops nested in loops[m] are loops[m + 1] to loops[loops[m].last].
+ * Each node gets:
+ *   loop: The innermost loop it is in, as loops[] index + 1. 0 = none.
+ *   loop_last: Only on a loop head, loops[].last + 1 of its loop.
+ *   member_of_loop: The heads of all the loops it is in, outermost first.
+ * so is_member_of_loop() is an interval check on loop and loop_last.
+ */
+int build_control_flow_loop_forest(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct loop_s **loops_out, int *loops_size_out)
 {
-	int n;
-	int m;
-	int found;
-	struct loop_s *loop;
+	int *number;
+	int *node_of;
+	int *last;
+	int *stack_node;
+	int *stack_link;
+	int *union_find;
+	int *mark;
+	int *innermost;
+	int *loop_of_head;
+	struct loop_forest_list_s *back_preds;
+	struct loop_forest_list_s *non_back_preds;
+	struct loop_forest_list_s pool = {0, 0, NULL};
+	int *tmp_head;
+	int *tmp_parent;
+	int *tmp_irreducible;
+	int *first_child;
+	int *next_sibling;
+	int *order;
+	int roots;
+	struct loop_s *loops;
+	int loops_size = 0;
+	int count = 0;
+	int sp;
+	int node;
+	int next;
+	int n, m, l;
+	int v, w, x, y;
+	int is_loop;
+	int irreducible;
 	int tmp;
 
-	/* Build loops table */
-	for (n = 0; n < *paths_size; n++) {
-		if (paths[n].loop_head != 0) {
-			found = -1;
-			for(m = 0; m < *loop_size; m++) {
-				if (loops[m].head == paths[n].loop_head) {
-					found = m;
-					debug_print(DEBUG_ANALYSE, 1, "flow_loops found = %d\n", found);
-					break;
+	number = calloc(nodes_size, sizeof(int));
+	node_of = calloc(nodes_size + 1, sizeof(int));
+	last = calloc(nodes_size + 1, sizeof(int));
+	stack_node = calloc(nodes_size + 1, sizeof(int));
+	stack_link = calloc(nodes_size + 1, sizeof(int));
+	if (!number || !node_of || !last || !stack_node || !stack_link) {
+		debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loop_forest: calloc failed\n");
+		exit(1);
+	}
+	for (n = 1; n < nodes_size; n++) {
+		nodes[n].loop = 0;
+		nodes[n].loop_last = 0;
+		free(nodes[n].member_of_loop);
+		nodes[n].member_of_loop = NULL;
+		nodes[n].member_of_loop_size = 0;
+	}
+
+	/* Depth first walk, numbering the nodes in pre-order */
+	if ((nodes_size > 1) && nodes[1].valid) {
+		count++;
+		number[1] = count;
+		node_of[count] = 1;
+		stack_node[0] = 1;
+		stack_link[0] = 0;
+		sp = 1;
+		while (sp > 0) {
+			node = stack_node[sp - 1];
+			if (stack_link[sp - 1] < nodes[node].next_size) {
+				next = nodes[node].link_next[stack_link[sp - 1]].node;
+				stack_link[sp - 1]++;
+				if ((next > 0) && (next < nodes_size) &&
+					nodes[next].valid && !number[next]) {
+					count++;
+					number[next] = count;
+					node_of[count] = next;
+					stack_node[sp] = next;
+					stack_link[sp] = 0;
+					sp++;
 				}
+			} else {
+				last[number[node]] = count;
+				sp--;
+			}
+		}
+	}
+	free(stack_node);
+	free(stack_link);
+
+	union_find = calloc(count + 1, sizeof(int));
+	mark = calloc(count + 1, sizeof(int));
+	innermost = calloc(count + 1, sizeof(int));
+	loop_of_head = calloc(count + 1, sizeof(int));
+	back_preds = calloc(count + 1, sizeof(struct loop_forest_list_s));
+	non_back_preds = calloc(count + 1, sizeof(struct loop_forest_list_s));
+	tmp_head = calloc(count + 1, sizeof(int));
+	tmp_parent = calloc(count + 1, sizeof(int));
+	tmp_irreducible = calloc(count + 1, sizeof(int));
+	if (!union_find || !mark || !innermost || !loop_of_head ||
+		!back_preds || !non_back_preds ||
+		!tmp_head || !tmp_parent || !tmp_irreducible) {
+		debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loop_forest: calloc failed\n");
+		exit(1);
+	}
+
+	/* Split the predecessors into back edges, and the rest */
+	for (w = 1; w <= count; w++) {
+		union_find[w] = w;
+		innermost[w] = -1;
+		loop_of_head[w] = -1;
+		node = node_of[w];
+		for (n = 0; n < nodes[node].prev_size; n++) {
+			tmp = nodes[node].prev_node[n];
+			if ((tmp <= 0) || (tmp >= nodes_size)) {
+				continue;
+			}
+			v = number[tmp];
+			if (!v) {
+				/* Not reachable from the entry node */
+				continue;
 			}
-			if (found == -1) {
-				for(m = 0; m < *loop_size; m++) {
-					if (loops[m].head == 0) {
-						found = m;
-						debug_print(DEBUG_ANALYSE, 1, "flow_loops2 found = %d\n", found);
+			if ((w <= v) && (v <= last[w])) {
+				for (m = 0; m < back_preds[w].size; m++) {
+					if (back_preds[w].list[m] == v) {
 						break;
 					}
 				}
+				if (m == back_preds[w].size) {
+					loop_forest_list_add(&back_preds[w], v);
+				}
+			} else {
+				loop_forest_list_add(&non_back_preds[w], v);
 			}
-			if (found == -1) {
-				debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loops problem\n");
-				exit(1);
-			}
-			if (found >= *loop_size) {
-				debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loops problem2\n");
-				exit(1);
-			}
-			loop = &loops[found];
-			merge_path_into_loop(paths, loop, n);
 		}
 	}
-	/* Add nesting information to loops */
-	for (n = 0; n < *paths_size; n++) {
-		if (paths[n].loop_head != 0) {
-			found = -1;
-			for(m = 0; m < *loop_size; m++) {
-				if (loops[m].head == paths[n].loop_head) {
-					found = m;
-					debug_print(DEBUG_ANALYSE, 1, "flow_loops2 found = %d\n", found);
-					break;
-				}
+
+	/* Innermost loops first. Each loop found is collapsed into its head */
+	for (w = count; w >= 1; w--) {
+		pool.size = 0;
+		is_loop = 0;
+		irreducible = 0;
+		for (n = 0; n < back_preds[w].size; n++) {
+			v = back_preds[w].list[n];
+			if (v == w) {
+				/* Self loop */
+				is_loop = 1;
+				continue;
 			}
-			if (found == -1) {
-				debug_print(DEBUG_ANALYSE, 1, "loop nesting failed\n");
-				return 1;
+			x = loop_forest_find(union_find, v);
+			if (mark[x] != w) {
+				mark[x] = w;
+				loop_forest_list_add(&pool, x);
+			}
+		}
+		/* The pool is also the work list */
+		for (n = 0; n < pool.size; n++) {
+			x = pool.list[n];
+			for (m = 0; m < non_back_preds[x].size; m++) {
+				y = loop_forest_find(union_find, non_back_preds[x].list[m]);
+				if ((y < w) || (y > last[w])) {
+					/* Entered from outside, not through w */
+					irreducible = 1;
+					loop_forest_list_add(&non_back_preds[w], y);
+				} else if ((y != w) && (mark[y] != w)) {
+					mark[y] = w;
+					loop_forest_list_add(&pool, y);
+				}
 			}
-			tmp = paths[n].path_prev;
-			if (paths[tmp].loop_head != 0) {
-				debug_print(DEBUG_ANALYSE, 1, "flow_loops2 path %d nesting %d in %d:%d\n", n, m, tmp, paths[tmp].loop_head);
-				loops[m].nest = paths[tmp].loop_head;
+		}
+		if (!pool.size && !is_loop) {
+			continue;
+		}
+		tmp_head[loops_size] = w;
+		tmp_parent[loops_size] = -1;
+		tmp_irreducible[loops_size] = irreducible;
+		loop_of_head[w] = loops_size;
+		innermost[w] = loops_size;
+		for (n = 0; n < pool.size; n++) {
+			x = pool.list[n];
+			union_find[x] = w;
+			if (loop_of_head[x] >= 0) {
+				tmp_parent[loop_of_head[x]] = loops_size;
+			} else {
+				innermost[x] = loops_size;
 			}
 		}
+		loops_size++;
+	}
+
+	/* Put the loops in pre-order of the loop tree.
+	 * The loops were found in decreasing head number, so pushing each one
+	 * onto the front of its parent's list leaves the lists in increasing head number.
+	 */
+	first_child = calloc(loops_size + 1, sizeof(int));
+	next_sibling = calloc(loops_size + 1, sizeof(int));
+	order = calloc(loops_size + 1, sizeof(int));
+	stack_node = calloc(loops_size + 1, sizeof(int));
+	loops = calloc(loops_size + 1, sizeof(struct loop_s));
+	if (!first_child || !next_sibling || !order || !stack_node || !loops) {
+		debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loop_forest: calloc failed\n");
+		exit(1);
 	}
-#if 0
-	for(m = 0; m < *loop_size; m++) {
-		if (loops[m].size) {
-			debug_print(DEBUG_ANALYSE, 1, "flow_loops2 loop:%d head=%d nest=%d size=%d\n", m, loops[m].head, loops[m].nest, loops[m].size);
+	roots = -1;
+	for (n = 0; n < loops_size; n++) {
+		first_child[n] = -1;
+	}
+	for (n = 0; n < loops_size; n++) {
+		if (tmp_parent[n] >= 0) {
+			next_sibling[n] = first_child[tmp_parent[n]];
+			first_child[tmp_parent[n]] = n;
+		} else {
+			next_sibling[n] = roots;
+			roots = n;
 		}
 	}
-#endif
-	return 0;
-}
-
-int build_control_flow_loops_multi_exit(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct loop_s *loops, int loops_size)
-{
-	int l;
-	int n;
-	int m;
-	int multi_exit;
-	int node;
-	/* Detect multi_exit loops */
-	for (m = 0; m < loops_size; m++) {
-		multi_exit = 0;
-		if (loops[m].size > 0) {
-			for (n = 0; n < loops[m].size; n++) {
-				node = loops[m].list[n];
-				debug_print(DEBUG_ANALYSE, 1, "multi_exit: node=0x%x\n", node);
-				for (l = 0; l < nodes[node].next_size; l++) {
-					if (nodes[node].link_next[l].is_loop_exit) {
-						debug_print(DEBUG_ANALYSE, 1, "multi_exit: exit found\n");
-						multi_exit++;
-					}
-				}
+	m = 0;
+	for (l = roots; l >= 0; l = next_sibling[l]) {
+		sp = 0;
+		stack_node[sp++] = l;
+		while (sp > 0) {
+			n = stack_node[--sp];
+			order[n] = m;
+			m++;
+			/* Push the children in reverse, so the first is popped first */
+			tmp = 0;
+			for (x = first_child[n]; x >= 0; x = next_sibling[x]) {
+				tmp++;
+			}
+			sp += tmp;
+			y = sp - 1;
+			for (x = first_child[n]; x >= 0; x = next_sibling[x]) {
+				stack_node[y--] = x;
 			}
 		}
-		loops[m].multi_exit = multi_exit;
-		nodes[loops[m].head].multi_exit = multi_exit;
 	}
-	return 0;
-}
+	for (n = 0; n < loops_size; n++) {
+		l = order[n];
+		loops[l].head = node_of[tmp_head[n]];
+		loops[l].parent = (tmp_parent[n] >= 0) ? order[tmp_parent[n]] : -1;
+		loops[l].irreducible = tmp_irreducible[n];
+		loops[l].last = l;
+	}
+	for (l = 0; l < loops_size; l++) {
+		if (loops[l].parent >= 0) {
+			loops[l].depth = loops[loops[l].parent].depth + 1;
+			loops[l].nest = loops[loops[l].parent].head;
+		} else {
+			loops[l].depth = 1;
+			loops[l].nest = 0;
+		}
+	}
+	/* Children come after their parents */
+	for (l = loops_size - 1; l >= 0; l--) {
+		if ((loops[l].parent >= 0) &&
+			(loops[loops[l].parent].last < loops[l].last)) {
+			loops[loops[l].parent].last = loops[l].last;
+		}
+	}
 
-int build_control_flow_loops_node_members(struct self_s *self,
-	struct control_flow_node_s *nodes, int nodes_size,
-	struct loop_s *loops, int *loops_size)
-{
-	int n, m;
-	int node;
-	int head;
-	int size;
+	/* Loop bodies and node membership. Walking in node pre-order puts each head first in its list. */
+	for (w = 1; w <= count; w++) {
+		if (innermost[w] < 0) {
+			continue;
+		}
+		node = node_of[w];
+		l = order[innermost[w]];
+		nodes[node].loop = l + 1;
+		nodes[node].member_of_loop_size = loops[l].depth;
+		nodes[node].member_of_loop = calloc(loops[l].depth, sizeof(int));
+		for (; l >= 0; l = loops[l].parent) {
+			loops[l].size++;
+			nodes[node].member_of_loop[loops[l].depth - 1] = loops[l].head;
+		}
+	}
+	for (l = 0; l < loops_size; l++) {
+		loops[l].list = calloc(loops[l].size, sizeof(int));
+		loops[l].size = 0;
+		nodes[loops[l].head].loop_last = loops[l].last + 1;
+	}
+	for (w = 1; w <= count; w++) {
+		if (innermost[w] < 0) {
+			continue;
+		}
+		node = node_of[w];
+		for (l = order[innermost[w]]; l >= 0; l = loops[l].parent) {
+			loops[l].list[loops[l].size] = node;
+			loops[l].size++;
+		}
+	}
 
-	for (m = 0; m < *loops_size; m++) {
-		if (loops[m].size > 0) {
-			for (n = 0; n < loops[m].size; n++) {
-				node = loops[m].list[n];
-				head = loops[m].head;
-				size = nodes[node].member_of_loop_size;
-				size++;
-				nodes[node].member_of_loop = realloc(nodes[node].member_of_loop, size * sizeof(int));
-				nodes[node].member_of_loop[size - 1] = head;
-				nodes[node].member_of_loop_size = size;
+	/* Count the edges that leave each loop */
+	for (l = 0; l < loops_size; l++) {
+		tmp = 0;
+		for (n = 0; n < loops[l].size; n++) {
+			node = loops[l].list[n];
+			for (m = 0; m < nodes[node].next_size; m++) {
+				next = nodes[node].link_next[m].node;
+				if ((next <= 0) || (next >= nodes_size) ||
+					(nodes[next].loop < l + 1) ||
+					(nodes[next].loop > loops[l].last + 1)) {
+					tmp++;
+				}
 			}
 		}
+		loops[l].multi_exit = tmp;
+		nodes[loops[l].head].multi_exit = tmp;
+	}
+
+	for (w = 1; w <= count; w++) {
+		free(back_preds[w].list);
+		free(non_back_preds[w].list);
 	}
+	free(pool.list);
+	free(back_preds);
+	free(non_back_preds);
+	free(number);
+	free(node_of);
+	free(last);
+	free(union_find);
+	free(mark);
+	free(innermost);
+	free(loop_of_head);
+	free(tmp_head);
+	free(tmp_parent);
+	free(tmp_irreducible);
+	free(first_child);
+	free(next_sibling);
+	free(order);
+	free(stack_node);
+
+	*loops_out = loops;
+	*loops_size_out = loops_size;
+	debug_print(DEBUG_ANALYSE, 1, "build_control_flow_loop_forest: nodes = 0x%x, loops = 0x%x\n", count, loops_size);
 	return 0;
 }
 
@@ -381,7 +582,8 @@ int print_control_flow_loops(struct self_s *self, struct loop_s *loops, int *loo
 	debug_print(DEBUG_ANALYSE, 1, "Printing loops size = %d\n", *loops_size);
 	for (m = 0; m < *loops_size; m++) {
 		if (loops[m].size > 0) {
-			debug_print(DEBUG_ANALYSE, 1, "Loop %d: loop_head=%d, nest=%d, multi_exit=%d\n", m, loops[m].head, loops[m].nest, loops[m].multi_exit);
+			debug_print(DEBUG_ANALYSE, 1, "Loop %d: loop_head=%d, nest=%d, depth=%d, last=%d, irreducible=%d, multi_exit=%d\n",
+				m, loops[m].head, loops[m].nest, loops[m].depth, loops[m].last, loops[m].irreducible, loops[m].multi_exit);
 			for (n = 0; n < loops[m].size; n++) {
 				debug_print(DEBUG_ANALYSE, 1, "Loop %d=0x%x\n", m, loops[m].list[n]);
 			}
@@ -480,48 +682,6 @@ is_subset_exit:
 	return result;
 }
 
-int build_node_dominance(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
-{
-	int n,m;
-	int node_b = 1;
-	int tmp;
-	//int type;
-
-	for(n = 1; n < nodes_size; n++) {
-		node_b = n;
-		while (node_b != 0) {
-			tmp = 0;
-			/* avoid following loop edge ones */
-			for (m = 0; m < nodes[node_b].prev_size; m++) {
-				int prev_node;
-				int prev_link_index;
-
-				prev_node = nodes[node_b].prev_node[m];
-				if (!prev_node) {
-					continue;
-				}
-				prev_link_index = nodes[node_b].prev_link_index[m];
-				//debug_print(DEBUG_ANALYSE, 1, "dom: prev_node = 0x%x, prev_link_index = 0x%x\n", prev_node, prev_link_index);
-				if (!(nodes[prev_node].link_next[prev_link_index].is_loop_edge)) {
-					tmp = prev_node;
-					break;
-				}
-			}
-			node_b = tmp;
-			if (0 == node_b) {
-				break;
-			}
-			tmp = is_subset(nodes[n].path_size, nodes[n].path, nodes[node_b].path_size, nodes[node_b].path);
-			//debug_print(DEBUG_ANALYSE, 1, "node_dominance: %d = 0x%x, 0x%x\n", tmp, n, node_b);
-			if (tmp) {
-				nodes[n].dominator = node_b;
-				break;
-			}
-		}
-	}
-	return 0;
-}
-
 int build_node_type(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
 {
 	int n;
@@ -572,331 +732,6 @@ build_node_type_found:
 	return 0;
 }
 
-/* find the position of a node in a base path */
-/* negative results imply that the node is found in a parent path */
-/* returns the "index" */
-int find_node_in_path(struct self_s *self, struct path_s *paths, int paths_size, int base_path, int node, int *index)
-{
-	int position;
-	int path;
-	int step;
-	int found = 0;
-	int tmp;
-
-	step = paths[base_path].path_size; /* convert size to index */
-	position = step;
-	path = base_path;
-	while (1) {
-		step--;
-		position--;
-		if (step < 0) {
-			/* If path_prev == path, we have reached the beginning of the path list */
-			if (paths[path].path_prev != path) {
-				tmp = paths[path].path_prev;
-				step = paths[path].path_prev_index;
-				path = tmp;
-			} else {
-				found = 0;
-				break;
-			}
-		}
-		if (node == paths[path].path[step]) {
-			found = 1;
-			break;	
-		}
-	}
-	if (found) {
-		debug_print(DEBUG_ANALYSE, 1, "found node_in_path base_path = 0x%X, node = 0x%x, path = 0x%x step = 0x%x, position = 0x%x\n",
-			base_path, node, path, step, position);
-		*index = position;
-		return 0;
-	} else {
-		debug_print(DEBUG_ANALYSE, 1, "not found node_in_path\n");
-		return 1;
-	}
-}
-
-/* Returns the "node" */
-int find_node_at_index_in_path(struct self_s *self, struct path_s *paths, int paths_size, int base_path, int index, int *node)
-{
-	int position;
-	int path;
-	int step;
-	int found = 0;
-	int tmp;
-
-	step = paths[base_path].path_size; /* convert size to index */
-	position = step;
-	path = base_path;
-	/* FIXME: This can be optimised */
-	while (1) {
-		step--;
-		position--;
-		if (step < 0) {
-			/* If path_prev == path, we have reached the beginning of the path list */
-			if (paths[path].path_prev != path) {
-				tmp = paths[path].path_prev;
-				step = paths[path].path_prev_index;
-				path = tmp;
-			} else {
-				found = 0;
-				break;
-			}
-		}
-		if (position == index) {
-			found = 1;
-			break;	
-		}
-	}
-	if (found) {
-		*node = paths[path].path[step];
-		debug_print(DEBUG_ANALYSE, 1, "found node_at_index base_path = 0x%X, node = 0x%x, path = 0x%x step = 0x%x, position = 0x%x\n",
-			base_path, *node, path, step, position);
-		return 0;
-	} else {
-		debug_print(DEBUG_ANALYSE, 1, "not found node_at_index\n");
-		return 1;
-	}
-	return 0;
-}
-
-int build_node_if_tail(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
-{
-	int n,m;
-	int node_b = 1;
-	int tmp;
-	int count = 0;
-	// int m;
-	int subset_method = 0;
-	int type = 0;
-	int branch_follow_exit = 0;
-	int follow_path = 0;
-	int start_node;
-	struct path_s *paths;
-	int paths_size;
-	int loops_size;
-	struct loop_s *loops;
-
-	for(n = 1; n < nodes_size; n++) {
-		start_node = n;
-		if (!nodes[start_node].valid) {
-			continue;
-		}
-		type = nodes[n].type;
-		//debug_print(DEBUG_ANALYSE, 1, "%s: start_node = 0x%x, nodes[start_node].entry_point = 0x%x\n", __FUNCTION__, start_node, nodes[start_node].entry_point);
-		paths_size = self->external_entry_points[nodes[start_node].entry_point - 1].paths_size;
-		paths = self->external_entry_points[nodes[start_node].entry_point - 1].paths;
-		loops_size = self->external_entry_points[nodes[start_node].entry_point - 1].loops_size;
-		loops = self->external_entry_points[nodes[start_node].entry_point - 1].loops;
-		/* Check that it is a branch statement */
-		if (2 > nodes[n].next_size) {
-			continue;
-		}
-		debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: start_node = 0x%x, type = 0x%x\n", start_node, nodes[start_node].type);
-		switch (nodes[n].type) {
-		case NODE_TYPE_IF_THEN_ELSE:
-			/* A normal IF statement */
-			if (nodes[n].path_size >= 2) {
-				subset_method = 0; /* paths */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			} else {
-				subset_method = 1; /* loops */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			}
-			break;
-		case NODE_TYPE_JMPT:
-			/* A normal IF statement */
-			if (nodes[n].path_size >= 2) {
-				subset_method = 0; /* paths */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			} else {
-				subset_method = 1; /* loops */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			}
-			break;
-		case NODE_TYPE_IF_THEN_GOTO:
-			/* Control flow within a loop */
-			subset_method = 0; /* paths */
-			branch_follow_exit = 1;  /* 0 = non-exit link, 1 = exit_links */
-			follow_path = 0;
-			break;
-		case NODE_TYPE_LOOP:
-			/* A loop_head statement */
-			if (nodes[n].multi_exit > 1) {
-				subset_method = 0; /* paths */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			} else {
-				subset_method = 0; /* paths */
-				branch_follow_exit = 1;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 0;
-			}
-			break;
-		case NODE_TYPE_LOOP_THEN_ELSE:
-			/* Loop head with both links of type is_normal */
-			if (nodes[n].multi_exit > 1) {
-				subset_method = 0; /* paths */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 1;
-			} else {
-				subset_method = 1; /* loops */
-				branch_follow_exit = 0;  /* 0 = non-exit link, 1 = exit_links */
-				follow_path = 0;
-			}
-			break;
-		default:
-			debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail node type 0x%x unknown\n", nodes[n].type);
-			exit(1);
-		}
-
-		debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: subset_method = 0x%x, branch_follow_exit = 0x%x, follow_path = 0x%x\n",
-			subset_method, branch_follow_exit, follow_path);
-		node_b = n;
-		while ((node_b != 0) ) {
-			struct node_link_s *link;
-			struct node_link_s *link_exit;
-
-			tmp = 0;
-			if (follow_path && !subset_method) {
-				int path;
-				int index;
-				int next_node;
-
-				if (nodes[start_node].path_size >= 2) {
-					path = nodes[start_node].path[0];
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "Folling path 0x%x, size 0x%x, looking for node 0x%x\n", path, paths[path].path_size, node_b);
-					tmp = find_node_in_path(self, paths, paths_size, path, node_b, &index);
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "find_node_in_path=%d, index=%d\n", tmp, index);
-					tmp = find_node_at_index_in_path(self, paths, paths_size, path, index + 1, &next_node);
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "find_node_in_path next_node = 0x%x\n", next_node);
-					if (!tmp) {
-						tmp = next_node;
-					} else {
-						tmp = 0;
-					}
-				} else if (nodes[start_node].path_size == 1) {
-					path = nodes[start_node].path[0];
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "Folling path 0x%x, size 0x%x, looking for node 0x%x\n", path, paths[path].path_size, node_b);
-					tmp = find_node_in_path(self, paths, paths_size, path, node_b, &index);
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "find_node_in_path=%d, index=%d\n", tmp, index);
-					tmp = find_node_at_index_in_path(self, paths, paths_size, path, index + 1, &next_node);
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "find_node_in_path next_node = 0x%x\n", next_node);
-					if (!tmp) {
-						tmp = next_node;
-					} else {
-						tmp = 0;
-					}
-				} else {
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "follow path failed1 path_size = 0x%x\n", nodes[start_node].path_size);
-					exit(1);
-				}
-			} else if (follow_path && subset_method) {
-				int path;
-
-				debug_print(DEBUG_ANALYSE_PATHS, 1, "follow if...then...else in loop. looped_path_size = 0x%x\n",
-					nodes[start_node].looped_path_size);
-				if (nodes[start_node].looped_path_size >= 2) {
-					path = nodes[start_node].looped_path[0];
-					for (m = 0; m < paths[path].path_size; m++) {
-						debug_print(DEBUG_ANALYSE_PATHS, 1, "node_b = 0x%x, looped_path = 0x%x, m = 0x%x\n",
-							node_b, path, m);
-						if (paths[path].path[m] == node_b) {
-							if ((m + 1) < paths[path].path_size) {
-								tmp = paths[path].path[m + 1];
-								debug_print(DEBUG_ANALYSE_PATHS, 1, "follow path next = 0x%x\n", tmp);
-								break;
-							} else {
-								debug_print(DEBUG_ANALYSE_PATHS, 1, "follow path failed2/n");
-								exit(1);
-							}
-						}
-					}
-				} else {
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "follow path failed3 path_size = 0x%x\n", nodes[start_node].path_size);
-					exit(1);
-				}
-			} else {
-				if (nodes[node_b].next_size == 0) {
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: end of function()\n");
-					break;
-				} else if (nodes[node_b].next_size == 1) {
-					link = &(nodes[node_b].link_next[0]);
-					if (link->is_loop_edge) {
-						debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: not following loop edge\n");
-						break;
-					}
-				} else if (nodes[node_b].next_size == 2) {
-				/* FIXME: preferred is only valid the first time round the loop */
-				/* FIXME: what to do if the node is a loop edge and no other links */
-					link_exit = NULL;
-					if (nodes[node_b].link_next[0].is_loop_exit == 1) {
-						link_exit = &(nodes[node_b].link_next[0]);
-					} else if (nodes[node_b].link_next[1].is_loop_exit == 1) {
-						link_exit = &(nodes[node_b].link_next[1]);
-					} if ((nodes[node_b].link_next[0].is_loop_exit == 1) &&
-						(nodes[node_b].link_next[1].is_loop_exit == 1)) {
-						break;
-					}
-
-					link = NULL;
-					if (nodes[node_b].link_next[0].is_normal == 1) {
-						link = &(nodes[node_b].link_next[0]);
-					} else if (nodes[node_b].link_next[1].is_normal == 1) {
-						link = &(nodes[node_b].link_next[1]);
-					}
-					if (link) debug_print(DEBUG_ANALYSE_PATHS, 1, "link node = 0x%x\n", link->node);
-					if (link_exit) debug_print(DEBUG_ANALYSE_PATHS, 1, "link_exit node = 0x%x\n", link_exit->node);
-					if (branch_follow_exit) {
-						link = link_exit;
-					}
-					if (!link) {
-						debug_print(DEBUG_ANALYSE_PATHS, 1, "node_if_tail: empty link\n");
-						break;
-					}
-					/* Do not follow loop edges */
-					if (link->is_loop_edge) {
-						break;
-					}
-					debug_print(DEBUG_ANALYSE_PATHS, 1, "node = 0x%x, is_norm = %d, is_loop_edge = %d, is_loop_exit = %d, is_loop_entry = %d\n",
-						node_b, link->is_normal, link->is_loop_edge, link->is_loop_exit, link->is_loop_entry);
-					tmp = link->node;
-				}
-			}
-			debug_print(DEBUG_ANALYSE_PATHS, 1, "next node=0x%x\n", tmp);
-
-			node_b = tmp;
-			if (0 == node_b) {
-				break;
-			}
-			if (subset_method == 0) {
-				tmp = is_subset(nodes[start_node].path_size, nodes[start_node].path, nodes[node_b].path_size, nodes[node_b].path);
-			} else {
-				tmp = is_subset(nodes[start_node].looped_path_size, nodes[start_node].looped_path, nodes[node_b].looped_path_size, nodes[node_b].looped_path);
-			}
-			debug_print(DEBUG_ANALYSE_PATHS, 1, "node_if_tail: %d = 0x%x, 0x%x\n", tmp, start_node, node_b);
-			count++;
-			if (count > 1000) {
-				debug_print(DEBUG_ANALYSE_PATHS, 1, "node_if_tail: failed, too many if_tails\n");
-				debug_print(DEBUG_ANALYSE_PATHS, 1, "Start node: 0x%x is_norm = %d, is_loop_edge = %d is_loop_exit = %d is_loop_entry = %d\n",
-					n, link->is_normal, link->is_loop_edge, link->is_loop_exit, link->is_loop_entry);
-				exit(1);
-			}
-			if (tmp) {
-				nodes[n].if_tail = node_b;
-				break;
-			}
-		}
-		debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail:function end\n");
-	}
-	debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail:end\n");
-	return 0;
-}
-
-
 int build_node_paths(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct path_s *paths, int *paths_size, int entry_point)
 
 {
@@ -1097,6 +932,7 @@ int build_control_flow_nodes(struct self_s *self, struct control_flow_node_s *no
 {
 	struct inst_log_entry_s *inst_log1;
 	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_hot_s *hot;
 	int node = 1;
 	int inst_start = 1;
 	int inst_end;
@@ -1106,47 +942,53 @@ int build_control_flow_nodes(struct self_s *self, struct control_flow_node_s *no
 	int tmp;
 
 	debug_print(DEBUG_ANALYSE, 1, "build_control_flow_nodes:\n");	
+	if (!self->inst_log_hot) {
+		inst_log_hot_build(self);
+	}
+	hot = self->inst_log_hot;
 	//inst_log_entry[inst_start].node_start = 1;
 	debug_print(DEBUG_ANALYSE, 1, "f_node_start = inst 0x%x\n", inst_start);	
 	/* Start by scanning all the inst_log for node_start and node_end. */
+	/* The scans use the dense hot table, which holds the node fields. */
 	for (n = 1; n < inst_log; n++) {
-		inst_log1 = &inst_log_entry[n];
-		debug_print(DEBUG_ANALYSE, 1, "inst 0x%x prev_size = %d, next_size = %d\n", n, inst_log1->prev_size, inst_log1->next_size);	
-		if (inst_log1->prev_size > 0) {
-			debug_print(DEBUG_ANALYSE, 1, "inst 0x%x prev = 0x%x\n", n, inst_log1->prev[0]);
+		debug_print(DEBUG_ANALYSE, 1, "inst 0x%x prev_size = %d, next_size = %d\n", n, hot->prev_size[n], hot->next_size[n]);	
+		if (hot->prev_size[n] > 0) {
+			debug_print(DEBUG_ANALYSE, 1, "inst 0x%x prev = 0x%x\n", n, hot->prev[n]);
 		}
-		if (inst_log1->next_size > 0) {
-			debug_print(DEBUG_ANALYSE, 1, "inst 0x%x next = 0x%x\n", n, inst_log1->next[0]);
+		if (hot->next_size[n] > 0) {
+			debug_print(DEBUG_ANALYSE, 1, "inst 0x%x next = 0x%x\n", n, hot->next[n]);
 		}
 
 		/* Test for end of node */
-		if ((inst_log1->next_size > 1) ||
-			(inst_log1->next_size == 0)) {
+		if ((hot->next_size[n] > 1) ||
+			(hot->next_size[n] == 0)) {
+			inst_log1 = &inst_log_entry[n];
 			inst_end = n;
-			inst_log_entry[inst_end].node_end = 1;
+			hot->node_end[inst_end] = 1;
 			debug_print(DEBUG_ANALYSE, 1, "n_node_end = inst 0x%x\n", inst_end);	
 			/* Handle special case of duplicate prev_inst */
 			/* FIXME: Stop duplicate prev_inst being created in the first place */
 			for (m = 0; m < inst_log1->next_size; m++) {
 				/* Mark all the node_starts */
 				inst_start = inst_log_entry[inst_end].next[m];
-				inst_log_entry[inst_start].node_start = 1;
+				hot->node_start[inst_start] = 1;
 				debug_print(DEBUG_ANALYSE, 1, "n_node_start = inst 0x%x\n", inst_start);	
 			}
 		}
-		if ((inst_log1->prev_size > 1) ||
-			(inst_log1->prev_size == 0)) {
+		if ((hot->prev_size[n] > 1) ||
+			(hot->prev_size[n] == 0)) {
+			inst_log1 = &inst_log_entry[n];
 			inst_start = n;
-			inst_log_entry[inst_start].node_start = 1;
+			hot->node_start[inst_start] = 1;
 			debug_print(DEBUG_ANALYSE, 1, "p_node_start = inst 0x%x\n", inst_start);	
 			for (m = 0; m < inst_log1->prev_size; m++) {
 				/* Mark all the node_starts */
 				inst_end = inst_log_entry[inst_start].prev[m];
-				inst_log_entry[inst_end].node_end = 1;
+				hot->node_end[inst_end] = 1;
 				debug_print(DEBUG_ANALYSE, 1, "p_node_end = inst 0x%x\n", inst_end);	
-				if (inst_log_entry[inst_end].next_size == 1) {
-					inst_log_entry[inst_log_entry[inst_end].next[0]].node_start = 1;
-					debug_print(DEBUG_ANALYSE, 1, "p_node_start2 = inst 0x%x\n", inst_log_entry[inst_end].next[0]);	
+				if (hot->next_size[inst_end] == 1) {
+					hot->node_start[hot->next[inst_end]] = 1;
+					debug_print(DEBUG_ANALYSE, 1, "p_node_start2 = inst 0x%x\n", hot->next[inst_end]);	
 				}
 			}
 			/* Handle special case of duplicate prev_inst */
@@ -1154,29 +996,24 @@ int build_control_flow_nodes(struct self_s *self, struct control_flow_node_s *no
 		}
 	}
 	for (n = 1; n < inst_log; n++) {
-		if (inst_log_entry[n].node_start) {
+		if (hot->node_start[n]) {
 			debug_print(DEBUG_ANALYSE, 1, "p_node_start = inst 0x%x\n", n);	
 		}
-		if (inst_log_entry[n].node_end) {
+		if (hot->node_end[n]) {
 			debug_print(DEBUG_ANALYSE, 1, "p_node_end = inst 0x%x\n", n);	
 		}
 	}
 	node = 1;
 	for (n = 1; n < inst_log; n++) {
-		inst_log1 = &inst_log_entry[n];
-		if (inst_log1->node_start) {
+		if (hot->node_start[n]) {
 			inst_start = n;
-			inst_log1->node_member = node;
-			if (!inst_log1->node_end) {
-				do {
-					tmp = inst_log1->next[0];
-					inst_log1 = &inst_log_entry[tmp];
-					inst_log1->node_member = node;
-				} while (!(inst_log1->node_end));
-				inst_end = tmp;
-			} else {
-				inst_end = n;
+			tmp = n;
+			hot->node_member[tmp] = node;
+			while (!(hot->node_end[tmp])) {
+				tmp = hot->next[tmp];
+				hot->node_member[tmp] = node;
 			}
+			inst_end = tmp;
 			nodes[node].inst_start = inst_start;
 			nodes[node].inst_end = inst_end;
 			nodes[node].valid = 1;
@@ -1563,7 +1400,9 @@ int analyse_merge_nodes(struct self_s *self, int function, int node_a, int node_
 			nodes[node_a].prev_link_index[size] = 0;
 			nodes[node_a].prev_size++;
 			nodes[node_b].inst_end = new_inst_start + offset - 1;
-			self->inst_log_entry[nodes[node_b].inst_end].node_end = 1;
+			if (self->inst_log_hot) {
+				self->inst_log_hot->node_end[nodes[node_b].inst_end] = 1;
+			}
 			nodes[node_b].link_next = calloc(1, sizeof(struct node_link_s));
 			nodes[node_b].next_size = 1;
 			nodes[node_b].link_next[0].node = node_a;
@@ -1605,6 +1444,10 @@ int analyse_merge_nodes(struct self_s *self, int function, int node_a, int node_
 		nodes[node_b].link_next[0].node = node_new;
 	}
 
+	if (ret) {
+		/* The instructions moved between nodes */
+		inst_node_set_function(self, function);
+	}
 	debug_print(DEBUG_ANALYSE, 1, "merge_nodes:  node_a = 0x%x, node_b = 0x%x\n", node_a, node_b);
 	debug_print(DEBUG_ANALYSE, 1, "merge_nodes: next_size: node_a = 0x%x, node_b = 0x%x\n", nodes[node_a].next_size, nodes[node_b].next_size);
 	return ret;
@@ -2010,135 +1853,3 @@ int scan_for_labels_in_function_body(struct self_s *self, struct external_entry_
 	}
 	return 0;
 }
-/***********************************************************************************
- * This is a complex routine. It utilises dynamic lists in order to reduce 
- * memory usage.
- **********************************************************************************/
-int search_back_local_reg_stack(struct self_s *self, uint64_t mid_start_size, struct mid_start_s *mid_start, int reg_stack, uint64_t indirect_init_value, uint64_t indirect_offset_value, uint64_t *size, int *search_back_seen, uint64_t **inst_list)
-{
-	struct instruction_s *instruction;
-	struct inst_log_entry_s *inst_log1;
-	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	//uint64_t value_id;
-	uint64_t inst_num;
-	uint64_t tmp;
-	int found = 0;
-	int n;
-
-	*size = 0;
-	/* FIXME: This could be optimized out if the "seen" value just increased on each call */
-	for (n = 0; n < INST_LOG_ENTRY_SIZE; n++) {
-		search_back_seen[n] = 0;
-	}
-
-	debug_print(DEBUG_ANALYSE, 1, "search_back_local_stack: 0x%"PRIx64", 0x%"PRIx64"\n", indirect_init_value, indirect_offset_value);
-	if (0 < mid_start_size) {
-		debug_print(DEBUG_ANALYSE, 1, "search_back:prev_size=0x%"PRIx64"\n", mid_start_size);
-	}
-	if (0 == mid_start_size) {
-		debug_print(DEBUG_ANALYSE, 1, "search_back ended\n");
-		return 1;
-	}
-
-	do {
-		found = 0;
-		for(n = 0; n < mid_start_size; n++) {
-			if (1 == mid_start[n].valid) {
-				inst_num = mid_start[n].mid_start;
-				mid_start[n].valid = 0;
-				found = 1;
-				debug_print(DEBUG_ANALYSE, 1, "mid_start removed 0x%"PRIx64" at 0x%x, size=0x%"PRIx64"\n", mid_start[n].mid_start, n, mid_start_size);
-				break;
-			}
-		}
-		if (!found) {
-			debug_print(DEBUG_ANALYSE, 1, "mid_start not found, exiting\n");
-			goto search_back_exit_free;
-		}
-		if (search_back_seen[inst_num]) {
-			continue;
-		}
-		search_back_seen[inst_num] = 1;
-		inst_log1 =  &inst_log_entry[inst_num];
-		instruction =  &inst_log1->instruction;
-		//value_id = inst_log1->value3.value_id;
-		debug_print(DEBUG_ANALYSE, 1, "inst_num:0x%"PRIx64"\n", inst_num);
-		/* STACK */
-		if ((reg_stack == 2) &&
-			(instruction->dstA.store == STORE_REG) &&
-			(inst_log1->value3.value_scope == 2) &&
-			(instruction->dstA.indirect == IND_STACK) &&
-			(inst_log1->value3.indirect_init_value == indirect_init_value) &&
-			(inst_log1->value3.indirect_offset_value == indirect_offset_value)) {
-			tmp = *size;
-			tmp++;
-			*size = tmp;
-			if (tmp == 1) {
-				*inst_list = malloc(sizeof(*inst_list));
-				(*inst_list)[0] = inst_num;
-			} else {
-				*inst_list = realloc(*inst_list, tmp * sizeof(*inst_list));
-				(*inst_list)[tmp - 1] = inst_num;
-			}
-		/* REGISTER */
-		} else if ((reg_stack == 1) &&
-			(instruction->dstA.store == STORE_REG) &&
-			(instruction->dstA.indirect == IND_DIRECT) &&
-			(instruction->dstA.index == indirect_init_value)) {
-			tmp = *size;
-			tmp++;
-			*size = tmp;
-			if (tmp == 1) {
-				*inst_list = malloc(sizeof(*inst_list));
-				(*inst_list)[0] = inst_num;
-				debug_print(DEBUG_ANALYSE, 1, "JCD2: inst_list[0] = 0x%"PRIx64"\n", inst_num);
-			} else {
-				*inst_list = realloc(*inst_list, tmp * sizeof(*inst_list));
-				(*inst_list)[tmp - 1] = inst_num;
-			}
-		} else {
-			if ((inst_log1->prev_size > 0) &&
-				(inst_log1->prev[0] != 0)) {
-				int prev_index;
-				found = 0;
-				prev_index = 0;
-				for(n = 0; n < mid_start_size; n++) {
-					if (0 == mid_start[n].valid) {
-						mid_start[n].mid_start = inst_log1->prev[prev_index];
-						prev_index++;
-						mid_start[n].valid = 1;
-						debug_print(DEBUG_ANALYSE, 1, "mid_start added 0x%"PRIx64" at 0x%x\n", mid_start[n].mid_start, n);
-						found = 1;
-					}
-					if (prev_index >= inst_log1->prev_size) {
-						break;
-					}
-				}
-				if (prev_index < inst_log1->prev_size) {
-					uint64_t mid_next;
-					mid_next = mid_start_size + inst_log1->prev_size - prev_index;
-					mid_start = realloc(mid_start, mid_next * sizeof(struct mid_start_s));
-					for(n = mid_start_size; n < mid_next; n++) {
-						mid_start[n].mid_start = inst_log1->prev[prev_index];
-						prev_index++;
-						debug_print(DEBUG_ANALYSE, 1, "mid_start realloc added 0x%"PRIx64" at 0x%x\n", mid_start[n].mid_start, n);
-						mid_start[n].valid = 1;
-					}
-					mid_start_size = mid_next;
-				}
-
-				if (!found) {
-					debug_print(DEBUG_ANALYSE, 1, "not found\n");
-					goto search_back_exit_free;
-				}
-			}
-		}
-	/* FIXME: There must be deterministic exit point */
-	} while (1);
-	debug_print(DEBUG_ANALYSE, 1, "end of loop, exiting\n");
-
-search_back_exit_free:
-	free(mid_start);
-	return 0;
-}
-
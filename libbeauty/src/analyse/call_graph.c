@@ -0,0 +1,590 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Call graph and function summaries.
+ * call_graph_build() finds the target of every direct CALL, through the
+ * relocation table (srcA.relocated == 1, index is the external_entry_points[] index)
+ * or the .text address (srcA.relocated == 2), and splits the graph into
+ * strongly connected components with Tarjan's algorithm.
+ * Tarjan finds an SCC only after every SCC it calls, so that order is bottom-up.
+ * call_graph_summarise() then works out, per function, which registers it reads
+ * as params, which it clobbers and which a RET returns. A CALL uses the summary
+ * of its target instead of looking inside it. The functions of a recursive SCC
+ * are redone until their summaries stop growing.
+ * The SCCs of one level only call SCCs of lower levels, so each level is
+ * shared out between threads.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <rev.h>
+
+struct call_graph_value_s {
+	uint64_t value;
+	int function;
+};
+
+static int call_graph_value_cmp(const void *a, const void *b)
+{
+	const struct call_graph_value_s *value_a = a;
+	const struct call_graph_value_s *value_b = b;
+
+	if (value_a->value < value_b->value) {
+		return -1;
+	}
+	return (value_a->value > value_b->value);
+}
+
+/* Turn a CALL to a .text address into a CALL to the entry point, as print_inst() does */
+static int call_graph_resolve(struct self_s *self, struct call_graph_value_s *by_value, int by_value_size, int inst)
+{
+	struct instruction_s *instruction = &(self->inst_log_entry[inst].instruction);
+	struct call_graph_value_s key;
+	struct call_graph_value_s *found;
+
+	if ((instruction->opcode != CALL) ||
+		(instruction->srcA.indirect != IND_DIRECT) ||
+		(instruction->srcA.relocated != 2)) {
+		return 0;
+	}
+	key.value = instruction->srcA.relocated_index;
+	found = bsearch(&key, by_value, by_value_size, sizeof(struct call_graph_value_s), call_graph_value_cmp);
+	if (found) {
+		instruction->srcA.index = found->function;
+		instruction->srcA.relocated = 1;
+		inst_log_hot_update(self, inst);
+	}
+	return 0;
+}
+
+/* The external_entry_points[] index a CALL goes to, or -1 if not known */
+int call_graph_target(struct self_s *self, int inst)
+{
+	struct instruction_s *instruction = &(self->inst_log_entry[inst].instruction);
+
+	if ((instruction->opcode != CALL) ||
+		(instruction->srcA.indirect != IND_DIRECT) ||
+		(instruction->srcA.relocated != 1) ||
+		(instruction->srcA.index >= EXTERNAL_ENTRY_POINTS_MAX) ||
+		!self->external_entry_points[instruction->srcA.index].valid) {
+		return -1;
+	}
+	return instruction->srcA.index;
+}
+
+/* Tarjan, without recursion. Fills scc, scc_start, scc_member and scc_level */
+static int call_graph_scc(struct call_graph_s *graph, struct external_entry_point_s *external_entry_points)
+{
+	int size = graph->size;
+	int *index;
+	int *low;
+	int *stack;
+	int *frame_function;
+	int *frame_edge;
+	uint8_t *on_stack;
+	int counter = 0;
+	int stack_size = 0;
+	int frame_size;
+	int member_size = 0;
+	int root;
+	int function;
+	int callee;
+	int edge;
+	int level;
+	int n;
+
+	index = calloc(size, sizeof(int));
+	low = calloc(size, sizeof(int));
+	stack = calloc(size, sizeof(int));
+	frame_function = calloc(size, sizeof(int));
+	frame_edge = calloc(size, sizeof(int));
+	on_stack = calloc(size, sizeof(uint8_t));
+	graph->scc = calloc(size, sizeof(int));
+	graph->scc_start = calloc(size + 1, sizeof(int));
+	graph->scc_member = calloc(size, sizeof(int));
+	graph->scc_level = calloc(size, sizeof(int));
+	if (!index || !low || !stack || !frame_function || !frame_edge || !on_stack ||
+		!graph->scc || !graph->scc_start || !graph->scc_member || !graph->scc_level) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_scc: calloc failed\n");
+		exit(1);
+	}
+	graph->scc_size = 0;
+	graph->level_size = 0;
+	for (root = 0; root < size; root++) {
+		if (!external_entry_points[root].valid || index[root]) {
+			continue;
+		}
+		frame_size = 0;
+		function = root;
+		/* Push function */
+		counter++;
+		index[function] = low[function] = counter;
+		stack[stack_size++] = function;
+		on_stack[function] = 1;
+		frame_function[frame_size] = function;
+		frame_edge[frame_size] = graph->callee_start[function];
+		frame_size++;
+		while (frame_size > 0) {
+			function = frame_function[frame_size - 1];
+			edge = frame_edge[frame_size - 1];
+			if (edge < graph->callee_start[function + 1]) {
+				frame_edge[frame_size - 1]++;
+				callee = graph->callee[edge];
+				if (!index[callee]) {
+					counter++;
+					index[callee] = low[callee] = counter;
+					stack[stack_size++] = callee;
+					on_stack[callee] = 1;
+					frame_function[frame_size] = callee;
+					frame_edge[frame_size] = graph->callee_start[callee];
+					frame_size++;
+				} else if (on_stack[callee] && (index[callee] < low[function])) {
+					low[function] = index[callee];
+				}
+				continue;
+			}
+			frame_size--;
+			if ((frame_size > 0) && (low[function] < low[frame_function[frame_size - 1]])) {
+				low[frame_function[frame_size - 1]] = low[function];
+			}
+			if (low[function] != index[function]) {
+				continue;
+			}
+			/* function is the root of an SCC. Every SCC it calls is already done */
+			graph->scc_start[graph->scc_size] = member_size;
+			do {
+				callee = stack[--stack_size];
+				on_stack[callee] = 0;
+				graph->scc[callee] = graph->scc_size;
+				graph->scc_member[member_size++] = callee;
+			} while (callee != function);
+			level = 0;
+			for (n = graph->scc_start[graph->scc_size]; n < member_size; n++) {
+				function = graph->scc_member[n];
+				for (edge = graph->callee_start[function]; edge < graph->callee_start[function + 1]; edge++) {
+					callee = graph->callee[edge];
+					if ((graph->scc[callee] != graph->scc_size) &&
+						(graph->scc_level[graph->scc[callee]] + 1 > level)) {
+						level = graph->scc_level[graph->scc[callee]] + 1;
+					}
+				}
+			}
+			graph->scc_level[graph->scc_size] = level;
+			if (level + 1 > graph->level_size) {
+				graph->level_size = level + 1;
+			}
+			graph->scc_size++;
+		}
+	}
+	graph->scc_start[graph->scc_size] = member_size;
+	free(index);
+	free(low);
+	free(stack);
+	free(frame_function);
+	free(frame_edge);
+	free(on_stack);
+	return 0;
+}
+
+/* Needs the inst_node index, so run after create_function_node_members() */
+int call_graph_build(struct self_s *self)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct call_graph_value_s *by_value;
+	struct call_graph_s *graph;
+	int by_value_size = 0;
+	int function;
+	int callee;
+	int inst;
+	int n;
+
+	call_graph_free(self);
+	graph = calloc(1, sizeof(struct call_graph_s));
+	by_value = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct call_graph_value_s));
+	if (!graph || !by_value) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_build: calloc failed\n");
+		exit(1);
+	}
+	self->call_graph = graph;
+	graph->size = EXTERNAL_ENTRY_POINTS_MAX;
+	for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
+		/* Type 3 too. Its callers still call it by address */
+		if (external_entry_points[n].valid &&
+			((external_entry_points[n].type == 1) || (external_entry_points[n].type == 3))) {
+			by_value[by_value_size].value = external_entry_points[n].value;
+			by_value[by_value_size].function = n;
+			by_value_size++;
+		}
+	}
+	qsort(by_value, by_value_size, sizeof(struct call_graph_value_s), call_graph_value_cmp);
+
+	/* Count the calls out of each function, then fill them in */
+	graph->callee_start = calloc(graph->size + 1, sizeof(int));
+	graph->summary = calloc(graph->size, sizeof(struct function_summary_s));
+	if (!graph->callee_start || !graph->summary) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_build: calloc failed\n");
+		exit(1);
+	}
+	for (inst = 1; inst < inst_log; inst++) {
+		call_graph_resolve(self, by_value, by_value_size, inst);
+		function = inst_node_function(self, inst) - 1;
+		if ((function >= 0) && (call_graph_target(self, inst) >= 0)) {
+			graph->callee_start[function + 1]++;
+		}
+	}
+	for (n = 0; n < graph->size; n++) {
+		graph->callee_start[n + 1] += graph->callee_start[n];
+	}
+	graph->callee = calloc(graph->callee_start[graph->size] + 1, sizeof(int));
+	if (!graph->callee) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_build: calloc failed\n");
+		exit(1);
+	}
+	/* by_value is not needed now. Use it as the fill position */
+	memset(by_value, 0, EXTERNAL_ENTRY_POINTS_MAX * sizeof(struct call_graph_value_s));
+	for (inst = 1; inst < inst_log; inst++) {
+		function = inst_node_function(self, inst) - 1;
+		if (function < 0) {
+			continue;
+		}
+		callee = call_graph_target(self, inst);
+		if (callee >= 0) {
+			graph->callee[graph->callee_start[function] + by_value[function].function] = callee;
+			by_value[function].function++;
+		}
+	}
+	free(by_value);
+	call_graph_scc(graph, external_entry_points);
+	debug_print(DEBUG_ANALYSE, 1, "call_graph_build: 0x%x calls, 0x%x SCCs, 0x%x levels\n",
+		graph->callee_start[graph->size], graph->scc_size, graph->level_size);
+	return 0;
+}
+
+/* The registers inst reads and writes. A CALL uses the summary of its target */
+static int call_graph_inst_regs(struct self_s *self, struct call_graph_s *graph, int inst,
+	struct reg_set_s *use, struct reg_set_s *def)
+{
+	struct instruction_hot_s *instruction = &(self->inst_log_hot->instruction[inst]);
+	struct function_summary_s *summary;
+	int callee;
+	int n;
+
+	memset(use, 0, sizeof(struct reg_set_s));
+	memset(def, 0, sizeof(struct reg_set_s));
+	if ((instruction->srcA.store == STORE_REG) && (instruction->srcA.index < MAX_REG)) {
+		REG_SET_ADD(use, instruction->srcA.index);
+	}
+	if ((instruction->srcB.store == STORE_REG) && (instruction->srcB.index < MAX_REG)) {
+		REG_SET_ADD(use, instruction->srcB.index);
+	}
+	if ((instruction->dstA.store == STORE_REG) && (instruction->dstA.index < MAX_REG)) {
+		if (instruction->dstA.indirect == IND_DIRECT) {
+			REG_SET_ADD(def, instruction->dstA.index);
+		} else {
+			/* The register holds the address, so is read */
+			REG_SET_ADD(use, instruction->dstA.index);
+		}
+	}
+	if (instruction->opcode != CALL) {
+		return 0;
+	}
+	callee = call_graph_target(self, inst);
+	if (callee < 0) {
+		return 0;
+	}
+	summary = &(graph->summary[callee]);
+	if (!summary->valid) {
+		return 0;
+	}
+	for (n = 0; n < summary->params_size; n++) {
+		REG_SET_ADD(use, reg_params_order[n]);
+	}
+	for (n = 0; n < REG_SET_WORDS; n++) {
+		def->word[n] |= summary->clobber.word[n];
+	}
+	return 0;
+}
+
+/* Returns 1 if the summary of function grew */
+static int call_graph_summarise_function(struct self_s *self, struct call_graph_s *graph, int function)
+{
+	struct external_entry_point_s *external_entry_point = &(self->external_entry_points[function]);
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	int nodes_size = external_entry_point->nodes_size;
+	struct function_summary_s *summary = &(graph->summary[function]);
+	struct function_summary_s new_summary;
+	struct reg_set_s *gen;
+	struct reg_set_s *kill;
+	struct reg_set_s *in;
+	struct reg_set_s *out;
+	struct reg_set_s use;
+	struct reg_set_s def;
+	int changed = 0;
+	int node;
+	int inst;
+	int n;
+
+	if ((external_entry_point->type != 1) || !nodes || (nodes_size < 2)) {
+		return 0;
+	}
+	gen = calloc(nodes_size, sizeof(struct reg_set_s));
+	kill = calloc(nodes_size, sizeof(struct reg_set_s));
+	in = calloc(nodes_size, sizeof(struct reg_set_s));
+	out = calloc(nodes_size, sizeof(struct reg_set_s));
+	if (!gen || !kill || !in || !out) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_summarise_function: calloc failed\n");
+		exit(1);
+	}
+	memset(&new_summary, 0, sizeof(struct function_summary_s));
+	for (node = 1; node < nodes_size; node++) {
+		if (!nodes[node].valid) {
+			continue;
+		}
+		inst = nodes[node].inst_start;
+		while ((inst > 0) && (inst < inst_log)) {
+			call_graph_inst_regs(self, graph, inst, &use, &def);
+			for (n = 0; n < REG_SET_WORDS; n++) {
+				gen[node].word[n] |= use.word[n] & ~kill[node].word[n];
+				kill[node].word[n] |= def.word[n];
+			}
+			if ((self->inst_log_hot->instruction[inst].opcode == RET) &&
+				(self->inst_log_hot->instruction[inst].srcA.store == STORE_REG)) {
+				REG_SET_ADD(&new_summary.ret, self->inst_log_hot->instruction[inst].srcA.index);
+			}
+			if (inst == nodes[node].inst_end) {
+				break;
+			}
+			inst = self->inst_log_hot->next[inst];
+		}
+		for (n = 0; n < REG_SET_WORDS; n++) {
+			new_summary.clobber.word[n] |= kill[node].word[n];
+		}
+	}
+	reg_dataflow_solve(nodes, nodes_size, DATAFLOW_BACKWARD, gen, kill, in, out);
+	/* Node 1 is the entry. Only the ABI param registers count */
+	for (n = 0; n < REG_PARAMS_ORDER_MAX; n++) {
+		if (REG_SET_TEST(&in[1], reg_params_order[n])) {
+			new_summary.params_size = n + 1;
+		}
+	}
+	for (n = 0; n < new_summary.params_size; n++) {
+		REG_SET_ADD(&new_summary.params, reg_params_order[n]);
+	}
+
+	/* Only ever grow, so a recursive SCC settles */
+	if (!summary->valid) {
+		summary->valid = 1;
+		changed = 1;
+	}
+	if (new_summary.params_size > summary->params_size) {
+		summary->params_size = new_summary.params_size;
+		changed = 1;
+	}
+	for (n = 0; n < REG_SET_WORDS; n++) {
+		new_summary.params.word[n] |= summary->params.word[n];
+		new_summary.clobber.word[n] |= summary->clobber.word[n];
+		new_summary.ret.word[n] |= summary->ret.word[n];
+		if ((new_summary.params.word[n] != summary->params.word[n]) ||
+			(new_summary.clobber.word[n] != summary->clobber.word[n]) ||
+			(new_summary.ret.word[n] != summary->ret.word[n])) {
+			changed = 1;
+		}
+	}
+	summary->params = new_summary.params;
+	summary->clobber = new_summary.clobber;
+	summary->ret = new_summary.ret;
+	free(gen);
+	free(kill);
+	free(in);
+	free(out);
+	return changed;
+}
+
+static int call_graph_summarise_scc(struct self_s *self, struct call_graph_s *graph, int scc)
+{
+	int first = graph->scc_start[scc];
+	int last = graph->scc_start[scc + 1];
+	int recursive = (last - first) > 1;
+	int function;
+	int changed;
+	int record;
+	int edge;
+	int n;
+
+	function = graph->scc_member[first];
+	if (self->external_entry_points[function].type != 1) {
+		/* External functions are SCCs of their own. Nothing to summarise */
+		return 0;
+	}
+	for (edge = graph->callee_start[function]; edge < graph->callee_start[function + 1]; edge++) {
+		if (graph->callee[edge] == function) {
+			recursive = 1;
+		}
+	}
+	do {
+		changed = 0;
+		for (n = first; n < last; n++) {
+			record = stats_begin(self, "summarise", graph->scc_member[n]);
+			changed |= call_graph_summarise_function(self, graph, graph->scc_member[n]);
+			stats_end(self, record);
+		}
+	} while (recursive && changed);
+	return 0;
+}
+
+struct call_graph_worker_s {
+	struct self_s *self;
+	int *level_scc;
+	int last;
+	int next;	/* Shared. Taken with __sync_fetch_and_add() */
+};
+
+static void *call_graph_worker(void *arg)
+{
+	struct call_graph_worker_s *worker = arg;
+	int n;
+
+	while ((n = __sync_fetch_and_add(&(worker->next), 1)) < worker->last) {
+		call_graph_summarise_scc(worker->self, worker->self->call_graph, worker->level_scc[n]);
+	}
+	return NULL;
+}
+
+/* Needs call_graph_build() and the function nodes tables.
+ * threads = 0 uses one per online CPU.
+ */
+int call_graph_summarise(struct self_s *self, int threads)
+{
+	struct call_graph_s *graph = self->call_graph;
+	struct call_graph_worker_s worker;
+	pthread_t *thread;
+	uint8_t *started;
+	int *level_start;
+	int *level_scc;
+	int level;
+	int count;
+	int function;
+	int n;
+
+	if (!graph) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_summarise: no call graph\n");
+		return 1;
+	}
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (threads <= 0) {
+			threads = 1;
+		}
+	}
+	/* Group the SCCs by level */
+	level_start = calloc(graph->level_size + 1, sizeof(int));
+	level_scc = calloc(graph->scc_size + 1, sizeof(int));
+	thread = calloc(threads, sizeof(pthread_t));
+	started = calloc(threads, sizeof(uint8_t));
+	if (!level_start || !level_scc || !thread || !started) {
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_summarise: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < graph->scc_size; n++) {
+		level_start[graph->scc_level[n] + 1]++;
+	}
+	for (level = 0; level < graph->level_size; level++) {
+		level_start[level + 1] += level_start[level];
+	}
+	for (n = 0; n < graph->scc_size; n++) {
+		level = graph->scc_level[n];
+		level_scc[level_start[level]++] = n;
+	}
+	/* level_start[level] is now the end of level. Shift it back */
+	for (level = graph->level_size; level > 0; level--) {
+		level_start[level] = level_start[level - 1];
+	}
+	level_start[0] = 0;
+
+	worker.self = self;
+	worker.level_scc = level_scc;
+	for (level = 0; level < graph->level_size; level++) {
+		worker.next = level_start[level];
+		worker.last = level_start[level + 1];
+		count = worker.last - worker.next;
+		if (count > threads) {
+			count = threads;
+		}
+		/* This thread is one of the workers */
+		memset(started, 0, threads * sizeof(uint8_t));
+		for (n = 1; n < count; n++) {
+			started[n] = !pthread_create(&thread[n], NULL, call_graph_worker, &worker);
+		}
+		call_graph_worker(&worker);
+		for (n = 1; n < count; n++) {
+			if (started[n]) {
+				pthread_join(thread[n], NULL);
+			}
+		}
+	}
+	free(level_start);
+	free(level_scc);
+	free(thread);
+	free(started);
+
+	for (function = 0; function < graph->size; function++) {
+		if (!graph->summary[function].valid) {
+			continue;
+		}
+		debug_print(DEBUG_ANALYSE, 1, "call_graph_summarise: %s: scc 0x%x, level 0x%x, params 0x%x\n",
+			self->external_entry_points[function].name,
+			graph->scc[function],
+			graph->scc_level[graph->scc[function]],
+			graph->summary[function].params_size);
+	}
+	return 0;
+}
+
+/* The summary of function, or NULL if it does not have one */
+struct function_summary_s *call_graph_summary(struct self_s *self, int function)
+{
+	struct call_graph_s *graph = self->call_graph;
+
+	if (!graph || (function < 0) || (function >= graph->size) ||
+		!graph->summary[function].valid) {
+		return NULL;
+	}
+	return &(graph->summary[function]);
+}
+
+int call_graph_free(struct self_s *self)
+{
+	struct call_graph_s *graph = self->call_graph;
+
+	if (!graph) {
+		return 0;
+	}
+	free(graph->callee_start);
+	free(graph->callee);
+	free(graph->scc);
+	free(graph->scc_start);
+	free(graph->scc_member);
+	free(graph->scc_level);
+	free(graph->summary);
+	free(graph);
+	self->call_graph = NULL;
+	return 0;
+}
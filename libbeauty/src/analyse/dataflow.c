@@ -0,0 +1,326 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Node level register dataflow.
+ * reg_dataflow_solve() is a plain work list solver over the node CFG,
+ * with union as the meet, so it serves both liveness (backward) and
+ * "written on some path" (forward).
+ * The sets are struct reg_set_s bitsets indexed by the dense register number,
+ * so the transfer function is one word op instead of a walk per register.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+/* The registers the decoders use, in register number order, so iterating
+ * a set by dense number visits the registers in the same order as before.
+ */
+const int reg_dense_reg[REG_DENSE_MAX] = {
+	0,
+	REG_AX, REG_CX, REG_DX, REG_BX, REG_SP, REG_BP, REG_SI, REG_DI, REG_IP,
+	REG_08, REG_09, REG_10, REG_11, REG_12, REG_13, REG_14, REG_15,
+	REG_OVERFLOW, REG_NOT_OVERFLOW, REG_BELOW, REG_NOT_BELOW,
+	REG_EQUAL, REG_NOT_EQUAL, REG_BELOW_EQUAL, REG_ABOVE,
+	REG_SIGNED, REG_NO_SIGNED, REG_PARITY, REG_NOT_PARITY,
+	REG_LESS, REG_GREATER_EQUAL, REG_LESS_EQUAL, REG_GREATER,
+	REG_CS,
+	REG_XMM0, REG_XMM1, REG_XMM2,
+	REG_TMP1, REG_TMP2, REG_TMP3
+};
+
+const uint8_t reg_dense_index[MAX_REG] = {
+	[REG_AX] = 1, [REG_CX] = 2, [REG_DX] = 3, [REG_BX] = 4,
+	[REG_SP] = 5, [REG_BP] = 6, [REG_SI] = 7, [REG_DI] = 8, [REG_IP] = 9,
+	[REG_08] = 10, [REG_09] = 11, [REG_10] = 12, [REG_11] = 13,
+	[REG_12] = 14, [REG_13] = 15, [REG_14] = 16, [REG_15] = 17,
+	[REG_OVERFLOW] = 18, [REG_NOT_OVERFLOW] = 19, [REG_BELOW] = 20, [REG_NOT_BELOW] = 21,
+	[REG_EQUAL] = 22, [REG_NOT_EQUAL] = 23, [REG_BELOW_EQUAL] = 24, [REG_ABOVE] = 25,
+	[REG_SIGNED] = 26, [REG_NO_SIGNED] = 27, [REG_PARITY] = 28, [REG_NOT_PARITY] = 29,
+	[REG_LESS] = 30, [REG_GREATER_EQUAL] = 31, [REG_LESS_EQUAL] = 32, [REG_GREATER] = 33,
+	[REG_CS] = 34,
+	[REG_XMM0] = 35, [REG_XMM1] = 36, [REG_XMM2] = 37,
+	[REG_TMP1] = 38, [REG_TMP2] = 39, [REG_TMP3] = 40
+};
+
+/* Return the first dense register number >= dense that is in the set, or -1.
+ * reg_dense_reg[] turns it back into the register.
+ */
+int reg_set_next(struct reg_set_s *set, int dense)
+{
+	int word;
+	uint64_t bits;
+
+	if (dense < 1) {
+		dense = 1;
+	}
+	if (dense >= REG_DENSE_MAX) {
+		return -1;
+	}
+	word = dense >> 6;
+	bits = set->word[word] & (~0ULL << (dense & 63));
+	while (!bits) {
+		word++;
+		if (word >= REG_SET_WORDS) {
+			return -1;
+		}
+		bits = set->word[word];
+	}
+	return (word << 6) + __builtin_ctzll(bits);
+}
+
+static int reg_set_transfer(struct reg_set_s *result, struct reg_set_s *gen,
+	struct reg_set_s *kill, struct reg_set_s *meet)
+{
+	int n;
+	uint64_t tmp;
+	int changed = 0;
+
+	for (n = 0; n < REG_SET_WORDS; n++) {
+		tmp = gen->word[n] | (meet->word[n] & ~kill->word[n]);
+		changed |= (tmp != result->word[n]);
+		result->word[n] = tmp;
+	}
+	return changed;
+}
+
+static void reg_set_union(struct reg_set_s *result, struct reg_set_s *set)
+{
+	int n;
+
+	for (n = 0; n < REG_SET_WORDS; n++) {
+		result->word[n] |= set->word[n];
+	}
+}
+
+/* Forward: in = union of the out of the prev nodes, out = gen | (in & ~kill)
+ * Backward: out = union of the in of the next nodes, in = gen | (out & ~kill)
+ * All arrays are indexed by node. in and out are overwritten.
+ */
+int reg_dataflow_solve(struct control_flow_node_s *nodes, int nodes_size, int direction,
+	struct reg_set_s *gen, struct reg_set_s *kill, struct reg_set_s *in, struct reg_set_s *out)
+{
+	int *queue;
+	uint8_t *in_list;
+	int head = 0;
+	int count = 0;
+	int node;
+	int next;
+	int n;
+
+	if (nodes_size < 2) {
+		return 0;
+	}
+	queue = calloc(nodes_size, sizeof(int));
+	in_list = calloc(nodes_size, sizeof(uint8_t));
+	if (!queue || !in_list) {
+		debug_print(DEBUG_ANALYSE, 1, "reg_dataflow_solve: calloc failed\n");
+		exit(1);
+	}
+	memset(in, 0, nodes_size * sizeof(struct reg_set_s));
+	memset(out, 0, nodes_size * sizeof(struct reg_set_s));
+	/* Seed in node order for forward, reverse for backward. It converges faster. */
+	for (n = 1; n < nodes_size; n++) {
+		node = (direction == DATAFLOW_FORWARD) ? n : nodes_size - n;
+		if (nodes[node].valid) {
+			queue[count++] = node;
+			in_list[node] = 1;
+		}
+	}
+	while (count > 0) {
+		node = queue[head];
+		head = (head + 1) % nodes_size;
+		count--;
+		in_list[node] = 0;
+		if (direction == DATAFLOW_FORWARD) {
+			memset(&in[node], 0, sizeof(struct reg_set_s));
+			for (n = 0; n < nodes[node].prev_size; n++) {
+				next = nodes[node].prev_node[n];
+				if ((next > 0) && (next < nodes_size)) {
+					reg_set_union(&in[node], &out[next]);
+				}
+			}
+			if (!reg_set_transfer(&out[node], &gen[node], &kill[node], &in[node])) {
+				continue;
+			}
+			for (n = 0; n < nodes[node].next_size; n++) {
+				next = nodes[node].link_next[n].node;
+				if ((next > 0) && (next < nodes_size) &&
+					nodes[next].valid && !in_list[next]) {
+					queue[(head + count) % nodes_size] = next;
+					count++;
+					in_list[next] = 1;
+				}
+			}
+		} else {
+			memset(&out[node], 0, sizeof(struct reg_set_s));
+			for (n = 0; n < nodes[node].next_size; n++) {
+				next = nodes[node].link_next[n].node;
+				if ((next > 0) && (next < nodes_size)) {
+					reg_set_union(&out[node], &in[next]);
+				}
+			}
+			if (!reg_set_transfer(&in[node], &gen[node], &kill[node], &out[node])) {
+				continue;
+			}
+			for (n = 0; n < nodes[node].prev_size; n++) {
+				next = nodes[node].prev_node[n];
+				if ((next > 0) && (next < nodes_size) &&
+					nodes[next].valid && !in_list[next]) {
+					queue[(head + count) % nodes_size] = next;
+					count++;
+					in_list[next] = 1;
+				}
+			}
+		}
+	}
+	free(queue);
+	free(in_list);
+	return 0;
+}
+
+/* Needs reg_use and reg_def, from fill_node_used_register_table(), and the phi lists.
+ * Fills reg_live_in, reg_live_out and reg_avail_in.
+ * A register read by a node, that is not in its reg_avail_in, can only be a param.
+ */
+int build_node_reg_liveness(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
+{
+	struct reg_set_s *gen;
+	struct reg_set_s *kill;
+	struct reg_set_s *in;
+	struct reg_set_s *out;
+	int node;
+	int n;
+
+	gen = calloc(nodes_size, sizeof(struct reg_set_s));
+	kill = calloc(nodes_size, sizeof(struct reg_set_s));
+	in = calloc(nodes_size, sizeof(struct reg_set_s));
+	out = calloc(nodes_size, sizeof(struct reg_set_s));
+	if (!gen || !kill || !in || !out) {
+		debug_print(DEBUG_ANALYSE, 1, "build_node_reg_liveness: calloc failed\n");
+		exit(1);
+	}
+	/* Liveness */
+	for (node = 1; node < nodes_size; node++) {
+		if (nodes[node].valid) {
+			gen[node] = nodes[node].reg_use;
+			kill[node] = nodes[node].reg_def;
+		}
+	}
+	reg_dataflow_solve(nodes, nodes_size, DATAFLOW_BACKWARD, gen, kill, in, out);
+	for (node = 1; node < nodes_size; node++) {
+		nodes[node].reg_live_in = in[node];
+		nodes[node].reg_live_out = out[node];
+	}
+	/* Written, or given a phi, on some path */
+	memset(kill, 0, nodes_size * sizeof(struct reg_set_s));
+	for (node = 1; node < nodes_size; node++) {
+		if (!nodes[node].valid) {
+			continue;
+		}
+		gen[node] = nodes[node].reg_def;
+		for (n = 0; n < nodes[node].phi_size; n++) {
+			REG_SET_ADD(&gen[node], nodes[node].phi[n].reg);
+		}
+	}
+	reg_dataflow_solve(nodes, nodes_size, DATAFLOW_FORWARD, gen, kill, in, out);
+	for (node = 1; node < nodes_size; node++) {
+		nodes[node].reg_avail_in = in[node];
+	}
+	if (nodes_size > 1) {
+		for (n = reg_set_next(&nodes[1].reg_live_in, 1); n >= 0;
+			n = reg_set_next(&nodes[1].reg_live_in, n + 1)) {
+			debug_print(DEBUG_ANALYSE, 1, "build_node_reg_liveness: reg 0x%x live at entry\n", reg_dense_reg[n]);
+		}
+	}
+	free(gen);
+	free(kill);
+	free(in);
+	free(out);
+	return 0;
+}
+
+/* For each node, and each dense register, the node whose write, or phi, of the register
+ * is the last one before the node along the first prev node of each node.
+ * This is the node the labels of a register read first in a node come from. 0 = none, a param.
+ * Each node is resolved once, and a first prev node cycle with no write ends as 0.
+ * Returns nodes_size * REG_DENSE_MAX entries, indexed node * REG_DENSE_MAX + dense.
+ */
+int *build_node_reg_reach(struct control_flow_node_s *nodes, int nodes_size)
+{
+	int *reach;
+	uint8_t *state;
+	int *stack;
+	int stack_size;
+	int node;
+	int prev;
+	int dense;
+	int n;
+	int m;
+
+	reach = calloc((nodes_size + 1) * REG_DENSE_MAX, sizeof(int));
+	state = calloc(nodes_size + 1, sizeof(uint8_t));
+	stack = calloc(nodes_size + 1, sizeof(int));
+	if (!reach || !state || !stack) {
+		debug_print(DEBUG_ANALYSE, 1, "build_node_reg_reach: calloc failed\n");
+		exit(1);
+	}
+	/* state: 0 = not resolved, 1 = on the stack, 2 = resolved. Node 0 is resolved as all 0 */
+	state[0] = 2;
+	for (node = 1; node < nodes_size; node++) {
+		stack_size = 0;
+		n = node;
+		while (state[n] == 0) {
+			state[n] = 1;
+			stack[stack_size++] = n;
+			prev = 0;
+			if (nodes[n].valid && (nodes[n].prev_size > 0) &&
+				(nodes[n].prev_node[0] > 0) && (nodes[n].prev_node[0] < nodes_size)) {
+				prev = nodes[n].prev_node[0];
+			}
+			n = prev;
+		}
+		/* n is resolved, or on the stack because of a cycle, where it is still 0 */
+		while (stack_size > 0) {
+			n = stack[--stack_size];
+			prev = 0;
+			if (nodes[n].valid && (nodes[n].prev_size > 0) &&
+				(nodes[n].prev_node[0] > 0) && (nodes[n].prev_node[0] < nodes_size)) {
+				prev = nodes[n].prev_node[0];
+			}
+			if (prev && (state[prev] == 2)) {
+				/* Written in prev, or reaching it */
+				for (dense = 1; dense < REG_DENSE_MAX; dense++) {
+					reach[(n * REG_DENSE_MAX) + dense] =
+						REG_SET_TEST_DENSE(&nodes[prev].reg_def, dense) ? prev :
+						reach[(prev * REG_DENSE_MAX) + dense];
+				}
+				for (m = 0; m < nodes[prev].phi_size; m++) {
+					if (!REG_SET_TEST(&nodes[prev].reg_def, nodes[prev].phi[m].reg)) {
+						reach[(n * REG_DENSE_MAX) + REG_DENSE(nodes[prev].phi[m].reg)] = prev;
+					}
+				}
+			}
+			state[n] = 2;
+		}
+	}
+	free(state);
+	free(stack);
+	return reach;
+}
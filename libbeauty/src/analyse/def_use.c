@@ -0,0 +1,340 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Def-use index for one function.
+ * def_use_build() scans the function's nodes once, and records which
+ * instructions write each register and each local stack slot, and which read
+ * each register.
+ * def_use_reaching() answers "which writes of X reach instruction i".
+ * If X is never written in the function the answer is empty without any walk.
+ * Otherwise it walks back from i and stops at the writes of X, which are
+ * marked up front, so each step is one compare.
+ * The seen and mark arrays only cover the function's own instructions, and
+ * are stamped with an epoch, so they are never cleared.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+struct def_use_key_s {
+	uint64_t init_value;
+	uint64_t offset_value;
+	int inst;
+};
+
+static void def_use_list_add(struct def_use_list_s *list, int inst)
+{
+	if (list->size >= list->max) {
+		list->max = list->max ? list->max * 2 : 4;
+		list->list = realloc(list->list, list->max * sizeof(int));
+		if (!list->list) {
+			debug_print(DEBUG_ANALYSE, 1, "def_use_list_add: realloc failed\n");
+			exit(1);
+		}
+	}
+	list->list[list->size] = inst;
+	list->size++;
+}
+
+static int def_use_compare_key(const void *a, const void *b)
+{
+	const struct def_use_key_s *key_a = a;
+	const struct def_use_key_s *key_b = b;
+
+	if (key_a->init_value != key_b->init_value) {
+		return (key_a->init_value < key_b->init_value) ? -1 : 1;
+	}
+	if (key_a->offset_value != key_b->offset_value) {
+		return (key_a->offset_value < key_b->offset_value) ? -1 : 1;
+	}
+	return key_a->inst - key_b->inst;
+}
+
+static void def_use_add_reg_use(struct def_use_s *def_use, struct operand_s *operand, int inst)
+{
+	if ((operand->store == STORE_REG) && (operand->index < MAX_REG)) {
+		def_use_list_add(&def_use->reg_use[operand->index], inst);
+	}
+}
+
+int def_use_build(struct self_s *self, struct external_entry_point_s *external_entry_point)
+{
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	int nodes_size = external_entry_point->nodes_size;
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1;
+	struct instruction_s *instruction;
+	struct def_use_s *def_use;
+	struct def_use_key_s *keys = NULL;
+	int keys_size = 0;
+	int keys_max = 0;
+	int inst_min = 0;
+	int inst_max = 0;
+	int node;
+	int inst;
+	int n;
+
+	def_use_free(external_entry_point);
+	def_use = calloc(1, sizeof(struct def_use_s));
+	if (!def_use) {
+		debug_print(DEBUG_ANALYSE, 1, "def_use_build: calloc failed\n");
+		exit(1);
+	}
+	for (node = 1; node < nodes_size; node++) {
+		if (!nodes[node].valid) {
+			continue;
+		}
+		inst = nodes[node].inst_start;
+		do {
+			inst_log1 = &inst_log_entry[inst];
+			instruction = &inst_log1->instruction;
+			if (!inst_min || (inst < inst_min)) {
+				inst_min = inst;
+			}
+			if (inst > inst_max) {
+				inst_max = inst;
+			}
+			def_use_add_reg_use(def_use, &instruction->srcA, inst);
+			def_use_add_reg_use(def_use, &instruction->srcB, inst);
+			if ((instruction->dstA.store == STORE_REG) &&
+				(instruction->dstA.indirect == IND_DIRECT) &&
+				(instruction->dstA.index < MAX_REG)) {
+				def_use_list_add(&def_use->reg_def[instruction->dstA.index], inst);
+			} else if ((instruction->dstA.store == STORE_REG) &&
+				(inst_log1->value3.value_scope == 2) &&
+				(instruction->dstA.indirect == IND_STACK)) {
+				/* A write to a local stack slot. The register is still read, as the pointer */
+				def_use_add_reg_use(def_use, &instruction->dstA, inst);
+				if (keys_size >= keys_max) {
+					keys_max = keys_max ? keys_max * 2 : 64;
+					keys = realloc(keys, keys_max * sizeof(struct def_use_key_s));
+					if (!keys) {
+						debug_print(DEBUG_ANALYSE, 1, "def_use_build: realloc failed\n");
+						exit(1);
+					}
+				}
+				keys[keys_size].init_value = inst_log1->value3.indirect_init_value;
+				keys[keys_size].offset_value = inst_log1->value3.indirect_offset_value;
+				keys[keys_size].inst = inst;
+				keys_size++;
+			} else if (instruction->dstA.store == STORE_REG) {
+				/* Indirect through a register, so the register is read */
+				def_use_add_reg_use(def_use, &instruction->dstA, inst);
+			}
+			if (INST_LOG_NODE_END(self, inst) || !inst_log1->next_size) {
+				break;
+			}
+			inst = inst_log1->next[0];
+		} while (1);
+	}
+
+	/* Group the stack slot writes by slot */
+	if (keys_size) {
+		qsort(keys, keys_size, sizeof(struct def_use_key_s), def_use_compare_key);
+		def_use->stack_slot = calloc(keys_size, sizeof(struct def_use_stack_slot_s));
+		if (!def_use->stack_slot) {
+			debug_print(DEBUG_ANALYSE, 1, "def_use_build: calloc failed\n");
+			exit(1);
+		}
+	}
+	for (n = 0; n < keys_size; n++) {
+		struct def_use_stack_slot_s *slot;
+		if (!def_use->stack_slot_size ||
+			(def_use->stack_slot[def_use->stack_slot_size - 1].init_value != keys[n].init_value) ||
+			(def_use->stack_slot[def_use->stack_slot_size - 1].offset_value != keys[n].offset_value)) {
+			slot = &def_use->stack_slot[def_use->stack_slot_size];
+			slot->init_value = keys[n].init_value;
+			slot->offset_value = keys[n].offset_value;
+			def_use->stack_slot_size++;
+		}
+		slot = &def_use->stack_slot[def_use->stack_slot_size - 1];
+		def_use_list_add(&slot->def, keys[n].inst);
+	}
+	free(keys);
+
+	def_use->seen_base = inst_min;
+	def_use->seen_size = inst_max - inst_min + 1;
+	def_use->seen = calloc(def_use->seen_size, sizeof(uint32_t));
+	def_use->def_mark = calloc(def_use->seen_size, sizeof(uint32_t));
+	if (!def_use->seen || !def_use->def_mark) {
+		debug_print(DEBUG_ANALYSE, 1, "def_use_build: calloc failed\n");
+		exit(1);
+	}
+	external_entry_point->def_use = def_use;
+	debug_print(DEBUG_ANALYSE, 1, "def_use_build: %s: stack slots = 0x%x\n",
+		external_entry_point->name, def_use->stack_slot_size);
+	return 0;
+}
+
+void def_use_free(struct external_entry_point_s *external_entry_point)
+{
+	struct def_use_s *def_use = external_entry_point->def_use;
+	int n;
+
+	if (!def_use) {
+		return;
+	}
+	for (n = 0; n < MAX_REG; n++) {
+		free(def_use->reg_def[n].list);
+		free(def_use->reg_use[n].list);
+	}
+	for (n = 0; n < def_use->stack_slot_size; n++) {
+		free(def_use->stack_slot[n].def.list);
+	}
+	free(def_use->stack_slot);
+	free(def_use->seen);
+	free(def_use->def_mark);
+	free(def_use->stack);
+	free(def_use);
+	external_entry_point->def_use = NULL;
+}
+
+/* reg_stack: 1 = register init_value, 2 = local stack slot init_value:offset_value */
+struct def_use_list_s *def_use_find_def(struct def_use_s *def_use, int reg_stack,
+	uint64_t init_value, uint64_t offset_value)
+{
+	int low = 0;
+	int high;
+	int mid;
+	struct def_use_stack_slot_s *slot;
+
+	if (reg_stack == 1) {
+		if (init_value >= MAX_REG) {
+			return NULL;
+		}
+		return &def_use->reg_def[init_value];
+	}
+	high = def_use->stack_slot_size - 1;
+	while (low <= high) {
+		mid = (low + high) / 2;
+		slot = &def_use->stack_slot[mid];
+		if ((slot->init_value == init_value) && (slot->offset_value == offset_value)) {
+			return &slot->def;
+		}
+		if ((slot->init_value < init_value) ||
+			((slot->init_value == init_value) && (slot->offset_value < offset_value))) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return NULL;
+}
+
+static void def_use_push(struct def_use_s *def_use, int inst, int *sp)
+{
+	if (*sp >= def_use->stack_size) {
+		def_use->stack_size = def_use->stack_size ? def_use->stack_size * 2 : 64;
+		def_use->stack = realloc(def_use->stack, def_use->stack_size * sizeof(int));
+		if (!def_use->stack) {
+			debug_print(DEBUG_ANALYSE, 1, "def_use_push: realloc failed\n");
+			exit(1);
+		}
+	}
+	def_use->stack[*sp] = inst;
+	(*sp)++;
+}
+
+/* Which writes of the register or stack slot reach instruction inst.
+ * The search starts from the instructions before inst, like search_back did.
+ * Returns 0 and the list in inst_list, which the caller frees, or 1 on error.
+ */
+int def_use_reaching(struct self_s *self, struct def_use_s *def_use, int reg_stack,
+	uint64_t init_value, uint64_t offset_value, int inst, uint64_t *size, uint64_t **inst_list)
+{
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1;
+	struct def_use_list_s *def;
+	uint32_t epoch;
+	int sp = 0;
+	int n;
+
+	*size = 0;
+	*inst_list = NULL;
+	if (!def_use) {
+		debug_print(DEBUG_ANALYSE, 1, "def_use_reaching: no def_use index for inst 0x%x\n", inst);
+		return 1;
+	}
+	if ((inst < def_use->seen_base) || (inst >= def_use->seen_base + def_use->seen_size)) {
+		debug_print(DEBUG_ANALYSE, 1, "def_use_reaching: inst 0x%x out of range\n", inst);
+		return 1;
+	}
+	def = def_use_find_def(def_use, reg_stack, init_value, offset_value);
+	if (!def || !def->size) {
+		/* Never written in this function */
+		return 0;
+	}
+	def_use->epoch++;
+	if (!def_use->epoch) {
+		memset(def_use->seen, 0, def_use->seen_size * sizeof(uint32_t));
+		memset(def_use->def_mark, 0, def_use->seen_size * sizeof(uint32_t));
+		def_use->epoch = 1;
+	}
+	epoch = def_use->epoch;
+	for (n = 0; n < def->size; n++) {
+		def_use->def_mark[def->list[n] - def_use->seen_base] = epoch;
+	}
+	inst_log1 = &inst_log_entry[inst];
+	for (n = 0; n < inst_log1->prev_size; n++) {
+		def_use_push(def_use, inst_log1->prev[n], &sp);
+	}
+	while (sp > 0) {
+		sp--;
+		inst = def_use->stack[sp];
+		/* Outside the function's instructions */
+		if ((inst < def_use->seen_base) || (inst >= def_use->seen_base + def_use->seen_size) ||
+			(def_use->seen[inst - def_use->seen_base] == epoch)) {
+			continue;
+		}
+		def_use->seen[inst - def_use->seen_base] = epoch;
+		if (def_use->def_mark[inst - def_use->seen_base] == epoch) {
+			(*size)++;
+			*inst_list = realloc(*inst_list, *size * sizeof(**inst_list));
+			(*inst_list)[*size - 1] = inst;
+			continue;
+		}
+		inst_log1 = &inst_log_entry[inst];
+		for (n = 0; n < inst_log1->prev_size; n++) {
+			def_use_push(def_use, inst_log1->prev[n], &sp);
+		}
+	}
+	return 0;
+}
+
+/* The def-use index of the function that instruction inst was logged for */
+struct def_use_s *def_use_of_inst(struct self_s *self, int inst)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	int l;
+
+	l = inst_node_function(self, inst);
+	if (l) {
+		return external_entry_points[l - 1].def_use;
+	}
+	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
+		if (external_entry_points[l].valid &&
+			(external_entry_points[l].type == 1) &&
+			(inst >= external_entry_points[l].inst_log) &&
+			(inst <= external_entry_points[l].inst_log_end)) {
+			return external_entry_points[l].def_use;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,244 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Reaching flags.
+ * For every inst_log entry, self->flag_reach->producer[inst] holds the instruction
+ * whose flags are live on entry to it:
+ *   FLAG_REACH_NONE = no flag setting instruction reaches it.
+ *   > 0 = the single flag setting instruction that reaches it on every path.
+ *   FLAG_REACH_JOIN = different flag setting instructions reach it at a join.
+ * It is a forward work list pass over all the prev/next edges, so
+ * each instruction only changes value at most twice.
+ * flag_reach_update() redoes the part of the table after an instruction
+ * that has been rewritten or inserted, and is called by inst_edit_commit().
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+static int flag_reach_grow(struct flag_reach_s *reach, int size)
+{
+	int n;
+
+	if (size <= reach->size) {
+		return 0;
+	}
+	n = reach->size * 2;
+	if (n < size) {
+		n = size;
+	}
+	reach->producer = realloc(reach->producer, n * sizeof(int));
+	reach->queue = realloc(reach->queue, n * sizeof(int));
+	reach->stack = realloc(reach->stack, n * sizeof(int));
+	reach->in_list = realloc(reach->in_list, n * sizeof(uint8_t));
+	if (!reach->producer || !reach->queue || !reach->stack || !reach->in_list) {
+		debug_print(DEBUG_ANALYSE, 1, "flag_reach_grow: realloc failed\n");
+		exit(1);
+	}
+	memset(&(reach->producer[reach->size]), 0, (n - reach->size) * sizeof(int));
+	memset(&(reach->in_list[reach->size]), 0, (n - reach->size) * sizeof(uint8_t));
+	reach->size = n;
+	return 0;
+}
+
+/* The flags live on exit from inst */
+int flag_reach_out(struct self_s *self, int inst)
+{
+	if (1 == self->inst_log_entry[inst].instruction.flags) {
+		return inst;
+	}
+	return self->flag_reach->producer[inst];
+}
+
+static int flag_reach_meet(int value1, int value2)
+{
+	if (value1 == FLAG_REACH_NONE) {
+		return value2;
+	}
+	if ((value2 == FLAG_REACH_NONE) || (value1 == value2)) {
+		return value1;
+	}
+	return FLAG_REACH_JOIN;
+}
+
+/* The queue holds count entries, all marked in in_list.
+ * in_list is all clear again on return.
+ */
+static int flag_reach_solve(struct self_s *self, int count)
+{
+	struct flag_reach_s *reach = self->flag_reach;
+	struct inst_log_entry_s *inst_log1;
+	int size = reach->size;
+	int head = 0;
+	int inst;
+	int value;
+	int prev;
+	int next;
+	int n;
+
+	while (count > 0) {
+		inst = reach->queue[head];
+		head = (head + 1) % size;
+		count--;
+		reach->in_list[inst] = 0;
+		inst_log1 = &(self->inst_log_entry[inst]);
+		value = FLAG_REACH_NONE;
+		for (n = 0; n < inst_log1->prev_size; n++) {
+			prev = inst_log1->prev[n];
+			if ((prev > 0) && (prev < inst_log)) {
+				value = flag_reach_meet(value, flag_reach_out(self, prev));
+			}
+		}
+		if (value == reach->producer[inst]) {
+			continue;
+		}
+		reach->producer[inst] = value;
+		if (1 == inst_log1->instruction.flags) {
+			/* Sets its own flags, so the change stops here */
+			continue;
+		}
+		for (n = 0; n < inst_log1->next_size; n++) {
+			next = inst_log1->next[n];
+			if ((next > 0) && (next < inst_log) && !reach->in_list[next]) {
+				reach->queue[(head + count) % size] = next;
+				count++;
+				reach->in_list[next] = 1;
+			}
+		}
+	}
+	return 0;
+}
+
+int flag_reach_build(struct self_s *self)
+{
+	struct flag_reach_s *reach;
+	int count = 0;
+	int n;
+
+	if (!self->flag_reach) {
+		self->flag_reach = calloc(1, sizeof(struct flag_reach_s));
+		if (!self->flag_reach) {
+			debug_print(DEBUG_ANALYSE, 1, "flag_reach_build: calloc failed\n");
+			exit(1);
+		}
+	}
+	reach = self->flag_reach;
+	flag_reach_grow(reach, inst_log);
+	memset(reach->producer, 0, reach->size * sizeof(int));
+	for (n = 1; n < inst_log; n++) {
+		reach->queue[count++] = n;
+		reach->in_list[n] = 1;
+	}
+	flag_reach_solve(self, count);
+	return 0;
+}
+
+/* inst has been inserted, or its flags or edges changed.
+ * Only the instructions reachable from inst without passing through
+ * another flag setting instruction can change, so reset and solve just those.
+ * A plain re-solve from the old values is not enough, as a loop would
+ * keep feeding a removed producer back to itself.
+ */
+int flag_reach_update(struct self_s *self, int inst)
+{
+	struct flag_reach_s *reach = self->flag_reach;
+	struct inst_log_entry_s *inst_log1;
+	int stack_size = 0;
+	int count = 0;
+	int this;
+	int next;
+	int n;
+
+	if (!reach) {
+		/* Not built yet. Nothing to keep up to date */
+		return 0;
+	}
+	flag_reach_grow(reach, inst_log);
+	reach->stack[stack_size++] = inst;
+	reach->in_list[inst] = 1;
+	while (stack_size > 0) {
+		this = reach->stack[--stack_size];
+		reach->queue[count++] = this;
+		reach->producer[this] = FLAG_REACH_NONE;
+		inst_log1 = &(self->inst_log_entry[this]);
+		if ((this != inst) && (1 == inst_log1->instruction.flags)) {
+			continue;
+		}
+		for (n = 0; n < inst_log1->next_size; n++) {
+			next = inst_log1->next[n];
+			if ((next > 0) && (next < inst_log) && !reach->in_list[next]) {
+				reach->stack[stack_size++] = next;
+				reach->in_list[next] = 1;
+			}
+		}
+	}
+	flag_reach_solve(self, count);
+	return 0;
+}
+
+/* The producer whose flags reach inst, or 0 if there is not exactly one */
+int flag_reach_producer(struct self_s *self, int inst)
+{
+	int producer;
+
+	if (!self->flag_reach || (inst >= self->flag_reach->size)) {
+		return 0;
+	}
+	producer = self->flag_reach->producer[inst];
+	return (producer > 0) ? producer : 0;
+}
+
+/* Where different flags meet at inst, the producer along the prev[0] path.
+ * The prev[0] of a JOIN can be a JOIN too, so keep going back until a single
+ * producer is found. Returns 0 if there is none, or the path loops.
+ */
+int flag_reach_first_prev(struct self_s *self, int inst)
+{
+	struct inst_log_entry_s *inst_log1;
+	int producer = FLAG_REACH_JOIN;
+	int steps;
+
+	for (steps = 0; (producer == FLAG_REACH_JOIN) && (steps < inst_log); steps++) {
+		inst_log1 = &(self->inst_log_entry[inst]);
+		if ((inst_log1->prev_size < 1) || (inst_log1->prev[0] <= 0) ||
+			(inst_log1->prev[0] >= inst_log)) {
+			return 0;
+		}
+		inst = inst_log1->prev[0];
+		producer = flag_reach_out(self, inst);
+	}
+	return (producer > 0) ? producer : 0;
+}
+
+int flag_reach_free(struct self_s *self)
+{
+	struct flag_reach_s *reach = self->flag_reach;
+
+	if (!reach) {
+		return 0;
+	}
+	free(reach->producer);
+	free(reach->queue);
+	free(reach->stack);
+	free(reach->in_list);
+	free(reach);
+	self->flag_reach = NULL;
+	return 0;
+}
@@ -0,0 +1,462 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Batched edits of the inst_log.
+ * inst_edit_insert_before(), inst_edit_insert_after(), inst_edit_changed()
+ * and inst_edit_delete() only record the edit.
+ * An inserted instruction gets its inst_log number at once, as a NOP,
+ * so the caller can fill it in straight away, but it is not linked in
+ * until inst_edit_commit().
+ * inst_edit_commit() applies the edits in the order they were recorded,
+ * looks up entry points in an index instead of scanning them all,
+ * and refreshes the inst_log_hot and flag_reach tables once for the batch.
+ * An inserted instruction joins the node and function of the one it is next to.
+ * The per inst flag_dependency tables grow by doubling.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+static struct inst_edit_s *inst_edit_get(struct self_s *self)
+{
+	if (!self->inst_edit) {
+		self->inst_edit = calloc(1, sizeof(struct inst_edit_s));
+		if (!self->inst_edit) {
+			debug_print(DEBUG_ANALYSE, 1, "inst_edit_get: calloc failed\n");
+			exit(1);
+		}
+	}
+	return self->inst_edit;
+}
+
+static int inst_edit_record(struct self_s *self, int type, int inst, int new_inst)
+{
+	struct inst_edit_s *edit = inst_edit_get(self);
+
+	if (edit->size >= edit->max) {
+		edit->max = edit->max ? edit->max * 2 : 64;
+		edit->list = realloc(edit->list, edit->max * sizeof(struct inst_edit_entry_s));
+		if (!edit->list) {
+			debug_print(DEBUG_ANALYSE, 1, "inst_edit_record: realloc failed\n");
+			exit(1);
+		}
+	}
+	edit->list[edit->size].type = type;
+	edit->list[edit->size].inst = inst;
+	edit->list[edit->size].new_inst = new_inst;
+	edit->size++;
+	return 0;
+}
+
+/* Grow the flag_dependency tables to cover size entries */
+int flag_dependency_grow(struct self_s *self, int size)
+{
+	int n;
+
+	if (size > self->flag_dependency_max) {
+		n = self->flag_dependency_max * 2;
+		if (n < size) {
+			n = size;
+		}
+		self->flag_dependency = realloc(self->flag_dependency, n * sizeof(int));
+		self->flag_dependency_opcode = realloc(self->flag_dependency_opcode, n * sizeof(int));
+		self->flag_result_users = realloc(self->flag_result_users, n * sizeof(int));
+		if (!self->flag_dependency || !self->flag_dependency_opcode || !self->flag_result_users) {
+			debug_print(DEBUG_ANALYSE, 1, "flag_dependency_grow: realloc failed\n");
+			exit(1);
+		}
+		self->flag_dependency_max = n;
+	}
+	for (n = self->flag_dependency_size; n < size; n++) {
+		self->flag_dependency[n] = 0;
+		self->flag_dependency_opcode[n] = 0;
+		self->flag_result_users[n] = 0;
+	}
+	if (size > self->flag_dependency_size) {
+		self->flag_dependency_size = size;
+	}
+	return 0;
+}
+
+/* Take the next inst_log entry, as an unlinked NOP */
+static int inst_edit_new_inst(struct self_s *self, int *new_inst)
+{
+	struct inst_log_entry_s *inst_log1;
+
+	if (inst_log >= INST_LOG_ENTRY_SIZE) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_edit_new_inst: inst_log full at 0x%"PRIx64"\n", inst_log);
+		return 1;
+	}
+	*new_inst = inst_log;
+	inst_log1 = &(self->inst_log_entry[inst_log]);
+	inst_log++;
+	if (self->flag_dependency) {
+		flag_dependency_grow(self, inst_log);
+	}
+	inst_log1->instruction.opcode = NOP;
+	inst_log1->instruction.flags = 0;
+	inst_log1->prev_size = 0;
+	inst_log1->prev = NULL;
+	inst_log1->next_size = 0;
+	inst_log1->next = NULL;
+	inst_log_hot_update(self, *new_inst);
+	return 0;
+}
+
+int inst_edit_insert_before(struct self_s *self, int inst, int *new_inst)
+{
+	int tmp;
+
+	tmp = inst_edit_new_inst(self, new_inst);
+	if (tmp) {
+		return tmp;
+	}
+	debug_print(DEBUG_ANALYSE, 1, "INFO: Insert nop before: inst 0x%x new inst 0x%x\n", inst, *new_inst);
+	return inst_edit_record(self, INST_EDIT_INSERT_BEFORE, inst, *new_inst);
+}
+
+int inst_edit_insert_after(struct self_s *self, int inst, int *new_inst)
+{
+	int tmp;
+
+	if (self->inst_log_entry[inst].next_size > 1) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_edit_insert_after: FAILED Inst 0x%x\n", inst);
+		return 1;
+	}
+	tmp = inst_edit_new_inst(self, new_inst);
+	if (tmp) {
+		return tmp;
+	}
+	debug_print(DEBUG_ANALYSE, 1, "INFO: Insert nop after: inst 0x%x new inst 0x%x\n", inst, *new_inst);
+	return inst_edit_record(self, INST_EDIT_INSERT_AFTER, inst, *new_inst);
+}
+
+/* inst has been rewritten in place. For example, by substitute_inst() */
+int inst_edit_changed(struct self_s *self, int inst)
+{
+	return inst_edit_record(self, INST_EDIT_CHANGED, inst, 0);
+}
+
+int inst_edit_delete(struct self_s *self, int inst)
+{
+	return inst_edit_record(self, INST_EDIT_DELETE, inst, 0);
+}
+
+static int inst_edit_entry_point_cmp(const void *p1, const void *p2)
+{
+	const struct inst_edit_entry_point_s *entry1 = p1;
+	const struct inst_edit_entry_point_s *entry2 = p2;
+
+	return (entry1->inst > entry2->inst) - (entry1->inst < entry2->inst);
+}
+
+/* The external_entry_points index whose inst_log is inst, or -1.
+ * The index is built the first time a commit needs it.
+ */
+static int inst_edit_entry_point_find(struct self_s *self, struct inst_edit_s *edit, int inst)
+{
+	struct inst_edit_entry_point_s key;
+	struct inst_edit_entry_point_s *found;
+	int l;
+
+	if (!edit->entry_points) {
+		edit->entry_points = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct inst_edit_entry_point_s));
+		if (!edit->entry_points) {
+			debug_print(DEBUG_ANALYSE, 1, "inst_edit_entry_point_find: calloc failed\n");
+			exit(1);
+		}
+		edit->entry_points_size = 0;
+		for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
+			if ((self->external_entry_points[l].valid != 0) &&
+				(self->external_entry_points[l].type == 1)) {
+				edit->entry_points[edit->entry_points_size].inst = self->external_entry_points[l].inst_log;
+				edit->entry_points[edit->entry_points_size].entry = l;
+				edit->entry_points_size++;
+			}
+		}
+		qsort(edit->entry_points, edit->entry_points_size,
+			sizeof(struct inst_edit_entry_point_s), inst_edit_entry_point_cmp);
+	}
+	key.inst = inst;
+	found = bsearch(&key, edit->entry_points, edit->entry_points_size,
+		sizeof(struct inst_edit_entry_point_s), inst_edit_entry_point_cmp);
+	if (!found) {
+		return -1;
+	}
+	return found->entry;
+}
+
+/* Point the entry point at inst to new_inst. Keeps the index sorted. */
+static int inst_edit_entry_point_move(struct self_s *self, struct inst_edit_s *edit, int inst, int new_inst)
+{
+	int l;
+	int n;
+
+	l = inst_edit_entry_point_find(self, edit, inst);
+	if (l < 0) {
+		return 0;
+	}
+	self->external_entry_points[l].inst_log = new_inst;
+	debug_print(DEBUG_ANALYSE, 1, "fixing entry point[0x%x] from 0x%x to 0x%x\n",
+		l, inst, new_inst);
+	for (n = 0; n < edit->entry_points_size; n++) {
+		if (edit->entry_points[n].entry == l) {
+			edit->entry_points[n].inst = new_inst;
+			break;
+		}
+	}
+	qsort(edit->entry_points, edit->entry_points_size,
+		sizeof(struct inst_edit_entry_point_s), inst_edit_entry_point_cmp);
+	return 0;
+}
+
+static int inst_edit_apply_insert_before(struct self_s *self, struct inst_edit_s *edit, int inst, int inst_new)
+{
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1 = &inst_log_entry[inst];
+	struct inst_log_entry_s *inst_log1_previous;
+	struct inst_log_entry_s *inst_log1_new = &inst_log_entry[inst_new];
+	int m, n;
+
+	if (inst_log1->prev_size) {
+		inst_log1_new->prev = calloc(inst_log1->prev_size, sizeof(int));
+		inst_log1_new->prev_size = inst_log1->prev_size;
+		for (n = 0; n < inst_log1->prev_size; n++) {
+			inst_log1_new->prev[n] = inst_log1->prev[n];
+			if (inst_log1->prev[n] == 0) {
+				debug_print(DEBUG_ANALYSE, 1, "ERROR: Insert nop before first instruction not yet supported. Case 0\n");
+				/* Move the entry point. Should never get here */
+				exit(1);
+			}
+			inst_log1_previous = &inst_log_entry[inst_log1->prev[n]];
+			for (m = 0; m < inst_log1_previous->next_size; m++) {
+				if (inst_log1_previous->next[m] == inst) {
+					inst_log1_previous->next[m] = inst_new;
+				}
+			}
+			inst_log_hot_update(self, inst_log1->prev[n]);
+		}
+	} else {
+		inst_edit_entry_point_move(self, edit, inst, inst_new);
+	}
+	inst_log1_new->next = calloc(1, sizeof(int));
+	inst_log1_new->next_size = 1;
+	inst_log1_new->next[0] = inst;
+	if (0 == inst_log1->prev_size) {
+		inst_log1->prev = calloc(1, sizeof(int));
+	}
+	inst_log1->prev_size = 1;
+	inst_log1->prev[0] = inst_new;
+	inst_log_hot_update(self, inst_new);
+	inst_log_hot_update(self, inst);
+	return 0;
+}
+
+static int inst_edit_apply_insert_after(struct self_s *self, int inst, int inst_new)
+{
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1 = &inst_log_entry[inst];
+	struct inst_log_entry_s *inst_log1_next;
+	struct inst_log_entry_s *inst_log1_new = &inst_log_entry[inst_new];
+	int m, n;
+
+	if (inst_log1->next_size > 1) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_edit_apply_insert_after: FAILED Inst 0x%x\n", inst);
+		return 1;
+	}
+	if (inst_log1->next_size) {
+		inst_log1_new->next = calloc(inst_log1->next_size, sizeof(int));
+		inst_log1_new->next_size = inst_log1->next_size;
+		for (n = 0; n < inst_log1->next_size; n++) {
+			inst_log1_new->next[n] = inst_log1->next[n];
+			inst_log1_next = &inst_log_entry[inst_log1->next[n]];
+			for (m = 0; m < inst_log1_next->prev_size; m++) {
+				if (inst_log1_next->prev[m] == inst) {
+					inst_log1_next->prev[m] = inst_new;
+				}
+			}
+			inst_log_hot_update(self, inst_log1->next[n]);
+		}
+	} else {
+		inst_log1->next = calloc(1, sizeof(int));
+	}
+	inst_log1_new->prev = calloc(1, sizeof(int));
+	inst_log1_new->prev_size = 1;
+	inst_log1_new->prev[0] = inst;
+	inst_log1->next_size = 1;
+	inst_log1->next[0] = inst_new;
+	inst_log_hot_update(self, inst_new);
+	inst_log_hot_update(self, inst);
+	return 0;
+}
+
+/* Unlink inst, joining its prev instructions to its single next instruction */
+static int inst_edit_apply_delete(struct self_s *self, struct inst_edit_s *edit, int inst)
+{
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1 = &inst_log_entry[inst];
+	struct inst_log_entry_s *inst_log1_previous;
+	struct inst_log_entry_s *inst_log1_next = NULL;
+	int next = 0;
+	int prev;
+	int m, n;
+
+	if (inst_log1->next_size > 1) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_edit_apply_delete: FAILED Inst 0x%x has 0x%x next\n",
+			inst, inst_log1->next_size);
+		return 1;
+	}
+	if (inst_log1->next_size) {
+		next = inst_log1->next[0];
+		inst_log1_next = &inst_log_entry[next];
+	}
+	for (n = 0; n < inst_log1->prev_size; n++) {
+		prev = inst_log1->prev[n];
+		inst_log1_previous = &inst_log_entry[prev];
+		for (m = 0; m < inst_log1_previous->next_size; m++) {
+			if (inst_log1_previous->next[m] != inst) {
+				continue;
+			}
+			if (next) {
+				inst_log1_previous->next[m] = next;
+			} else {
+				inst_log1_previous->next_size--;
+				inst_log1_previous->next[m] = inst_log1_previous->next[inst_log1_previous->next_size];
+				m--;
+			}
+		}
+		inst_log_hot_update(self, prev);
+	}
+	if (inst_log1_next) {
+		for (m = 0; m < inst_log1_next->prev_size; m++) {
+			if (inst_log1_next->prev[m] == inst) {
+				break;
+			}
+		}
+		if (m < inst_log1_next->prev_size) {
+			/* Replace inst by its prev list */
+			inst_log1_next->prev_size--;
+			inst_log1_next->prev[m] = inst_log1_next->prev[inst_log1_next->prev_size];
+		}
+		if (inst_log1->prev_size) {
+			inst_log1_next->prev = realloc(inst_log1_next->prev,
+				(inst_log1_next->prev_size + inst_log1->prev_size) * sizeof(int));
+			if (!inst_log1_next->prev) {
+				debug_print(DEBUG_ANALYSE, 1, "inst_edit_apply_delete: realloc failed\n");
+				exit(1);
+			}
+			for (n = 0; n < inst_log1->prev_size; n++) {
+				inst_log1_next->prev[inst_log1_next->prev_size++] = inst_log1->prev[n];
+			}
+		} else {
+			inst_edit_entry_point_move(self, edit, inst, next);
+		}
+		inst_log_hot_update(self, next);
+	}
+	free(inst_log1->prev);
+	free(inst_log1->next);
+	inst_log1->prev = NULL;
+	inst_log1->next = NULL;
+	inst_log1->prev_size = 0;
+	inst_log1->next_size = 0;
+	inst_log1->instruction.opcode = NOP;
+	inst_log1->instruction.flags = 0;
+	inst_log_hot_update(self, inst);
+	return 0;
+}
+
+/* Apply all the recorded edits. Returns 1 if any of them failed. */
+int inst_edit_commit(struct self_s *self)
+{
+	struct inst_edit_s *edit = self->inst_edit;
+	struct inst_edit_entry_s *entry;
+	int rebuild;
+	int ret = 0;
+	int tmp;
+	int n;
+
+	if (!edit || !edit->size) {
+		return 0;
+	}
+	for (n = 0; n < edit->size; n++) {
+		entry = &(edit->list[n]);
+		switch (entry->type) {
+		case INST_EDIT_INSERT_BEFORE:
+			tmp = inst_edit_apply_insert_before(self, edit, entry->inst, entry->new_inst);
+			inst_node_copy(self, entry->new_inst, entry->inst);
+			break;
+		case INST_EDIT_INSERT_AFTER:
+			tmp = inst_edit_apply_insert_after(self, entry->inst, entry->new_inst);
+			inst_node_copy(self, entry->new_inst, entry->inst);
+			break;
+		case INST_EDIT_CHANGED:
+			inst_log_hot_update(self, entry->inst);
+			tmp = 0;
+			break;
+		case INST_EDIT_DELETE:
+			/* Keep the next inst, as that is where the flags change */
+			if (self->inst_log_entry[entry->inst].next_size) {
+				entry->new_inst = self->inst_log_entry[entry->inst].next[0];
+			}
+			tmp = inst_edit_apply_delete(self, edit, entry->inst);
+			break;
+		default:
+			debug_print(DEBUG_ANALYSE, 1, "inst_edit_commit: unknown edit 0x%x\n", entry->type);
+			tmp = 1;
+			break;
+		}
+		if (tmp) {
+			ret = 1;
+		}
+	}
+	/* A large batch is cheaper to re-solve in one go */
+	rebuild = (edit->size * 8 > inst_log);
+	if (self->flag_reach && rebuild) {
+		flag_reach_build(self);
+	} else if (self->flag_reach) {
+		for (n = 0; n < edit->size; n++) {
+			entry = &(edit->list[n]);
+			if (entry->new_inst) {
+				flag_reach_update(self, entry->new_inst);
+			}
+			flag_reach_update(self, entry->inst);
+		}
+	}
+	debug_print(DEBUG_ANALYSE, 1, "inst_edit_commit: 0x%x edits\n", edit->size);
+	edit->size = 0;
+	free(edit->entry_points);
+	edit->entry_points = NULL;
+	edit->entry_points_size = 0;
+	return ret;
+}
+
+int inst_edit_free(struct self_s *self)
+{
+	struct inst_edit_s *edit = self->inst_edit;
+
+	if (!edit) {
+		return 0;
+	}
+	free(edit->list);
+	free(edit->entry_points);
+	free(edit);
+	self->inst_edit = NULL;
+	return 0;
+}
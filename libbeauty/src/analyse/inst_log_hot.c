@@ -0,0 +1,141 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* The inst_log_entry_s is large, mostly because of the three memory_s values.
+ * The passes that only walk opcodes, operands and edges use the
+ * dense inst_log_hot_s arrays instead, so they stream through far less memory.
+ * The opcode, operands and edges stay in inst_log_entry_s as well. The
+ * execute, label and output code reads them next to the memory_s values of
+ * the same instruction, and the full next[] and prev[] lists are only there.
+ * So this is a copy, built once the execution is done by inst_log_hot_build().
+ * After that, every change of those fields calls inst_log_hot_update() for
+ * the instruction, either straight away or through inst_edit_changed() and
+ * inst_edit_commit().
+ * The node fields are only held here, so neither of them touches those.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+static void operand_to_hot(struct operand_s *operand, struct operand_hot_s *hot)
+{
+	hot->store = operand->store;
+	hot->indirect = operand->indirect;
+	hot->index = operand->index;
+	hot->value_size = operand->value_size;
+}
+
+static int inst_log_hot_grow(struct inst_log_hot_s *hot, int size)
+{
+	int n;
+
+	if (size <= hot->size) {
+		return 0;
+	}
+	/* Double, so the inserts one at a time are cheap */
+	n = hot->size * 2;
+	if (n < size) {
+		n = size;
+	}
+	hot->instruction = realloc(hot->instruction, n * sizeof(struct instruction_hot_s));
+	hot->prev_size = realloc(hot->prev_size, n * sizeof(int));
+	hot->prev = realloc(hot->prev, n * sizeof(int));
+	hot->next_size = realloc(hot->next_size, n * sizeof(int));
+	hot->next = realloc(hot->next, n * sizeof(int));
+	hot->node_start = realloc(hot->node_start, n * sizeof(uint8_t));
+	hot->node_member = realloc(hot->node_member, n * sizeof(int));
+	hot->node_end = realloc(hot->node_end, n * sizeof(uint8_t));
+	if (!hot->instruction || !hot->prev_size || !hot->prev ||
+		!hot->next_size || !hot->next || !hot->node_start ||
+		!hot->node_member || !hot->node_end) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_log_hot_grow: realloc failed\n");
+		exit(1);
+	}
+	/* New instructions are not in a node yet */
+	memset(&(hot->node_start[hot->size]), 0, (n - hot->size) * sizeof(uint8_t));
+	memset(&(hot->node_member[hot->size]), 0, (n - hot->size) * sizeof(int));
+	memset(&(hot->node_end[hot->size]), 0, (n - hot->size) * sizeof(uint8_t));
+	hot->size = n;
+	return 0;
+}
+
+int inst_log_hot_update(struct self_s *self, int inst)
+{
+	struct inst_log_hot_s *hot = self->inst_log_hot;
+	struct inst_log_entry_s *inst_log1;
+	struct instruction_hot_s *instruction;
+
+	if (!hot) {
+		/* Not built yet. Nothing to keep up to date */
+		return 0;
+	}
+	inst_log_hot_grow(hot, inst + 1);
+	inst_log1 = &(self->inst_log_entry[inst]);
+	instruction = &(hot->instruction[inst]);
+	instruction->opcode = inst_log1->instruction.opcode;
+	instruction->flags = inst_log1->instruction.flags;
+	operand_to_hot(&(inst_log1->instruction.srcA), &(instruction->srcA));
+	operand_to_hot(&(inst_log1->instruction.srcB), &(instruction->srcB));
+	operand_to_hot(&(inst_log1->instruction.dstA), &(instruction->dstA));
+	hot->prev_size[inst] = inst_log1->prev_size;
+	hot->prev[inst] = (inst_log1->prev_size > 0) ? inst_log1->prev[0] : 0;
+	hot->next_size[inst] = inst_log1->next_size;
+	hot->next[inst] = (inst_log1->next_size > 0) ? inst_log1->next[0] : 0;
+	return 0;
+}
+
+int inst_log_hot_build(struct self_s *self)
+{
+	int n;
+
+	if (!self->inst_log_hot) {
+		self->inst_log_hot = calloc(1, sizeof(struct inst_log_hot_s));
+		if (!self->inst_log_hot) {
+			debug_print(DEBUG_ANALYSE, 1, "inst_log_hot_build: calloc failed\n");
+			exit(1);
+		}
+	}
+	inst_log_hot_grow(self->inst_log_hot, inst_log);
+	for (n = 0; n < inst_log; n++) {
+		inst_log_hot_update(self, n);
+	}
+	debug_print(DEBUG_ANALYSE, 1, "inst_log_hot_build: 0x%"PRIx64" entries\n", inst_log);
+	return 0;
+}
+
+int inst_log_hot_free(struct self_s *self)
+{
+	struct inst_log_hot_s *hot = self->inst_log_hot;
+
+	if (!hot) {
+		return 0;
+	}
+	free(hot->instruction);
+	free(hot->prev_size);
+	free(hot->prev);
+	free(hot->next_size);
+	free(hot->next);
+	free(hot->node_start);
+	free(hot->node_member);
+	free(hot->node_end);
+	free(hot);
+	self->inst_log_hot = NULL;
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Instruction to node lookups.
+ * build_control_flow_nodes() sets node_member, the node in the global nodes table,
+ * on every instruction of every node, so find_node_from_inst() is a read of
+ * the inst_log_hot table.
+ * self->inst_node adds the function each instruction is in.
+ * inst_node_set_function() fills it in, from
+ * create_function_node_members() and again after analyse_merge_nodes().
+ * inst_edit_commit() calls inst_node_copy() so an inserted instruction
+ * gets the node and function of the one it was inserted next to.
+ * dis64 frees it with inst_node_free() once the LLVM export is done.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+static int inst_node_grow(struct inst_node_s *index, int size)
+{
+	int n;
+
+	if (size <= index->size) {
+		return 0;
+	}
+	n = index->size * 2;
+	if (n < size) {
+		n = size;
+	}
+	index->function = realloc(index->function, n * sizeof(int));
+	if (!index->function) {
+		debug_print(DEBUG_ANALYSE, 1, "inst_node_grow: realloc failed\n");
+		exit(1);
+	}
+	memset(&(index->function[index->size]), 0, (n - index->size) * sizeof(int));
+	index->size = n;
+	return 0;
+}
+
+/* function is the external_entry_points[] index */
+int inst_node_set_function(struct self_s *self, int function)
+{
+	struct external_entry_point_s *external_entry_point = &(self->external_entry_points[function]);
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_node_s *index;
+	int node;
+	int inst;
+
+	if (!self->inst_node) {
+		self->inst_node = calloc(1, sizeof(struct inst_node_s));
+		if (!self->inst_node) {
+			debug_print(DEBUG_ANALYSE, 1, "inst_node_set_function: calloc failed\n");
+			exit(1);
+		}
+	}
+	index = self->inst_node;
+	inst_node_grow(index, inst_log);
+	for (node = 1; node < external_entry_point->nodes_size; node++) {
+		if (!nodes[node].valid) {
+			continue;
+		}
+		inst = nodes[node].inst_start;
+		while ((inst > 0) && (inst < inst_log)) {
+			index->function[inst] = function + 1;
+			if ((inst == nodes[node].inst_end) ||
+				(inst_log_entry[inst].next_size != 1)) {
+				break;
+			}
+			inst = inst_log_entry[inst].next[0];
+		}
+	}
+	return 0;
+}
+
+/* inst was inserted next to from. It joins the same node and function */
+int inst_node_copy(struct self_s *self, int inst, int from)
+{
+	struct inst_node_s *index = self->inst_node;
+
+	inst_log_hot_update(self, inst);
+	if (self->inst_log_hot && (from < self->inst_log_hot->size)) {
+		self->inst_log_hot->node_member[inst] = self->inst_log_hot->node_member[from];
+	}
+	if (!index || (from >= index->size)) {
+		return 0;
+	}
+	inst_node_grow(index, inst + 1);
+	index->function[inst] = index->function[from];
+	return 0;
+}
+
+/* The external_entry_points[] index + 1 of the function inst is in. 0 = not known */
+int inst_node_function(struct self_s *self, int inst)
+{
+	struct inst_node_s *index = self->inst_node;
+
+	if (!index || (inst <= 0) || (inst >= index->size)) {
+		return 0;
+	}
+	return index->function[inst];
+}
+
+int inst_node_free(struct self_s *self)
+{
+	struct inst_node_s *index = self->inst_node;
+
+	if (!index) {
+		return 0;
+	}
+	free(index->function);
+	free(index);
+	self->inst_node = NULL;
+	return 0;
+}
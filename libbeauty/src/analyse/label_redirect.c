@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Label equivalence.
+ * The label_redirect table is a union-find forest over the value_ids.
+ * label_redirect_union() makes two value_ids share a label, with union by rank
+ * and path halving, and keeps the label the set uses at its root.
+ * The .redirect field is what everything else reads.
+ * label_redirect_canonicalize() sets it, for every value_id, to the label
+ * of its set. After that, each lookup is one index, however long the
+ * chain of MOVs was.
+ * Entries that were never given a label stay in the set of value_id 0.
+ * That matches the old calloc()ed table, where they redirect to 0.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+/* Make room for value_ids below size, in both label_redirect and labels */
+int label_redirect_reserve(struct external_entry_point_s *external_entry_point, int size)
+{
+	int old_size = external_entry_point->label_redirect_size;
+	int n;
+
+	if (size <= old_size) {
+		return 0;
+	}
+	n = old_size * 2;
+	if (n < size) {
+		n = size;
+	}
+	external_entry_point->label_redirect = realloc(external_entry_point->label_redirect,
+		n * sizeof(struct label_redirect_s));
+	external_entry_point->labels = realloc(external_entry_point->labels,
+		n * sizeof(struct label_s));
+	if (!external_entry_point->label_redirect || !external_entry_point->labels) {
+		debug_print(DEBUG_ANALYSE, 1, "label_redirect_reserve: realloc failed\n");
+		exit(1);
+	}
+	memset(&(external_entry_point->label_redirect[old_size]), 0,
+		(n - old_size) * sizeof(struct label_redirect_s));
+	memset(&(external_entry_point->labels[old_size]), 0,
+		(n - old_size) * sizeof(struct label_s));
+	external_entry_point->label_redirect_size = n;
+	return 0;
+}
+
+/* id gets its own label */
+int label_redirect_init(struct label_redirect_s *label_redirect, uint64_t id)
+{
+	label_redirect[id].redirect = id;
+	label_redirect[id].parent = id;
+	label_redirect[id].rank = 0;
+	label_redirect[id].label = id;
+	return 0;
+}
+
+uint64_t label_redirect_find(struct label_redirect_s *label_redirect, uint64_t id)
+{
+	uint64_t parent;
+
+	while ((parent = label_redirect[id].parent) != id) {
+		/* Path halving. Point at the grandparent as we go */
+		label_redirect[id].parent = label_redirect[parent].parent;
+		id = label_redirect[id].parent;
+	}
+	return id;
+}
+
+/* dst now uses the same label as src. As for a "MOV src, dst" */
+int label_redirect_union(struct label_redirect_s *label_redirect, uint64_t dst, uint64_t src)
+{
+	uint64_t root_dst;
+	uint64_t root_src;
+	uint64_t label;
+
+	if (!dst) {
+		debug_print(DEBUG_ANALYSE, 1, "label_redirect_union: no dst value_id. src = 0x%"PRIx64"\n", src);
+		return 1;
+	}
+	/* A parent of 0 means the value_id was never given a label */
+	if (!label_redirect[dst].parent) {
+		label_redirect_init(label_redirect, dst);
+	}
+	if (src && !label_redirect[src].parent) {
+		src = 0;
+	}
+	root_dst = label_redirect_find(label_redirect, dst);
+	if (!src) {
+		/* No src label. Same as the old table, the dst set redirects to 0 */
+		label_redirect[root_dst].label = 0;
+		label_redirect[dst].redirect = 0;
+		return 0;
+	}
+	root_src = label_redirect_find(label_redirect, src);
+	label = label_redirect[root_src].label;
+	if (root_dst != root_src) {
+		if (label_redirect[root_dst].rank < label_redirect[root_src].rank) {
+			label_redirect[root_dst].parent = root_src;
+		} else {
+			label_redirect[root_src].parent = root_dst;
+			if (label_redirect[root_dst].rank == label_redirect[root_src].rank) {
+				label_redirect[root_dst].rank++;
+			}
+			label_redirect[root_dst].label = label;
+		}
+	}
+	/* Keep the two ends readable before label_redirect_canonicalize() */
+	label_redirect[dst].redirect = label;
+	label_redirect[src].redirect = label;
+	return 0;
+}
+
+/* Point every .redirect straight at the label of its set */
+int label_redirect_canonicalize(struct external_entry_point_s *external_entry_point)
+{
+	struct label_redirect_s *label_redirect = external_entry_point->label_redirect;
+	uint64_t root;
+	int size = external_entry_point->variable_id;
+	int n;
+
+	if (size > external_entry_point->label_redirect_size) {
+		size = external_entry_point->label_redirect_size;
+	}
+	for (n = 0; n < size; n++) {
+		root = label_redirect_find(label_redirect, n);
+		label_redirect[n].redirect = label_redirect[root].label;
+	}
+	return 0;
+}
@@ -0,0 +1,431 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Per phase statistics.
+ * stats_begin() and stats_end() bracket a phase of main(), either for the
+ * whole program (function = -1) or for one function. Each pair is a record of
+ * the wall time, CPU time and peak RSS at both ends, and the counters at the end.
+ * Records may nest, e.g. a function inside its phase.
+ * With self->stats NULL they do nothing, so the calls can stay in place.
+ * stats_write_json() writes the records, and the largest counters of every function.
+ * stats_write_trace() writes the same records as trace events, a begin and an end
+ * per record on the thread that made it, for chrome://tracing or Perfetto.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <rev.h>
+
+static uint64_t stats_clock(clockid_t clock)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clock, &ts)) {
+		return 0;
+	}
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static long stats_max_rss(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+	return usage.ru_maxrss;
+}
+
+static void stats_lock(struct stats_s *stats)
+{
+	while (__sync_lock_test_and_set(&(stats->lock), 1)) {
+		/* Only held for a copy */
+	}
+}
+
+static void stats_unlock(struct stats_s *stats)
+{
+	__sync_lock_release(&(stats->lock));
+}
+
+/* function = -1 counts every function */
+static int stats_count(struct self_s *self, int function, uint64_t *counter)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct control_flow_node_s *nodes;
+	int first = 0;
+	int last = EXTERNAL_ENTRY_POINTS_MAX;
+	int l;
+	int node;
+
+	memset(counter, 0, STATS_COUNTER_MAX * sizeof(uint64_t));
+	counter[STATS_COUNTER_INSTRUCTIONS] = inst_log - 1;
+	if (!external_entry_points) {
+		return 0;
+	}
+	if (function >= 0) {
+		first = function;
+		last = function + 1;
+	}
+	for (l = first; l < last; l++) {
+		if (!external_entry_points[l].valid || (external_entry_points[l].type != 1)) {
+			continue;
+		}
+		if (function >= 0) {
+			counter[STATS_COUNTER_INSTRUCTIONS] = 0;
+			if (external_entry_points[l].inst_log_end >= external_entry_points[l].inst_log) {
+				counter[STATS_COUNTER_INSTRUCTIONS] = external_entry_points[l].inst_log_end -
+					external_entry_points[l].inst_log + 1;
+			}
+		}
+		nodes = external_entry_points[l].nodes;
+		if (external_entry_points[l].nodes_size > 1) {
+			counter[STATS_COUNTER_NODES] += external_entry_points[l].nodes_size - 1;
+		}
+		counter[STATS_COUNTER_PATHS] += external_entry_points[l].paths_size;
+		counter[STATS_COUNTER_LABELS] += external_entry_points[l].variable_id;
+		for (node = 1; nodes && (node < external_entry_points[l].nodes_size); node++) {
+			counter[STATS_COUNTER_PHIS] += nodes[node].phi_size;
+		}
+	}
+	return 0;
+}
+
+int stats_open(struct self_s *self)
+{
+	struct stats_s *stats;
+
+	stats_close(self);
+	stats = calloc(1, sizeof(struct stats_s));
+	if (!stats) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_open: calloc failed\n");
+		exit(1);
+	}
+	stats->wall_base = stats_clock(CLOCK_MONOTONIC);
+	stats->cpu_base = stats_clock(CLOCK_PROCESS_CPUTIME_ID);
+	self->stats = stats;
+	return 0;
+}
+
+/* Returns the record to pass to stats_end(). Safe to call from other threads */
+int stats_begin(struct self_s *self, const char *phase, int function)
+{
+	struct stats_s *stats = self->stats;
+	struct stats_record_s *record;
+	int n;
+
+	if (!stats) {
+		return -1;
+	}
+	stats_lock(stats);
+	if (stats->size >= stats->max) {
+		stats->max = stats->max ? stats->max * 2 : 256;
+		stats->record = realloc(stats->record, stats->max * sizeof(struct stats_record_s));
+		if (!stats->record) {
+			debug_print(DEBUG_ANALYSE, 1, "stats_begin: realloc failed\n");
+			exit(1);
+		}
+	}
+	n = stats->size;
+	stats->size++;
+	record = &(stats->record[n]);
+	memset(record, 0, sizeof(struct stats_record_s));
+	record->phase = phase;
+	record->function = function;
+	record->tid = syscall(SYS_gettid);
+	record->rss_start = stats_max_rss();
+	record->cpu_start = stats_clock((function >= 0) ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID);
+	record->wall_start = stats_clock(CLOCK_MONOTONIC) - stats->wall_base;
+	stats_unlock(stats);
+	return n;
+}
+
+int stats_end(struct self_s *self, int n)
+{
+	struct stats_s *stats = self->stats;
+	struct stats_record_s *record;
+	uint64_t counter[STATS_COUNTER_MAX];
+	uint64_t wall_end = stats_clock(CLOCK_MONOTONIC);
+	uint64_t cpu_end;
+	long rss_end = stats_max_rss();
+	int function;
+
+	if (!stats || (n < 0)) {
+		return 0;
+	}
+	stats_lock(stats);
+	function = stats->record[n].function;
+	stats_unlock(stats);
+	cpu_end = stats_clock((function >= 0) ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID);
+	stats_count(self, function, counter);
+
+	stats_lock(stats);
+	record = &(stats->record[n]);
+	record->wall_end = wall_end - stats->wall_base;
+	record->cpu_end = cpu_end;
+	record->rss_end = rss_end;
+	memcpy(record->counter, counter, sizeof(counter));
+	record->done = 1;
+	stats_unlock(stats);
+	return 0;
+}
+
+static void stats_json_string(FILE *file, const char *string)
+{
+	if (!string) {
+		fprintf(file, "null");
+		return;
+	}
+	fputc('"', file);
+	for (; *string; string++) {
+		if ((*string == '"') || (*string == '\\')) {
+			fprintf(file, "\\%c", *string);
+		} else if ((unsigned char)*string < 0x20) {
+			fprintf(file, "\\u%04x", (unsigned char)*string);
+		} else {
+			fputc(*string, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static void stats_json_counters(FILE *file, uint64_t *counter)
+{
+	fprintf(file, "\"instructions\": %"PRIu64", \"nodes\": %"PRIu64", \"paths\": %"PRIu64", \"phis\": %"PRIu64", \"labels\": %"PRIu64,
+		counter[STATS_COUNTER_INSTRUCTIONS],
+		counter[STATS_COUNTER_NODES],
+		counter[STATS_COUNTER_PATHS],
+		counter[STATS_COUNTER_PHIS],
+		counter[STATS_COUNTER_LABELS]);
+}
+
+/* Times are in microseconds, RSS in KB */
+int stats_write_json(struct self_s *self, const char *path)
+{
+	struct stats_s *stats = self->stats;
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct stats_record_s *record;
+	uint64_t counter[STATS_COUNTER_MAX];
+	FILE *file;
+	int first = 1;
+	int n;
+	int m;
+	int c;
+
+	if (!stats) {
+		return 0;
+	}
+	file = fopen(path, "w");
+	if (!file) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_write_json: cannot create %s\n", path);
+		return 1;
+	}
+	fprintf(file, "{\n\"wall_us\": %"PRIu64",\n\"cpu_us\": %"PRIu64",\n\"max_rss_kb\": %ld,\n",
+		(stats_clock(CLOCK_MONOTONIC) - stats->wall_base) / 1000,
+		(stats_clock(CLOCK_PROCESS_CPUTIME_ID) - stats->cpu_base) / 1000,
+		stats_max_rss());
+	fprintf(file, "\"phases\": [");
+	for (n = 0; n < stats->size; n++) {
+		record = &(stats->record[n]);
+		if (!record->done) {
+			continue;
+		}
+		fprintf(file, "%s\n\t{\"phase\": ", first ? "" : ",");
+		first = 0;
+		stats_json_string(file, record->phase);
+		if (record->function >= 0) {
+			fprintf(file, ", \"function\": ");
+			stats_json_string(file, external_entry_points[record->function].name);
+		}
+		fprintf(file, ", \"start_us\": %"PRIu64", \"wall_us\": %"PRIu64", \"cpu_us\": %"PRIu64", \"rss_delta_kb\": %ld, ",
+			record->wall_start / 1000,
+			(record->wall_end - record->wall_start) / 1000,
+			(record->cpu_end - record->cpu_start) / 1000,
+			record->rss_end - record->rss_start);
+		stats_json_counters(file, record->counter);
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n],\n\"functions\": [");
+	first = 1;
+	for (n = 0; external_entry_points && (n < EXTERNAL_ENTRY_POINTS_MAX); n++) {
+		if (!external_entry_points[n].valid || (external_entry_points[n].type != 1)) {
+			continue;
+		}
+		fprintf(file, "%s\n\t{\"function\": ", first ? "" : ",");
+		first = 0;
+		stats_json_string(file, external_entry_points[n].name);
+		fprintf(file, ", ");
+		/* The largest each counter got. Some tables are freed before the end */
+		stats_count(self, n, counter);
+		for (m = 0; m < stats->size; m++) {
+			if (!stats->record[m].done || (stats->record[m].function != n)) {
+				continue;
+			}
+			for (c = 0; c < STATS_COUNTER_MAX; c++) {
+				if (stats->record[m].counter[c] > counter[c]) {
+					counter[c] = stats->record[m].counter[c];
+				}
+			}
+		}
+		stats_json_counters(file, counter);
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n]\n}\n");
+	if (fclose(file)) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_write_json: cannot write %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+struct stats_trace_event_s {
+	uint64_t ts;
+	int end;
+	int record;
+};
+
+/* In time order. At the same time an end goes first, and nested records
+ * begin outer first and end inner first, so every thread stays a stack.
+ */
+static int stats_trace_event_cmp(const void *a, const void *b)
+{
+	const struct stats_trace_event_s *event_a = a;
+	const struct stats_trace_event_s *event_b = b;
+
+	if (event_a->ts != event_b->ts) {
+		return (event_a->ts < event_b->ts) ? -1 : 1;
+	}
+	if (event_a->end != event_b->end) {
+		return event_b->end - event_a->end;
+	}
+	if (event_a->end) {
+		return event_b->record - event_a->record;
+	}
+	return event_a->record - event_b->record;
+}
+
+/* Trace event format. Times are in microseconds */
+int stats_write_trace(struct self_s *self, const char *path)
+{
+	struct stats_s *stats = self->stats;
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct stats_trace_event_s *event;
+	struct stats_record_s *record;
+	FILE *file;
+	int pid = getpid();
+	int *tid;
+	int tids_size = 0;
+	int size = 0;
+	int n;
+	int m;
+
+	if (!stats) {
+		return 0;
+	}
+	event = calloc(stats->size * 2 + 1, sizeof(struct stats_trace_event_s));
+	tid = calloc(stats->size + 1, sizeof(int));
+	if (!event || !tid) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_write_trace: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < stats->size; n++) {
+		if (!stats->record[n].done) {
+			continue;
+		}
+		event[size].ts = stats->record[n].wall_start;
+		event[size].end = 0;
+		event[size].record = n;
+		size++;
+		event[size].ts = stats->record[n].wall_end;
+		event[size].end = 1;
+		event[size].record = n;
+		size++;
+	}
+	qsort(event, size, sizeof(struct stats_trace_event_s), stats_trace_event_cmp);
+	file = fopen(path, "w");
+	if (!file) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_write_trace: cannot create %s\n", path);
+		free(event);
+		free(tid);
+		return 1;
+	}
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(file, "\t{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"libbeauty\"}}", pid);
+	/* Name each thread once. There are only ever a few */
+	for (n = 0; n < stats->size; n++) {
+		for (m = 0; m < tids_size; m++) {
+			if (tid[m] == stats->record[n].tid) {
+				break;
+			}
+		}
+		if (m < tids_size) {
+			continue;
+		}
+		tid[tids_size++] = stats->record[n].tid;
+		fprintf(file, ",\n\t{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+			pid, stats->record[n].tid, (stats->record[n].tid == pid) ? "main" : "worker");
+	}
+	free(tid);
+	for (n = 0; n < size; n++) {
+		record = &(stats->record[event[n].record]);
+		fprintf(file, ",\n\t{\"name\": ");
+		if (record->function >= 0) {
+			stats_json_string(file, external_entry_points[record->function].name);
+		} else {
+			stats_json_string(file, record->phase);
+		}
+		fprintf(file, ", \"cat\": ");
+		stats_json_string(file, record->phase);
+		fprintf(file, ", \"ph\": \"%s\", \"ts\": %"PRIu64".%03"PRIu64", \"pid\": %d, \"tid\": %d",
+			event[n].end ? "E" : "B", event[n].ts / 1000, event[n].ts % 1000, pid, record->tid);
+		if (event[n].end) {
+			fprintf(file, ", \"args\": {\"cpu_us\": %"PRIu64", ",
+				(record->cpu_end - record->cpu_start) / 1000);
+			stats_json_counters(file, record->counter);
+			fprintf(file, "}");
+		}
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n]}\n");
+	free(event);
+	if (fclose(file)) {
+		debug_print(DEBUG_ANALYSE, 1, "stats_write_trace: cannot write %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+int stats_close(struct self_s *self)
+{
+	struct stats_s *stats = self->stats;
+
+	if (!stats) {
+		return 0;
+	}
+	free(stats->record);
+	free(stats);
+	self->stats = NULL;
+	return 0;
+}
@@ -0,0 +1,778 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Control flow structuring.
+ * build_node_dominance() fills nodes[].dominator with the immediate dominator.
+ * build_node_if_tail() fills nodes[].post_dominator, the immediate post dominator
+ * once the loop edges are taken out, and from that the if_tail of each branch
+ * node and the follow node of each loop.
+ * Both use the Cooper, Harvey, Kennedy iterative algorithm over a reverse post order,
+ * which in practice settles in two or three passes.
+ * build_function_ast() then turns the nodes of a function into the ast_* tables.
+ * Each node is placed once, so it is linear in the size of the CFG.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+/* An edge list in compressed form. The edges of vertex v are edge[start[v]] to edge[start[v + 1] - 1] */
+struct structure_graph_s {
+	int size;
+	int *start;
+	int *edge;
+};
+
+int is_member_of_loop(struct control_flow_node_s *nodes, int loop_node, int test_node) {
+	/* The loops nested inside a loop follow it in loops[] */
+	if (!nodes[loop_node].loop_last) {
+		return 0;
+	}
+	return ((nodes[test_node].loop >= nodes[loop_node].loop) &&
+		(nodes[test_node].loop <= nodes[loop_node].loop_last));
+}
+
+/* loop is a loops[] index + 1, as in nodes[].loop. 0 = the whole function */
+static int structure_in_loop(struct control_flow_node_s *nodes, struct loop_s *loops, int loop, int node)
+{
+	if (!loop) {
+		return 1;
+	}
+	return is_member_of_loop(nodes, loops[loop - 1].head, node);
+}
+
+/* An edge that goes back to the head of a loop it is in */
+static int structure_is_back_edge(struct control_flow_node_s *nodes, int nodes_size, int node, int link)
+{
+	int next = nodes[node].link_next[link].node;
+
+	if ((next <= 0) || (next >= nodes_size)) {
+		return 0;
+	}
+	if (nodes[node].link_next[link].is_loop_edge) {
+		return 1;
+	}
+	return is_member_of_loop(nodes, next, node);
+}
+
+static struct loop_s *structure_loops(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, int *loops_size)
+{
+	struct external_entry_point_s *external_entry_point;
+
+	*loops_size = 0;
+	if ((nodes_size < 2) || !nodes[1].entry_point) {
+		return NULL;
+	}
+	external_entry_point = &(self->external_entry_points[nodes[1].entry_point - 1]);
+	*loops_size = external_entry_point->loops_size;
+	return external_entry_point->loops;
+}
+
+static int structure_graph_alloc(struct structure_graph_s *graph, int size, int edges)
+{
+	graph->size = size;
+	graph->start = calloc(size + 1, sizeof(int));
+	graph->edge = calloc(edges + 1, sizeof(int));
+	if (!graph->start || !graph->edge) {
+		debug_print(DEBUG_ANALYSE, 1, "structure_graph_alloc: calloc failed\n");
+		exit(1);
+	}
+	return 0;
+}
+
+static void structure_graph_free(struct structure_graph_s *graph)
+{
+	free(graph->start);
+	free(graph->edge);
+}
+
+/* Fill succ and pred from a list of count edges from[n] -> to[n] */
+static int structure_graph_build(struct structure_graph_s *succ, struct structure_graph_s *pred,
+	int size, int count, int *from, int *to)
+{
+	int *fill;
+	int n;
+
+	structure_graph_alloc(succ, size, count);
+	structure_graph_alloc(pred, size, count);
+	for (n = 0; n < count; n++) {
+		succ->start[from[n] + 1]++;
+		pred->start[to[n] + 1]++;
+	}
+	for (n = 0; n < size; n++) {
+		succ->start[n + 1] += succ->start[n];
+		pred->start[n + 1] += pred->start[n];
+	}
+	fill = calloc(size, sizeof(int));
+	if (!fill) {
+		debug_print(DEBUG_ANALYSE, 1, "structure_graph_build: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < count; n++) {
+		succ->edge[succ->start[from[n]] + fill[from[n]]++] = to[n];
+	}
+	memset(fill, 0, size * sizeof(int));
+	for (n = 0; n < count; n++) {
+		pred->edge[pred->start[to[n]] + fill[to[n]]++] = from[n];
+	}
+	free(fill);
+	return 0;
+}
+
+/* Cooper, Harvey, Kennedy. "A Simple, Fast Dominance Algorithm".
+ * idom[] gets the immediate dominator of each vertex reachable from root, root for root itself,
+ * and -1 for the rest. number[] gets the post order number, 0 if not reachable.
+ */
+static int structure_idom(struct structure_graph_s *succ, struct structure_graph_s *pred,
+	int root, int *idom, int *number)
+{
+	int size = succ->size;
+	int *order;
+	int *stack;
+	int *stack_edge;
+	int stack_size = 0;
+	int count = 0;
+	int changed;
+	int node;
+	int next;
+	int new_idom;
+	int b1, b2;
+	int n, m;
+
+	order = calloc(size + 1, sizeof(int));
+	stack = calloc(size + 1, sizeof(int));
+	stack_edge = calloc(size + 1, sizeof(int));
+	if (!order || !stack || !stack_edge) {
+		debug_print(DEBUG_ANALYSE, 1, "structure_idom: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < size; n++) {
+		idom[n] = -1;
+		number[n] = 0;
+	}
+	/* Depth first, numbering on the way out. number[] doubles as the "seen" mark, as -1 */
+	stack[stack_size] = root;
+	stack_edge[stack_size] = succ->start[root];
+	stack_size++;
+	number[root] = -1;
+	while (stack_size > 0) {
+		node = stack[stack_size - 1];
+		if (stack_edge[stack_size - 1] < succ->start[node + 1]) {
+			next = succ->edge[stack_edge[stack_size - 1]++];
+			if (!number[next]) {
+				number[next] = -1;
+				stack[stack_size] = next;
+				stack_edge[stack_size] = succ->start[next];
+				stack_size++;
+			}
+			continue;
+		}
+		stack_size--;
+		count++;
+		number[node] = count;
+		order[count] = node;
+	}
+	idom[root] = root;
+	do {
+		changed = 0;
+		/* Reverse post order, skipping the root */
+		for (m = count - 1; m >= 1; m--) {
+			node = order[m];
+			new_idom = -1;
+			for (n = pred->start[node]; n < pred->start[node + 1]; n++) {
+				b1 = pred->edge[n];
+				if (idom[b1] < 0) {
+					continue;
+				}
+				if (new_idom < 0) {
+					new_idom = b1;
+					continue;
+				}
+				b2 = new_idom;
+				while (b1 != b2) {
+					while (number[b1] < number[b2]) {
+						b1 = idom[b1];
+					}
+					while (number[b2] < number[b1]) {
+						b2 = idom[b2];
+					}
+				}
+				new_idom = b1;
+			}
+			if (idom[node] != new_idom) {
+				idom[node] = new_idom;
+				changed = 1;
+			}
+		}
+	} while (changed);
+	free(order);
+	free(stack);
+	free(stack_edge);
+	return count;
+}
+
+int build_node_dominance(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
+{
+	struct structure_graph_s succ;
+	struct structure_graph_s pred;
+	int *from;
+	int *to;
+	int *idom;
+	int *number;
+	int count = 0;
+	int next;
+	int n, m;
+
+	if (nodes_size < 2) {
+		return 0;
+	}
+	for (n = 1; n < nodes_size; n++) {
+		if (nodes[n].valid) {
+			count += nodes[n].next_size;
+		}
+	}
+	from = calloc(count + 1, sizeof(int));
+	to = calloc(count + 1, sizeof(int));
+	idom = calloc(nodes_size, sizeof(int));
+	number = calloc(nodes_size, sizeof(int));
+	if (!from || !to || !idom || !number) {
+		debug_print(DEBUG_ANALYSE, 1, "build_node_dominance: calloc failed\n");
+		exit(1);
+	}
+	count = 0;
+	for (n = 1; n < nodes_size; n++) {
+		if (!nodes[n].valid) {
+			continue;
+		}
+		for (m = 0; m < nodes[n].next_size; m++) {
+			next = nodes[n].link_next[m].node;
+			if ((next > 0) && (next < nodes_size) && nodes[next].valid) {
+				from[count] = n;
+				to[count] = next;
+				count++;
+			}
+		}
+	}
+	structure_graph_build(&succ, &pred, nodes_size, count, from, to);
+	structure_idom(&succ, &pred, 1, idom, number);
+	for (n = 1; n < nodes_size; n++) {
+		nodes[n].dominator = (idom[n] > 0 && n != 1) ? idom[n] : 0;
+	}
+	structure_graph_free(&succ);
+	structure_graph_free(&pred);
+	free(from);
+	free(to);
+	free(idom);
+	free(number);
+	return 0;
+}
+
+/* Nearest common post dominator. number[] and ipdom[] are over the reversed graph */
+static int structure_intersect(int *ipdom, int *number, int b1, int b2)
+{
+	while (b1 != b2) {
+		while (number[b1] < number[b2]) {
+			b1 = ipdom[b1];
+		}
+		while (number[b2] < number[b1]) {
+			b2 = ipdom[b2];
+		}
+	}
+	return b1;
+}
+
+/* Post dominators are taken with the loop edges removed, and a virtual exit node,
+ * numbered nodes_size, after every node that is left with no next nodes.
+ * So the if_tail of a branch is where its paths meet again, the same as it was
+ * with the path subset tests, and a loop's follow is where its exits meet.
+ *   IF_THEN_ELSE, JMPT, LOOP_THEN_ELSE: The immediate post dominator. If the
+ *     paths only meet by going round the loop again, the head of the loop.
+ *   LOOP: The follow of the loop.
+ *   IF_THEN_GOTO: The follow of the outermost loop the goto leaves.
+ */
+int build_node_if_tail(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
+{
+	struct structure_graph_s succ;
+	struct structure_graph_s pred;
+	struct loop_s *loops;
+	int loops_size;
+	int exit_node = nodes_size;
+	int *from;
+	int *to;
+	int *ipdom;
+	int *number;
+	int count = 0;
+	int outgoing;
+	int follow;
+	int next;
+	int node;
+	int tail;
+	int l;
+	int n, m;
+
+	if (nodes_size < 2) {
+		return 0;
+	}
+	loops = structure_loops(self, nodes, nodes_size, &loops_size);
+	for (n = 1; n < nodes_size; n++) {
+		if (nodes[n].valid) {
+			count += nodes[n].next_size + 1;
+		}
+	}
+	from = calloc(count + 1, sizeof(int));
+	to = calloc(count + 1, sizeof(int));
+	ipdom = calloc(nodes_size + 1, sizeof(int));
+	number = calloc(nodes_size + 1, sizeof(int));
+	if (!from || !to || !ipdom || !number) {
+		debug_print(DEBUG_ANALYSE, 1, "build_node_if_tail: calloc failed\n");
+		exit(1);
+	}
+	/* The reversed graph, so the exit is the root */
+	count = 0;
+	for (n = 1; n < nodes_size; n++) {
+		if (!nodes[n].valid) {
+			continue;
+		}
+		outgoing = 0;
+		for (m = 0; m < nodes[n].next_size; m++) {
+			next = nodes[n].link_next[m].node;
+			if ((next <= 0) || (next >= nodes_size) || !nodes[next].valid ||
+				structure_is_back_edge(nodes, nodes_size, n, m)) {
+				continue;
+			}
+			from[count] = next;
+			to[count] = n;
+			count++;
+			outgoing++;
+		}
+		if (!outgoing) {
+			from[count] = exit_node;
+			to[count] = n;
+			count++;
+		}
+	}
+	structure_graph_build(&succ, &pred, nodes_size + 1, count, from, to);
+	structure_idom(&succ, &pred, exit_node, ipdom, number);
+	for (n = 1; n < nodes_size; n++) {
+		nodes[n].post_dominator = ((ipdom[n] > 0) && (ipdom[n] != exit_node)) ? ipdom[n] : 0;
+		nodes[n].if_tail = 0;
+	}
+
+	/* Loop follow. Where all the edges that leave the loop meet */
+	for (l = 0; l < loops_size; l++) {
+		follow = -1;
+		for (n = 0; n < loops[l].size; n++) {
+			node = loops[l].list[n];
+			for (m = 0; m < nodes[node].next_size; m++) {
+				next = nodes[node].link_next[m].node;
+				if ((next <= 0) || (next >= nodes_size) || !number[next] ||
+					is_member_of_loop(nodes, loops[l].head, next)) {
+					continue;
+				}
+				if (follow < 0) {
+					follow = next;
+				} else {
+					follow = structure_intersect(ipdom, number, follow, next);
+				}
+			}
+		}
+		loops[l].follow = ((follow > 0) && (follow != exit_node)) ? follow : 0;
+		debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: loop 0x%x head 0x%x follow 0x%x\n",
+			l, loops[l].head, loops[l].follow);
+	}
+
+	for (n = 1; n < nodes_size; n++) {
+		if (!nodes[n].valid || (nodes[n].next_size < 2)) {
+			continue;
+		}
+		tail = 0;
+		switch (nodes[n].type) {
+		case NODE_TYPE_IF_THEN_ELSE:
+		case NODE_TYPE_LOOP_THEN_ELSE:
+		case NODE_TYPE_JMPT:
+			tail = nodes[n].post_dominator;
+			if (!tail && nodes[n].loop) {
+				tail = loops[nodes[n].loop - 1].head;
+			}
+			break;
+		case NODE_TYPE_LOOP:
+			if (nodes[n].loop_last) {
+				tail = loops[nodes[n].loop - 1].follow;
+			}
+			break;
+		case NODE_TYPE_IF_THEN_GOTO:
+			next = 0;
+			for (m = 0; m < nodes[n].next_size; m++) {
+				if (nodes[n].link_next[m].is_loop_exit) {
+					next = nodes[n].link_next[m].node;
+					break;
+				}
+			}
+			if ((next <= 0) || (next >= nodes_size)) {
+				break;
+			}
+			/* Walk out to the outermost loop that the goto leaves */
+			for (l = nodes[n].loop - 1; l >= 0; l = loops[l].parent) {
+				if (is_member_of_loop(nodes, loops[l].head, next)) {
+					break;
+				}
+				tail = loops[l].follow;
+			}
+			break;
+		default:
+			debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail node type 0x%x unknown\n", nodes[n].type);
+			tail = nodes[n].post_dominator;
+			break;
+		}
+		nodes[n].if_tail = tail;
+		debug_print(DEBUG_ANALYSE_PATHS, 1, "if_tail: node 0x%x type 0x%x if_tail 0x%x\n", n, nodes[n].type, tail);
+	}
+	structure_graph_free(&succ);
+	structure_graph_free(&pred);
+	free(from);
+	free(to);
+	free(ipdom);
+	free(number);
+	return 0;
+}
+
+/* Add a zeroed entry to one of the ast tables, growing it as needed. Returns its index */
+static int ast_table_add(void **table, int *size, int *max, size_t entry_size)
+{
+	int n;
+
+	if (*size >= *max) {
+		n = (*max) ? (*max) * 2 : 64;
+		*table = realloc(*table, n * entry_size);
+		if (!*table) {
+			debug_print(DEBUG_ANALYSE, 1, "ast_table_add: realloc failed\n");
+			exit(1);
+		}
+		*max = n;
+	}
+	memset((char *)(*table) + (*size) * entry_size, 0, entry_size);
+	return (*size)++;
+}
+
+static int ast_container_add(struct ast_s *ast, int start_node, int parent_type, int parent_index, int parent_offset)
+{
+	int index;
+
+	index = ast_table_add((void **)&(ast->ast_container), &(ast->container_size),
+		&(ast->container_max), sizeof(struct ast_container_s));
+	ast->ast_container[index].start_node = start_node;
+	ast->ast_container[index].parent.type = parent_type;
+	ast->ast_container[index].parent.index = parent_index;
+	ast->ast_container[index].parent.offset = parent_offset;
+	return index;
+}
+
+/* Append an object to a container. Returns its offset in the container */
+static int ast_container_append(struct ast_s *ast, int container, int type, int index)
+{
+	struct ast_container_s *ast_container = &(ast->ast_container[container]);
+	int length = ast_container->length;
+
+	if (length >= ast_container->max) {
+		ast_container->max = (ast_container->max) ? ast_container->max * 2 : 8;
+		ast_container->object = realloc(ast_container->object,
+			ast_container->max * sizeof(struct ast_type_index_s));
+		if (!ast_container->object) {
+			debug_print(DEBUG_ANALYSE, 1, "ast_container_append: realloc failed\n");
+			exit(1);
+		}
+	}
+	ast_container->object[length].type = type;
+	ast_container->object[length].index = index;
+	ast_container->length = length + 1;
+	return length;
+}
+
+/* Queue up a container to fill, from node up to, but not including, node_end */
+static int ast_entry_push(struct ast_s *ast, int container, int sub_type, int node, int node_end, int loop)
+{
+	int entry;
+
+	entry = ast_table_add((void **)&(ast->ast_entry), &(ast->entry_size),
+		&(ast->entry_max), sizeof(struct ast_entry_s));
+	ast->ast_entry[entry].type = AST_TYPE_CONTAINER;
+	ast->ast_entry[entry].sub_type = sub_type;
+	ast->ast_entry[entry].index = container;
+	ast->ast_entry[entry].node = node;
+	ast->ast_entry[entry].node_end = node_end;
+	ast->ast_entry[entry].loop = loop;
+	return 0;
+}
+
+/* Reverse the entries pushed since first, so the first arm of a branch is filled first */
+static void ast_entry_flip(struct ast_s *ast, int first)
+{
+	struct ast_entry_s tmp;
+	int last;
+
+	for (last = ast->entry_size - 1; first < last; first++, last--) {
+		tmp = ast->ast_entry[first];
+		ast->ast_entry[first] = ast->ast_entry[last];
+		ast->ast_entry[last] = tmp;
+	}
+}
+
+/* An arm of a branch. Empty if there is nothing between the branch and its tail */
+static int ast_arm(struct ast_s *ast, struct control_flow_node_s *nodes, int nodes_size,
+	int node, int link, int tail, int loop, int parent_type, int parent_index, int parent_offset,
+	struct ast_type_index_s *arm)
+{
+	int next;
+	int container;
+
+	arm->type = AST_TYPE_EMPTY;
+	arm->index = 0;
+	if (link >= nodes[node].next_size) {
+		return 0;
+	}
+	next = nodes[node].link_next[link].node;
+	if ((next <= 0) || (next >= nodes_size) || (next == tail) ||
+		structure_is_back_edge(nodes, nodes_size, node, link)) {
+		return 0;
+	}
+	container = ast_container_add(ast, next, parent_type, parent_index, parent_offset);
+	arm->type = AST_TYPE_CONTAINER;
+	arm->index = container;
+	ast_entry_push(ast, container, 0, next, tail, loop);
+	return 0;
+}
+
+int ast_reset(struct ast_s *ast)
+{
+	int n;
+
+	for (n = 0; n < ast->container_size; n++) {
+		free(ast->ast_container[n].object);
+	}
+	for (n = 0; n < ast->loop_container_size; n++) {
+		free(ast->ast_loop_container[n].object);
+	}
+	ast->container_size = 0;
+	ast->if_then_else_size = 0;
+	ast->if_then_goto_size = 0;
+	ast->loop_size = 0;
+	ast->loop_container_size = 0;
+	ast->loop_then_else_size = 0;
+	ast->entry_size = 0;
+	return 0;
+}
+
+/* Convert the Control flow graph of a function to an Abstract syntax tree.
+ * Needs build_node_if_tail().
+ * One container is filled at a time, from the ast_entry[] stack. Walking a
+ * container appends its nodes, one after the other, until it reaches its node_end,
+ * leaves its loop, or gets to a node that has already been placed.
+ * At a branch or a loop, the rest of the container is pushed first, and the
+ * containers for the arms or loop body after, so they are filled before it.
+ * The ast tables grow as needed. Call ast_reset() to reuse them for the next function.
+ * Returns the index of the container for the whole function.
+ */
+int build_function_ast(struct self_s *self, struct external_entry_point_s *external_entry_point, struct ast_s *ast)
+{
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	int nodes_size = external_entry_point->nodes_size;
+	struct loop_s *loops = external_entry_point->loops;
+	struct ast_entry_s entry;
+	uint8_t *visited;
+	int root;
+	int node;
+	int next;
+	int tail;
+	int container;
+	int offset;
+	int index;
+	int link_goto;
+	int link_norm;
+	int loop;
+	int head_branch;
+	int first;
+	int m;
+
+	root = ast_container_add(ast, 1, AST_TYPE_EMPTY, 0, 0);
+	if (nodes_size < 2) {
+		return root;
+	}
+	visited = calloc(nodes_size, sizeof(uint8_t));
+	if (!visited) {
+		debug_print(DEBUG_ANALYSE, 1, "build_function_ast: calloc failed\n");
+		exit(1);
+	}
+	ast_entry_push(ast, root, 0, 1, 0, 0);
+	while (ast->entry_size > 0) {
+		ast->entry_size--;
+		entry = ast->ast_entry[ast->entry_size];
+		container = entry.index;
+		node = entry.node;
+		first = 1;
+		debug_print(DEBUG_ANALYSE, 1, "build_function_ast: container 0x%x node 0x%x node_end 0x%x loop 0x%x\n",
+			container, node, entry.node_end, entry.loop);
+		while ((node > 0) && (node < nodes_size) && (node != entry.node_end)) {
+			if (!structure_in_loop(nodes, loops, entry.loop, node)) {
+				/* Left the loop. A break */
+				break;
+			}
+			/* A loop body container starts with the branch of its own loop head */
+			head_branch = (first && (entry.sub_type == 1));
+			first = 0;
+			if (!head_branch) {
+				if (visited[node]) {
+					/* Already placed. A continue or a goto */
+					break;
+				}
+				visited[node] = 1;
+			}
+			next = 0;
+			if (!head_branch && nodes[node].loop_last) {
+				loop = nodes[node].loop;
+				index = ast_table_add((void **)&(ast->ast_loop), &(ast->loop_size),
+					&(ast->loop_max), sizeof(struct ast_loop_s));
+				offset = ast_container_append(ast, container, AST_TYPE_LOOP, index);
+				ast->ast_loop[index].parent.type = AST_TYPE_CONTAINER;
+				ast->ast_loop[index].parent.index = container;
+				ast->ast_loop[index].parent.offset = offset;
+				ast->ast_loop[index].first_node.type = AST_TYPE_NODE;
+				ast->ast_loop[index].first_node.index = node;
+				ast->ast_loop[index].body.type = AST_TYPE_EMPTY;
+				/* Count the ways into the body from the head.
+				 * If the head itself leaves the loop, carry on from there, else from the follow.
+				 */
+				next = 0;
+				link_norm = -1;
+				link_goto = loops[loop - 1].follow;
+				for (m = 0; m < nodes[node].next_size; m++) {
+					tail = nodes[node].link_next[m].node;
+					if ((tail <= 0) || (tail >= nodes_size) ||
+						structure_is_back_edge(nodes, nodes_size, node, m)) {
+						continue;
+					}
+					if (structure_in_loop(nodes, loops, loop, tail)) {
+						next++;
+						link_norm = m;
+					} else {
+						link_goto = tail;
+					}
+				}
+				ast_entry_push(ast, container, 0, link_goto, entry.node_end, entry.loop);
+				if (next == 1) {
+					tail = nodes[node].link_next[link_norm].node;
+					ast->ast_loop[index].body.type = AST_TYPE_CONTAINER;
+					ast->ast_loop[index].body.index = ast_container_add(ast, tail, AST_TYPE_LOOP, index, 0);
+					ast_entry_push(ast, ast->ast_loop[index].body.index, 0, tail, 0, loop);
+				} else if (next > 1) {
+					ast->ast_loop[index].body.type = AST_TYPE_CONTAINER;
+					ast->ast_loop[index].body.index = ast_container_add(ast, node, AST_TYPE_LOOP, index, 0);
+					ast->ast_container[ast->ast_loop[index].body.index].sub_type = 1;
+					ast_entry_push(ast, ast->ast_loop[index].body.index, 1, node, 0, loop);
+				}
+				break;
+			}
+			if (nodes[node].next_size == 0) {
+				ast_container_append(ast, container, AST_TYPE_NODE, node);
+				break;
+			}
+			if (nodes[node].next_size == 1) {
+				ast_container_append(ast, container, AST_TYPE_NODE, node);
+				if (structure_is_back_edge(nodes, nodes_size, node, 0)) {
+					break;
+				}
+				node = nodes[node].link_next[0].node;
+				continue;
+			}
+			tail = nodes[node].if_tail;
+			if ((nodes[node].next_size == 2) && !head_branch &&
+				(nodes[node].type == NODE_TYPE_IF_THEN_GOTO)) {
+				if (nodes[node].link_next[0].is_loop_exit) {
+					link_goto = 0;
+					link_norm = 1;
+				} else {
+					link_goto = 1;
+					link_norm = 0;
+				}
+				index = ast_table_add((void **)&(ast->ast_if_then_goto), &(ast->if_then_goto_size),
+					&(ast->if_then_goto_max), sizeof(struct ast_if_then_goto_s));
+				offset = ast_container_append(ast, container, AST_TYPE_IF_THEN_GOTO, index);
+				ast->ast_if_then_goto[index].parent.type = AST_TYPE_CONTAINER;
+				ast->ast_if_then_goto[index].parent.index = container;
+				ast->ast_if_then_goto[index].parent.offset = offset;
+				ast->ast_if_then_goto[index].expression_node.type = AST_TYPE_NODE;
+				ast->ast_if_then_goto[index].expression_node.index = node;
+				/* The goto arm runs in the loop that holds its target */
+				next = nodes[node].link_next[link_goto].node;
+				loop = entry.loop;
+				while (loop && (next > 0) && (next < nodes_size) &&
+					!structure_in_loop(nodes, loops, loop, next)) {
+					loop = loops[loop - 1].parent + 1;
+				}
+				ast_arm(ast, nodes, nodes_size, node, link_goto, tail, loop,
+					AST_TYPE_IF_THEN_GOTO, index, 0, &(ast->ast_if_then_goto[index].if_then_goto));
+				if (structure_is_back_edge(nodes, nodes_size, node, link_norm)) {
+					break;
+				}
+				node = nodes[node].link_next[link_norm].node;
+				continue;
+			}
+			if (nodes[node].next_size == 2) {
+				index = ast_table_add((void **)&(ast->ast_if_then_else), &(ast->if_then_else_size),
+					&(ast->if_then_else_max), sizeof(struct ast_if_then_else_s));
+				offset = ast_container_append(ast, container, AST_TYPE_IF_THEN_ELSE, index);
+				ast->ast_if_then_else[index].parent.type = AST_TYPE_CONTAINER;
+				ast->ast_if_then_else[index].parent.index = container;
+				ast->ast_if_then_else[index].parent.offset = offset;
+				ast->ast_if_then_else[index].expression_node.type = AST_TYPE_NODE;
+				ast->ast_if_then_else[index].expression_node.index = node;
+				ast_entry_push(ast, container, 0, tail, entry.node_end, entry.loop);
+				first = ast->entry_size;
+				ast_arm(ast, nodes, nodes_size, node, 0, tail, entry.loop,
+					AST_TYPE_IF_THEN_ELSE, index, 0, &(ast->ast_if_then_else[index].if_then));
+				ast_arm(ast, nodes, nodes_size, node, 1, tail, entry.loop,
+					AST_TYPE_IF_THEN_ELSE, index, 1, &(ast->ast_if_then_else[index].if_else));
+				ast_entry_flip(ast, first);
+				break;
+			}
+			/* A jump table. The node, then one container for each target */
+			ast_container_append(ast, container, AST_TYPE_NODE, node);
+			ast_entry_push(ast, container, 0, tail, entry.node_end, entry.loop);
+			first = ast->entry_size;
+			for (m = 0; m < nodes[node].next_size; m++) {
+				struct ast_type_index_s arm;
+
+				ast_arm(ast, nodes, nodes_size, node, m, tail, entry.loop,
+					AST_TYPE_CONTAINER, container, ast->ast_container[container].length, &arm);
+				if (arm.type == AST_TYPE_CONTAINER) {
+					ast_container_append(ast, container, AST_TYPE_CONTAINER, arm.index);
+				}
+			}
+			ast_entry_flip(ast, first);
+			break;
+		}
+	}
+	for (node = 1; node < nodes_size; node++) {
+		if (nodes[node].valid && !visited[node]) {
+			debug_print(DEBUG_ANALYSE, 1, "build_function_ast: %s node 0x%x not placed\n",
+				external_entry_point->name, node);
+		}
+	}
+	free(visited);
+	return root;
+}
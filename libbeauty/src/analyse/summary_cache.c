@@ -0,0 +1,726 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Summary cache. The results of each function, kept from one run to the next.
+ * A function is keyed by an FNV-1a hash of its name, its .text bytes and the
+ * relocations inside them, by offset, type, addend and target symbol. The hash
+ * starts from a base that covers .data and .rodata and their relocations.
+ * summary_cache_select() runs before process_block(). A function whose key is
+ * in the cache, and whose callees in this file are all served from the cache
+ * too, gets type 3. The phases from process_block() on only look at type 1,
+ * so it is not decoded or analysed again. Its call graph summary, params and
+ * locals come from the cache. main() writes its cached C text, and the LLVM
+ * export links in its cached bitcode.
+ * The file is a header, the entries sorted by key, and a blob with the parts
+ * of each entry that vary in size. It is mmap()ed and searched where it lies.
+ * summary_cache_close() merges the new entries with the old ones, writes them
+ * to a new file and renames it over the old one.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <rev.h>
+
+#define SUMMARY_CACHE_MAGIC "LBSUMC02"
+
+struct summary_cache_header_s {
+	char magic[8];
+	uint32_t entry_size;	/* Rejects a file written with a different struct layout */
+	uint32_t label_size;
+	uint64_t entries;
+	uint64_t blob_size;
+};
+
+struct summary_cache_key_s {
+	uint64_t key;
+	int function;
+};
+
+struct summary_cache_blob_s {
+	uint8_t *data;
+	uint64_t size;
+	uint64_t max;
+};
+
+uint64_t summary_cache_hash(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *byte = data;
+	size_t n;
+
+	for (n = 0; n < size; n++) {
+		hash ^= byte[n];
+		hash *= SUMMARY_CACHE_FNV_PRIME;
+	}
+	return hash;
+}
+
+/* For the .data and .rodata relocations, which are in every function's key */
+uint64_t summary_cache_hash_relocs(uint64_t hash, struct reloc_table_s *reloc_table, int reloc_table_size)
+{
+	int n;
+
+	for (n = 0; n < reloc_table_size; n++) {
+		hash = summary_cache_hash(hash, &(reloc_table[n].address), sizeof(reloc_table[n].address));
+		hash = summary_cache_hash(hash, &(reloc_table[n].type), sizeof(reloc_table[n].type));
+		hash = summary_cache_hash(hash, &(reloc_table[n].addend), sizeof(reloc_table[n].addend));
+		hash = summary_cache_hash(hash, &(reloc_table[n].symbol_value), sizeof(reloc_table[n].symbol_value));
+		if (reloc_table[n].symbol_name) {
+			hash = summary_cache_hash(hash, reloc_table[n].symbol_name,
+				strlen(reloc_table[n].symbol_name) + 1);
+		}
+	}
+	return hash;
+}
+
+/* A missing or unreadable file is an empty cache.
+ * llvm is set when the run writes bitcode. Then only entries with bitcode are hits.
+ */
+int summary_cache_open(struct self_s *self, const char *path, int llvm)
+{
+	struct summary_cache_s *cache;
+	struct summary_cache_header_s *header;
+	struct stat st;
+	uint64_t entries_size;
+	int fd;
+
+	summary_cache_close(self);
+	cache = calloc(1, sizeof(struct summary_cache_s));
+	if (!cache) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: calloc failed\n");
+		exit(1);
+	}
+	cache->path = strdup(path);
+	cache->llvm = llvm;
+	cache->key = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(uint64_t));
+	cache->hit = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct summary_cache_entry_s *));
+	cache->added = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct summary_cache_new_s));
+	if (!cache->path || !cache->key || !cache->hit || !cache->added) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: calloc failed\n");
+		exit(1);
+	}
+	self->summary_cache = cache;
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: %s: new cache\n", path);
+		return 0;
+	}
+	if (fstat(fd, &st) || (st.st_size < (off_t)sizeof(struct summary_cache_header_s))) {
+		close(fd);
+		return 0;
+	}
+	cache->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (cache->map == MAP_FAILED) {
+		cache->map = NULL;
+		return 0;
+	}
+	cache->map_size = st.st_size;
+	header = cache->map;
+	if (memcmp(header->magic, SUMMARY_CACHE_MAGIC, sizeof(header->magic)) ||
+		(header->entry_size != sizeof(struct summary_cache_entry_s)) ||
+		(header->label_size != sizeof(struct label_s)) ||
+		(header->entries > (cache->map_size - sizeof(struct summary_cache_header_s)) /
+			sizeof(struct summary_cache_entry_s))) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: %s: not a cache file, ignored\n", path);
+		return 0;
+	}
+	entries_size = header->entries * sizeof(struct summary_cache_entry_s);
+	if (header->blob_size > cache->map_size - sizeof(struct summary_cache_header_s) - entries_size) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: %s: truncated, ignored\n", path);
+		return 0;
+	}
+	cache->entries = header->entries;
+	cache->entry = (struct summary_cache_entry_s *)(header + 1);
+	cache->blob = (uint8_t *)(cache->entry) + entries_size;
+	cache->blob_size = header->blob_size;
+	debug_print(DEBUG_ANALYSE, 1, "summary_cache_open: %s: 0x%"PRIx64" entries\n", path, cache->entries);
+	return 0;
+}
+
+/* Key every function in this file by its bytes and relocations, on top of base.
+ * A function runs from its entry point to the next one, or the end of .text.
+ */
+int summary_cache_keys(struct self_s *self, uint64_t base, uint8_t *code, size_t code_size,
+	struct reloc_table_s *reloc_table, int reloc_table_size)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct summary_cache_s *cache = self->summary_cache;
+	uint64_t start;
+	uint64_t end;
+	uint64_t offset;
+	uint64_t hash;
+	int function;
+	int n;
+
+	if (!cache) {
+		return 0;
+	}
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		cache->key[function] = 0;
+		if (!external_entry_points[function].valid ||
+			(external_entry_points[function].type != 1) ||
+			!external_entry_points[function].name) {
+			continue;
+		}
+		start = external_entry_points[function].value;
+		end = code_size;
+		for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
+			if (external_entry_points[n].valid &&
+				(external_entry_points[n].type == 1) &&
+				(external_entry_points[n].value > start) &&
+				(external_entry_points[n].value < end)) {
+				end = external_entry_points[n].value;
+			}
+		}
+		if (start >= end) {
+			continue;
+		}
+		hash = base;
+		/* The name is in the C text, and the callers' C text */
+		hash = summary_cache_hash(hash, external_entry_points[function].name,
+			strlen(external_entry_points[function].name) + 1);
+		offset = end - start;
+		hash = summary_cache_hash(hash, &offset, sizeof(offset));
+		hash = summary_cache_hash(hash, &code[start], end - start);
+		for (n = 0; n < reloc_table_size; n++) {
+			if ((reloc_table[n].address < start) || (reloc_table[n].address >= end)) {
+				continue;
+			}
+			offset = reloc_table[n].address - start;
+			hash = summary_cache_hash(hash, &offset, sizeof(offset));
+			hash = summary_cache_hash(hash, &(reloc_table[n].type), sizeof(reloc_table[n].type));
+			hash = summary_cache_hash(hash, &(reloc_table[n].addend), sizeof(reloc_table[n].addend));
+			if (reloc_table[n].symbol_name) {
+				hash = summary_cache_hash(hash, reloc_table[n].symbol_name,
+					strlen(reloc_table[n].symbol_name) + 1);
+			}
+			/* A callee in .text is named, and its own key covers it, so
+			 * moving it does not change its callers. A data offset is in the C text.
+			 */
+			if (!reloc_table[n].section_name || strcmp(reloc_table[n].section_name, ".text")) {
+				hash = summary_cache_hash(hash, &(reloc_table[n].symbol_value),
+					sizeof(reloc_table[n].symbol_value));
+			}
+		}
+		/* 0 means not known */
+		cache->key[function] = hash ? hash : 1;
+	}
+	return 0;
+}
+
+static struct summary_cache_entry_s *summary_cache_lookup(struct summary_cache_s *cache, uint64_t key)
+{
+	uint64_t low = 0;
+	uint64_t high = cache->entries;
+	uint64_t mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (cache->entry[mid].key < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if ((low < cache->entries) && (cache->entry[low].key == key)) {
+		return &(cache->entry[low]);
+	}
+	return NULL;
+}
+
+/* count items of size bytes at offset, 8 byte aligned, all inside the blob */
+static int summary_cache_in_blob(struct summary_cache_s *cache, uint64_t offset, uint64_t count, uint64_t size)
+{
+	if ((offset & 7) || (count > cache->blob_size / size)) {
+		return 0;
+	}
+	return offset <= cache->blob_size - (count * size);
+}
+
+/* Returns 1 if every part of entry is inside the file */
+static int summary_cache_entry_ok(struct summary_cache_s *cache, struct summary_cache_entry_s *entry)
+{
+	int n;
+
+	if (!summary_cache_in_blob(cache, entry->callee_offset, entry->callees, sizeof(uint64_t)) ||
+		(entry->params > cache->blob_size) ||
+		(entry->locals > cache->blob_size) ||
+		!summary_cache_in_blob(cache, entry->label_offset, entry->params + entry->locals, sizeof(struct label_s))) {
+		return 0;
+	}
+	for (n = 0; n < SUMMARY_CACHE_TEXTS; n++) {
+		if (!summary_cache_in_blob(cache, entry->text_offset[n], entry->text_size[n], 1)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int summary_cache_key_cmp(const void *a, const void *b)
+{
+	const struct summary_cache_key_s *key_a = a;
+	const struct summary_cache_key_s *key_b = b;
+
+	if (key_a->key < key_b->key) {
+		return -1;
+	}
+	return (key_a->key > key_b->key);
+}
+
+/* Gives the function the params, locals and labels from entry */
+static int summary_cache_restore(struct self_s *self, int function, struct summary_cache_entry_s *entry)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct external_entry_point_s *external_entry_point = &(self->external_entry_points[function]);
+	struct label_s *label = (struct label_s *)(cache->blob + entry->label_offset);
+	int count = entry->params + entry->locals;
+	int n;
+
+	/* value_id 0 is no label, so they start at 1 */
+	label_redirect_reserve(external_entry_point, count + 1);
+	for (n = 0; n < count; n++) {
+		label_redirect_init(external_entry_point->label_redirect, n + 1);
+		external_entry_point->labels[n + 1] = label[n];
+		external_entry_point->labels[n + 1].name = NULL;
+	}
+	external_entry_point->variable_id = count + 1;
+	external_entry_point->params_size = entry->params;
+	external_entry_point->params = calloc(entry->params + 1, sizeof(int));
+	external_entry_point->locals_size = entry->locals;
+	external_entry_point->locals = calloc(entry->locals + 1, sizeof(int));
+	if (!external_entry_point->params || !external_entry_point->locals) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_restore: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < entry->params; n++) {
+		external_entry_point->params[n] = n + 1;
+	}
+	for (n = 0; n < entry->locals; n++) {
+		external_entry_point->locals[n] = entry->params + n + 1;
+	}
+	external_entry_point->type = 3;
+	return 0;
+}
+
+/* Needs summary_cache_keys(). Finds the functions that are served from the
+ * cache, and gives them type 3, so process_block() and the analysis skip them.
+ * A function is only served if every function in this file it called last time
+ * is served too. Otherwise a changed callee could change its summary, and so
+ * its labels.
+ * Returns the number of functions served from the cache.
+ */
+int summary_cache_select(struct self_s *self)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct summary_cache_entry_s *entry;
+	struct summary_cache_key_s *current;
+	struct summary_cache_key_s key;
+	struct summary_cache_key_s *found;
+	uint64_t *callee;
+	int current_size = 0;
+	int changed;
+	int function;
+	int n;
+
+	if (!cache) {
+		return 0;
+	}
+	current = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct summary_cache_key_s));
+	if (!current) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_select: calloc failed\n");
+		exit(1);
+	}
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		cache->hit[function] = NULL;
+		if (!cache->key[function]) {
+			continue;
+		}
+		current[current_size].key = cache->key[function];
+		current[current_size].function = function;
+		current_size++;
+		entry = summary_cache_lookup(cache, cache->key[function]);
+		if (entry && summary_cache_entry_ok(cache, entry) &&
+			(!cache->llvm || entry->text_size[SUMMARY_CACHE_LLVM])) {
+			cache->hit[function] = entry;
+		}
+	}
+	qsort(current, current_size, sizeof(struct summary_cache_key_s), summary_cache_key_cmp);
+	/* Drop the hits that call a function that is not a hit, until none are left */
+	do {
+		changed = 0;
+		for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+			entry = cache->hit[function];
+			if (!entry) {
+				continue;
+			}
+			callee = (uint64_t *)(cache->blob + entry->callee_offset);
+			for (n = 0; n < entry->callees; n++) {
+				key.key = callee[n];
+				found = bsearch(&key, current, current_size, sizeof(struct summary_cache_key_s), summary_cache_key_cmp);
+				if (!found || !cache->hit[found->function]) {
+					cache->hit[function] = NULL;
+					changed = 1;
+					break;
+				}
+			}
+		}
+	} while (changed);
+	free(current);
+
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		if (cache->hit[function]) {
+			summary_cache_restore(self, function, cache->hit[function]);
+			cache->hits++;
+			debug_print(DEBUG_ANALYSE, 1, "summary_cache_select: %s: from the cache\n",
+				self->external_entry_points[function].name);
+		} else if (cache->key[function]) {
+			cache->misses++;
+		}
+	}
+	debug_print(DEBUG_ANALYSE, 1, "summary_cache_select: 0x%x hits, 0x%x misses\n", cache->hits, cache->misses);
+	return cache->hits;
+}
+
+/* Needs call_graph_build(). Before call_graph_summarise(), which leaves type 3 alone */
+int summary_cache_summaries(struct self_s *self)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct call_graph_s *graph = self->call_graph;
+	int function;
+
+	if (!cache || !graph) {
+		return 0;
+	}
+	for (function = 0; function < graph->size; function++) {
+		if (cache->hit[function]) {
+			graph->summary[function] = cache->hit[function]->summary;
+		}
+	}
+	return 0;
+}
+
+/* The cached text of a function served from the cache. Returns 1 if it is not */
+int summary_cache_text(struct self_s *self, int function, int text, const char **data, size_t *size)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct summary_cache_entry_s *entry;
+
+	*data = NULL;
+	*size = 0;
+	if (!cache || (function < 0) || (function >= EXTERNAL_ENTRY_POINTS_MAX) ||
+		(text < 0) || (text >= SUMMARY_CACHE_TEXTS) || !cache->hit[function]) {
+		return 1;
+	}
+	entry = cache->hit[function];
+	*data = (const char *)(cache->blob + entry->text_offset[text]);
+	*size = entry->text_size[text];
+	return 0;
+}
+
+/* Keep a copy of the text of function, to write out.
+ * Each function is only set by one thread, so the LLVM export threads can call it.
+ */
+int summary_cache_set_text(struct self_s *self, int function, int text, const char *data, size_t size)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct summary_cache_new_s *added;
+
+	if (!cache || (function < 0) || (function >= EXTERNAL_ENTRY_POINTS_MAX) ||
+		(text < 0) || (text >= SUMMARY_CACHE_TEXTS) || !cache->key[function]) {
+		return 1;
+	}
+	added = &(cache->added[function]);
+	free(added->text[text]);
+	added->text[text] = malloc(size + 1);
+	if (!added->text[text]) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_set_text: malloc failed\n");
+		exit(1);
+	}
+	memcpy(added->text[text], data, size);
+	added->text[text][size] = 0;
+	added->text_size[text] = size;
+	return 0;
+}
+
+/* Keep the summary, callees, params and locals of function, once its C output is written */
+int summary_cache_add(struct self_s *self, int function)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct external_entry_point_s *external_entry_point = &(self->external_entry_points[function]);
+	struct call_graph_s *graph = self->call_graph;
+	struct function_summary_s *summary;
+	struct summary_cache_new_s *added;
+	int callee;
+	int index;
+	int edge;
+	int n;
+
+	if (!cache || (function < 0) || (function >= EXTERNAL_ENTRY_POINTS_MAX) || !cache->key[function]) {
+		return 0;
+	}
+	added = &(cache->added[function]);
+	summary = call_graph_summary(self, function);
+	if (summary) {
+		added->summary = *summary;
+	}
+	if (graph) {
+		added->callee = calloc(graph->callee_start[function + 1] - graph->callee_start[function] + 1,
+			sizeof(uint64_t));
+		if (!added->callee) {
+			debug_print(DEBUG_ANALYSE, 1, "summary_cache_add: calloc failed\n");
+			exit(1);
+		}
+		for (edge = graph->callee_start[function]; edge < graph->callee_start[function + 1]; edge++) {
+			callee = graph->callee[edge];
+			/* External functions are in the key, by their relocation */
+			if (cache->key[callee]) {
+				added->callee[added->callees] = cache->key[callee];
+				added->callees++;
+			}
+		}
+	}
+	added->label = calloc(external_entry_point->params_size + external_entry_point->locals_size + 1,
+		sizeof(struct label_s));
+	if (!added->label) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_add: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < external_entry_point->params_size; n++) {
+		index = external_entry_point->params[n];
+		if ((index >= 0) && (index < external_entry_point->label_redirect_size)) {
+			added->label[added->params] = external_entry_point->labels[index];
+			/* Not kept. A pointer means nothing in the next run */
+			added->label[added->params].name = NULL;
+		}
+		added->params++;
+	}
+	for (n = 0; n < external_entry_point->locals_size; n++) {
+		index = external_entry_point->locals[n];
+		if ((index >= 0) && (index < external_entry_point->label_redirect_size)) {
+			added->label[added->params + added->locals] = external_entry_point->labels[index];
+			added->label[added->params + added->locals].name = NULL;
+		}
+		added->locals++;
+	}
+	added->valid = 1;
+	return 0;
+}
+
+/* Returns the offset of the copy. Each part starts 8 byte aligned */
+static uint64_t summary_cache_blob_add(struct summary_cache_blob_s *blob, const void *data, uint64_t size)
+{
+	uint64_t offset = blob->size;
+	uint64_t padded = (size + 7) & ~7ULL;
+
+	if (offset + padded > blob->max) {
+		blob->max = blob->max ? blob->max * 2 : 0x10000;
+		while (offset + padded > blob->max) {
+			blob->max *= 2;
+		}
+		blob->data = realloc(blob->data, blob->max);
+		if (!blob->data) {
+			debug_print(DEBUG_ANALYSE, 1, "summary_cache_blob_add: realloc failed\n");
+			exit(1);
+		}
+	}
+	if (size) {
+		memcpy(&(blob->data[offset]), data, size);
+	}
+	memset(&(blob->data[offset + size]), 0, padded - size);
+	blob->size += padded;
+	return offset;
+}
+
+/* Copy the parts of an old entry into blob, and point it at them */
+static void summary_cache_copy_entry(struct summary_cache_s *cache, struct summary_cache_blob_s *blob,
+	struct summary_cache_entry_s *entry)
+{
+	int n;
+
+	entry->callee_offset = summary_cache_blob_add(blob, cache->blob + entry->callee_offset,
+		entry->callees * sizeof(uint64_t));
+	entry->label_offset = summary_cache_blob_add(blob, cache->blob + entry->label_offset,
+		(entry->params + entry->locals) * sizeof(struct label_s));
+	for (n = 0; n < SUMMARY_CACHE_TEXTS; n++) {
+		entry->text_offset[n] = summary_cache_blob_add(blob, cache->blob + entry->text_offset[n],
+			entry->text_size[n]);
+	}
+}
+
+static int summary_cache_entry_cmp(const void *a, const void *b)
+{
+	const struct summary_cache_entry_s *entry_a = a;
+	const struct summary_cache_entry_s *entry_b = b;
+
+	if (entry_a->key < entry_b->key) {
+		return -1;
+	}
+	return (entry_a->key > entry_b->key);
+}
+
+/* Merge the old entries and the new ones, both sorted, into the file */
+static int summary_cache_write(struct summary_cache_s *cache)
+{
+	struct summary_cache_header_s header;
+	struct summary_cache_entry_s *added;
+	struct summary_cache_entry_s *entry;
+	struct summary_cache_new_s *new_entry;
+	struct summary_cache_blob_s blob;
+	char *tmp_path;
+	uint64_t old = 0;
+	uint64_t size = 0;
+	int added_size = 0;
+	int function;
+	int n;
+	FILE *file;
+
+	memset(&blob, 0, sizeof(blob));
+	added = calloc(EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct summary_cache_entry_s));
+	entry = calloc(cache->entries + EXTERNAL_ENTRY_POINTS_MAX, sizeof(struct summary_cache_entry_s));
+	tmp_path = malloc(strlen(cache->path) + 5);
+	if (!added || !entry || !tmp_path) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_write: calloc failed\n");
+		exit(1);
+	}
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		new_entry = &(cache->added[function]);
+		if (!new_entry->valid ||
+			(cache->llvm && !new_entry->text[SUMMARY_CACHE_LLVM])) {
+			continue;
+		}
+		added[added_size].key = cache->key[function];
+		added[added_size].summary = new_entry->summary;
+		added[added_size].callees = new_entry->callees;
+		added[added_size].callee_offset = summary_cache_blob_add(&blob, new_entry->callee,
+			new_entry->callees * sizeof(uint64_t));
+		added[added_size].params = new_entry->params;
+		added[added_size].locals = new_entry->locals;
+		added[added_size].label_offset = summary_cache_blob_add(&blob, new_entry->label,
+			(new_entry->params + new_entry->locals) * sizeof(struct label_s));
+		for (n = 0; n < SUMMARY_CACHE_TEXTS; n++) {
+			added[added_size].text_size[n] = new_entry->text_size[n];
+			added[added_size].text_offset[n] = summary_cache_blob_add(&blob, new_entry->text[n],
+				new_entry->text_size[n]);
+		}
+		added_size++;
+	}
+	qsort(added, added_size, sizeof(struct summary_cache_entry_s), summary_cache_entry_cmp);
+	n = 0;
+	while ((old < cache->entries) || (n < added_size)) {
+		if ((n >= added_size) ||
+			((old < cache->entries) && (cache->entry[old].key < added[n].key))) {
+			/* Only keep the old entries that are whole */
+			if (summary_cache_entry_ok(cache, &(cache->entry[old]))) {
+				entry[size] = cache->entry[old];
+				summary_cache_copy_entry(cache, &blob, &(entry[size]));
+				size++;
+			}
+			old++;
+		} else if ((old < cache->entries) && (cache->entry[old].key == added[n].key)) {
+			/* The new one replaces it */
+			old++;
+		} else {
+			if ((size == 0) || (entry[size - 1].key != added[n].key)) {
+				entry[size++] = added[n];
+			}
+			n++;
+		}
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SUMMARY_CACHE_MAGIC, sizeof(header.magic));
+	header.entry_size = sizeof(struct summary_cache_entry_s);
+	header.label_size = sizeof(struct label_s);
+	header.entries = size;
+	header.blob_size = blob.size;
+	sprintf(tmp_path, "%s.tmp", cache->path);
+	file = fopen(tmp_path, "wb");
+	if (!file) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_write: cannot create %s\n", tmp_path);
+		free(added);
+		free(entry);
+		free(blob.data);
+		free(tmp_path);
+		return 1;
+	}
+	if ((fwrite(&header, sizeof(header), 1, file) != 1) ||
+		(fwrite(entry, sizeof(struct summary_cache_entry_s), size, file) != size) ||
+		(fwrite(blob.data, 1, blob.size, file) != blob.size) ||
+		fclose(file) ||
+		rename(tmp_path, cache->path)) {
+		debug_print(DEBUG_ANALYSE, 1, "summary_cache_write: cannot write %s\n", cache->path);
+		unlink(tmp_path);
+		free(added);
+		free(entry);
+		free(blob.data);
+		free(tmp_path);
+		return 1;
+	}
+	debug_print(DEBUG_ANALYSE, 1, "summary_cache_write: %s: 0x%"PRIx64" entries, 0x%x new\n",
+		cache->path, size, added_size);
+	free(added);
+	free(entry);
+	free(blob.data);
+	free(tmp_path);
+	return 0;
+}
+
+/* Writes out any new entries. After the LLVM export, which reads the cached bitcode */
+int summary_cache_close(struct self_s *self)
+{
+	struct summary_cache_s *cache = self->summary_cache;
+	struct summary_cache_new_s *added;
+	int write = 0;
+	int ret = 0;
+	int function;
+	int n;
+
+	if (!cache) {
+		return 0;
+	}
+	debug_print(DEBUG_ANALYSE, 1, "summary_cache_close: 0x%x hits, 0x%x misses\n", cache->hits, cache->misses);
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		write |= cache->added[function].valid;
+	}
+	if (write) {
+		ret = summary_cache_write(cache);
+	}
+	if (cache->map) {
+		munmap(cache->map, cache->map_size);
+	}
+	for (function = 0; function < EXTERNAL_ENTRY_POINTS_MAX; function++) {
+		added = &(cache->added[function]);
+		free(added->callee);
+		free(added->label);
+		for (n = 0; n < SUMMARY_CACHE_TEXTS; n++) {
+			free(added->text[n]);
+		}
+	}
+	free(cache->added);
+	free(cache->hit);
+	free(cache->key);
+	free(cache->path);
+	free(cache);
+	self->summary_cache = NULL;
+	return ret;
+}
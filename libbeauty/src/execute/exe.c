@@ -167,6 +167,294 @@ int print_store(struct memory_s *memory) {
 	return 0;
 }
 
+/* Number of valid entries. search_store() stops at the first invalid one */
+static int store_valid_size(struct memory_s *memory, int limit)
+{
+	int n = 0;
+	while ((n < limit) && (memory[n].valid == 1)) {
+		n++;
+	}
+	return n;
+}
+
+/* The valid entries are a prefix of the store, so the first invalid one,
+ * where add_new_store() puts the next, can be found by bisection.
+ */
+static int store_free_entry(struct memory_s *memory, int limit)
+{
+	int low = 0;
+	int high = limit;
+	int mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (memory[mid].valid == 1) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static struct memory_s *store_copy(struct memory_s *memory, int size)
+{
+	struct memory_s *copy;
+
+	/* Always allocate something, so the restore memcpy never sees NULL */
+	copy = malloc((size + 1) * sizeof(struct memory_s));
+	if (!copy) {
+		debug_print(DEBUG_EXE, 1, "store_copy: malloc failed\n");
+		exit(1);
+	}
+	memcpy(copy, memory, size * sizeof(struct memory_s));
+	return copy;
+}
+
+static const int store_cow_size[STORE_COW_MAX] = {
+	MEMORY_STACK_SIZE,
+	MEMORY_DATA_SIZE
+};
+
+static struct memory_s *store_cow_memory(struct process_state_s *process_state, int store)
+{
+	if (store == STORE_COW_STACK) {
+		return process_state->memory_stack;
+	}
+	return process_state->memory_data;
+}
+
+static void store_cow_save(struct process_state_snapshot_s *snapshot, int store,
+	struct store_page_s *page)
+{
+	struct store_page_s **saved;
+
+	if (snapshot->saved_size[store] >= snapshot->saved_max[store]) {
+		snapshot->saved_max[store] = snapshot->saved_max[store] ? snapshot->saved_max[store] * 2 : 8;
+		saved = realloc(snapshot->saved[store],
+			snapshot->saved_max[store] * sizeof(struct store_page_s *));
+		if (!saved) {
+			debug_print(DEBUG_EXE, 1, "store_cow_save: realloc failed\n");
+			exit(1);
+		}
+		snapshot->saved[store] = saved;
+	}
+	snapshot->saved[store][snapshot->saved_size[store]] = page;
+	snapshot->saved_size[store]++;
+	page->refcount++;
+}
+
+/* Call before entry n of the stack or data store is changed.
+ * The first write to a page after a snapshot copies the page once, and the copy
+ * is shared by all the snapshots taken since the page was last saved.
+ */
+static void store_cow_write(struct process_state_s *process_state, int store, int n)
+{
+	struct store_cow_s *cow = process_state->cow;
+	struct process_state_snapshot_s *snapshot;
+	struct store_page_s *page = NULL;
+	struct memory_s *memory;
+	int page_index;
+	int size;
+
+	if (!cow || (n < 0) || (n >= store_cow_size[store])) {
+		return;
+	}
+	page_index = n >> STORE_PAGE_SHIFT;
+	if (cow->page_generation[store][page_index] == cow->generation) {
+		return;
+	}
+	/* The live list is newest first */
+	for (snapshot = cow->live;
+		snapshot && (snapshot->generation > cow->page_generation[store][page_index]);
+		snapshot = snapshot->live_next) {
+		if (!page) {
+			page = malloc(sizeof(struct store_page_s));
+			if (!page) {
+				debug_print(DEBUG_EXE, 1, "store_cow_write: malloc failed\n");
+				exit(1);
+			}
+			page->refcount = 0;
+			page->page = page_index;
+			size = store_cow_size[store] - (page_index << STORE_PAGE_SHIFT);
+			if (size > STORE_PAGE_SIZE) {
+				size = STORE_PAGE_SIZE;
+			}
+			memory = store_cow_memory(process_state, store);
+			memcpy(page->entry, &(memory[page_index << STORE_PAGE_SHIFT]),
+				size * sizeof(struct memory_s));
+		}
+		store_cow_save(snapshot, store, page);
+	}
+	cow->page_generation[store][page_index] = cow->generation;
+}
+
+/* add_new_store() for the stack and data stores */
+static struct memory_s *store_cow_add(struct process_state_s *process_state, int store,
+	uint64_t index, int size_bits)
+{
+	struct memory_s *memory = store_cow_memory(process_state, store);
+
+	store_cow_write(process_state, store,
+		store_free_entry(memory, store_cow_size[store]));
+	return add_new_store(memory, index, size_bits);
+}
+
+/* Take a snapshot of the process_state to be restored when a queued branch is resumed.
+ * The reg store is small and written everywhere, so it is copied.
+ * The stack and data stores are only copied a page at a time, on the first write
+ * to the page after the snapshot. See store_cow_write().
+ * The caller holds one reference. Release it with process_state_snapshot_put().
+ */
+struct process_state_snapshot_s *process_state_snapshot(
+	struct process_state_s *process_state)
+{
+	struct process_state_snapshot_s *snapshot;
+	struct store_cow_s *cow;
+	int store;
+
+	snapshot = calloc(1, sizeof(struct process_state_snapshot_s));
+	if (!snapshot) {
+		debug_print(DEBUG_EXE, 1, "process_state_snapshot: calloc failed\n");
+		exit(1);
+	}
+	if (!process_state->cow) {
+		cow = calloc(1, sizeof(struct store_cow_s));
+		if (!cow) {
+			debug_print(DEBUG_EXE, 1, "process_state_snapshot: calloc failed\n");
+			exit(1);
+		}
+		for (store = 0; store < STORE_COW_MAX; store++) {
+			cow->page_generation[store] = calloc(
+				(store_cow_size[store] + STORE_PAGE_SIZE - 1) >> STORE_PAGE_SHIFT,
+				sizeof(int));
+			if (!cow->page_generation[store]) {
+				debug_print(DEBUG_EXE, 1, "process_state_snapshot: calloc failed\n");
+				exit(1);
+			}
+		}
+		process_state->cow = cow;
+	}
+	cow = process_state->cow;
+	cow->generation++;
+	snapshot->refcount = 1;
+	snapshot->generation = cow->generation;
+	snapshot->process_state = process_state;
+	snapshot->live_next = cow->live;
+	cow->live = snapshot;
+	snapshot->memory_reg_size = store_valid_size(process_state->memory_reg, MEMORY_REG_SIZE);
+	snapshot->memory_reg = store_copy(process_state->memory_reg, snapshot->memory_reg_size);
+	debug_print(DEBUG_EXE, 1, "process_state_snapshot: generation=%d, reg=%d\n",
+		snapshot->generation,
+		snapshot->memory_reg_size);
+	return snapshot;
+}
+
+/* Put the reg and stack stores back as they were at the snapshot.
+ * Entries added since are dropped, as they were only valid on the other path.
+ * Data entries added since are kept, so that all the globals found are still output,
+ * but the ones in the snapshot get their values at the snapshot back.
+ * Only the stack and data pages written since the snapshot differ from it.
+ */
+int process_state_restore(struct process_state_s *process_state,
+	struct process_state_snapshot_s *snapshot)
+{
+	struct store_page_s *page;
+	struct memory_s *memory;
+	int size;
+	int store;
+	int n;
+	int m;
+
+	size = store_valid_size(process_state->memory_reg, MEMORY_REG_SIZE);
+	memcpy(process_state->memory_reg, snapshot->memory_reg,
+		snapshot->memory_reg_size * sizeof(struct memory_s));
+	if (size > snapshot->memory_reg_size) {
+		memset(&(process_state->memory_reg[snapshot->memory_reg_size]), 0,
+			(size - snapshot->memory_reg_size) * sizeof(struct memory_s));
+	}
+
+	for (store = 0; store < STORE_COW_MAX; store++) {
+		memory = store_cow_memory(process_state, store);
+		for (n = 0; n < snapshot->saved_size[store]; n++) {
+			page = snapshot->saved[store][n];
+			/* The other live snapshots may still need the page as it is now */
+			store_cow_write(process_state, store, page->page << STORE_PAGE_SHIFT);
+			size = store_cow_size[store] - (page->page << STORE_PAGE_SHIFT);
+			if (size > STORE_PAGE_SIZE) {
+				size = STORE_PAGE_SIZE;
+			}
+			if (store == STORE_COW_STACK) {
+				memcpy(&(memory[page->page << STORE_PAGE_SHIFT]), page->entry,
+					size * sizeof(struct memory_s));
+				continue;
+			}
+			for (m = 0; m < size; m++) {
+				if (page->entry[m].valid == 1) {
+					memory[(page->page << STORE_PAGE_SHIFT) + m] = page->entry[m];
+				}
+			}
+		}
+	}
+	debug_print(DEBUG_EXE, 1, "process_state_restore: generation=%d, reg=%d, stack pages=%d, data pages=%d\n",
+		snapshot->generation,
+		snapshot->memory_reg_size,
+		snapshot->saved_size[STORE_COW_STACK],
+		snapshot->saved_size[STORE_COW_DATA]);
+	return 0;
+}
+
+void process_state_snapshot_get(struct process_state_snapshot_s *snapshot)
+{
+	if (snapshot) {
+		snapshot->refcount++;
+	}
+}
+
+void process_state_snapshot_put(struct process_state_snapshot_s *snapshot)
+{
+	struct store_cow_s *cow;
+	struct process_state_snapshot_s **live;
+	struct store_page_s *page;
+	int store;
+	int n;
+
+	if (!snapshot) {
+		return;
+	}
+	snapshot->refcount--;
+	if (snapshot->refcount > 0) {
+		return;
+	}
+	cow = snapshot->process_state->cow;
+	for (live = &(cow->live); *live; live = &((*live)->live_next)) {
+		if (*live == snapshot) {
+			*live = snapshot->live_next;
+			break;
+		}
+	}
+	for (store = 0; store < STORE_COW_MAX; store++) {
+		for (n = 0; n < snapshot->saved_size[store]; n++) {
+			page = snapshot->saved[store][n];
+			page->refcount--;
+			if (page->refcount == 0) {
+				free(page);
+			}
+		}
+		free(snapshot->saved[store]);
+	}
+	if (!cow->live) {
+		/* No writes need saving until the next snapshot */
+		for (store = 0; store < STORE_COW_MAX; store++) {
+			free(cow->page_generation[store]);
+		}
+		free(cow);
+		snapshot->process_state->cow = NULL;
+	}
+	free(snapshot->memory_reg);
+	free(snapshot);
+}
+
 static int source_equals_dest(struct operand_s *srcA, struct operand_s *dstA)
 {
 	int ret;
@@ -183,611 +471,640 @@ static int source_equals_dest(struct operand_s *srcA, struct operand_s *dstA)
 	return ret;
 }
 
-static int get_value_RTL_instruction(
+/* Operand access.
+ * There is one get and one put handler for each (indirect, store) pair,
+ * so the classification is done once by resolve_operand_handlers() when the
+ * instruction is logged, and not again on every access.
+ */
+
+static void get_value_from_store(struct memory_s *destination, struct memory_s *value)
+{
+	destination->length = value->length;
+	destination->init_value_type = value->init_value_type;
+	destination->init_value = value->init_value;
+	destination->offset_value = value->offset_value;
+	destination->value_type = value->value_type;
+	destination->ref_memory =
+		value->ref_memory;
+	destination->ref_log =
+		value->ref_log;
+	destination->value_scope = value->value_scope;
+	/* counter */
+	destination->value_id = value->value_id;
+	/* 1 - Entry Used */
+	destination->valid = 1;
+}
+
+static void put_value_to_store(struct memory_s *value, struct memory_s *source)
+{
+	/* FIXME: these should always be the same */
+	/* value->length = source->length; */
+	value->init_value_type = source->init_value_type;
+	value->init_value = source->init_value;
+	value->offset_value = source->offset_value;
+	value->value_type = source->value_type;
+	value->ref_memory =
+		source->ref_memory;
+	value->ref_log =
+		source->ref_log;
+	value->value_scope = source->value_scope;
+	/* 1 - Ids */
+	value->value_id = source->value_id;
+	/* 1 - Entry Used */
+	value->valid = 1;
+}
+
+/* The reg holding the address for an IND_MEM or IND_STACK operand */
+static struct memory_s *get_indirect_reg(struct memory_s *memory_reg, struct operand_s *operand)
+{
+	struct memory_s *value;
+
+	value = search_store(memory_reg,
+			operand->index,
+			operand->indirect_size);
+	debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
+	/* FIXME what to do in NULL */
+	if (!value) {
+		value = add_new_store(memory_reg,
+				operand->index,
+				operand->indirect_size);
+		if (value) {
+			value->value_id = 0;
+		}
+	}
+	return value;
+}
+
+static int get_value_invalid(
 	struct self_s *self,
 	struct process_state_s *process_state,
 	struct operand_s *source,
 	struct memory_s *destination,
-	int info_id )
+	int info_id)
 {
-	struct memory_s *value = NULL;
-	struct memory_s *value_data = NULL;
-	struct memory_s *value_stack = NULL;
-	uint64_t data_index;
-	char *info = NULL;
-	//struct memory_s *memory_text;
-	struct memory_s *memory_stack;
-	struct memory_s *memory_reg;
-	struct memory_s *memory_data;
-	//int *memory_used;
+	/* Should not get here */
+	debug_print(DEBUG_EXE, 1, "FAILED: get indirect=0x%x, store=0x%x\n",
+		source->indirect, source->store);
+	return 1;
+}
 
-	//memory_text = process_state->memory_text;
-	memory_stack = process_state->memory_stack;
-	memory_reg = process_state->memory_reg;
-	memory_data = process_state->memory_data;
-	//memory_used = process_state->memory_used;
+/* i - immediate */
+static int get_value_direct_imm(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id)
+{
+	debug_print(DEBUG_EXE, 1, "src%c-immediate\n", 'A' + info_id);
+	debug_print(DEBUG_EXE, 1, "relocated=0x%x\n", source->relocated);
+	debug_print(DEBUG_EXE, 1, "index=%"PRIx64", size=%d\n",
+			source->index,
+			source->value_size);
+	destination->start_address = 0;
+	destination->length = source->value_size;
+	/* known */
+	destination->init_value_type = 1;
+	destination->init_value = source->index;
+	destination->offset_value = 0;
+	/* unknown */
+	destination->value_type = 0;
+	/* not set yet. */
+	destination->ref_memory = 0;
+	/* not set yet. */
+	destination->ref_log = 0;
+	/* unknown */
+	/* FIXME: Do we need a special value for this. E.g. for CONSTANT */
+	destination->value_scope = 0;
+	/* 1 - Entry Used */
+	destination->value_id = 0;
+	destination->valid = 1;
+	debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		destination->init_value,
+		destination->offset_value,
+		destination->init_value +
+			 destination->offset_value);
+	return 0;
+}
 
-	if (info_id == 0) info = "srcA";
-	if (info_id == 1) info = "srcB";
-	debug_print(DEBUG_EXE, 1, "get_value_RTL_instruction:%p, %p, %i\n", source, destination, info_id);
-	switch (source->indirect) {
-	case IND_DIRECT:
-		/* Not indirect */
-		debug_print(DEBUG_EXE, 1, "%s-direct\n", info);
-		switch (source->store) {
-		case STORE_DIRECT:
-			/* i - immediate */
-			debug_print(DEBUG_EXE, 1, "%s-immediate\n", info);
-			debug_print(DEBUG_EXE, 1, "%s-relocated=0x%x\n", info, source->relocated);
-			debug_print(DEBUG_EXE, 1, "index=%"PRIx64", size=%d\n",
-					source->index,
-					source->value_size);
-			destination->start_address = 0;
-			destination->length = source->value_size;
-			/* known */
-			destination->init_value_type = 1;
-			destination->init_value = source->index;
-			destination->offset_value = 0;
-			/* unknown */
-			destination->value_type = 0;
-			/* not set yet. */
-			destination->ref_memory = 0;
-			/* not set yet. */
-			destination->ref_log = 0;
-			/* unknown */
-			/* FIXME: Do we need a special value for this. E.g. for CONSTANT */
-			destination->value_scope = 0;
-			/* 1 - Entry Used */
-			destination->value_id = 0;
-			destination->valid = 1;
-			debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-				destination->init_value,
-				destination->offset_value,
-				destination->init_value +
-					 destination->offset_value);
-			break;
-		case STORE_REG:
-			/* r - register */
-			debug_print(DEBUG_EXE, 1, "%s-register\n", info);
-			debug_print(DEBUG_EXE, 1, "index=%"PRIx64", size=%d\n",
-					source->index,
-					source->value_size);
-			value = search_store(memory_reg,
-					source->index,
-					source->value_size);
-			debug_print(DEBUG_EXE, 1, "GET:EXE value=%p\n", value);
-			if (value) {
-				debug_print(DEBUG_EXE, 1, "value_id = 0x%"PRIx64"\n", value->value_id);
-				debug_print(DEBUG_EXE, 1, "init_value = 0x%"PRIx64", offset_value = 0x%"PRIx64", start_address = 0x%"PRIx64", length = 0x%x\n",
-					value->init_value, value->offset_value,
-					value->start_address, value->length);
-			}
-			/* FIXME what to do in NULL */
-			if (!value) {
-				value = add_new_store(memory_reg,
-						source->index,
-						source->value_size);
-				value->value_id = 0;
-				value->value_scope = 1;
-				if (1 == info_id) {
-					value->value_scope = 2;
-				}
-			}
-			if (!value) {
-				debug_print(DEBUG_EXE, 1, "GET CASE0:STORE_REG ERROR!\n");
-				return 1;
-				break;
-			}
-			destination->start_address = value->start_address;
-			destination->length = value->length;
-			destination->init_value_type = value->init_value_type;
-			destination->init_value = value->init_value;
-			destination->offset_value = value->offset_value;
-			destination->value_type = value->value_type;
-			destination->ref_memory =
-				value->ref_memory;
-			destination->ref_log =
-				value->ref_log;
-			destination->value_scope = value->value_scope;
-			/* local counter */
-			destination->value_id = value->value_id;
-			/* 1 - Entry Used */
-			destination->valid = 1;
-			debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-				destination->init_value,
-				destination->offset_value,
-				destination->init_value +
-					destination->offset_value);
-			break;
-		default:
-			/* Should not get here */
-			debug_print(DEBUG_EXE, 1, "FAILED\n");
-			return 1;
-		}
-		break;
-	case IND_MEM:
-		/* m - memory */
-		debug_print(DEBUG_EXE, 1, "%s-indirect\n", info);
-		debug_print(DEBUG_EXE, 1, "%s-memory\n", info);
-		debug_print(DEBUG_EXE, 1, "index=%"PRIx64", indirect_size=%d, value_size=%d\n",
+/* r - register */
+static int get_value_direct_reg(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id)
+{
+	struct memory_s *memory_reg = process_state->memory_reg;
+	struct memory_s *value;
+
+	debug_print(DEBUG_EXE, 1, "src%c-register\n", 'A' + info_id);
+	debug_print(DEBUG_EXE, 1, "index=%"PRIx64", size=%d\n",
+			source->index,
+			source->value_size);
+	value = search_store(memory_reg,
+			source->index,
+			source->value_size);
+	debug_print(DEBUG_EXE, 1, "GET:EXE value=%p\n", value);
+	if (value) {
+		debug_print(DEBUG_EXE, 1, "value_id = 0x%"PRIx64"\n", value->value_id);
+		debug_print(DEBUG_EXE, 1, "init_value = 0x%"PRIx64", offset_value = 0x%"PRIx64", start_address = 0x%"PRIx64", length = 0x%x\n",
+			value->init_value, value->offset_value,
+			value->start_address, value->length);
+	}
+	/* FIXME what to do in NULL */
+	if (!value) {
+		value = add_new_store(memory_reg,
 				source->index,
-				source->indirect_size,
 				source->value_size);
-		switch (source->store) {
-		case STORE_DIRECT:
-			data_index = source->index;
-			break;
-		case STORE_REG:
-			value = search_store(memory_reg,
-					source->index,
-					source->indirect_size);
-			debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
-			/* FIXME what to do in NULL */
-			if (!value) {
-				value = add_new_store(memory_reg,
-						source->index,
-						source->indirect_size);
-				value->value_id = 0;
-			}
-			if (!value) {
-				debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
-				return 1;
-				break;
-			}
-			data_index = value->init_value + value->offset_value;
-			destination->indirect_value_id = value->value_id;
-			break;
-		default:
-			/* Should not get here */
-			debug_print(DEBUG_EXE, 1, "FAILED\n");
+		if (!value) {
+			debug_print(DEBUG_EXE, 1, "GET CASE0:STORE_REG ERROR!\n");
 			return 1;
-			break;
 		}
-		value_data = search_store(memory_data,
-				data_index,
-				source->value_size);
-		debug_print(DEBUG_EXE, 1, "EXE2 value_data=%p, %p\n", value_data, &value_data);
-		if (!value_data) {
-			value_data = add_new_store(memory_data,
-				data_index,
-				source->value_size);
-			value_data->init_value = read_data(self, data_index, 32); 
-			debug_print(DEBUG_EXE, 1, "EXE3 value_data=%p, %p\n", value_data, &value_data);
-			debug_print(DEBUG_EXE, 1, "EXE3 value_data->init_value=%"PRIx64"\n", value_data->init_value);
-			/* Data */
-			value_data->value_scope = 3;
-			/* Param number */
-			value_data->value_id = 0;
+		value->value_id = 0;
+		value->value_scope = 1;
+		if (1 == info_id) {
+			value->value_scope = 2;
 		}
-		debug_print(DEBUG_EXE, 1, "variable on data:0x%"PRIx64"\n",
-			data_index);
+	}
+	destination->start_address = value->start_address;
+	get_value_from_store(destination, value);
+	debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		destination->init_value,
+		destination->offset_value,
+		destination->init_value +
+			destination->offset_value);
+	print_store(memory_reg);
+	print_store(process_state->memory_stack);
+	return 0;
+}
+
+/* m - memory. value is the reg holding the address, or NULL for an immediate address */
+static int get_value_mem(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id,
+	struct memory_s *value,
+	uint64_t data_index)
+{
+	struct memory_s *memory_data = process_state->memory_data;
+	struct memory_s *value_data;
+
+	value_data = search_store(memory_data,
+			data_index,
+			source->value_size);
+	debug_print(DEBUG_EXE, 1, "EXE2 value_data=%p, %p\n", value_data, &value_data);
+	if (!value_data) {
+		value_data = store_cow_add(process_state, STORE_COW_DATA,
+			data_index,
+			source->value_size);
 		if (!value_data) {
 			debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG2 ERROR!\n");
 			return 1;
-			break;
 		}
-		destination->start_address = value_data->start_address;
-		destination->length = value_data->length;
-		destination->init_value_type = value_data->init_value_type;
-		destination->init_value = value_data->init_value;
-		destination->offset_value = value_data->offset_value;
+		value_data->init_value = read_data(self, data_index, 32); 
+		debug_print(DEBUG_EXE, 1, "EXE3 value_data=%p, %p\n", value_data, &value_data);
+		debug_print(DEBUG_EXE, 1, "EXE3 value_data->init_value=%"PRIx64"\n", value_data->init_value);
+		/* Data */
+		value_data->value_scope = 3;
+		/* Param number */
+		value_data->value_id = 0;
+	}
+	debug_print(DEBUG_EXE, 1, "variable on data:0x%"PRIx64"\n",
+		data_index);
+	destination->start_address = value_data->start_address;
+	if (value) {
 		destination->indirect_init_value = value->init_value;
 		destination->indirect_offset_value = value->offset_value;
-		destination->value_type = value_data->value_type;
-		destination->ref_memory =
-			value_data->ref_memory;
-		destination->ref_log =
-			value_data->ref_log;
-		destination->value_scope = value_data->value_scope;
-		/* counter */
-		destination->value_id = value_data->value_id;
-		debug_print(DEBUG_EXE, 1, "%s: scope=%d, id=%"PRIu64"\n",
-			info,
-			destination->value_scope,
-			destination->value_id);
-		/* 1 - Entry Used */
-		destination->valid = 1;
-		debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-			destination->init_value,
-			destination->offset_value,
-			destination->init_value +
-				destination->offset_value);
-		break;
-	case IND_STACK:
-		/* s - stack */
-		debug_print(DEBUG_EXE, 1, "%s-indirect\n", info);
-		debug_print(DEBUG_EXE, 1, "%s-stack\n", info);
-		debug_print(DEBUG_EXE, 1, "index=%"PRIx64", indirect_size=%d, value_size=%d\n",
-				source->index,
-				source->indirect_size,
+	} else {
+		destination->indirect_init_value = 0;
+		destination->indirect_offset_value = 0;
+	}
+	get_value_from_store(destination, value_data);
+	debug_print(DEBUG_EXE, 1, "src%c: scope=%d, id=%"PRIu64"\n",
+		'A' + info_id,
+		destination->value_scope,
+		destination->value_id);
+	debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		destination->init_value,
+		destination->offset_value,
+		destination->init_value +
+			destination->offset_value);
+	print_store(process_state->memory_reg);
+	print_store(process_state->memory_stack);
+	return 0;
+}
+
+static int get_value_mem_imm(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id)
+{
+	debug_print(DEBUG_EXE, 1, "src%c-memory index=%"PRIx64", value_size=%d\n",
+			'A' + info_id,
+			source->index,
+			source->value_size);
+	return get_value_mem(self, process_state, source, destination, info_id,
+		NULL, source->index);
+}
+
+static int get_value_mem_reg(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id)
+{
+	struct memory_s *value;
+
+	debug_print(DEBUG_EXE, 1, "src%c-memory index=%"PRIx64", indirect_size=%d, value_size=%d\n",
+			'A' + info_id,
+			source->index,
+			source->indirect_size,
+			source->value_size);
+	value = get_indirect_reg(process_state->memory_reg, source);
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
+		return 1;
+	}
+	destination->indirect_value_id = value->value_id;
+	return get_value_mem(self, process_state, source, destination, info_id,
+		value, value->init_value + value->offset_value);
+}
+
+/* s - stack */
+static int get_value_stack(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id)
+{
+	struct memory_s *memory_stack = process_state->memory_stack;
+	struct memory_s *value;
+	struct memory_s *value_stack;
+
+	debug_print(DEBUG_EXE, 1, "src%c-stack index=%"PRIx64", indirect_size=%d, value_size=%d\n",
+			'A' + info_id,
+			source->index,
+			source->indirect_size,
+			source->value_size);
+	value = get_indirect_reg(process_state->memory_reg, source);
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
+		return 1;
+	}
+	value_stack = search_store(memory_stack,
+			value->init_value +
+				value->offset_value,
+				source->value_size);
+	debug_print(DEBUG_EXE, 1, "EXE2 value_stack=%p, %p\n", value_stack, &value_stack);
+	if (!value_stack) {
+		value_stack = store_cow_add(process_state, STORE_COW_STACK,
+			value->init_value +
+				value->offset_value,
 				source->value_size);
-		value = search_store(memory_reg,
-				source->index,
-				source->indirect_size);
-		debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
-		/* FIXME what to do in NULL */
-		if (!value) {
-			value = add_new_store(memory_reg,
-					source->index,
-					source->indirect_size);
-			value->value_id = 0;
-		}
-		if (!value) {
-			debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
-			return 1;
-			break;
-		}
-		value_stack = search_store(memory_stack,
-				value->init_value +
-					value->offset_value,
-					source->value_size);
-		debug_print(DEBUG_EXE, 1, "EXE2 value_stack=%p, %p\n", value_stack, &value_stack);
-		if (!value_stack) {
-			value_stack = add_new_store(memory_stack,
-				value->init_value +
-					value->offset_value,
-					source->value_size);
-			debug_print(DEBUG_EXE, 1, "EXE3 value_stack=%p, %p\n", value_stack, &value_stack);
-			/* Only do this init on new stores */
-			/* FIXME: 0x10000 should be a global variable */
-			/* because it should match the ESP entry value */
-			if ((value->init_value +
-				value->offset_value) > 0x10000) {
-				debug_print(DEBUG_EXE, 1, "PARAM\n");
-				/* Param */
-				value_stack->value_scope = 1;
-				/* Param number */
-				value_stack->value_id = 0;
-			} else {
-				debug_print(DEBUG_EXE, 1, "LOCAL\n");
-				/* Local */
-				value_stack->value_scope = 2;
-				/* Local number */
-				value_stack->value_id = 0;
-			}
-/* Section ends */
-		}
-		debug_print(DEBUG_EXE, 1, "variable on stack:0x%"PRIx64"\n",
-			value->init_value + value->offset_value);
 		if (!value_stack) {
 			debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG2 ERROR!\n");
 			return 1;
-			break;
 		}
-		destination->start_address = 0;
-		destination->length = value_stack->length;
-		destination->init_value_type = value_stack->init_value_type;
-		destination->init_value = value_stack->init_value;
-		destination->offset_value = value_stack->offset_value;
-		destination->indirect_init_value = value->init_value;
-		destination->indirect_offset_value = value->offset_value;
-		destination->value_type = value_stack->value_type;
-		destination->ref_memory =
-			value_stack->ref_memory;
-		destination->ref_log =
-			value_stack->ref_log;
-		destination->value_scope = value_stack->value_scope;
-		/* counter */
-		destination->value_id = value_stack->value_id;
-		debug_print(DEBUG_EXE, 1, "%s: scope=%d, id=%"PRIu64"\n",
-			info,
-			destination->value_scope,
-			destination->value_id);
-		/* 1 - Entry Used */
-		destination->valid = 1;
-		debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-			destination->init_value,
-			destination->offset_value,
-			destination->init_value +
-				destination->offset_value);
-		break;
-	default:
-		/* Should not get here */
-		debug_print(DEBUG_EXE, 1, "FAILED\n");
-		return 1;
+		debug_print(DEBUG_EXE, 1, "EXE3 value_stack=%p, %p\n", value_stack, &value_stack);
+		/* Only do this init on new stores */
+		/* FIXME: 0x10000 should be a global variable */
+		/* because it should match the ESP entry value */
+		if ((value->init_value +
+			value->offset_value) > 0x10000) {
+			debug_print(DEBUG_EXE, 1, "PARAM\n");
+			/* Param */
+			value_stack->value_scope = 1;
+			/* Param number */
+			value_stack->value_id = 0;
+		} else {
+			debug_print(DEBUG_EXE, 1, "LOCAL\n");
+			/* Local */
+			value_stack->value_scope = 2;
+			/* Local number */
+			value_stack->value_id = 0;
+		}
 	}
-	print_store(memory_reg);
+	debug_print(DEBUG_EXE, 1, "variable on stack:0x%"PRIx64"\n",
+		value->init_value + value->offset_value);
+	destination->start_address = 0;
+	destination->indirect_init_value = value->init_value;
+	destination->indirect_offset_value = value->offset_value;
+	get_value_from_store(destination, value_stack);
+	debug_print(DEBUG_EXE, 1, "src%c: scope=%d, id=%"PRIu64"\n",
+		'A' + info_id,
+		destination->value_scope,
+		destination->value_id);
+	debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		destination->init_value,
+		destination->offset_value,
+		destination->init_value +
+			destination->offset_value);
+	print_store(process_state->memory_reg);
 	print_store(memory_stack);
 	return 0;
 }
 
-static int put_value_RTL_instruction( 
+static int put_value_invalid(
 	struct self_s *self,
 	struct process_state_s *process_state,
 	struct inst_log_entry_s *inst)
 {
-	struct instruction_s *instruction;
+	/* Also dstA-immediate. THIS SHOULD NEVER HAPPEN! */
+	debug_print(DEBUG_EXE, 1, "FAILED: put indirect=0x%x, store=0x%x\n",
+		inst->instruction.dstA.indirect, inst->instruction.dstA.store);
+	return 1;
+}
+
+/* r - register */
+static int put_value_direct_reg(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct inst_log_entry_s *inst)
+{
+	struct operand_s *dstA = &(inst->instruction.dstA);
+	struct memory_s *memory_reg = process_state->memory_reg;
 	struct memory_s *value;
-//	struct memory_s *value_mem;
+	int result = 1;
+
+	debug_print(DEBUG_EXE, 1, "dstA-register saving result\n");
+	value = search_store(memory_reg,
+			dstA->index,
+			dstA->value_size);
+	debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
+	if (value) {
+		debug_print(DEBUG_EXE, 1, "init_value = 0x%"PRIx64", offset_value = 0x%"PRIx64", start_address = 0x%"PRIx64", length = 0x%x\n",
+			value->init_value, value->offset_value,
+			value->start_address, value->length);
+	}
+	/* FIXME what to do in NULL */
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "WHY!!!!!\n");
+		value = add_new_store(memory_reg,
+				dstA->index,
+				dstA->value_size);
+	}
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "PUT CASE0:STORE_REG ERROR!\n");
+		goto exit_put_value;
+	}
+	/* eip changing */
+	/* Make the constant 0x24 configurable
+	 * depending on CPU type.
+	 */
+	debug_print(DEBUG_EXE, 1, "STORE_REG: index=0x%"PRIx64", start_address=0x%"PRIx64"\n",
+		dstA->index, value->start_address);
+	if (value->start_address != dstA->index) {
+		debug_print(DEBUG_EXE, 1, "STORE failure\n");
+		goto exit_put_value;
+	}
+	if (value->start_address == 0x24) {
+		debug_print(DEBUG_EXE, 1, "A JUMP or RET has occured\n");
+	}
+
+	debug_print(DEBUG_EXE, 1, "STORING: value3.start_address 0x%"PRIx64" into value->start_address 0x%"PRIx64"\n",
+		inst->value3.start_address, value->start_address);
+	if (value->start_address != inst->value3.start_address) {
+		debug_print(DEBUG_EXE, 1, "STORE failure2\n");
+		goto exit_put_value;
+	}
+	put_value_to_store(value, &(inst->value3));
+	debug_print(DEBUG_EXE, 1, "Saving to reg value_id of 0x%"PRIx64"\n", value->value_id);
+	debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		value->init_value,
+		value->offset_value,
+		value->init_value + value->offset_value);
+	result = 0;
+
+exit_put_value:
+	print_store(memory_reg);
+	print_store(process_state->memory_stack);
+	return result;
+}
+
+/* m - memory. value is the reg holding the address, or NULL for an immediate address */
+static int put_value_mem(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct inst_log_entry_s *inst,
+	uint64_t data_index)
+{
+	struct operand_s *dstA = &(inst->instruction.dstA);
+	struct memory_s *memory_data = process_state->memory_data;
 	struct memory_s *value_data;
+	int result = 1;
+
+	value_data = search_store(memory_data,
+			data_index,
+			dstA->value_size);
+	debug_print(DEBUG_EXE, 1, "EXE2 value_data=%p\n", value_data);
+	if (!value_data) {
+		value_data = store_cow_add(process_state, STORE_COW_DATA,
+			data_index,
+			dstA->value_size);
+	}
+	if (!value_data) {
+		debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG2 ERROR!\n");
+		goto exit_put_value;
+	}
+	if (value_data->start_address != data_index) {
+		debug_print(DEBUG_EXE, 1, "STORE DATA failure\n");
+		goto exit_put_value;
+	}
+	store_cow_write(process_state, STORE_COW_DATA, value_data - memory_data);
+	put_value_to_store(value_data, &(inst->value3));
+	debug_print(DEBUG_EXE, 1, "PUT: scope=%d, id=%"PRIu64"\n",
+		value_data->value_scope,
+		value_data->value_id);
+	debug_print(DEBUG_EXE, 1, "value_data=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		value_data->init_value,
+		value_data->offset_value,
+		value_data->init_value + value_data->offset_value);
+	result = 0;
+
+exit_put_value:
+	print_store(process_state->memory_reg);
+	print_store(process_state->memory_stack);
+	return result;
+}
+
+static int put_value_mem_imm(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct inst_log_entry_s *inst)
+{
+	debug_print(DEBUG_EXE, 1, "dstA-memory index=%"PRIx64", value_size=%d\n",
+			inst->instruction.dstA.index,
+			inst->instruction.dstA.value_size);
+	return put_value_mem(self, process_state, inst, inst->instruction.dstA.index);
+}
+
+static int put_value_mem_reg(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct inst_log_entry_s *inst)
+{
+	struct operand_s *dstA = &(inst->instruction.dstA);
+	struct memory_s *value;
+
+	debug_print(DEBUG_EXE, 1, "dstA-memory index=%"PRIx64", value_size=%d\n",
+			dstA->index,
+			dstA->value_size);
+	value = get_indirect_reg(process_state->memory_reg, dstA);
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
+		return 1;
+	}
+	if (value->start_address != dstA->index) {
+		debug_print(DEBUG_EXE, 1, "STORE failure\n");
+		return 1;
+	}
+	return put_value_mem(self, process_state, inst, value->init_value + value->offset_value);
+}
+
+/* s - stack */
+static int put_value_stack(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct inst_log_entry_s *inst)
+{
+	struct operand_s *dstA = &(inst->instruction.dstA);
+	struct memory_s *memory_reg = process_state->memory_reg;
+	struct memory_s *memory_stack = process_state->memory_stack;
+	struct memory_s *value;
 	struct memory_s *value_stack;
-	uint64_t data_index;
-	//struct memory_s *memory_text;
-	struct memory_s *memory_stack;
-	struct memory_s *memory_reg;
-	struct memory_s *memory_data;
-	//int *memory_used;
 	int result = 1;
 
-	//memory_text = process_state->memory_text;
-	memory_stack = process_state->memory_stack;
-	memory_reg = process_state->memory_reg;
-	memory_data = process_state->memory_data;
-	//memory_used = process_state->memory_used;
+	debug_print(DEBUG_EXE, 1, "dstA-stack saving result\n");
+	debug_print(DEBUG_EXE, 1, "index=%"PRIx64", indirect_size=%d\n",
+			dstA->index,
+			dstA->indirect_size);
+	value = search_store(memory_reg,
+			dstA->index,
+			dstA->indirect_size);
+	/* FIXME what to do in NULL */
+	if (!value) {
+		value = add_new_store(memory_reg,
+				dstA->index,
+				dstA->indirect_size);
+	}
+	if (!value) {
+		debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG ERROR!\n");
+		goto exit_put_value;
+	}
+	debug_print(DEBUG_EXE, 1, "dstA reg 0x%"PRIx64" value = 0x%"PRIx64" + 0x%"PRIx64"\n", dstA->index, value->init_value, value->offset_value);
+	if (value->start_address != dstA->index) {
+		debug_print(DEBUG_EXE, 1, "STORE failure\n");
+		goto exit_put_value;
+	}
+	value_stack = search_store(memory_stack,
+			value->init_value +
+				value->offset_value,
+				dstA->value_size);
+	debug_print(DEBUG_EXE, 1, "EXE2 value_stack=%p\n", value_stack);
+	if (!value_stack) {
+		value_stack = store_cow_add(process_state, STORE_COW_STACK,
+			value->init_value +
+				value->offset_value,
+				dstA->value_size);
+	}
+	if (!value_stack) {
+		debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG2 ERROR!\n");
+		goto exit_put_value;
+	}
+	store_cow_write(process_state, STORE_COW_STACK, value_stack - memory_stack);
+	put_value_to_store(value_stack, &(inst->value3));
+	debug_print(DEBUG_EXE, 1, "PUT: scope=%d, id=%"PRIu64"\n",
+		value_stack->value_scope,
+		value_stack->value_id);
+	debug_print(DEBUG_EXE, 1, "value_stack=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
+		value_stack->init_value,
+		value_stack->offset_value,
+		value_stack->init_value + value_stack->offset_value);
+	result = 0;
 
-	/* Put result in dstA */
-	instruction = &inst->instruction;
-	switch (instruction->dstA.indirect) {
+exit_put_value:
+	print_store(memory_reg);
+	print_store(memory_stack);
+	return result;
+}
+
+static get_value_fn_t get_value_handler(struct operand_s *operand)
+{
+	switch (operand->indirect) {
 	case IND_DIRECT:
-		/* Not indirect */
-		debug_print(DEBUG_EXE, 1, "dstA-direct\n");
-		switch (instruction->dstA.store) {
+		switch (operand->store) {
 		case STORE_DIRECT:
-			/* i - immediate */
-			debug_print(DEBUG_EXE, 1, "dstA-immediate-THIS SHOULD NEVER HAPPEN!\n");
-			result = 1;
-			goto exit_put_value;
-			break;
+			return get_value_direct_imm;
 		case STORE_REG:
-			/* r - register */
-			debug_print(DEBUG_EXE, 1, "dstA-register saving result\n");
-			value = search_store(memory_reg,
-					instruction->dstA.index,
-					instruction->dstA.value_size);
-			debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
-			if (value) {
-				debug_print(DEBUG_EXE, 1, "init_value = 0x%"PRIx64", offset_value = 0x%"PRIx64", start_address = 0x%"PRIx64", length = 0x%x\n",
-					value->init_value, value->offset_value,
-					value->start_address, value->length);
-			}
-			/* FIXME what to do in NULL */
-			if (!value) {
-				debug_print(DEBUG_EXE, 1, "WHY!!!!!\n");
-				value = add_new_store(memory_reg,
-						instruction->dstA.index,
-						instruction->dstA.value_size);
-			}
-			if (!value) {
-				debug_print(DEBUG_EXE, 1, "PUT CASE0:STORE_REG ERROR!\n");
-				result = 1;
-				goto exit_put_value;
-				break;
-			}
-			/* eip changing */
-			/* Make the constant 0x24 configurable
-			 * depending on CPU type.
-			 */
-			debug_print(DEBUG_EXE, 1, "STORE_REG: index=0x%"PRIx64", start_address=0x%"PRIx64"\n",
-				instruction->dstA.index, value->start_address);
-			if (value->start_address != instruction->dstA.index) {
-				debug_print(DEBUG_EXE, 1, "STORE failure\n");
-				result = 1;
-				goto exit_put_value;
-				break;
-			}
-			if (value->start_address == 0x24) {
-				debug_print(DEBUG_EXE, 1, "A JUMP or RET has occured\n");
-			}
-
-			/* FIXME: these should always be the same */
-			/* value->length = inst->value3.length; */
-			debug_print(DEBUG_EXE, 1, "STORING: value3.start_address 0x%"PRIx64" into value->start_address 0x%"PRIx64"\n",
-				inst->value3.start_address, value->start_address);
-			if (value->start_address != inst->value3.start_address) {
-				debug_print(DEBUG_EXE, 1, "STORE failure2\n");
-				result = 1;
-				goto exit_put_value;
-				break;
-			}
-			
-			value->start_address = inst->value3.start_address;
-			value->init_value_type = inst->value3.init_value_type;
-			value->init_value = inst->value3.init_value;
-			value->offset_value = inst->value3.offset_value;
-			value->value_type = inst->value3.value_type;
-			value->ref_memory =
-				inst->value3.ref_memory;
-			value->ref_log =
-				inst->value3.ref_log;
-			value->value_scope = inst->value3.value_scope;
-			/* 1 - Ids */
-			value->value_id = inst->value3.value_id;
-			debug_print(DEBUG_EXE, 1, "Saving to reg value_id of 0x%"PRIx64"\n", value->value_id);
-			/* 1 - Entry Used */
-			value->valid = 1;
-			debug_print(DEBUG_EXE, 1, "value=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-				value->init_value,
-				value->offset_value,
-				value->init_value + value->offset_value);
-			result = 0;
-			break;
-		default:
-			/* Should not get here */
-			debug_print(DEBUG_EXE, 1, "FAILED\n");
-			result = 1;
-			goto exit_put_value;
+			return get_value_direct_reg;
 		}
 		break;
 	case IND_MEM:
-		/* m - memory */
-		/* FIXME TODO */
-		debug_print(DEBUG_EXE, 1, "dstA-indirect-NOT\n");
-		debug_print(DEBUG_EXE, 1, "dstA-memory-NOT\n");
-		debug_print(DEBUG_EXE, 1, "index=%"PRIx64", value_size=%d\n",
-				instruction->dstA.index,
-				instruction->dstA.value_size);
-		switch (instruction->dstA.store) {
+		switch (operand->store) {
 		case STORE_DIRECT:
-			data_index = instruction->dstA.index;
-			result = 0;
-			break;
+			return get_value_mem_imm;
 		case STORE_REG:
-			value = search_store(memory_reg,
-					instruction->dstA.index,
-					instruction->dstA.indirect_size);
-			debug_print(DEBUG_EXE, 1, "EXE value=%p\n", value);
-			/* FIXME what to do in NULL */
-			if (!value) {
-				value = add_new_store(memory_reg,
-						instruction->dstA.index,
-						instruction->dstA.indirect_size);
-				value->value_id = 0;
-			}
-			if (!value) {
-				debug_print(DEBUG_EXE, 1, "GET CASE2:STORE_REG ERROR!\n");
-				result = 1;
-				goto exit_put_value;
-				break;
-			}
-			if (value->start_address != instruction->dstA.index) {
-				debug_print(DEBUG_EXE, 1, "STORE failure\n");
-				result = 1;
-				goto exit_put_value;
-				break;
-			}
-			data_index = value->init_value + value->offset_value;
-			result = 0;
-			break;
-		default:
-			/* Should not get here */
-			debug_print(DEBUG_EXE, 1, "FAILED\n");
-			result = 1;
-			goto exit_put_value;
-			break;
+			return get_value_mem_reg;
 		}
-		value_data = search_store(memory_data,
-				data_index,
-				instruction->dstA.value_size);
-		debug_print(DEBUG_EXE, 1, "EXE2 value_data=%p\n", value_data);
-		if (!value_data) {
-			value_data = add_new_store(memory_data,
-				data_index,
-				instruction->dstA.value_size);
-		}
-		if (!value_data) {
-			debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG2 ERROR!\n");
-			result = 1;
-			goto exit_put_value;
-			break;
-		}
-		if (value_data->start_address != data_index) {
-			debug_print(DEBUG_EXE, 1, "STORE DATA failure\n");
-			result = 1;
-			goto exit_put_value;
-			break;
-		}
-		/* FIXME: these should always be the same */
-		/* value_data->length = inst->value3.length; */
-		value_data->init_value_type = inst->value3.init_value_type;
-		value_data->init_value = inst->value3.init_value;
-		value_data->offset_value = inst->value3.offset_value;
-		value_data->value_type = inst->value3.value_type;
-		value_data->ref_memory =
-			inst->value3.ref_memory;
-		value_data->ref_log =
-			inst->value3.ref_log;
-		value_data->value_scope = inst->value3.value_scope;
-		/* 1 - Ids */
-		value_data->value_id = inst->value3.value_id;
-		debug_print(DEBUG_EXE, 1, "PUT: scope=%d, id=%"PRIu64"\n",
-			value_data->value_scope,
-			value_data->value_id);
-		/* 1 - Entry Used */
-		value_data->valid = 1;
-		debug_print(DEBUG_EXE, 1, "value_data=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-			value_data->init_value,
-			value_data->offset_value,
-			value_data->init_value + value_data->offset_value);
-		result = 0;
 		break;
 	case IND_STACK:
-		/* s - stack */
-		debug_print(DEBUG_EXE, 1, "dstA-indirect\n");
-		debug_print(DEBUG_EXE, 1, "dstA-stack saving result\n");
-		debug_print(DEBUG_EXE, 1, "index=%"PRIx64", indirect_size=%d\n",
-				instruction->dstA.index,
-				instruction->dstA.indirect_size);
-		value = search_store(memory_reg,
-				instruction->dstA.index,
-				instruction->dstA.indirect_size);
-		debug_print(DEBUG_EXE, 1, "dstA reg 0x%"PRIx64" value = 0x%"PRIx64" + 0x%"PRIx64"\n", instruction->dstA.index, value->init_value, value->offset_value);
-		/* FIXME what to do in NULL */
-		if (!value) {
-			value = add_new_store(memory_reg,
-					instruction->dstA.index,
-					instruction->dstA.indirect_size);
-		}
-		if (!value) {
-			debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG ERROR!\n");
-			result = 1;
-			goto exit_put_value;
-			break;
-		}
-		if (value->start_address != instruction->dstA.index) {
-			debug_print(DEBUG_EXE, 1, "STORE failure\n");
-			result = 1;
-			goto exit_put_value;
-			break;
-		}
-		value_stack = search_store(memory_stack,
-				value->init_value +
-					value->offset_value,
-					instruction->dstA.value_size);
-		debug_print(DEBUG_EXE, 1, "EXE2 value_stack=%p\n", value_stack);
-		if (!value_stack) {
-			value_stack = add_new_store(memory_stack,
-				value->init_value +
-					value->offset_value,
-					instruction->dstA.value_size);
+		/* The stack address is always in a reg */
+		return get_value_stack;
+	}
+	return get_value_invalid;
+}
+
+static put_value_fn_t put_value_handler(struct operand_s *operand)
+{
+	switch (operand->indirect) {
+	case IND_DIRECT:
+		if (STORE_REG == operand->store) {
+			return put_value_direct_reg;
 		}
-		if (!value_stack) {
-			debug_print(DEBUG_EXE, 1, "PUT CASE2:STORE_REG2 ERROR!\n");
-			result = 1;
-			goto exit_put_value;
-			break;
+		break;
+	case IND_MEM:
+		switch (operand->store) {
+		case STORE_DIRECT:
+			return put_value_mem_imm;
+		case STORE_REG:
+			return put_value_mem_reg;
 		}
-		/* FIXME: these should always be the same */
-		/* value_stack->length = inst->value3.length; */
-		value_stack->init_value_type = inst->value3.init_value_type;
-		value_stack->init_value = inst->value3.init_value;
-		value_stack->offset_value = inst->value3.offset_value;
-		value_stack->value_type = inst->value3.value_type;
-		value_stack->ref_memory =
-			inst->value3.ref_memory;
-		value_stack->ref_log =
-			inst->value3.ref_log;
-		value_stack->value_scope = inst->value3.value_scope;
-		/* 1 - Ids */
-		value_stack->value_id = inst->value3.value_id;
-		debug_print(DEBUG_EXE, 1, "PUT: scope=%d, id=%"PRIu64"\n",
-			value_stack->value_scope,
-			value_stack->value_id);
-		/* 1 - Entry Used */
-		value_stack->valid = 1;
-		debug_print(DEBUG_EXE, 1, "value_stack=0x%"PRIx64"+0x%"PRIx64"=0x%"PRIx64"\n",
-			value_stack->init_value,
-			value_stack->offset_value,
-			value_stack->init_value + value_stack->offset_value);
-		result = 0;
 		break;
-	default:
-		/* Should not get here */
-		debug_print(DEBUG_EXE, 1, "FAILED\n");
-		result = 1;
-		goto exit_put_value;
+	case IND_STACK:
+		return put_value_stack;
 	}
-
-exit_put_value:
-	print_store(memory_reg);
-	print_store(memory_stack);
-	return result;
+	return put_value_invalid;
 }
 
+/* Pick the operand access handlers for the instruction. Call again if the operands change. */
+int resolve_operand_handlers(struct inst_log_entry_s *inst)
+{
+	inst->get_srcA = get_value_handler(&(inst->instruction.srcA));
+	inst->get_srcB = get_value_handler(&(inst->instruction.srcB));
+	inst->get_dstA = get_value_handler(&(inst->instruction.dstA));
+	inst->put_dstA = put_value_handler(&(inst->instruction.dstA));
+	return 0;
+}
 
+/* For operands that are not part of a logged instruction */
+static int get_value_RTL_instruction(
+	struct self_s *self,
+	struct process_state_s *process_state,
+	struct operand_s *source,
+	struct memory_s *destination,
+	int info_id )
+{
+	get_value_fn_t get_value = get_value_handler(source);
 
-
-
-
+	return get_value(self, process_state, source, destination, info_id);
+}
 
 int execute_instruction(struct self_s *self, struct process_state_s *process_state, struct inst_log_entry_s *inst)
 {
@@ -813,15 +1130,18 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 	int ret = 0;
 
 	instruction = &inst->instruction;
+	if (!inst->put_dstA) {
+		resolve_operand_handlers(inst);
+	}
 
 	print_inst_short(self, instruction);
 
 	switch (instruction->opcode) {
 	case NOP:
 		/* Get value of srcA */
-		//ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		//ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of dstA */
-		//ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
+		//ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "NOP\n");
 		//put_value_RTL_instruction(self, process_state, inst);
@@ -829,9 +1149,9 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 	case CMP:
 		/* Currently, do the same as NOP */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "CMP\n");
 		//debug_print(DEBUG_EXE, 1, "value1 = 0x%x, value2 = 0x%x\n", inst->value1, inst->value2);
@@ -849,7 +1169,7 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		break;
 	case MOV:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "MOV\n");
 		debug_print(DEBUG_EXE, 1, "MOV dest length = %d %d\n", inst->value1.length, inst->value3.length);
@@ -900,11 +1220,11 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case LOAD:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "LOAD\n");
 		debug_print(DEBUG_EXE, 1, "LOAD dest length = %d %d\n", inst->value1.length, inst->value3.length);
@@ -948,14 +1268,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case STORE:
 		/* STORE is a special case where the indirect REG of IMM in the dstA is a direct REG or IMM in srcB */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "STORE\n");
 		debug_print(DEBUG_EXE, 1, "STORE dest length = %d %d\n", inst->value1.length, inst->value3.length);
@@ -1010,12 +1330,12 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SEX:
 		debug_print(DEBUG_EXE, 1, "SEX dest length = %d %d\n", inst->value1.length, inst->value3.length);
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SEX\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1097,13 +1417,13 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case ADD:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "ADD\n");
 		debug_print(DEBUG_EXE, 1, "ADD dest length = %d %d %d\n", inst->value1.length, inst->value2.length, inst->value3.length);
@@ -1137,23 +1457,23 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case ADC:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "ADC\n");
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case MUL:  /* Unsigned mul */
 	case IMUL: /* FIXME: Handled signed case */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of dstA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "MUL\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1188,13 +1508,13 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SUB:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SUB\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1227,14 +1547,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SBB:
 		/* FIXME: Add support for the Carry bit */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SUB\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1267,13 +1587,13 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case TEST:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "TEST \n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1312,9 +1632,9 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		break;
 	case rAND:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "AND \n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1348,13 +1668,13 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case OR:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "OR \n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1388,7 +1708,7 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case XOR:
 		/* If XOR against itself, this is a special case of making a dst value out of a src value,
@@ -1400,9 +1720,9 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		 */
 		tmp = source_equals_dest(&(instruction->srcA), &(instruction->srcB));
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), tmp); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), tmp); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "XOR\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1436,12 +1756,12 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case NEG:
 		/* Get value of srcA */
 		/* Could be replaced with a SUB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "NOT\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1474,11 +1794,11 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case NOT:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "NOT\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1511,14 +1831,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SHL:
 		/* This is an UNSIGNED operation */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SHL\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1552,14 +1872,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SHR:
 		/* This is an UNSIGNED operation */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SHR\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1593,14 +1913,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SAL:
 		/* This is an UNSIGNED operation */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SAL\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1635,14 +1955,14 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case SAR:
 		/* This is an UNSIGNED operation */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
+		ret = inst->get_srcB(self, process_state, &(instruction->srcB), &(inst->value2), 0); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "SAR\n");
 		inst->value3.start_address = instruction->dstA.index;
@@ -1677,13 +1997,13 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case IF:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->dstA), &(inst->value2), 1); 
+		ret = inst->get_dstA(self, process_state, &(instruction->dstA), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "IF\n");
 		/* Create absolute JMP value in value3 */
@@ -1710,9 +2030,9 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		break;
 	case JMPT:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of srcB */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->dstA), &(inst->value2), 1); 
+		ret = inst->get_dstA(self, process_state, &(instruction->dstA), &(inst->value2), 1); 
 		/* Create result */
 		debug_print(DEBUG_EXE, 1, "JMPT\n");
 		debug_print(DEBUG_EXE, 1, "JMPT dest length = %d %d %d\n", inst->value1.length, inst->value2.length, inst->value3.length);
@@ -1760,11 +2080,11 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 				inst->value3.offset_value,
 				inst->value3.init_value +
 					inst->value3.offset_value);
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		break;
 	case JMP:
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0); 
 		/* Get value of dstA */
 		//ret = get_value_RTL_instruction(self,  &(instruction->dstA), &(inst->value2), 1); 
 		/* Create result */
@@ -1807,7 +2127,7 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		 * value2 = ESP
 		 */
 		/* Get value of srcA */
-		ret = get_value_RTL_instruction(self, process_state, &(instruction->srcA), &(inst->value1), 0);
+		ret = inst->get_srcA(self, process_state, &(instruction->srcA), &(inst->value1), 0);
 		value = search_store(memory_reg,
 				REG_IP,
 				4);
@@ -1837,7 +2157,7 @@ int execute_instruction(struct self_s *self, struct process_state_s *process_sta
 		/* 1 - Entry Used */
 		inst->value1.valid = 1;
 		inst->value3.valid = 1;
-		put_value_RTL_instruction(self, process_state, inst);
+		inst->put_dstA(self, process_state, inst);
 		/* Once value3 is written, over write value1 with ESP */
 		/* Get the current ESP value so one can convert function params to locals */
 		operand.indirect = IND_DIRECT;
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Record of which .text offsets have been executed, and for each
+ * instruction start, the inst_log entry it was logged as.
+ * This used to be a fixed int[MEMORY_USED_SIZE] per function, which
+ * overflowed for any .text larger than that.
+ * memory_used_get() returns the same values the old array held:
+ *   0 = not used yet.
+ *   > 0 = an instruction starts here. The value is its inst_log.
+ *   -n = the byte n bytes into an instruction.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rev.h>
+
+struct memory_used_s *memory_used_init(uint64_t size)
+{
+	struct memory_used_s *memory_used;
+
+	memory_used = calloc(1, sizeof(struct memory_used_s));
+	if (!memory_used) {
+		debug_print(DEBUG_EXE, 1, "memory_used_init: calloc failed\n");
+		exit(1);
+	}
+	memory_used->size = size;
+	memory_used->pages_size = (size + MEMORY_USED_PAGE_MASK) >> MEMORY_USED_PAGE_BITS;
+	if (memory_used->pages_size) {
+		memory_used->pages = calloc(memory_used->pages_size, sizeof(struct memory_used_page_s *));
+		if (!memory_used->pages) {
+			debug_print(DEBUG_EXE, 1, "memory_used_init: calloc failed\n");
+			exit(1);
+		}
+	}
+	return memory_used;
+}
+
+void memory_used_free(struct memory_used_s *memory_used)
+{
+	uint64_t n;
+
+	if (!memory_used) {
+		return;
+	}
+	for (n = 0; n < memory_used->pages_size; n++) {
+		free(memory_used->pages[n]);
+	}
+	free(memory_used->pages);
+	free(memory_used);
+}
+
+int memory_used_get(struct memory_used_s *memory_used, uint64_t offset)
+{
+	struct memory_used_page_s *page;
+
+	if (offset >= memory_used->size) {
+		return 0;
+	}
+	page = memory_used->pages[offset >> MEMORY_USED_PAGE_BITS];
+	if (!page) {
+		return 0;
+	}
+	return page->value[offset & MEMORY_USED_PAGE_MASK];
+}
+
+static struct memory_used_page_s *memory_used_page(struct memory_used_s *memory_used, uint64_t offset)
+{
+	uint64_t index = offset >> MEMORY_USED_PAGE_BITS;
+
+	if (!memory_used->pages[index]) {
+		memory_used->pages[index] = calloc(1, sizeof(struct memory_used_page_s));
+		if (!memory_used->pages[index]) {
+			debug_print(DEBUG_EXE, 1, "memory_used_page: calloc failed\n");
+			exit(1);
+		}
+	}
+	return memory_used->pages[index];
+}
+
+/* Mark the bytes_used bytes at offset as one instruction, logged as inst_log */
+int memory_used_set(struct memory_used_s *memory_used, uint64_t offset,
+	int bytes_used, int inst_log)
+{
+	struct memory_used_page_s *page;
+	uint64_t tmp;
+	int n;
+
+	if (offset >= memory_used->size) {
+		debug_print(DEBUG_EXE, 1, "memory_used_set: offset 0x%"PRIx64" outside .text\n", offset);
+		return 1;
+	}
+	for (n = 1; n < bytes_used; n++) {
+		tmp = offset + n;
+		if (tmp >= memory_used->size) {
+			break;
+		}
+		page = memory_used_page(memory_used, tmp);
+		page->value[tmp & MEMORY_USED_PAGE_MASK] = -n;
+	}
+	page = memory_used_page(memory_used, offset);
+	page->value[offset & MEMORY_USED_PAGE_MASK] = inst_log;
+	return 0;
+}
@@ -48,32 +48,153 @@
 #include <rev.h>
 #include <assert.h>
 
-/* This function starts and the JMPT instruction and then searches back for the instruction referencing the jump table base */
-int search_for_jump_table_base(struct self_s *self, uint64_t inst_log, uint64_t *inst_base) {
+/* How far search_for_jump_table() looks back from the JMPT */
+#define JMPT_SLICE_LIMIT 32
+/* Largest jump table read when the bound is not found */
+#define JMPT_TABLE_MAX 4096
+
+struct jump_table_s {
+	uint64_t inst_base;	/* The inst adding the table base */
+	uint64_t base;		/* Offset of the table in rodata */
+	int index_reg;		/* Reg holding the table index. 0 if not found */
+	int bound;		/* Number of entries. 0 if not found */
+};
+
+static int operand_is_reg(struct operand_s *operand, uint64_t reg)
+{
+	return (STORE_REG == operand->store) &&
+		(IND_DIRECT == operand->indirect) &&
+		(reg == operand->index);
+}
+
+static int operand_is_rodata(struct operand_s *operand)
+{
+	return (operand->relocated) &&
+		(2 == operand->relocated_area);
+}
+
+/* This function starts at the JMPT instruction and searches back along prev[0]
+ * for the instructions computing the jump address.
+ * It follows the address reg through copies and the index scaling
+ * to find the ADD of the table base, the index reg and a CMP bounding the index.
+ */
+int search_for_jump_table(struct self_s *self, uint64_t inst_log, struct jump_table_s *jump_table)
+{
 	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct instruction_s *instruction = NULL;
+	struct instruction_s *instruction = &inst_log_entry[inst_log].instruction;
 	uint64_t inst_this = inst_log;
+	uint64_t reg;
+	int n;
 
-	/* Quick fix for now. Do proper register tracking */
-	inst_this--;
-	instruction = &inst_log_entry[inst_this].instruction;
-	if (ADD == instruction->opcode) {
-		*inst_base = inst_this;
-		return 0;
+	memset(jump_table, 0, sizeof(struct jump_table_s));
+	if (STORE_REG != instruction->srcA.store) {
+		return 1;
+	}
+	/* The reg holding the jump address */
+	reg = instruction->srcA.index;
+	for (n = 0; n < JMPT_SLICE_LIMIT; n++) {
+		if ((inst_log_entry[inst_this].prev_size == 0) ||
+			(inst_log_entry[inst_this].prev[0] == 0)) {
+			break;
+		}
+		inst_this = inst_log_entry[inst_this].prev[0];
+		instruction = &inst_log_entry[inst_this].instruction;
+		if (!operand_is_reg(&(instruction->dstA), reg)) {
+			/* e.g. cmp $0x5,%eax; ja default */
+			if (jump_table->index_reg && (CMP == instruction->opcode)) {
+				if (operand_is_reg(&(instruction->srcA), reg) &&
+					(STORE_DIRECT == instruction->srcB.store)) {
+					jump_table->bound = instruction->srcB.index + 1;
+					break;
+				}
+				if (operand_is_reg(&(instruction->srcB), reg) &&
+					(STORE_DIRECT == instruction->srcA.store)) {
+					jump_table->bound = instruction->srcA.index + 1;
+					break;
+				}
+			}
+			continue;
+		}
+		/* This instruction sets the reg being followed */
+		debug_print(DEBUG_EXE, 1, "JMPT slice: inst 0x%"PRIx64" opcode 0x%x sets reg 0x%"PRIx64"\n",
+			inst_this, instruction->opcode, reg);
+		switch (instruction->opcode) {
+		case ADD:
+			if (jump_table->inst_base) {
+				/* A second base. Not a simple table */
+				goto exit_search;
+			}
+			if (operand_is_rodata(&(instruction->srcB)) &&
+				(STORE_REG == instruction->srcA.store)) {
+				jump_table->base = instruction->srcB.relocated_index;
+				reg = instruction->srcA.index;
+			} else if (operand_is_rodata(&(instruction->srcA)) &&
+				(STORE_REG == instruction->srcB.store)) {
+				jump_table->base = instruction->srcA.relocated_index;
+				reg = instruction->srcB.index;
+			} else {
+				goto exit_search;
+			}
+			jump_table->inst_base = inst_this;
+			jump_table->index_reg = reg;
+			break;
+		case MOV:
+		case SEX:
+			if ((STORE_REG != instruction->srcA.store) ||
+				(IND_DIRECT != instruction->srcA.indirect)) {
+				goto exit_search;
+			}
+			reg = instruction->srcA.index;
+			if (jump_table->inst_base) {
+				jump_table->index_reg = reg;
+			}
+			break;
+		case MUL:
+		case IMUL:
+		case SHL:
+			/* The index scaling. The reg is the other operand, if there is one */
+			if ((STORE_DIRECT == instruction->srcB.store) &&
+				(STORE_REG == instruction->srcA.store)) {
+				reg = instruction->srcA.index;
+			} else if ((STORE_DIRECT == instruction->srcA.store) &&
+				(STORE_REG == instruction->srcB.store)) {
+				reg = instruction->srcB.index;
+			}
+			if (jump_table->inst_base) {
+				jump_table->index_reg = reg;
+			}
+			break;
+		default:
+			goto exit_search;
+		}
+	}
+exit_search:
+	debug_print(DEBUG_EXE, 1, "JMPT slice: inst_base = 0x%"PRIx64", base = 0x%"PRIx64", index_reg = 0x%x, bound = 0x%x\n",
+		jump_table->inst_base,
+		jump_table->base,
+		jump_table->index_reg,
+		jump_table->bound);
+	if (!jump_table->inst_base) {
+		return 1;
+	}
+	if (jump_table->bound > JMPT_TABLE_MAX) {
+		jump_table->bound = JMPT_TABLE_MAX;
 	}
-	inst_this--;
-	instruction = &inst_log_entry[inst_this].instruction;
-	if (ADD == instruction->opcode) {
-		*inst_base = inst_this;
-		return 0;
+	return 0;
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+	uint64_t value_a = *(const uint64_t *)a;
+	uint64_t value_b = *(const uint64_t *)b;
+
+	if (value_a < value_b) {
+		return -1;
 	}
-	inst_this--;
-	instruction = &inst_log_entry[inst_this].instruction;
-	if (ADD == instruction->opcode) {
-		*inst_base = inst_this;
-		return 0;
+	if (value_a > value_b) {
+		return 1;
 	}
-	return 1;
+	return 0;
 }
 
 int process_block(struct self_s *self, struct process_state_s *process_state, uint64_t inst_log_prev, uint64_t eip_offset_limit) {
@@ -93,8 +214,10 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 	struct memory_s *memory_reg;
 	//struct memory_s *memory_data;
 	struct dis_instructions_s dis_instructions;
-	int *memory_used;
+	struct memory_used_s *memory_used;
+	int inst_this;
 	struct entry_point_s *entry = self->entry_point;
+	struct process_state_snapshot_s *snapshot;
 	uint64_t list_length = self->entry_point_list_length;
 	void *handle_void = self->handle_void;
 
@@ -127,16 +250,15 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 		debug_print(DEBUG_EXE, 1, "eip=0x%"PRIx64", offset=0x%"PRIx64"\n",
 			memory_reg[2].offset_value, offset);
 		/* Memory not used yet */
-		if (0 == memory_used[offset]) {
+		inst_this = memory_used_get(memory_used, offset);
+		if (0 == inst_this) {
 			debug_print(DEBUG_EXE, 1, "Memory not used yet\n");
 			for (n = 0; n < dis_instructions.bytes_used; n++) {
-				memory_used[offset + n] = -n;
 				debug_print(DEBUG_EXE, 1, " 0x%02x\n", inst[offset + n]);
 			}
 			debug_print(DEBUG_EXE, 1, "\n");
-			memory_used[offset] = inst_log;
+			memory_used_set(memory_used, offset, dis_instructions.bytes_used, inst_log);
 		} else {
-			int inst_this = memory_used[offset];
 			if (inst_this < 0) {
 				/* FIXME: What to do in this case? */
 				/* problem caused by rep movs instruction */
@@ -226,6 +348,7 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 			inst_exe_prev = &inst_log_entry[inst_log_prev];
 			inst_exe = &inst_log_entry[inst_log];
 			memcpy(&(inst_exe->instruction), instruction, sizeof(struct instruction_s));
+			resolve_operand_handlers(inst_exe);
 			err = execute_instruction(self, process_state, inst_exe);
 			if (err) {
 				debug_print(DEBUG_EXE, 1, "execute_intruction failed err=%d\n", err);
@@ -263,6 +386,8 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 					inst_exe->value3.offset_value);
 				debug_print(DEBUG_EXE, 1, "IF: inst_log = %"PRId64"\n",
 					inst_log);
+				/* Both paths resume with the state as it is at the IF */
+				snapshot = process_state_snapshot(process_state);
 				for (m = 0; m < list_length; m++ ) {
 					if (0 == entry[m].used) {
 						entry[m].esp_init_value = memory_reg[0].init_value;
@@ -272,6 +397,8 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 						entry[m].eip_init_value = memory_reg[2].init_value;
 						entry[m].eip_offset_value = memory_reg[2].offset_value;
 						entry[m].previous_instuction = inst_log;
+						entry[m].snapshot = snapshot;
+						process_state_snapshot_get(snapshot);
 						entry[m].used = 1;
 						debug_print(DEBUG_EXE, 1, "JCD:8 used 1\n");
 						
@@ -288,61 +415,76 @@ int process_block(struct self_s *self, struct process_state_s *process_state, ui
 						entry[m].eip_init_value = inst_exe->value3.init_value;
 						entry[m].eip_offset_value = inst_exe->value3.offset_value;
 						entry[m].previous_instuction = inst_log;
+						entry[m].snapshot = snapshot;
+						process_state_snapshot_get(snapshot);
 						entry[m].used = 1;
 						debug_print(DEBUG_EXE, 1, "JCD:8 used 2\n");
 						break;
 					}
 				}
+				process_state_snapshot_put(snapshot);
 			}
 			if (JMPT == instruction->opcode) {
-				/* FIXME: add the jump table detection here */
-				uint64_t inst_base;
+				struct jump_table_s jump_table;
+				int *relocation_area;
+				uint64_t *relocation_index;
+				int count;
+				int max;
 				int tmp;
-				struct inst_log_entry_s *inst_exe_base;
-				struct instruction_s *instruction = NULL;
-				int relocation_area;
-				uint64_t relocation_index;
-				tmp = search_for_jump_table_base(self, inst_log, &inst_base);
+
+				tmp = search_for_jump_table(self, inst_log, &jump_table);
 				if (tmp) {
-					debug_print(DEBUG_EXE, 1, "FIXME: JMPT reached..exiting %d 0x%"PRIx64"\n", tmp, inst_base);
+					debug_print(DEBUG_EXE, 1, "FIXME: JMPT reached..exiting %d 0x%"PRIx64"\n", tmp, jump_table.inst_base);
 					exit(1);
 				}
-				inst_exe_base = &inst_log_entry[inst_base];
-				instruction = &(inst_exe_base->instruction);
-				debug_print(DEBUG_EXE, 1, "Relocated = 0x%x\n", instruction->srcB.relocated);
-				debug_print(DEBUG_EXE, 1, "Relocated_area = 0x%x\n", instruction->srcB.relocated_area);
-				debug_print(DEBUG_EXE, 1, "Relocated_index = 0x%x\n", instruction->srcB.relocated_index);
-				if (2 == instruction->srcB.relocated_area) {
-					uint64_t index = instruction->srcB.relocated_index;
-					tmp = 0;
-					
-					do {
-						tmp = bf_find_relocation_rodata(handle_void, index, &relocation_area, &relocation_index);
-						if (!tmp) {
-							if (1 != relocation_area) {
-								debug_print(DEBUG_EXE, 1, "JMPT Relocation area not to code\n");
-								exit(1);
-							}
-							for (m = 0; m < list_length; m++ ) {
-								if (0 == entry[m].used) {
-									entry[m].esp_init_value = memory_reg[0].init_value;
-									entry[m].esp_offset_value = memory_reg[0].offset_value;
-									entry[m].ebp_init_value = memory_reg[1].init_value;
-									entry[m].ebp_offset_value = memory_reg[1].offset_value;
-									entry[m].eip_init_value = 0;
-									entry[m].eip_offset_value = relocation_index;
-									entry[m].previous_instuction = inst_log;
-									entry[m].used = 1;
-									debug_print(DEBUG_EXE, 1, "JMPT new entry \n");
-									break;
-								}
-							}
-						} else {
-							debug_print(DEBUG_EXE, 1, "JMPT index, 0x%"PRIx64", not found in rodata relocation table\n", index);
+				max = jump_table.bound ? jump_table.bound : JMPT_TABLE_MAX;
+				relocation_area = calloc(max, sizeof(int));
+				relocation_index = calloc(max, sizeof(uint64_t));
+				count = bf_read_relocation_rodata_table(handle_void, jump_table.base, 8, max,
+					relocation_area, relocation_index);
+				if (!count) {
+					debug_print(DEBUG_EXE, 1, "JMPT index, 0x%"PRIx64", not found in rodata relocation table\n", jump_table.base);
+				}
+				for (l = 0; l < count; l++) {
+					if (1 != relocation_area[l]) {
+						debug_print(DEBUG_EXE, 1, "JMPT Relocation area not to code\n");
+						exit(1);
+					}
+				}
+				/* Many cases often share a target. Only queue each one once */
+				qsort(relocation_index, count, sizeof(uint64_t), compare_uint64);
+				/* All the jump table targets share the one snapshot */
+				snapshot = process_state_snapshot(process_state);
+				m = 0;
+				for (l = 0; l < count; l++) {
+					if ((l > 0) && (relocation_index[l] == relocation_index[l - 1])) {
+						continue;
+					}
+					/* Carry on from the last free entry found */
+					for (; m < list_length; m++ ) {
+						if (0 == entry[m].used) {
+							entry[m].esp_init_value = memory_reg[0].init_value;
+							entry[m].esp_offset_value = memory_reg[0].offset_value;
+							entry[m].ebp_init_value = memory_reg[1].init_value;
+							entry[m].ebp_offset_value = memory_reg[1].offset_value;
+							entry[m].eip_init_value = 0;
+							entry[m].eip_offset_value = relocation_index[l];
+							entry[m].previous_instuction = inst_log;
+							entry[m].snapshot = snapshot;
+							process_state_snapshot_get(snapshot);
+							entry[m].used = 1;
+							debug_print(DEBUG_EXE, 1, "JMPT new entry \n");
+							break;
 						}
-						index += 8;
-					} while (!tmp);
+					}
+					if (m >= list_length) {
+						debug_print(DEBUG_EXE, 1, "JMPT entry_point list full\n");
+						break;
+					}
 				}
+				process_state_snapshot_put(snapshot);
+				free(relocation_area);
+				free(relocation_index);
 			}
 			inst_log_prev = inst_log;
 			inst_log++;
@@ -24,6 +24,7 @@ struct rev_eng {
 	uint64_t	reloc_table_data_sz;
 	struct reloc_table_s	*reloc_table_rodata;   /* relocation table */
 	uint64_t	reloc_table_rodata_sz;
+	int		*reloc_table_rodata_index;   /* reloc_table_rodata entries sorted by address */
 	int		*section_number_mapping;    /* Mapping bfd sections onto libbeauty sections */
 	disassembler_ftype disassemble_fn;
 	struct disassemble_info disasm_info;
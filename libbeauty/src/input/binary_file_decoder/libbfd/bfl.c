@@ -241,24 +241,75 @@ uint32_t bf_relocated_code(void *handle_void, uint8_t *base_address, uint64_t of
 	return 1;
 }
 
+/* Index of the first sorted rodata relocation with address >= index */
+static uint64_t bf_search_relocation_rodata(struct rev_eng *handle, uint64_t index)
+{
+	uint64_t low = 0;
+	uint64_t high = handle->reloc_table_rodata_sz;
+	uint64_t mid;
+
+	while (low < high) {
+		mid = low + ((high - low) >> 1);
+		if (handle->reloc_table_rodata[handle->reloc_table_rodata_index[mid]].address < index) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
 int bf_find_relocation_rodata(void *handle_void, uint64_t index, int *relocation_area, uint64_t *relocation_index)
 {
-	int n;
+	uint64_t n;
 	int found = 1;
 	struct rev_eng *handle = (struct rev_eng*) handle_void;
 	struct reloc_table_s *reloc_table_entry;
 	debug_print(DEBUG_EXE, 1, "JMPT rodata_sz = 0x%"PRIx64"\n", handle->reloc_table_rodata_sz);
-	for (n = 0; n < handle->reloc_table_rodata_sz; n++) {
-		if (handle->reloc_table_rodata[n].address == index) {
-			reloc_table_entry = &(handle->reloc_table_rodata[n]);
-			print_reloc_table_entry(reloc_table_entry);
-			found = 0;
-			*relocation_area = reloc_table_entry->relocated_area;
-			*relocation_index = reloc_table_entry->symbol_value;
+	n = bf_search_relocation_rodata(handle, index);
+	if ((n < handle->reloc_table_rodata_sz) &&
+		(handle->reloc_table_rodata[handle->reloc_table_rodata_index[n]].address == index)) {
+		reloc_table_entry = &(handle->reloc_table_rodata[handle->reloc_table_rodata_index[n]]);
+		print_reloc_table_entry(reloc_table_entry);
+		found = 0;
+		*relocation_area = reloc_table_entry->relocated_area;
+		*relocation_index = reloc_table_entry->symbol_value;
+	}
+	return found;
+}
+
+/* Read a table of relocations from rodata, such as a jump table.
+ * The entries start at index and are stride bytes apart.
+ * Stops at the first entry without a relocation, or after max entries.
+ * Returns the number of entries read.
+ */
+int bf_read_relocation_rodata_table(void *handle_void, uint64_t index, uint64_t stride, int max,
+	int *relocation_area, uint64_t *relocation_index)
+{
+	uint64_t n;
+	int count = 0;
+	struct rev_eng *handle = (struct rev_eng*) handle_void;
+	struct reloc_table_s *reloc_table_entry;
+
+	n = bf_search_relocation_rodata(handle, index);
+	while ((count < max) && (n < handle->reloc_table_rodata_sz)) {
+		reloc_table_entry = &(handle->reloc_table_rodata[handle->reloc_table_rodata_index[n]]);
+		if (reloc_table_entry->address < index) {
+			/* Duplicate address */
+			n++;
+			continue;
+		}
+		if (reloc_table_entry->address != index) {
 			break;
 		}
+		relocation_area[count] = reloc_table_entry->relocated_area;
+		relocation_index[count] = reloc_table_entry->symbol_value;
+		count++;
+		index += stride;
+		n++;
 	}
-	return found;
+	debug_print(DEBUG_EXE, 1, "JMPT table read 0x%x entries\n", count);
+	return count;
 }
 
 int bf_link_reloc_table_code_to_external_entry_point(void *handle_void, struct external_entry_point_s *external_entry_points)
@@ -545,6 +596,27 @@ struct reloc_table_s * bf_get_reloc_table_rodata(void *handle_void)
 	return ret->reloc_table_rodata;
 }
 
+/* The address is copied next to the index, so the comparator needs nothing else */
+struct reloc_sort_s {
+	uint64_t address;
+	int index;
+};
+
+static int bf_compare_reloc_address(const void *a, const void *b)
+{
+	const struct reloc_sort_s *sort_a = a;
+	const struct reloc_sort_s *sort_b = b;
+
+	if (sort_a->address < sort_b->address) {
+		return -1;
+	}
+	if (sort_a->address > sort_b->address) {
+		return 1;
+	}
+	/* Keep the table order for the same address */
+	return sort_a->index - sort_b->index;
+}
+
 int bf_get_reloc_table_rodata_section(void *handle_void)
 {
 	struct rev_eng *ret = (struct rev_eng*) handle_void;
@@ -554,6 +626,7 @@ int bf_get_reloc_table_rodata_section(void *handle_void)
 	arelent		**relpp;
 	arelent		*rel;
 	uint64_t relcount;
+	struct reloc_sort_s *sort;
 	int n;
 	int tmp;
 	const char *sym_name;
@@ -611,6 +684,22 @@ int bf_get_reloc_table_rodata_section(void *handle_void)
 
 	}
 	free(relpp);
+	/* Sorted index, so the jump table lookups are a binary search */
+	ret->reloc_table_rodata_index = calloc(relcount + 1, sizeof(int));
+	sort = calloc(relcount + 1, sizeof(struct reloc_sort_s));
+	if (!ret->reloc_table_rodata_index || !sort) {
+		debug_print(DEBUG_INPUT_BFD, 1, "bf_get_reloc_table_rodata_section: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < relcount; n++) {
+		sort[n].address = ret->reloc_table_rodata[n].address;
+		sort[n].index = n;
+	}
+	qsort(sort, relcount, sizeof(struct reloc_sort_s), bf_compare_reloc_address);
+	for (n = 0; n < relcount; n++) {
+		ret->reloc_table_rodata_index[n] = sort[n].index;
+	}
+	free(sort);
 	return 1;
 }
 
@@ -925,6 +1014,8 @@ void bf_test_close_file(void *handle_void)
 		free(r->dynsymtab);
 	if ( r->dynreloc )
 		free(r->dynreloc);
+	if ( r->reloc_table_rodata_index )
+		free(r->reloc_table_rodata_index);
 	bfd_close(r->bfd);
 	free(r);
 }
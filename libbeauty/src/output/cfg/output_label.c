@@ -176,7 +176,7 @@ int label_to_string(struct label_s *label, char *string, int size) {
 	return 0;
 }
 
-int output_label_redirect(int offset, struct label_s *labels, struct label_redirect_s *label_redirect, int fd) {
+int output_label_redirect(int offset, struct label_s *labels, struct label_redirect_s *label_redirect, struct string_s *string) {
 	int tmp;
 	struct label_s *label;
 	char buffer[1024];
@@ -187,11 +187,11 @@ int output_label_redirect(int offset, struct label_s *labels, struct label_redir
 	if (tmp) {
 		return tmp;
 	}
-	tmp = dprintf(fd, "%s", buffer);
+	tmp = string_printf(string, "%s", buffer);
 	return 0;
 }
 
-int output_variable(int store, int indirect, uint64_t index, uint64_t relocated, uint64_t value_scope, uint64_t value_id, uint64_t indirect_offset_value, uint64_t indirect_value_id, int fd) {
+int output_variable(int store, int indirect, uint64_t index, uint64_t relocated, uint64_t value_scope, uint64_t value_id, uint64_t indirect_offset_value, uint64_t indirect_value_id, struct string_s *string) {
 	int tmp;
 	/* FIXME: May handle by using first switch as switch (indirect) */
 	switch (store) {
@@ -205,13 +205,13 @@ int output_variable(int store, int indirect, uint64_t index, uint64_t relocated,
 		/* relocation table entry == pointer */
 		/* this info should be gathered at disassembly point */
 		if (indirect == IND_MEM) {
-			tmp = dprintf(fd, "data%04"PRIx64,
+			tmp = string_printf(string, "data%04"PRIx64,
 				index);
 		} else if (relocated) {
-			tmp = dprintf(fd, "&data%04"PRIx64,
+			tmp = string_printf(string, "&data%04"PRIx64,
 				index);
 		} else {
-			tmp = dprintf(fd, "0x%"PRIx64,
+			tmp = string_printf(string, "0x%"PRIx64,
 				index);
 		}
 		break;
@@ -222,12 +222,12 @@ int output_variable(int store, int indirect, uint64_t index, uint64_t relocated,
 			if (IND_STACK == indirect) {
 				debug_print(DEBUG_OUTPUT, 1, "param_stack%04"PRIx64",%04"PRIx64",%04d\n",
 					index, indirect_offset_value, indirect);
-				tmp = dprintf(fd, "param_stack%04"PRIx64",%04"PRIx64",%04d",
+				tmp = string_printf(string, "param_stack%04"PRIx64",%04"PRIx64",%04d",
 					index, indirect_offset_value, indirect);
 			} else if (0 == indirect) {
 				debug_print(DEBUG_OUTPUT, 1, "param_reg%04"PRIx64,
 					index);
-				tmp = dprintf(fd, "param_reg%04"PRIx64,
+				tmp = string_printf(string, "param_reg%04"PRIx64,
 					index);
 			}
 			break;
@@ -236,12 +236,12 @@ int output_variable(int store, int indirect, uint64_t index, uint64_t relocated,
 			if (IND_STACK == indirect) {
 				debug_print(DEBUG_OUTPUT, 1, "local_stack%04"PRIx64"\n",
 					value_id);
-				tmp = dprintf(fd, "local_stack%04"PRIx64,
+				tmp = string_printf(string, "local_stack%04"PRIx64,
 					value_id);
 			} else if (0 == indirect) {
 				debug_print(DEBUG_OUTPUT, 1, "local_reg%04"PRIx64"\n",
 					value_id);
-				tmp = dprintf(fd, "local_reg%04"PRIx64,
+				tmp = string_printf(string, "local_reg%04"PRIx64,
 					value_id);
 			}
 			break;
@@ -252,12 +252,12 @@ int output_variable(int store, int indirect, uint64_t index, uint64_t relocated,
 			/* value_id to identify it. */
 			/* It will always be a local and not a param */
 			debug_print(DEBUG_OUTPUT, 1, "xxxlocal_mem%04"PRIx64";\n", (indirect_value_id));
-			tmp = dprintf(fd, "xxxlocal_mem%04"PRIx64,
+			tmp = string_printf(string, "xxxlocal_mem%04"PRIx64,
 				indirect_value_id);
 			break;
 		default:
 			debug_print(DEBUG_OUTPUT, 1, "unknown value scope: %04"PRIx64";\n", (value_scope));
-			tmp = dprintf(fd, "unknown%04"PRIx64,
+			tmp = string_printf(string, "unknown%04"PRIx64,
 				value_scope);
 			break;
 		}
@@ -270,7 +270,7 @@ int output_variable(int store, int indirect, uint64_t index, uint64_t relocated,
 }
 
 int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
-	struct label_redirect_s *label_redirect, struct label_s *labels, int fd)
+	struct label_redirect_s *label_redirect, struct label_s *labels, struct string_s *string)
 {
 	int opcode;
 	int err = 0;
@@ -322,12 +322,12 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 			break;
 		}
 		if (err) break;
-		tmp = dprintf(fd, "(");
+		tmp = string_printf(string, "(");
 
 		switch (inst_log1_flagged->instruction.srcB.indirect) {
 		case IND_MEM:
 		case IND_IO:
-			tmp = dprintf(fd, "*");
+			tmp = string_printf(string, "*");
 			/* fall through */
 		case IND_STACK:
 			value_id = inst_log1_flagged->value2.indirect_value_id;
@@ -337,21 +337,21 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 			break;
 		}
 		if (STORE_DIRECT == inst_log1_flagged->instruction.srcB.store) {
-			tmp = dprintf(fd, "0x%"PRIx64, inst_log1_flagged->instruction.srcB.index);
+			tmp = string_printf(string, "0x%"PRIx64, inst_log1_flagged->instruction.srcB.index);
 		} else {
 			char buffer[1024];
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
+			tmp = string_printf(string, "%s", buffer);
 		}
-		tmp = dprintf(fd, "%s", condition_string);
+		tmp = string_printf(string, "%s", condition_string);
 
 		switch (inst_log1_flagged->instruction.srcA.indirect) {
 		case IND_MEM:
 		case IND_IO:
-			tmp = dprintf(fd, "*");
+			tmp = string_printf(string, "*");
 			/* fall through */
 		case IND_STACK:
 			value_id = inst_log1_flagged->value1.indirect_value_id;
@@ -362,16 +362,16 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 		}
 
 		if (STORE_DIRECT == inst_log1_flagged->instruction.srcB.store) {
-			tmp = dprintf(fd, "0x%"PRIx64, inst_log1_flagged->instruction.srcB.index);
+			tmp = string_printf(string, "0x%"PRIx64, inst_log1_flagged->instruction.srcB.index);
 		} else {
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
+			tmp = string_printf(string, "%s", buffer);
 		}
 
-		tmp = dprintf(fd, ") ");
+		tmp = string_printf(string, ") ");
 		break;
 	case SUB:
 	case ADD:
@@ -391,19 +391,19 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 		if ((!err) && (IND_DIRECT == inst_log1_flagged->instruction.srcA.indirect) &&
 			(IND_DIRECT == inst_log1_flagged->instruction.dstA.indirect) &&
 			(0 == inst_log1_flagged->value3.offset_value)) {
-			tmp = dprintf(fd, "((");
+			tmp = string_printf(string, "((");
 			if (1 == inst_log1_flagged->instruction.dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1_flagged->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1_flagged->value2.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, "%s) ", condition_string);
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, "%s) ", condition_string);
 		}
 		break;
 
@@ -427,31 +427,31 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 		if ((!err) && (IND_DIRECT == inst_log1_flagged->instruction.srcA.indirect) &&
 			(IND_DIRECT == inst_log1_flagged->instruction.dstA.indirect) &&
 			(0 == inst_log1_flagged->value3.offset_value)) {
-			tmp = dprintf(fd, "((");
+			tmp = string_printf(string, "((");
 			if (1 == inst_log1_flagged->instruction.dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1_flagged->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1_flagged->value2.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, " AND ");
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, " AND ");
 			if (1 == inst_log1_flagged->instruction.srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1_flagged->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1_flagged->value1.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, ")%s) ", condition_string);
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, ")%s) ", condition_string);
 		}
 		break;
 
@@ -472,31 +472,31 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 		if ((!err) && (IND_DIRECT == inst_log1_flagged->instruction.srcA.indirect) &&
 			(IND_DIRECT == inst_log1_flagged->instruction.dstA.indirect) &&
 			(0 == inst_log1_flagged->value3.offset_value)) {
-			tmp = dprintf(fd, "((");
+			tmp = string_printf(string, "((");
 			if (1 == inst_log1_flagged->instruction.dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1_flagged->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1_flagged->value2.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, " AND ");
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, " AND ");
 			if (1 == inst_log1_flagged->instruction.srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1_flagged->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1_flagged->value1.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, ")%s) ", condition_string);
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, ")%s) ", condition_string);
 		}
 		break;
 
@@ -508,18 +508,18 @@ int if_expression( int condition, struct inst_log_entry_s *inst_log1_flagged,
 	return err;
 }
 
-uint32_t output_function_name(int fd,
+uint32_t output_function_name(struct string_s *string,
 		struct external_entry_point_s *external_entry_point)
 {
 	int tmp;
 
 	debug_print(DEBUG_OUTPUT, 1, "int %s()\n{\n", external_entry_point->name);
 	debug_print(DEBUG_OUTPUT, 1, "value = %"PRIx64"\n", external_entry_point->value);
-	tmp = dprintf(fd, "int %s(", external_entry_point->name);
+	tmp = string_printf(string, "int %s(", external_entry_point->name);
 	return 0;
 }
 
-int output_3_labels(struct self_s *self, int fd, struct inst_log_entry_s *inst_log1, int inst_number,
+int output_3_labels(struct self_s *self, struct string_s *string, struct inst_log_entry_s *inst_log1, int inst_number,
         struct label_redirect_s *label_redirect, struct label_s *labels, const char *symbol, const char *cr, char *buffer) {
 	struct instruction_s *instruction = &(inst_log1->instruction);
 	int tmp;
@@ -540,33 +540,33 @@ int output_3_labels(struct self_s *self, int fd, struct inst_log_entry_s *inst_l
 	if (print_inst(self, instruction, inst_number, labels))
 		return 1;
 	debug_print(DEBUG_OUTPUT, 1, "\t");
-	tmp = dprintf(fd, "\t");
+	tmp = string_printf(string, "\t");
 	value_id = inst_log1->value3.value_id;
 	tmp = label_redirect[value_id].redirect;
 	label = &labels[tmp];
 	tmp = label_to_string(label, buffer, 1023);
-	tmp = dprintf(fd, "%s", buffer);
-	//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-	tmp = dprintf(fd, " = ");
+	tmp = string_printf(string, "%s", buffer);
+	//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+	tmp = string_printf(string, " = ");
 	value_id = inst_log1->value1.value_id;
 	tmp = label_redirect[value_id].redirect;
 	label = &labels[tmp];
 	tmp = label_to_string(label, buffer, 1023);
-	tmp = dprintf(fd, "%s", buffer);
-	tmp = dprintf(fd, " %s ", symbol);
+	tmp = string_printf(string, "%s", buffer);
+	tmp = string_printf(string, " %s ", symbol);
 	debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 	value_id = inst_log1->value2.value_id;
 	tmp = label_redirect[value_id].redirect;
 	label = &labels[tmp];
 	tmp = label_to_string(label, buffer, 1023);
-	tmp = dprintf(fd, "%s", buffer);
-	//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-	tmp = dprintf(fd, ";%s",cr);
+	tmp = string_printf(string, "%s", buffer);
+	//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+	tmp = string_printf(string, ";%s",cr);
 	return 0;
 }
 
 int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
-			 int fd, int inst_number, struct label_redirect_s *label_redirect, struct label_s *labels, const char *cr)
+			 struct string_s *string, int inst_number, struct label_redirect_s *label_redirect, struct label_s *labels, const char *cr)
 {
 	int tmp, l, n2;
 	int tmp_state;
@@ -581,10 +581,6 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 	struct external_entry_point_s *external_entry_points = self->external_entry_points;
 	struct label_s *label;
 	char buffer[1024];
-	struct string_s string1;
-	string1.len = 0;
-	string1.max = 1023;
-	string1.string[0] = 0;
 
 	inst_log1 =  &inst_log_entry[inst_number];
 	if (!inst_log1) {
@@ -599,39 +595,38 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 	instruction =  &inst_log1->instruction;
 	//instruction_prev =  &inst_log1_prev->instruction;
 
-	write_inst(self, &string1, instruction, inst_number, labels);
-	tmp = dprintf(fd, "%s", string1.string);
-	tmp = dprintf(fd, "%s", cr);
+	write_inst(self, string, instruction, inst_number, labels);
+	tmp = string_printf(string, "%s", cr);
 #if 0
-	tmp = dprintf(fd, "// ");
+	tmp = string_printf(string, "// ");
 	if (inst_log1->prev_size > 0) {
-		tmp = dprintf(fd, "prev_size=0x%x: ",
+		tmp = string_printf(string, "prev_size=0x%x: ",
 			inst_log1->prev_size);
 		for (l = 0; l < inst_log1->prev_size; l++) {
-			tmp = dprintf(fd, "prev=0x%x, ",
+			tmp = string_printf(string, "prev=0x%x, ",
 			inst_log1->prev[l]);
 		}
 	}
 	if (inst_log1->next_size > 0) {
-		tmp = dprintf(fd, "next_size=0x%x: ",
+		tmp = string_printf(string, "next_size=0x%x: ",
 			inst_log1->next_size);
 		for (l = 0; l < inst_log1->next_size; l++) {
-			tmp = dprintf(fd, "next=0x%x, ",
+			tmp = string_printf(string, "next=0x%x, ",
 			inst_log1->next[l]);
 		}
 	}
-	tmp = dprintf(fd, "%s", cr);
+	tmp = string_printf(string, "%s", cr);
 #endif
 	/* Output labels when this is a join point */
 	/* or when the previous instruction was some sort of jump */
 	if ((inst_log1->prev_size) > 1) {
 		debug_print(DEBUG_OUTPUT, 1, "label%04"PRIx32":\n", inst_number);
-		tmp = dprintf(fd, "label%04"PRIx32":%s", inst_number, cr);
+		tmp = string_printf(string, "label%04"PRIx32":%s", inst_number, cr);
 	} else if (1 == inst_log1->prev_size){
 		if ((inst_log1->prev[0] != (inst_number - 1)) &&
 			(inst_log1->prev[0] != 0)) {
 			debug_print(DEBUG_OUTPUT, 1, "label%04"PRIx32":\n", inst_number);
-			tmp = dprintf(fd, "label%04"PRIx32":%s", inst_number, cr);
+			tmp = string_printf(string, "label%04"PRIx32":%s", inst_number, cr);
 		}
 	}
 	debug_print(DEBUG_OUTPUT, 1, "\n");
@@ -649,7 +644,7 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 		(4 == inst_log1->value3.value_type) ||
 		(6 == inst_log1->value3.value_type) ||
 		(5 == inst_log1->value3.value_type)) {
-		//tmp = dprintf(fd, "//");
+		//tmp = string_printf(string, "//");
 		switch (instruction->opcode) {
 		case LOAD:
 			if (inst_log1->value1.value_type == 6) {
@@ -663,11 +658,11 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			//debug_print(DEBUG_OUTPUT, 1, "\n");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			/* FIXME: Check limits */
 			switch (instruction->dstA.indirect) {
 			case IND_MEM:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.value_id;
 				break;
 			case IND_STACK:
@@ -678,7 +673,7 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				value_id = inst_log1->value3.indirect_value_id;
 				break;
 			case IND_IO:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.value_id;
 				break;
 			case IND_DIRECT:
@@ -692,20 +687,20 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				exit(1);
 			}
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			switch (instruction->srcA.indirect) {
 			case IND_MEM:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.value_id;
 				//debug_print(DEBUG_OUTPUT, 1, "IND_MEM: inst:0x%x, value_id = 0x%lx\n", inst_number, value_id);
 				break;
 			case IND_STACK:
-				//tmp = dprintf(fd, "stack_");
+				//tmp = string_printf(string, "stack_");
 				value_id = inst_log1->value1.indirect_value_id;
 				break;
 			case IND_IO:
@@ -722,11 +717,11 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				debug_print(DEBUG_OUTPUT, 1, "value1 label zero. Label has not been initialized\n");
 				exit(1);
 			}
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 
 		case STORE:
@@ -741,11 +736,11 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			//debug_print(DEBUG_OUTPUT, 1, "\n");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			/* FIXME: Check limits */
 			switch (instruction->dstA.indirect) {
 			case IND_MEM:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				/* value2 holds the value_id for the value3 pointer */
 				value_id = inst_log1->value2.value_id;
 				break;
@@ -757,7 +752,7 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				value_id = inst_log1->value3.indirect_value_id;
 				break;
 			case IND_IO:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.value_id;
 				break;
 			case IND_DIRECT:
@@ -771,20 +766,20 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				exit(1);
 			}
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			switch (instruction->srcA.indirect) {
 			case IND_MEM:
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.value_id;
 				//debug_print(DEBUG_OUTPUT, 1, "IND_MEM: inst:0x%x, value_id = 0x%lx\n", inst_number, value_id);
 				break;
 			case IND_STACK:
-				//tmp = dprintf(fd, "stack_");
+				//tmp = string_printf(string, "stack_");
 				value_id = inst_log1->value1.indirect_value_id;
 				break;
 			case IND_IO:
@@ -801,11 +796,11 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				debug_print(DEBUG_OUTPUT, 1, "value1 label zero. Label has not been initialized\n");
 				exit(1);
 			}
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 
 			break;
 		case MOV:
@@ -829,24 +824,24 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			value_id = inst_log1->value3.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			value_id = inst_log1->value1.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 
 			break;
 		case NEG:
@@ -869,29 +864,29 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			value_id = inst_log1->value3.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = 0 -");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = 0 -");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			value_id = inst_log1->value1.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 
 			break;
 
 		case ADD:
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "+", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "+", cr, buffer);
 			break;
 		case GEP1:
 			if (instruction->srcA.indirect) {
@@ -909,31 +904,31 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			value_id = inst_log1->value3.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			value_id = inst_log1->value1.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
+			tmp = string_printf(string, "%s", buffer);
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			value_id = inst_log1->value2.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			if (label->value > INT64_MAX) {
-				tmp = dprintf(fd, " - 0x%lx", - label->value);
+				tmp = string_printf(string, " - 0x%lx", - label->value);
 			} else {
-				tmp = dprintf(fd, " + 0x%lx", label->value);
+				tmp = string_printf(string, " + 0x%lx", label->value);
 			}
 			//tmp = label_to_string(label, buffer, 1023);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 		case MUL:
 		case IMUL:
@@ -952,24 +947,24 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			value_id = inst_log1->value3.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			value_id = inst_log1->value1.value_id;
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, " * ");
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, " * ");
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
 			if (1 == instruction->srcB.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1->value2.value_id;
@@ -977,31 +972,31 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s", cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s", cr);
 			break;
 
 		case SUB:
 		case SBB:
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "-", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "-", cr, buffer);
 			break;
 		case rAND:
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "&", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "&", cr, buffer);
 			break;
 		case OR:
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "|", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "|", cr, buffer);
 			break;
 		case XOR:
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "^", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "^", cr, buffer);
 			break;
 		case NOT:
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			if (1 == instruction->dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.indirect_value_id;
 			} else {
 				value_id = inst_log1->value3.value_id;
@@ -1009,12 +1004,12 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = !");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = !");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			if (1 == instruction->srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1->value1.value_id;
@@ -1022,36 +1017,36 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 		case SHL: //TODO: UNSIGNED
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "<<", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "<<", cr, buffer);
 			break;
 		case SHR: //TODO: UNSIGNED
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, ">>", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, ">>", cr, buffer);
 			break;
 		case SAL: //TODO: SIGNED
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, "<<", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, "<<", cr, buffer);
 			break;
 		case SAR: //TODO: SIGNED
-			output_3_labels(self, fd, inst_log1, inst_number, label_redirect, labels, ">>", cr, buffer);
+			output_3_labels(self, string, inst_log1, inst_number, label_redirect, labels, ">>", cr, buffer);
 			break;
 		case JMP:
 			debug_print(DEBUG_OUTPUT, 1, "JMP reached XXXX\n");
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 
 //			if (instruction->srcA.relocated) {
 //				debug_print(DEBUG_OUTPUT, 1, "JMP goto rel%08"PRIx64";\n", instruction->srcA.index);
-//				tmp = dprintf(fd, "JMP goto rel%08"PRIx64";\n",
+//				tmp = string_printf(string, "JMP goto rel%08"PRIx64";\n",
 //					instruction->srcA.index);
 //			} else {
 				debug_print(DEBUG_OUTPUT, 1, "JMP2 goto label%04"PRIx32";%s",
 					inst_log1->next[0], cr);
-				tmp = dprintf(fd, "JMP2 goto label%04"PRIx32";%s",
+				tmp = string_printf(string, "JMP2 goto label%04"PRIx32";%s",
 					inst_log1->next[0], cr);
 //			}
 			break;
@@ -1068,40 +1063,40 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			/* FIXME: Check limits */
 			if (1 == instruction->dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.indirect_value_id;
 			} else {
 				value_id = inst_log1->value3.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			if (1 == instruction->srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1->value1.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 		case CALL:
 			/* FIXME: This does nothing at the moment. */
 			if (print_inst(self, instruction, inst_number, labels)) {
-				tmp = dprintf(fd, "exiting1\n");
+				tmp = string_printf(string, "exiting1\n");
 				return 1;
 			}
 			/* Search for EAX */
@@ -1112,13 +1107,13 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 					external_entry_points[instruction->srcA.index].params_size);
 			}
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			tmp = label_redirect[inst_log1->value3.value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
+			tmp = string_printf(string, "%s", buffer);
 			debug_print(DEBUG_OUTPUT, 1, " = ");
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, " = ");
 			if (IND_DIRECT == instruction->srcA.indirect) {
 				/* A direct call */
 				/* FIXME: Get the output right */
@@ -1130,15 +1125,15 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 						exit(1);
 					}
 						
-					//tmp = dprintf(fd, "%s(%d:", 
+					//tmp = string_printf(string, "%s(%d:", 
 					//	external_entry_points[instruction->srcA.index].name,
 					//	external_entry_points[instruction->srcA.index].params_size);
 					if (STORE_DIRECT == instruction->srcA.store) {
-						tmp = dprintf(fd, "%s(", 
+						tmp = string_printf(string, "%s(", 
 							external_entry_points[instruction->srcA.index].name);
 					} else if (STORE_REG == instruction->srcA.store) {
 						/* FIXME: find the label for this reg */
-						tmp = dprintf(fd, "register 0x%"PRIx64"(", 
+						tmp = string_printf(string, "register 0x%"PRIx64"(", 
 							instruction->srcA.index);
 					} else {
 						debug_print(DEBUG_OUTPUT, 1, "ERROR:Unknown CALL type\n");
@@ -1154,12 +1149,12 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 						//if ((label->scope == 2) &&
 						//	(label->type == 1)) {
 						if (tmp_state > 0) {
-							dprintf(fd, ", ");
+							string_printf(string, ", ");
 						}
-						//dprintf(fd, "int%"PRId64"_t ",
+						//string_printf(string, "int%"PRId64"_t ",
 						//	label->size_bits);
 						tmp = label_to_string(label, buffer, 1023);
-						tmp = dprintf(fd, "%s", buffer);
+						tmp = string_printf(string, "%s", buffer);
 						tmp_state++;
 					//	}
 					}
@@ -1172,17 +1167,17 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 							continue;
 						}
 						if (tmp_state > 0) {
-							dprintf(fd, ", ");
+							string_printf(string, ", ");
 						}
-						dprintf(fd, "int%"PRId64"_t ",
+						string_printf(string, "int%"PRId64"_t ",
 						label->size_bits);
-						tmp = output_label(label, fd);
+						tmp = output_label(label, string);
 						tmp_state++;
 					}
 #endif
-					tmp = dprintf(fd, ");%s", cr);
+					tmp = string_printf(string, ");%s", cr);
 				} else {
-					tmp = dprintf(fd, "CALL1()%s", cr);
+					tmp = string_printf(string, "CALL1()%s", cr);
 				}
 #if 0
 				/* FIXME: JCD test disabled */
@@ -1190,26 +1185,26 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				if (call) {
 					for (l = 0; l < call->params_size; l++) {
 						if (l > 0) {
-							dprintf(fd, ", ");
+							string_printf(string, ", ");
 						}
 						label = &labels[call->params[l]];
-						tmp = output_label(label, fd);
+						tmp = output_label(label, string);
 					}
 				}
 #endif
-				//tmp = dprintf(fd, ");\n");
+				//tmp = string_printf(string, ");\n");
 				//debug_print(DEBUG_OUTPUT, 1, "%s();\n",
 				//	external_entry_points[instruction->srcA.index].name);
 			} else {
 				/* A indirect call via a function pointer or call table. */
-				tmp = dprintf(fd, "(*");
+				tmp = string_printf(string, "(*");
 				tmp = label_redirect[inst_log1->value1.indirect_value_id].redirect;
 				label = &labels[tmp];
 				tmp = label_to_string(label, buffer, 1023);
-				tmp = dprintf(fd, "%s", buffer);
-				tmp = dprintf(fd, ") ()%s", cr);
+				tmp = string_printf(string, "%s", buffer);
+				tmp = string_printf(string, ") ()%s", cr);
 			}
-//			tmp = dprintf(fd, "/* call(); */\n");
+//			tmp = string_printf(string, "/* call(); */\n");
 //			debug_print(DEBUG_OUTPUT, 1, "/* call(); */\n");
 			break;
 
@@ -1219,9 +1214,9 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "//\tcmp ");
-			tmp = dprintf(fd, "//\tcmp ");
+			tmp = string_printf(string, "//\tcmp ");
 			if (1 == instruction->srcB.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1->value2.value_id;
@@ -1229,12 +1224,12 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " - ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " - ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			if (1 == instruction->srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1->value1.value_id;
@@ -1242,36 +1237,36 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 
 		case ICMP:
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			if (1 == instruction->dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value3.indirect_value_id;
 			} else {
 				value_id = inst_log1->value3.value_id;
 			}
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
-			//tmp = dprintf(fd, "0x%x:", tmp);
+			//tmp = string_printf(string, "0x%x:", tmp);
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " = ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " = ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			debug_print(DEBUG_OUTPUT, 1, "icmp\n");
-			err = if_expression( instruction->predicate, inst_log1, label_redirect, labels, fd);
+			err = if_expression( instruction->predicate, inst_log1, label_redirect, labels, string);
 			debug_print(DEBUG_OUTPUT, 1, "prev flags=%d\n",inst_log1->instruction.flags);
 			debug_print(DEBUG_OUTPUT, 1, "prev opcode=0x%x\n",inst_log1->instruction.opcode);
 			debug_print(DEBUG_OUTPUT, 1, "0x%"PRIx64":%s\n", instruction->srcA.index, condition_table[instruction->predicate]);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 
 		case TEST:
@@ -1280,9 +1275,9 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "//\ttest ");
-			tmp = dprintf(fd, "//\ttest ");
+			tmp = string_printf(string, "//\ttest ");
 			if (1 == instruction->dstA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value2.indirect_value_id;
 			} else {
 				value_id = inst_log1->value2.value_id;
@@ -1290,12 +1285,12 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
-			tmp = dprintf(fd, " , ");
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value3.value_id);
+			tmp = string_printf(string, " , ");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
 			if (1 == instruction->srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1->value1.value_id;
@@ -1303,9 +1298,9 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s",cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s",cr);
 			break;
 
 		case IF:
@@ -1315,9 +1310,9 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			debug_print(DEBUG_OUTPUT, 1, "if1 ");
-			tmp = dprintf(fd, "if1 ");
+			tmp = string_printf(string, "if1 ");
 			found = 0;
 			tmp = 30; /* Limit the scan backwards */
 			l = inst_log1->prev[0];
@@ -1343,7 +1338,7 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				debug_print(DEBUG_OUTPUT, 1, "Previous flags instruction found. found=%d, tmp=%d, l=%d\n", found, tmp, l);
 			}
 
-			err = if_expression( instruction->srcA.index, inst_log1_flags, label_redirect, labels, fd);
+			err = if_expression( instruction->srcA.index, inst_log1_flags, label_redirect, labels, string);
 			debug_print(DEBUG_OUTPUT, 1, "\t prev flags=%d, ",inst_log1_flags->instruction.flags);
 			debug_print(DEBUG_OUTPUT, 1, "\t prev opcode=0x%x, ",inst_log1_flags->instruction.opcode);
 			debug_print(DEBUG_OUTPUT, 1, "\t 0x%"PRIx64":%s", instruction->srcA.index, condition_table[instruction->srcA.index]);
@@ -1353,13 +1348,13 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 				debug_print(DEBUG_OUTPUT, 1, "IF CONDITION unknown\n");
 				return 1;
 			}
-			tmp = dprintf(fd, "IF goto ");
+			tmp = string_printf(string, "IF goto ");
 //			for (l = 0; l < inst_log1->next_size; l++) {
-//				tmp = dprintf(fd, ", label%04"PRIx32"", inst_log1->next[l]);
+//				tmp = string_printf(string, ", label%04"PRIx32"", inst_log1->next[l]);
 //			}
-			tmp = dprintf(fd, "label%04"PRIx32";", inst_log1->next[1]);
-			tmp = dprintf(fd, "%s", cr);
-			tmp = dprintf(fd, "\telse goto label%04"PRIx32";%s", inst_log1->next[0], cr);
+			tmp = string_printf(string, "label%04"PRIx32";", inst_log1->next[1]);
+			tmp = string_printf(string, "%s", cr);
+			tmp = string_printf(string, "\telse goto label%04"PRIx32";%s", inst_log1->next[0], cr);
 
 			break;
 
@@ -1370,15 +1365,15 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			debug_print(DEBUG_OUTPUT, 1, "if (");
-			tmp = dprintf(fd, "if (");
+			tmp = string_printf(string, "if (");
 //			debug_print(DEBUG_OUTPUT, 1, "\t prev flags=%d, ",inst_log1_flags->instruction.flags);
 //			debug_print(DEBUG_OUTPUT, 1, "\t prev opcode=0x%x, ",inst_log1_flags->instruction.opcode);
 //			debug_print(DEBUG_OUTPUT, 1, "\t LHS=%d, ",inst_log1->prev[0]);
 //			debug_print(DEBUG_OUTPUT, 1, "IF goto label%04"PRIx32";\n", inst_log1->next[1]);
 			if (1 == instruction->srcA.indirect) {
-				tmp = dprintf(fd, "*");
+				tmp = string_printf(string, "*");
 				value_id = inst_log1->value1.indirect_value_id;
 			} else {
 				value_id = inst_log1->value1.value_id;
@@ -1386,16 +1381,16 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			tmp = label_redirect[value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			tmp = dprintf(fd, ")");
+			tmp = string_printf(string, "%s", buffer);
+			tmp = string_printf(string, ")");
 			debug_print(DEBUG_OUTPUT, 1, "\nstore=%d\n", instruction->srcA.store);
-			tmp = dprintf(fd, " goto ");
+			tmp = string_printf(string, " goto ");
 //			for (l = 0; l < inst_log1->next_size; l++) {
-//				tmp = dprintf(fd, ", label%04"PRIx32"", inst_log1->next[l]);
+//				tmp = string_printf(string, ", label%04"PRIx32"", inst_log1->next[l]);
 //			}
-			tmp = dprintf(fd, "label%04"PRIx32";", inst_log1->next[1]);
-			tmp = dprintf(fd, "%s", cr);
-			tmp = dprintf(fd, "\telse goto label%04"PRIx32";%s", inst_log1->next[0], cr);
+			tmp = string_printf(string, "label%04"PRIx32";", inst_log1->next[1]);
+			tmp = string_printf(string, "%s", cr);
+			tmp = string_printf(string, "\telse goto label%04"PRIx32";%s", inst_log1->next[0], cr);
 
 			break;
 
@@ -1407,19 +1402,19 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			debug_print(DEBUG_OUTPUT, 1, "\t");
-			tmp = dprintf(fd, "\t");
+			tmp = string_printf(string, "\t");
 			debug_print(DEBUG_OUTPUT, 1, "return\n");
-			tmp = dprintf(fd, "return ");
+			tmp = string_printf(string, "return ");
 			tmp = label_redirect[inst_log1->value1.value_id].redirect;
 			label = &labels[tmp];
 			tmp = label_to_string(label, buffer, 1023);
-			tmp = dprintf(fd, "%s", buffer);
-			//tmp = dprintf(fd, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
-			tmp = dprintf(fd, ";%s", cr);
+			tmp = string_printf(string, "%s", buffer);
+			//tmp = string_printf(string, " /*(0x%"PRIx64")*/", inst_log1->value1.value_id);
+			tmp = string_printf(string, ";%s", cr);
 			break;
 		default:
 			debug_print(DEBUG_OUTPUT, 1, "Unhandled output instruction1 opcode=0x%x\n", instruction->opcode);
-			tmp = dprintf(fd, "//Unhandled output instruction\\l");
+			tmp = string_printf(string, "//Unhandled output instruction\\l");
 			if (print_inst(self, instruction, inst_number, labels))
 				return 1;
 			return 1;
@@ -1427,14 +1422,14 @@ int output_inst_in_c(struct self_s *self, struct process_state_s *process_state,
 		}
 		if (0 < inst_log1->next_size && inst_log1->next[0] != (inst_number + 1)) {
 			debug_print(DEBUG_OUTPUT, 1, "\tTMP3 goto label%04"PRIx32";\n", inst_log1->next[0]);
-			tmp = dprintf(fd, "\tTMP3 goto label%04"PRIx32";%s", inst_log1->next[0], cr);
+			tmp = string_printf(string, "\tTMP3 goto label%04"PRIx32";%s", inst_log1->next[0], cr);
 		}
 	}
 	return 0;
 }
 
 int output_function_body(struct self_s *self, struct process_state_s *process_state,
-			 int fd, int start, int end, struct label_redirect_s *label_redirect, struct label_s *labels)
+			 struct string_s *string, int start, int end, struct label_redirect_s *label_redirect, struct label_s *labels)
 {
 	int tmp, n;
 
@@ -1445,15 +1440,15 @@ int output_function_body(struct self_s *self, struct process_state_s *process_st
 	debug_print(DEBUG_OUTPUT, 1, "output_function_body:start=0x%x, end=0x%x\n", start, end);
 
 	for (n = start; n <= end; n++) {
-		tmp = output_inst_in_c(self, process_state, fd, n, label_redirect, labels, "\n");
+		tmp = output_inst_in_c(self, process_state, string, n, label_redirect, labels, "\n");
 	}
 #if 0
 	if (0 < inst_log1->next_size && inst_log1->next[0]) {
 		debug_print(DEBUG_OUTPUT, 1, "\tTMP1 goto label%04"PRIx32";\n", inst_log1->next[0]);
-		tmp = dprintf(fd, "\tTMP1 goto label%04"PRIx32";\n", inst_log1->next[0]);
+		tmp = string_printf(string, "\tTMP1 goto label%04"PRIx32";\n", inst_log1->next[0]);
 	}
 #endif
-	tmp = dprintf(fd, "}\n\n");
+	tmp = string_printf(string, "}\n\n");
 	return 0;
 }
 
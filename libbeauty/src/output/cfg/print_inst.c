@@ -21,6 +21,8 @@
  */
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
 #include <rev.h>
 #include <string.h>
 
@@ -90,19 +92,115 @@ const char * opcode_table[] = {
 char *store_table[] = { "i", "r", "m", "s" };
 char *indirect_table[] = { "", "m", "s", "p" };
 
-int string_cat(struct string_s *string, char *src, int src_length) {
-	int result = 1;
-	if ((string->len + src_length) < string->max) {
-		memcpy(&(string->string[string->len]), src, src_length);
-		string->len += src_length;
-		string->string[string->len] = 0;
-		result = 0;
-	} else {
-		printf("string_cat: FAILED. string len = 0x%x, src_length = 0x%x\n", string->len, src_length);
+/* Make room for size more bytes and the terminating 0 */
+static int string_reserve(struct string_s *string, int size)
+{
+	int max;
+
+	if ((string->len + size) < string->max) {
+		return 0;
+	}
+	max = string->max ? string->max : STRING_INIT_SIZE;
+	while ((string->len + size) >= max) {
+		max *= 2;
+	}
+	string->string = realloc(string->string, max);
+	if (!string->string) {
+		debug_print(DEBUG_OUTPUT, 1, "string_reserve: realloc failed\n");
+		exit(1);
 	}
-	return result;
+	string->max = max;
+	return 0;
+}
+
+/* fd >= 0: written out to fd in STRING_FLUSH_SIZE chunks.
+ * fd < 0: kept in memory. string->string holds the whole text.
+ */
+int string_init(struct string_s *string, int fd)
+{
+	string->string = NULL;
+	string->len = 0;
+	string->max = 0;
+	string->fd = fd;
+	string_reserve(string, 0);
+	string->string[0] = 0;
+	return 0;
 }
 
+int string_flush(struct string_s *string)
+{
+	int offset = 0;
+	ssize_t tmp;
+
+	if (string->fd < 0) {
+		return 0;
+	}
+	while (offset < string->len) {
+		tmp = write(string->fd, &(string->string[offset]), string->len - offset);
+		if (tmp <= 0) {
+			debug_print(DEBUG_OUTPUT, 1, "string_flush: write failed\n");
+			return 1;
+		}
+		offset += tmp;
+	}
+	string->len = 0;
+	string->string[0] = 0;
+	return 0;
+}
+
+static int string_check_flush(struct string_s *string)
+{
+	if ((string->fd >= 0) && (string->len >= STRING_FLUSH_SIZE)) {
+		return string_flush(string);
+	}
+	return 0;
+}
+
+int string_cat(struct string_s *string, char *src, int src_length)
+{
+	string_reserve(string, src_length);
+	memcpy(&(string->string[string->len]), src, src_length);
+	string->len += src_length;
+	string->string[string->len] = 0;
+	return string_check_flush(string);
+}
+
+/* Returns the number of bytes added, as dprintf() does */
+int string_printf(struct string_s *string, const char *format, ...)
+{
+	va_list ap;
+	int size;
+
+	va_start(ap, format);
+	size = vsnprintf(&(string->string[string->len]), string->max - string->len, format, ap);
+	va_end(ap);
+	if (size < 0) {
+		return size;
+	}
+	if ((string->len + size) >= string->max) {
+		/* Did not fit. Grow and do it again */
+		string_reserve(string, size);
+		va_start(ap, format);
+		vsnprintf(&(string->string[string->len]), string->max - string->len, format, ap);
+		va_end(ap);
+	}
+	string->len += size;
+	string_check_flush(string);
+	return size;
+}
+
+/* Flushes to the fd, if there is one */
+int string_free(struct string_s *string)
+{
+	int ret;
+
+	ret = string_flush(string);
+	free(string->string);
+	string->string = NULL;
+	string->len = 0;
+	string->max = 0;
+	return ret;
+}
 
 int write_inst(struct self_s *self, struct string_s *string, struct instruction_s *instruction, int instruction_number, struct label_s *labels)
 {
@@ -404,7 +502,7 @@ int write_inst(struct self_s *self, struct string_s *string, struct instruction_
 		if (instruction->srcA.relocated == 2) {
 			for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
 				if ((external_entry_points[n].valid != 0) &&
-					(external_entry_points[n].type == 1) &&
+					((external_entry_points[n].type == 1) || (external_entry_points[n].type == 3)) &&
 					(external_entry_points[n].value == instruction->srcA.relocated_index)) {
 					//debug_print(DEBUG_OUTPUT, 1, "found external relocated 0x%x\n", n);
 					instruction->srcA.index = n;
@@ -493,13 +591,12 @@ int print_inst(struct self_s *self, struct instruction_s *instruction, int instr
 	int ret;
 	int tmp;
 	struct string_s string1;
-	string1.len = 0;
-	string1.max = 1023;
-	string1.string[0] = 0;
-	
+
+	string_init(&string1, -1);
 	ret = write_inst(self, &string1, instruction, instruction_number, labels);
 	tmp = fprintf(stderr, "%s", string1.string);
 	tmp = fprintf(stderr, "\n");
+	string_free(&string1);
 	return ret;
 }
 
@@ -5,16 +5,26 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <string>
 #include <sstream>
 #include <global_struct.h>
 #include <output.h>
+#include <llvm.h>
+#include <stats.h>
+#include <summary_cache.h>
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/PassManager.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -39,6 +49,76 @@ using namespace llvm;
 			ICmpInst::ICMP_SGT,  ///< signed greater than. 
 		};
 
+/* The passes that can be named in a pass list */
+static FunctionPass *create_mem2reg_pass(void) { return createPromoteMemoryToRegisterPass(); }
+static FunctionPass *create_sroa_pass(void) { return createSROAPass(); }
+static FunctionPass *create_instcombine_pass(void) { return createInstructionCombiningPass(); }
+static FunctionPass *create_simplifycfg_pass(void) { return createCFGSimplificationPass(); }
+static FunctionPass *create_dce_pass(void) { return createDeadCodeEliminationPass(); }
+static FunctionPass *create_adce_pass(void) { return createAggressiveDCEPass(); }
+static FunctionPass *create_early_cse_pass(void) { return createEarlyCSEPass(); }
+static FunctionPass *create_reassociate_pass(void) { return createReassociatePass(); }
+static FunctionPass *create_gvn_pass(void) { return createGVNPass(); }
+
+struct llvm_pass_s {
+	const char *name;
+	FunctionPass *(*create)(void);
+};
+
+static struct llvm_pass_s llvm_pass_table[] = {
+	{ "mem2reg", create_mem2reg_pass },
+	{ "sroa", create_sroa_pass },
+	{ "instcombine", create_instcombine_pass },
+	{ "simplifycfg", create_simplifycfg_pass },
+	{ "dce", create_dce_pass },
+	{ "adce", create_adce_pass },
+	{ "early-cse", create_early_cse_pass },
+	{ "reassociate", create_reassociate_pass },
+	{ "gvn", create_gvn_pass },
+	{ NULL, NULL }
+};
+
+/* passes is a comma separated list of llvm_pass_table names, or "default".
+ * If FPM is not NULL, each pass is added to it.
+ * Returns 1 if a name is not known.
+ */
+static int llvm_passes_parse(const char *passes, FunctionPassManager *FPM)
+{
+	const char *name;
+	size_t length;
+	int n;
+
+	if (!strcmp(passes, "default")) {
+		passes = LLVM_PASSES_DEFAULT;
+	}
+	name = passes;
+	while (*name) {
+		length = strcspn(name, ",");
+		if (length) {
+			for (n = 0; llvm_pass_table[n].name; n++) {
+				if ((strlen(llvm_pass_table[n].name) == length) &&
+					!strncmp(llvm_pass_table[n].name, name, length)) {
+					break;
+				}
+			}
+			if (!llvm_pass_table[n].name) {
+				printf("LLVM pass \"%.*s\" not known\n", (int)length, name);
+				return 1;
+			}
+			if (FPM) {
+				FPM->add(llvm_pass_table[n].create());
+			}
+		}
+		name += length;
+		if (*name == ',') {
+			name++;
+		}
+	}
+	return 0;
+}
+
+struct llvm_export_thread_s;
+
 class LLVM_ir_export
 {
 	public:
@@ -46,7 +126,13 @@ class LLVM_ir_export
 		int add_instruction(struct self_s *self, Module *mod, Value **value, BasicBlock **bb, int node, int external_entry, int inst);
 		int add_node_instructions(struct self_s *self, Module *mod, Value **value, BasicBlock **bb, int node, int external_entry);
 		int fill_value(struct self_s *self, Value **value, int value_id, int external_entry);
-		int output(struct self_s *self);
+		Module *new_module(const char *name);
+		int add_function(struct self_s *self, Module *mod, int external_entry);
+		int run_passes(Module *mod, const char *passes);
+		int output(struct self_s *self, const char *passes);
+		int link_module(struct llvm_export_thread_s *thread, int threads, const char *filename);
+		int add_cached_function(struct self_s *self, Module *mod, int external_entry);
+		int add_function_to_cache(struct self_s *self, Module *mod, int external_entry);
 
 
 	private:
@@ -277,8 +363,8 @@ int LLVM_ir_export::add_instruction(struct self_s *self, Module *mod, Value **va
 		value[inst_log1->value3.value_id] = dstA;
 		break;
 	case 0x11:  // JMP
-		printf("LLVM 0x%x: OPCODE = 0x%x:JMP node_end = 0x%x\n", inst, inst_log1->instruction.opcode, inst_log1->node_end);
-		if (inst_log1->node_end) {
+		printf("LLVM 0x%x: OPCODE = 0x%x:JMP node_end = 0x%x\n", inst, inst_log1->instruction.opcode, INST_LOG_NODE_END(self, inst));
+		if (INST_LOG_NODE_END(self, inst)) {
 			node_true = nodes[node].link_next[0].node;
 			BranchInst::Create(bb[node_true], bb[node]);
 			result = 1;
@@ -544,15 +630,15 @@ int LLVM_ir_export::add_node_instructions(struct self_s *self, Module *mod, Valu
 		inst = inst_next;
 		inst_log1 =  &inst_log_entry[inst];
 		printf("LLVM node end: inst_end = 0x%x, next_size = 0x%x, node_end = 0x%x\n",
-			nodes[node].inst_end, inst_log1->next_size, inst_log1->node_end);
+			nodes[node].inst_end, inst_log1->next_size, INST_LOG_NODE_END(self, inst));
 		tmp = add_instruction(self, mod, value, bb, node, external_entry, inst);
 		if (inst_log1->next_size > 0) {
 			inst_next = inst_log1->next[0];
 		}
 		printf("tmp = 0x%x\n", tmp);
 		/* FIXME: is tmp really needed for block_end detection? */
-		block_end = (inst_log1->node_end || !(inst_log1->next_size) || tmp);
-		//block_end = (inst_log1->node_end || !(inst_log1->next_size));
+		block_end = (INST_LOG_NODE_END(self, inst) || !(inst_log1->next_size) || tmp);
+		//block_end = (INST_LOG_NODE_END(self, inst) || !(inst_log1->next_size));
 	} while (!block_end);
 
 	if (!tmp) {
@@ -592,11 +678,18 @@ int LLVM_ir_export::fill_value(struct self_s *self, Value **value, int value_id,
 	return 1;
 }
 
-int LLVM_ir_export::output(struct self_s *self)
+Module *LLVM_ir_export::new_module(const char *name)
 {
-	const char *function_name = "test123";
-	char output_filename[512];
-	int n;
+	Module *mod = new Module(name, Context);
+	mod->setDataLayout("e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128");
+	mod->setTargetTriple("x86_64-pc-linux-gnu");
+	return mod;
+}
+
+/* Adds the external_entry function, and any globals it uses, to mod. mod must be in this Context */
+int LLVM_ir_export::add_function(struct self_s *self, Module *mod, int external_entry)
+{
+	const char *function_name;
 	int m;
 	int l;
 	int tmp;
@@ -609,158 +702,191 @@ int LLVM_ir_export::output(struct self_s *self)
 	struct label_s *label;
 	char buffer[1024];
 	int index;
-	
 	struct external_entry_point_s *external_entry_points = self->external_entry_points;
-	
-	for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
-		if ((external_entry_points[n].valid != 0) &&
-			(external_entry_points[n].type == 1) && 
-			(external_entry_points[n].nodes_size)) {
-			Value** value = (Value**) calloc(external_entry_points[n].variable_id, sizeof(Value*));
-			nodes = external_entry_points[n].nodes;
-			nodes_size = external_entry_points[n].nodes_size;
-			labels = external_entry_points[n].labels;
-			labels_size = external_entry_points[n].variable_id;
-			label_redirect = external_entry_points[n].label_redirect;
-			Module *mod = new Module("test_llvm_export", Context);
- 			mod->setDataLayout("e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128");
-			mod->setTargetTriple("x86_64-pc-linux-gnu");
-
-			/* Add globals */
-			for (m = 0; m < labels_size; m++) {
-				label = &labels[label_redirect[m].redirect];
-				if ((3 == label->scope) && (2 == label->type)) {
-					printf("Label:0x%x: &data found. size=0x%lx\n", m, label->size_bits);
-					GlobalVariable* gvar_int32_mem1 = new GlobalVariable(/*Module=*/*mod,
-						/*Type=*/IntegerType::get(mod->getContext(), label->size_bits),
-						/*isConstant=*/false,
-						/*Linkage=*/GlobalValue::InternalLinkage,
-						/*Initializer=*/0, // has initializer, specified below
-						/*Name=*/"data0");
-					gvar_int32_mem1->setAlignment(label->size_bits >> 3);
-					value[m] = gvar_int32_mem1;
-				}
-			}
 
+	Value** value = (Value**) calloc(external_entry_points[external_entry].variable_id, sizeof(Value*));
+	nodes = external_entry_points[external_entry].nodes;
+	nodes_size = external_entry_points[external_entry].nodes_size;
+	labels = external_entry_points[external_entry].labels;
+	labels_size = external_entry_points[external_entry].variable_id;
+	label_redirect = external_entry_points[external_entry].label_redirect;
 
-			function_name = external_entry_points[n].name;
-			snprintf(output_filename, 500, "./llvm/%s.bc", function_name);
-			std::vector<Type*>FuncTy_0_args;
-			for (m = 0; m < external_entry_points[n].params_size; m++) {
-				index = external_entry_points[n].params[m];
-				if (labels[index].lab_pointer > 0) {
-					int size = labels[index].pointer_type_size_bits;
-					printf("Param=0x%x: Pointer Label 0x%x, size_bits = 0x%x\n", m, index, size);
-					if (size < 8) {
-						printf("FIXME: size too small\n");
-						size = 8;
-					}
-					FuncTy_0_args.push_back(PointerType::get(IntegerType::get(mod->getContext(), size), 0));
-				} else {	
-					int size = labels[index].size_bits;
-					printf("Param=0x%x: Label 0x%x, size_bits = 0x%x\n", m, index, size);
-					FuncTy_0_args.push_back(IntegerType::get(mod->getContext(), size));
-				}
-			}
+	/* Add globals */
+	for (m = 0; m < labels_size; m++) {
+		label = &labels[label_redirect[m].redirect];
+		if ((3 == label->scope) && (2 == label->type)) {
+			printf("Label:0x%x: &data found. size=0x%lx\n", m, label->size_bits);
+			GlobalVariable* gvar_int32_mem1 = new GlobalVariable(/*Module=*/*mod,
+				/*Type=*/IntegerType::get(mod->getContext(), label->size_bits),
+				/*isConstant=*/false,
+				/*Linkage=*/GlobalValue::InternalLinkage,
+				/*Initializer=*/0, // has initializer, specified below
+				/*Name=*/"data0");
+			gvar_int32_mem1->setAlignment(label->size_bits >> 3);
+			value[m] = gvar_int32_mem1;
+		}
+	}
 
-			FunctionType *FT =
-				FunctionType::get(Type::getInt32Ty(Context),
-					FuncTy_0_args,
-					false); /*not vararg*/
-
-			Function *F = Function::Create(FT, Function::ExternalLinkage, function_name, mod);
-
-			Function::arg_iterator args = F->arg_begin();
-			printf("Function: %s()  param_size = 0x%x\n", function_name, external_entry_points[n].params_size);
-			for (m = 0; m < external_entry_points[n].params_size; m++) {
-				index = external_entry_points[n].params[m];
-				value[index] = args;
-				args++;
-				tmp = label_to_string(&(labels[index]), buffer, 1023);
-				printf("Adding param:%s:value index=0x%x\n", buffer, index);
-				value[index]->setName(buffer);
-			}
 
-			/* Create all the nodes/basic blocks */
-			BasicBlock **bb = (BasicBlock **)calloc(nodes_size + 1, sizeof (BasicBlock *));
-			for (m = 1; m < nodes_size; m++) {
-				std::string node_string;
-				std::stringstream tmp_str;
-				tmp_str << "Node_0x" << std::hex << m;
-				node_string = tmp_str.str();
-				printf("LLVM2: %s\n", node_string.c_str());
-				bb[m] = BasicBlock::Create(Context, node_string, F);
+	function_name = external_entry_points[external_entry].name;
+	std::vector<Type*>FuncTy_0_args;
+	for (m = 0; m < external_entry_points[external_entry].params_size; m++) {
+		index = external_entry_points[external_entry].params[m];
+		if (labels[index].lab_pointer > 0) {
+			int size = labels[index].pointer_type_size_bits;
+			printf("Param=0x%x: Pointer Label 0x%x, size_bits = 0x%x\n", m, index, size);
+			if (size < 8) {
+				printf("FIXME: size too small\n");
+				size = 8;
 			}
+			FuncTy_0_args.push_back(PointerType::get(IntegerType::get(mod->getContext(), size), 0));
+		} else {	
+			int size = labels[index].size_bits;
+			printf("Param=0x%x: Label 0x%x, size_bits = 0x%x\n", m, index, size);
+			FuncTy_0_args.push_back(IntegerType::get(mod->getContext(), size));
+		}
+	}
 
-			/* Create the AllocaInst's */
-			for (m = 0; m < labels_size; m++) {
-				int size_bits;
-				/* param_stack or local_stack */
-				if (((labels[m].scope == 1) || 
-					(labels[m].scope == 2)) &&
-					(labels[m].type == 2)) {
-					size_bits = labels[m].size_bits;
-					/* FIXME: Make size_bits set correctly in the label */
-					//if (!size_bits) size_bits = 32;
-					printf("Creating alloca for lable 0x%x, size_bits = 0x%x\n", m, size_bits);
-					tmp = label_to_string(&labels[m], buffer, 1023);
-					AllocaInst* ptr_local = new AllocaInst(IntegerType::get(mod->getContext(), size_bits), buffer, bb[1]);
-					ptr_local->setAlignment(size_bits >> 3);
-					value[m] = ptr_local;
-				}
-			}
-				
-			/* FIXME: this needs the node to follow paths so the value[] is filled in the correct order */
-			printf("LLVM: starting nodes\n");
-			for (m = 1; m < nodes_size; m++) {
-				printf("JCD12: node:0x%x: next_size = 0x%x\n", m, nodes[m].next_size);
-			};
-			for (node = 1; node < nodes_size; node++) {
-				printf("LLVM: node=0x%x\n", node);
-
-				/* Output PHI instructions first */
-				for (m = 0; m < nodes[node].phi_size; m++) {
-					int size_bits = labels[nodes[node].phi[m].value_id].size_bits;
-					printf("LLVM:phi 0x%x\n", m);
-					tmp = label_to_string(&labels[nodes[node].phi[m].value_id], buffer, 1023);
-					printf("LLVM phi base size = 0x%x\n", size_bits);
-					PHINode* phi_node = PHINode::Create(IntegerType::get(mod->getContext(), size_bits),
-						nodes[node].phi[m].phi_node_size,
-						buffer, bb[node]);
-					/* The rest of the PHI instruction is added later */
-					value[nodes[node].phi[m].value_id] = phi_node;
-				}
-				LLVM_ir_export::add_node_instructions(self, mod, value, bb, node, n);
-			}
+	FunctionType *FT =
+		FunctionType::get(Type::getInt32Ty(Context),
+			FuncTy_0_args,
+			false); /*not vararg*/
+
+	Function *F = Function::Create(FT, Function::ExternalLinkage, function_name, mod);
+
+	Function::arg_iterator args = F->arg_begin();
+	printf("Function: %s()  param_size = 0x%x\n", function_name, external_entry_points[external_entry].params_size);
+	for (m = 0; m < external_entry_points[external_entry].params_size; m++) {
+		index = external_entry_points[external_entry].params[m];
+		value[index] = args;
+		args++;
+		tmp = label_to_string(&(labels[index]), buffer, 1023);
+		printf("Adding param:%s:value index=0x%x\n", buffer, index);
+		value[index]->setName(buffer);
+	}
+
+	/* Create all the nodes/basic blocks */
+	BasicBlock **bb = (BasicBlock **)calloc(nodes_size + 1, sizeof (BasicBlock *));
+	for (m = 1; m < nodes_size; m++) {
+		std::string node_string;
+		std::stringstream tmp_str;
+		tmp_str << "Node_0x" << std::hex << m;
+		node_string = tmp_str.str();
+		printf("LLVM2: %s\n", node_string.c_str());
+		bb[m] = BasicBlock::Create(Context, node_string, F);
+	}
+
+	/* Create the AllocaInst's */
+	for (m = 0; m < labels_size; m++) {
+		int size_bits;
+		/* param_stack or local_stack */
+		if (((labels[m].scope == 1) || 
+			(labels[m].scope == 2)) &&
+			(labels[m].type == 2)) {
+			size_bits = labels[m].size_bits;
+			/* FIXME: Make size_bits set correctly in the label */
+			//if (!size_bits) size_bits = 32;
+			printf("Creating alloca for lable 0x%x, size_bits = 0x%x\n", m, size_bits);
+			tmp = label_to_string(&labels[m], buffer, 1023);
+			AllocaInst* ptr_local = new AllocaInst(IntegerType::get(mod->getContext(), size_bits), buffer, bb[1]);
+			ptr_local->setAlignment(size_bits >> 3);
+			value[m] = ptr_local;
+		}
+	}
+		
+	/* FIXME: this needs the node to follow paths so the value[] is filled in the correct order */
+	printf("LLVM: starting nodes\n");
+	for (m = 1; m < nodes_size; m++) {
+		printf("JCD12: node:0x%x: next_size = 0x%x\n", m, nodes[m].next_size);
+	};
+	for (node = 1; node < nodes_size; node++) {
+		printf("LLVM: node=0x%x\n", node);
+
+		/* Output PHI instructions first */
+		for (m = 0; m < nodes[node].phi_size; m++) {
+			int size_bits = labels[nodes[node].phi[m].value_id].size_bits;
+			printf("LLVM:phi 0x%x\n", m);
+			tmp = label_to_string(&labels[nodes[node].phi[m].value_id], buffer, 1023);
+			printf("LLVM phi base size = 0x%x\n", size_bits);
+			PHINode* phi_node = PHINode::Create(IntegerType::get(mod->getContext(), size_bits),
+				nodes[node].phi[m].phi_node_size,
+				buffer, bb[node]);
+			/* The rest of the PHI instruction is added later */
+			value[nodes[node].phi[m].value_id] = phi_node;
+		}
+		LLVM_ir_export::add_node_instructions(self, mod, value, bb, node, external_entry);
+	}
+
+	for (node = 1; node < nodes_size; node++) {
+		printf("LLVM: node=0x%x\n", node);
 
-			for (node = 1; node < nodes_size; node++) {
-				printf("LLVM: node=0x%x\n", node);
-
-				for (m = 0; m < nodes[node].phi_size; m++) {
-					int size_bits = labels[nodes[node].phi[m].value_id].size_bits;
-					printf("LLVM:phi 0x%x\n", m);
-					printf("LLVM phi base size = 0x%x\n", size_bits);
-					PHINode* phi_node = (PHINode*)value[nodes[node].phi[m].value_id];
-					for (l = 0; l < nodes[node].phi[m].phi_node_size; l++) {
-						int value_id;
-						int redirect_value_id;
-						int first_previous_node;
-						value_id = nodes[node].phi[m].phi_node[l].value_id;
-						redirect_value_id = label_redirect[value_id].redirect;
-						first_previous_node = nodes[node].phi[m].phi_node[l].first_prev_node;
-						printf("LLVM:phi 0x%x:0x%x FPN=0x%x, SN=0x%x, value_id=0x%x, redirected_value_id=0x%x, size=0x%lx\n",
-							m, l,
-							nodes[node].phi[m].phi_node[l].first_prev_node,
-							nodes[node].phi[m].phi_node[l].node,
-							value_id,
-							redirect_value_id,
-							labels[redirect_value_id].size_bits);
-						if (value_id > 0) {
-							phi_node->addIncoming(value[redirect_value_id], bb[first_previous_node]);
-						}
-					}
+		for (m = 0; m < nodes[node].phi_size; m++) {
+			int size_bits = labels[nodes[node].phi[m].value_id].size_bits;
+			printf("LLVM:phi 0x%x\n", m);
+			printf("LLVM phi base size = 0x%x\n", size_bits);
+			PHINode* phi_node = (PHINode*)value[nodes[node].phi[m].value_id];
+			for (l = 0; l < nodes[node].phi[m].phi_node_size; l++) {
+				int value_id;
+				int redirect_value_id;
+				int first_previous_node;
+				value_id = nodes[node].phi[m].phi_node[l].value_id;
+				redirect_value_id = label_redirect[value_id].redirect;
+				first_previous_node = nodes[node].phi[m].phi_node[l].first_prev_node;
+				printf("LLVM:phi 0x%x:0x%x FPN=0x%x, SN=0x%x, value_id=0x%x, redirected_value_id=0x%x, size=0x%lx\n",
+					m, l,
+					nodes[node].phi[m].phi_node[l].first_prev_node,
+					nodes[node].phi[m].phi_node[l].node,
+					value_id,
+					redirect_value_id,
+					labels[redirect_value_id].size_bits);
+				if (value_id > 0) {
+					phi_node->addIncoming(value[redirect_value_id], bb[first_previous_node]);
 				}
 			}
+		}
+	}
+	free(value);
+	free(bb);
+	return 0;
+}
+
+/* Runs the passes list over every function defined in mod. NULL or "" runs nothing */
+int LLVM_ir_export::run_passes(Module *mod, const char *passes)
+{
+	Module::iterator function;
+
+	if (!passes || !passes[0]) {
+		return 0;
+	}
+	FunctionPassManager FPM(mod);
+	if (llvm_passes_parse(passes, &FPM)) {
+		return 1;
+	}
+	FPM.doInitialization();
+	for (function = mod->begin(); function != mod->end(); function++) {
+		if (!function->isDeclaration()) {
+			FPM.run(*function);
+		}
+	}
+	FPM.doFinalization();
+	return 0;
+}
+
+/* One .bc file per function, in ./llvm/ */
+int LLVM_ir_export::output(struct self_s *self, const char *passes)
+{
+	char output_filename[512];
+	int n;
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+
+	for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
+		if ((external_entry_points[n].valid != 0) &&
+			(external_entry_points[n].type == 1) && 
+			(external_entry_points[n].nodes_size)) {
+			Module *mod = new_module("test_llvm_export");
+			add_function(self, mod, n);
+			run_passes(mod, passes);
+			snprintf(output_filename, 500, "./llvm/%s.bc", external_entry_points[n].name);
 			std::string ErrorInfo;
 			raw_fd_ostream OS(output_filename, ErrorInfo, sys::fs::F_Binary);
 
@@ -775,11 +901,237 @@ int LLVM_ir_export::output(struct self_s *self)
 	return 0;
 }
 
+/* Modules in different LLVMContexts cannot be linked directly, so each
+ * thread hands its module back as bitcode in memory.
+ * The functions are queued by llvm_export_submit() as soon as their labels are done,
+ * so the IR is built while main() carries on with the next function.
+ */
+struct llvm_export_worker_s {
+	struct self_s *self;
+	const char *passes;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	int queue[EXTERNAL_ENTRY_POINTS_MAX];
+	int queued;	/* Submitted so far */
+	int next;	/* Taken so far */
+	int done;	/* Set by llvm_export_end(). No more will be submitted */
+};
+
+struct llvm_export_thread_s {
+	struct llvm_export_worker_s *worker;
+	std::string bitcode;
+	int functions;
+};
+
+struct llvm_export_s {
+	struct llvm_export_worker_s worker;
+	struct llvm_export_thread_s *thread;
+	pthread_t *thread_id;
+	uint8_t *started;
+	int threads;
+	const char *filename;
+};
+
+/* The next function submitted, or -1 once llvm_export_end() is called and the queue is empty */
+static int llvm_export_take(struct llvm_export_worker_s *worker)
+{
+	int n = -1;
+
+	pthread_mutex_lock(&(worker->lock));
+	while ((worker->next >= worker->queued) && !worker->done) {
+		pthread_cond_wait(&(worker->ready), &(worker->lock));
+	}
+	if (worker->next < worker->queued) {
+		n = worker->queue[worker->next];
+		worker->next++;
+	}
+	pthread_mutex_unlock(&(worker->lock));
+	return n;
+}
+
+static void *llvm_export_worker(void *arg)
+{
+	struct llvm_export_thread_s *thread = (struct llvm_export_thread_s *)arg;
+	struct llvm_export_worker_s *worker = thread->worker;
+	struct external_entry_point_s *external_entry_points = worker->self->external_entry_points;
+	/* Each object has its own LLVMContext */
+	LLVM_ir_export object;
+	Module *mod = object.new_module("llvm_export_part");
+	/* The passes are per function, so run them here, in parallel, each function as it is added */
+	FunctionPassManager *FPM = NULL;
+	Function *function;
+	int record;
+	int tmp;
+	int n;
+
+	if (worker->passes && worker->passes[0]) {
+		/* Already checked by llvm_export_begin() */
+		FPM = new FunctionPassManager(mod);
+		llvm_passes_parse(worker->passes, FPM);
+		FPM->doInitialization();
+	}
+	while ((n = llvm_export_take(worker)) >= 0) {
+		if ((external_entry_points[n].valid != 0) &&
+			(external_entry_points[n].type == 3)) {
+			record = stats_begin(worker->self, "llvm_cached", n);
+			tmp = object.add_cached_function(worker->self, mod, n);
+			stats_end(worker->self, record);
+		} else if ((external_entry_points[n].valid != 0) &&
+			(external_entry_points[n].type == 1) &&
+			(external_entry_points[n].nodes_size)) {
+			record = stats_begin(worker->self, "llvm_function", n);
+			if (worker->self->summary_cache) {
+				tmp = object.add_function_to_cache(worker->self, mod, n);
+			} else {
+				tmp = object.add_function(worker->self, mod, n);
+			}
+			stats_end(worker->self, record);
+		} else {
+			continue;
+		}
+		if (!tmp) {
+			thread->functions++;
+			/* The cache has the bitcode from before the passes, so they are run on both */
+			function = mod->getFunction(external_entry_points[n].name);
+			if (FPM && function && !function->isDeclaration()) {
+				record = stats_begin(worker->self, "llvm_passes", n);
+				FPM->run(*function);
+				stats_end(worker->self, record);
+			}
+		}
+	}
+	if (FPM) {
+		FPM->doFinalization();
+		delete FPM;
+	}
+	if (thread->functions) {
+		raw_string_ostream OS(thread->bitcode);
+		WriteBitcodeToFile(mod, OS);
+		OS.flush();
+	}
+	delete mod;
+	return NULL;
+}
+
+/* Link the bitcode the summary cache has for a function served from it into mod */
+int LLVM_ir_export::add_cached_function(struct self_s *self, Module *mod, int external_entry)
+{
+	std::string ErrorInfo;
+	const char *data;
+	size_t size;
+
+	if (summary_cache_text(self, external_entry, SUMMARY_CACHE_LLVM, &data, &size) || !size) {
+		printf("LLVM add_cached_function: 0x%x: no bitcode in the cache\n", external_entry);
+		return 1;
+	}
+	MemoryBuffer *buffer = MemoryBuffer::getMemBuffer(StringRef(data, size), "summary_cache", false);
+	ErrorOr<Module *> part = parseBitcodeFile(buffer, Context);
+	delete buffer;
+	if (!part) {
+		printf("LLVM add_cached_function: 0x%x: %s\n", external_entry, part.getError().message().c_str());
+		return 1;
+	}
+	if (Linker::LinkModules(mod, part.get(), Linker::DestroySource, &ErrorInfo)) {
+		printf("LLVM add_cached_function: 0x%x: link failed: %s\n", external_entry, ErrorInfo.c_str());
+		delete part.get();
+		return 1;
+	}
+	delete part.get();
+	return 0;
+}
+
+/* As add_function(), but the function is built in a module of its own,
+ * whose bitcode is kept for the summary cache, and then linked into mod.
+ */
+int LLVM_ir_export::add_function_to_cache(struct self_s *self, Module *mod, int external_entry)
+{
+	std::string ErrorInfo;
+	std::string bitcode;
+	Module *part;
+	int tmp;
+
+	part = new_module("summary_cache");
+	tmp = add_function(self, part, external_entry);
+	if (tmp) {
+		delete part;
+		return tmp;
+	}
+	raw_string_ostream OS(bitcode);
+	WriteBitcodeToFile(part, OS);
+	OS.flush();
+	summary_cache_set_text(self, external_entry, SUMMARY_CACHE_LLVM, bitcode.data(), bitcode.size());
+	if (Linker::LinkModules(mod, part, Linker::DestroySource, &ErrorInfo)) {
+		printf("LLVM add_function_to_cache: 0x%x: link failed: %s\n", external_entry, ErrorInfo.c_str());
+		delete part;
+		return 1;
+	}
+	delete part;
+	return 0;
+}
+
+/* Links the module of each thread into one, and writes it to filename */
+int LLVM_ir_export::link_module(struct llvm_export_thread_s *thread, int threads, const char *filename)
+{
+	std::string ErrorInfo;
+	std::string bitcode;
+	Module *linked;
+	int result = 0;
+	int n;
+
+	linked = new_module("llvm_export");
+	for (n = 0; n < threads; n++) {
+		if (!thread[n].functions) {
+			continue;
+		}
+		MemoryBuffer *buffer = MemoryBuffer::getMemBuffer(thread[n].bitcode, "llvm_export_part", false);
+		ErrorOr<Module *> part = parseBitcodeFile(buffer, Context);
+		delete buffer;
+		if (!part) {
+			printf("LLVM link_module: part 0x%x: %s\n", n, part.getError().message().c_str());
+			result = 1;
+			break;
+		}
+		if (Linker::LinkModules(linked, part.get(), Linker::DestroySource, &ErrorInfo)) {
+			printf("LLVM link_module: part 0x%x: link failed: %s\n", n, ErrorInfo.c_str());
+			delete part.get();
+			result = 1;
+			break;
+		}
+		printf("LLVM link_module: part 0x%x: 0x%x functions\n", n, thread[n].functions);
+		delete part.get();
+		std::string().swap(thread[n].bitcode);
+	}
+	if (result) {
+		delete linked;
+		return result;
+	}
+
+	/* Serialise into memory, so the file is written in one go */
+	raw_string_ostream BitcodeOS(bitcode);
+	WriteBitcodeToFile(linked, BitcodeOS);
+	BitcodeOS.flush();
+	delete linked;
+
+	raw_fd_ostream OS(filename, ErrorInfo, sys::fs::F_Binary);
+	if (!ErrorInfo.empty()) {
+		printf("LLVM link_module: %s: %s\n", filename, ErrorInfo.c_str());
+		return 1;
+	}
+	OS << bitcode;
+	OS.close();
+	if (OS.has_error()) {
+		OS.clear_error();
+		printf("LLVM link_module: %s: write failed\n", filename);
+		return 1;
+	}
+	return 0;
+}
+
 int LLVM_ir_export_entry(struct self_s *self)
 {
 	int tmp;
 	LLVM_ir_export object;
-	tmp = object.output(self);
+	tmp = object.output(self, NULL);
 	return tmp;
 }
 
@@ -790,3 +1142,123 @@ extern "C" int llvm_export(struct self_s *self)
 	return tmp;
 }
 
+/* Starts the workers that build all the functions into one .bc file, filename.
+ * The functions are built in parallel, a module per thread, and then linked by llvm_export_end().
+ * threads = 0 uses one per online CPU.
+ * passes, if not NULL, is run on each function before it is written. See llvm_passes_parse().
+ * Returns NULL if passes has a name that is not known.
+ */
+extern "C" struct llvm_export_s *llvm_export_begin(struct self_s *self, const char *filename, int threads, const char *passes)
+{
+	struct llvm_export_s *exporter;
+	int n;
+
+	if (passes && llvm_passes_parse(passes, NULL)) {
+		return NULL;
+	}
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (threads <= 0) {
+			threads = 1;
+		}
+	}
+	exporter = new llvm_export_s;
+	exporter->thread = new llvm_export_thread_s[threads];
+	exporter->thread_id = (pthread_t *)calloc(threads, sizeof(pthread_t));
+	exporter->started = (uint8_t *)calloc(threads, sizeof(uint8_t));
+	if (!exporter->thread_id || !exporter->started) {
+		printf("LLVM llvm_export_begin: calloc failed\n");
+		exit(1);
+	}
+	exporter->threads = threads;
+	exporter->filename = filename;
+	exporter->worker.self = self;
+	exporter->worker.passes = passes;
+	pthread_mutex_init(&(exporter->worker.lock), NULL);
+	pthread_cond_init(&(exporter->worker.ready), NULL);
+	exporter->worker.queued = 0;
+	exporter->worker.next = 0;
+	exporter->worker.done = 0;
+	for (n = 0; n < threads; n++) {
+		exporter->thread[n].worker = &(exporter->worker);
+		exporter->thread[n].functions = 0;
+	}
+	for (n = 0; n < threads; n++) {
+		exporter->started[n] = !pthread_create(&(exporter->thread_id[n]), NULL, llvm_export_worker, &(exporter->thread[n]));
+	}
+	return exporter;
+}
+
+/* Queue function, an external_entry_points[] index. Its labels must be done.
+ * Only the function's own labels, nodes and instructions are read, so main()
+ * can carry on with the next function.
+ */
+extern "C" int llvm_export_submit(struct llvm_export_s *exporter, int function)
+{
+	struct llvm_export_worker_s *worker = &(exporter->worker);
+	int ret = 0;
+
+	pthread_mutex_lock(&(worker->lock));
+	if (worker->done || (worker->queued >= EXTERNAL_ENTRY_POINTS_MAX)) {
+		ret = 1;
+	} else {
+		worker->queue[worker->queued] = function;
+		worker->queued++;
+		pthread_cond_signal(&(worker->ready));
+	}
+	pthread_mutex_unlock(&(worker->lock));
+	return ret;
+}
+
+/* Waits for the functions queued, links them, writes the file and frees exporter */
+extern "C" int llvm_export_end(struct llvm_export_s *exporter)
+{
+	struct llvm_export_worker_s *worker = &(exporter->worker);
+	LLVM_ir_export object;
+	int started = 0;
+	int result;
+	int n;
+
+	pthread_mutex_lock(&(worker->lock));
+	worker->done = 1;
+	pthread_cond_broadcast(&(worker->ready));
+	pthread_mutex_unlock(&(worker->lock));
+	for (n = 0; n < exporter->threads; n++) {
+		if (exporter->started[n]) {
+			pthread_join(exporter->thread_id[n], NULL);
+			started++;
+		}
+	}
+	if (!started) {
+		/* No threads, so do them all here */
+		llvm_export_worker(&(exporter->thread[0]));
+	}
+	result = object.link_module(exporter->thread, exporter->threads, exporter->filename);
+	pthread_cond_destroy(&(worker->ready));
+	pthread_mutex_destroy(&(worker->lock));
+	delete [] exporter->thread;
+	free(exporter->thread_id);
+	free(exporter->started);
+	delete exporter;
+	return result;
+}
+
+/* All the functions in one .bc file, filename. See llvm_export_begin() */
+extern "C" int llvm_export_module(struct self_s *self, const char *filename, int threads, const char *passes)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct llvm_export_s *exporter;
+	int n;
+
+	exporter = llvm_export_begin(self, filename, threads, passes);
+	if (!exporter) {
+		return 1;
+	}
+	for (n = 0; n < EXTERNAL_ENTRY_POINTS_MAX; n++) {
+		if ((external_entry_points[n].valid != 0) &&
+			((external_entry_points[n].type == 1) || (external_entry_points[n].type == 3))) {
+			llvm_export_submit(exporter, n);
+		}
+	}
+	return llvm_export_end(exporter);
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Benchmark the same files as autotest.sh. Run ./compile first.
+# Not included: test20, test25 to test29, test31 and test32. They have no .c here,
+# ./compile does not build them, and they are commented out in autotest.sh.
+# ./benchmark.sh writes bench.json. Copy it to bench_baseline.json to make it the baseline,
+# after which a median or peak RSS more than 10% over the baseline makes this exit 1.
+if [ -f bench_baseline.json ]; then
+	BASELINE="--baseline=bench_baseline.json"
+fi
+../../test/bench --dis64=../../test/dis64 --runs=5 --threshold=10 $BASELINE "$@" \
+	test0.o test1.o test2.o test3.o test4.o test5.o test6.o test7.o \
+	test8.o test9.o test10.o test11.o test12.o test13.o test14.o test15.o \
+	test16.o test17.o test18.o test19.o test21.o test22.o test23.o \
+	test24.o test30.o test33.o test34.o test35.o test36.o test37.o \
+	test38.o test39.o test40.o test41.o test42.o test43.o test44.o \
+	test45.o test46.o test47.o test48.o test49.o test50.o test51.o \
+	test52.o test53.o test54.o test55.o test56.o test57.o test58.o \
+	test59.o test60.o test61.o test62.o test63.o test64.o test65.o \
+	test66.o test67.o test68.o test69.o test70.o test71.o test72.o \
+	test73.o test74.o test75.o test76.o test77.o test78.o test79.o \
+	test80.o test81.o
@@ -0,0 +1,123 @@
+#!/bin/sh
+# Generate and compile a synthetic input that grows along one axis.
+# Usage: gen_scale.sh shape size
+# Writes scale_<shape>_<size>.c and compiles it like ./compile does, to scale_<shape>_<size>.o
+# Shapes:
+#	functions	size functions, each calling the one before
+#	nest		if/else nested size deep
+#	ifs		size if/else one after another, 2^size paths
+#	switch		a switch of size cases, a jump table
+#	straight	size statements with no branches, a long inst log
+#	stack		size local variables, a big stack frame
+#	relocs		size calls to different external functions
+
+SHAPE=$1
+SIZE=$2
+if [ -z "$SHAPE" ] || [ -z "$SIZE" ] || [ "$SIZE" -lt 1 ]; then
+	echo "Usage: gen_scale.sh functions|nest|ifs|switch|straight|stack|relocs size"
+	exit 1
+fi
+NAME=scale_${SHAPE}_${SIZE}
+OUT=$NAME.c
+
+case $SHAPE in
+functions)
+	echo "int f0(int a) { return a + 1; }" > $OUT
+	n=1
+	while [ $n -lt $SIZE ]; do
+		echo "int f$n(int a) { return f$((n - 1))(a) * 3 + $n; }" >> $OUT
+		n=$((n + 1))
+	done
+	;;
+nest)
+	echo "int test(int a) {" > $OUT
+	echo "	int r = 0;" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	if (a > $n) { r += $n;" >> $OUT
+		n=$((n + 1))
+	done
+	while [ $n -gt 0 ]; do
+		n=$((n - 1))
+		echo "	} else { r -= $n; }" >> $OUT
+	done
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+ifs)
+	echo "int test(int a) {" > $OUT
+	echo "	int r = 0;" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	if (a & $((1 << (n % 30)))) { r += $n; } else { r -= $n; }" >> $OUT
+		n=$((n + 1))
+	done
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+switch)
+	echo "int test(int a) {" > $OUT
+	echo "	int r = 0;" >> $OUT
+	echo "	switch (a) {" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	case $n: r = a * $((n + 3)); break;" >> $OUT
+		n=$((n + 1))
+	done
+	echo "	default: r = -1; break;" >> $OUT
+	echo "	}" >> $OUT
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+straight)
+	echo "int test(int a) {" > $OUT
+	echo "	int r = a;" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	r = r * 3 + $n;" >> $OUT
+		n=$((n + 1))
+	done
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+stack)
+	echo "int test(int a) {" > $OUT
+	echo "	int r = 0;" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	int v$n = a + $n;" >> $OUT
+		n=$((n + 1))
+	done
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	r += v$n;" >> $OUT
+		n=$((n + 1))
+	done
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+relocs)
+	: > $OUT.tmp
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "extern int ext$n(int a);" >> $OUT.tmp
+		n=$((n + 1))
+	done
+	mv $OUT.tmp $OUT
+	echo "int test(int a) {" >> $OUT
+	echo "	int r = 0;" >> $OUT
+	n=0
+	while [ $n -lt $SIZE ]; do
+		echo "	r += ext$n(a);" >> $OUT
+		n=$((n + 1))
+	done
+	echo "	return r;" >> $OUT
+	echo "}" >> $OUT
+	;;
+*)
+	echo "gen_scale.sh: unknown shape $SHAPE"
+	exit 1
+	;;
+esac
+
+${CC:-gcc} -c -g -O0 -o $NAME.o $OUT
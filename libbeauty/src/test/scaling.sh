@@ -0,0 +1,46 @@
+#!/bin/sh
+# Scaling curves. For each shape, generate inputs of growing size with
+# gen_scale.sh, benchmark them, and write scaling_<shape>.txt with one line
+# per size and phase: size phase median_us p95_us rss_kb
+# Usage: scaling.sh [shape...]
+# SIZES, RUNS and TIMEOUT in the environment override the defaults.
+# Each shape has its own default sizes: ifs has 2^size paths, and nest grows
+# faster than the straight line shapes, so they stop sooner.
+# A bench that takes more than TIMEOUT seconds a run is stopped. It is recorded
+# as a "total" line with the cap as its median and p95, and "-" for rss_kb,
+# and the larger sizes of that shape are skipped.
+
+RUNS=${RUNS:-3}
+TIMEOUT=${TIMEOUT:-300}
+SHAPES=${*:-"functions nest ifs switch straight stack relocs"}
+CAP_US=$((TIMEOUT * 1000000))
+
+for SHAPE in $SHAPES; do
+	case $SHAPE in
+	ifs)
+		DEFAULT_SIZES="1 2 4 8 12 16 20"
+		;;
+	nest)
+		DEFAULT_SIZES="1 2 4 8 16 24 32"
+		;;
+	*)
+		DEFAULT_SIZES="1 2 4 8 16 32 64 128"
+		;;
+	esac
+	echo "size phase median_us p95_us rss_kb" > scaling_$SHAPE.txt
+	for SIZE in ${SIZES:-$DEFAULT_SIZES}; do
+		NAME=scale_${SHAPE}_${SIZE}
+		echo $NAME
+		./gen_scale.sh $SHAPE $SIZE || exit 1
+		timeout $((TIMEOUT * RUNS)) ../../test/bench --dis64=../../test/dis64 --runs=$RUNS --output=$NAME.json $NAME.o > /dev/null
+		if [ $? -eq 124 ]; then
+			echo "$NAME: over ${TIMEOUT}s a run, skipping the larger sizes"
+			echo "$SIZE total $CAP_US $CAP_US -" >> scaling_$SHAPE.txt
+			break
+		fi
+		sed -n 's/.*"phase": "\([^"]*\)".*"median_us": \([0-9]*\), "p95_us": \([0-9]*\), "rss_kb": \([0-9-]*\).*/\1 \2 \3 \4/p' $NAME.json |
+			while read PHASE MEDIAN P95 RSS; do
+				echo "$SIZE $PHASE $MEDIAN $P95 $RSS" >> scaling_$SHAPE.txt
+			done
+	done
+done
@@ -0,0 +1,364 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Benchmark driver for the regression corpus.
+ * Every .o file is run through dis64 --runs times, with --stats=json.
+ * dis64 keeps its state in globals and main(), so each run is a new process.
+ * The "total" row is the wall time and peak RSS of the whole run, from wait4().
+ * The other rows are the whole program records of each phase from the stats file.
+ * For every file and phase it prints the min, median and p95 of the wall time,
+ * and writes them, one row per line, to --output.
+ * With --baseline=file, a row whose median is more than --threshold percent
+ * over the baseline, or a peak RSS more than --threshold percent over, is a
+ * regression, and the exit code is 1. A missing baseline file only gets a warning.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_NAME_SIZE 64
+/* Phases faster than this are noise, whatever the percentage */
+#define BENCH_FLOOR_US 200
+
+struct bench_row_s {
+	char file[BENCH_NAME_SIZE];
+	char phase[BENCH_NAME_SIZE];
+	int size;		/* Runs seen, so far */
+	uint64_t *sample;	/* Wall time of each run, in us. Indexed by run */
+	long rss_kb;		/* Largest over the runs. Peak RSS for "total", the phase growth otherwise */
+	uint64_t min;
+	uint64_t median;
+	uint64_t p95;
+};
+
+struct bench_s {
+	int size;
+	int max;
+	struct bench_row_s *row;
+};
+
+static struct bench_row_s *bench_row(struct bench_s *bench, const char *file, const char *phase, int runs)
+{
+	struct bench_row_s *row;
+	int n;
+
+	for (n = 0; n < bench->size; n++) {
+		if (!strcmp(bench->row[n].file, file) && !strcmp(bench->row[n].phase, phase)) {
+			return &(bench->row[n]);
+		}
+	}
+	if (bench->size >= bench->max) {
+		bench->max = bench->max ? bench->max * 2 : 64;
+		bench->row = realloc(bench->row, bench->max * sizeof(struct bench_row_s));
+		if (!bench->row) {
+			printf("bench_row: realloc failed\n");
+			exit(1);
+		}
+	}
+	row = &(bench->row[bench->size]);
+	bench->size++;
+	memset(row, 0, sizeof(struct bench_row_s));
+	snprintf(row->file, BENCH_NAME_SIZE, "%s", file);
+	snprintf(row->phase, BENCH_NAME_SIZE, "%s", phase);
+	row->sample = calloc(runs, sizeof(uint64_t));
+	if (!row->sample) {
+		printf("bench_row: calloc failed\n");
+		exit(1);
+	}
+	return row;
+}
+
+static uint64_t bench_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Read the whole program phase records written by dis64 --stats=json.
+ * A phase recorded more than once in a run adds up, in the sample of that run.
+ */
+static int bench_read_stats(struct bench_s *bench, const char *file, const char *path, int run, int runs)
+{
+	struct bench_row_s *row;
+	char line[1024];
+	char phase[BENCH_NAME_SIZE];
+	uint64_t start_us;
+	uint64_t wall_us;
+	uint64_t cpu_us;
+	long rss_delta_kb;
+	FILE *stats;
+
+	stats = fopen(path, "r");
+	if (!stats) {
+		return 1;
+	}
+	while (fgets(line, sizeof(line), stats)) {
+		/* Function records have a "function" before "start_us", so do not match */
+		if (sscanf(line, " {\"phase\": \"%63[^\"]\", \"start_us\": %"SCNu64", \"wall_us\": %"SCNu64", \"cpu_us\": %"SCNu64", \"rss_delta_kb\": %ld",
+			phase, &start_us, &wall_us, &cpu_us, &rss_delta_kb) != 5) {
+			continue;
+		}
+		row = bench_row(bench, file, phase, runs);
+		row->sample[run] += wall_us;
+		if (row->size < run + 1) {
+			row->size = run + 1;
+		}
+		if (rss_delta_kb > row->rss_kb) {
+			row->rss_kb = rss_delta_kb;
+		}
+	}
+	fclose(stats);
+	return 0;
+}
+
+/* Returns 0 if dis64 finished. run is 0 to runs - 1 */
+static int bench_run(struct bench_s *bench, const char *dis64, const char *file, const char *stats_path, int run, int runs)
+{
+	struct bench_row_s *row;
+	struct rusage usage;
+	char stats_option[1024];
+	uint64_t start;
+	uint64_t end;
+	pid_t pid;
+	int status;
+	int fd;
+
+	snprintf(stats_option, sizeof(stats_option), "--stats=json:%s", stats_path);
+	unlink(stats_path);
+	start = bench_clock();
+	pid = fork();
+	if (pid < 0) {
+		printf("bench_run: fork failed\n");
+		return 1;
+	}
+	if (pid == 0) {
+		fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0) {
+			dup2(fd, 1);
+			dup2(fd, 2);
+			close(fd);
+		}
+		execl(dis64, "dis64", stats_option, file, (char *)NULL);
+		_exit(127);
+	}
+	if (wait4(pid, &status, 0, &usage) != pid) {
+		printf("bench_run: wait4 failed\n");
+		return 1;
+	}
+	end = bench_clock();
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		printf("%s: dis64 failed, status 0x%x\n", file, status);
+		return 1;
+	}
+	row = bench_row(bench, file, "total", runs);
+	row->sample[run] = end - start;
+	row->size = run + 1;
+	if (usage.ru_maxrss > row->rss_kb) {
+		row->rss_kb = usage.ru_maxrss;
+	}
+	if (bench_read_stats(bench, file, stats_path, run, runs)) {
+		printf("%s: no stats file %s\n", file, stats_path);
+		return 1;
+	}
+	return 0;
+}
+
+static int bench_sample_cmp(const void *a, const void *b)
+{
+	uint64_t sample_a = *(const uint64_t *)a;
+	uint64_t sample_b = *(const uint64_t *)b;
+
+	if (sample_a < sample_b) {
+		return -1;
+	}
+	return (sample_a > sample_b);
+}
+
+static int bench_summarise(struct bench_s *bench)
+{
+	struct bench_row_s *row;
+	int n;
+
+	for (n = 0; n < bench->size; n++) {
+		row = &(bench->row[n]);
+		if (!row->size) {
+			continue;
+		}
+		qsort(row->sample, row->size, sizeof(uint64_t), bench_sample_cmp);
+		row->min = row->sample[0];
+		row->median = row->sample[(row->size - 1) / 2];
+		/* Nearest rank */
+		row->p95 = row->sample[(row->size * 95 + 99) / 100 - 1];
+	}
+	return 0;
+}
+
+static int bench_write(struct bench_s *bench, const char *path)
+{
+	struct bench_row_s *row;
+	FILE *file;
+	int n;
+
+	file = fopen(path, "w");
+	if (!file) {
+		printf("bench_write: cannot create %s\n", path);
+		return 1;
+	}
+	fprintf(file, "{\"results\": [");
+	for (n = 0; n < bench->size; n++) {
+		row = &(bench->row[n]);
+		fprintf(file, "%s\n\t{\"file\": \"%s\", \"phase\": \"%s\", \"runs\": %d, \"min_us\": %"PRIu64", \"median_us\": %"PRIu64", \"p95_us\": %"PRIu64", \"rss_kb\": %ld}",
+			n ? "," : "", row->file, row->phase, row->size, row->min, row->median, row->p95, row->rss_kb);
+	}
+	fprintf(file, "\n]}\n");
+	if (fclose(file)) {
+		printf("bench_write: cannot write %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+/* Returns the number of regressions. No baseline file is no gate, so 0 */
+static int bench_compare(struct bench_s *bench, const char *path, int threshold)
+{
+	struct bench_row_s *row;
+	char line[1024];
+	char file[BENCH_NAME_SIZE];
+	char phase[BENCH_NAME_SIZE];
+	uint64_t min;
+	uint64_t median;
+	uint64_t p95;
+	long rss_kb;
+	int runs;
+	int regressions = 0;
+	int n;
+	FILE *baseline;
+
+	baseline = fopen(path, "r");
+	if (!baseline) {
+		printf("WARNING: no baseline %s, nothing to compare with\n", path);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), baseline)) {
+		if (sscanf(line, " {\"file\": \"%63[^\"]\", \"phase\": \"%63[^\"]\", \"runs\": %d, \"min_us\": %"SCNu64", \"median_us\": %"SCNu64", \"p95_us\": %"SCNu64", \"rss_kb\": %ld",
+			file, phase, &runs, &min, &median, &p95, &rss_kb) != 7) {
+			continue;
+		}
+		for (n = 0; n < bench->size; n++) {
+			if (!strcmp(bench->row[n].file, file) && !strcmp(bench->row[n].phase, phase)) {
+				break;
+			}
+		}
+		if (n == bench->size) {
+			continue;
+		}
+		row = &(bench->row[n]);
+		if ((row->median > median + BENCH_FLOOR_US) &&
+			(row->median * 100 > median * (100 + threshold))) {
+			printf("REGRESSION %s %s: median %"PRIu64"us, baseline %"PRIu64"us\n",
+				file, phase, row->median, median);
+			regressions++;
+		}
+		if (!strcmp(phase, "total") &&
+			(row->rss_kb * 100 > rss_kb * (100 + threshold))) {
+			printf("REGRESSION %s: peak RSS %ldKB, baseline %ldKB\n",
+				file, row->rss_kb, rss_kb);
+			regressions++;
+		}
+	}
+	fclose(baseline);
+	return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_s bench;
+	struct bench_row_s *row;
+	const char *dis64 = "./dis64";
+	const char *baseline_path = NULL;
+	const char *output_path = "bench.json";
+	char stats_path[64];
+	int threshold = 10;
+	int runs = 5;
+	int regressions = 0;
+	int failed = 0;
+	int run;
+	int n;
+
+	for (n = 1; n < argc; n++) {
+		if (!strncmp(argv[n], "--dis64=", 8)) {
+			dis64 = &argv[n][8];
+		} else if (!strncmp(argv[n], "--runs=", 7)) {
+			runs = atoi(&argv[n][7]);
+		} else if (!strncmp(argv[n], "--baseline=", 11)) {
+			baseline_path = &argv[n][11];
+		} else if (!strncmp(argv[n], "--threshold=", 12)) {
+			threshold = atoi(&argv[n][12]);
+		} else if (!strncmp(argv[n], "--output=", 9)) {
+			output_path = &argv[n][9];
+		} else {
+			break;
+		}
+	}
+	if ((n >= argc) || (runs < 1) || (threshold < 0)) {
+		printf("Usage: bench [--dis64=path] [--runs=5] [--baseline=file] [--threshold=10] [--output=bench.json] file.o...\n");
+		printf("Runs dis64 on each file and reports the min, median and p95 time of each phase\n");
+		printf("With --baseline, exits 1 if a median or the peak RSS is over the baseline by more than threshold percent\n");
+		exit(1);
+	}
+	memset(&bench, 0, sizeof(bench));
+	snprintf(stats_path, sizeof(stats_path), "bench_stats_%d.json", (int)getpid());
+	for (; n < argc; n++) {
+		for (run = 0; run < runs; run++) {
+			if (bench_run(&bench, dis64, argv[n], stats_path, run, runs)) {
+				failed++;
+				break;
+			}
+		}
+	}
+	unlink(stats_path);
+	bench_summarise(&bench);
+
+	printf("%-20s %-20s %10s %10s %10s %10s\n", "file", "phase", "min_us", "median_us", "p95_us", "rss_kb");
+	for (n = 0; n < bench.size; n++) {
+		row = &(bench.row[n]);
+		printf("%-20s %-20s %10"PRIu64" %10"PRIu64" %10"PRIu64" %10ld\n",
+			row->file, row->phase, row->min, row->median, row->p95, row->rss_kb);
+	}
+	bench_write(&bench, output_path);
+	if (baseline_path) {
+		regressions = bench_compare(&bench, baseline_path, threshold);
+		printf("0x%x regressions over %d%%\n", regressions, threshold);
+	}
+	for (n = 0; n < bench.size; n++) {
+		free(bench.row[n].sample);
+	}
+	free(bench.row);
+	return (regressions || failed) ? 1 : 0;
+}
@@ -47,10 +47,12 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <rev.h>
 #include <llvm-c/Disassembler.h>
@@ -72,78 +74,234 @@ size_t rodata_size = 0;
 char *dis_flags_table[] = { " ", "f" };
 uint64_t inst_log = 1;	/* Pointer to the current free instruction log entry. */
 
-/* debug: 0 = no debug output. >= 1 is more debug output */
-int debug_dis64 = 1;
-int debug_input_bfd = 1;
-int debug_input_dis = 1;
-int debug_exe = 1;
-int debug_analyse = 1;
-int debug_analyse_paths = 1;
-int debug_analyse_phi = 1;
-int debug_output = 1;
-
-void debug_print(int module, int level, const char *format, ...)
+/* debug: 0 = no debug output. >= 1 is more debug output. Indexed by DEBUG_MAIN etc. */
+int debug_level[DEBUG_MODULE_MAX] = {
+	0,
+	1,	/* DEBUG_MAIN */
+	1,	/* DEBUG_INPUT_BFD */
+	1,	/* DEBUG_INPUT_DIS */
+	1,	/* DEBUG_OUTPUT */
+	1,	/* DEBUG_EXE */
+	1,	/* DEBUG_ANALYSE */
+	1,	/* DEBUG_ANALYSE_PATHS */
+	1,	/* DEBUG_ANALYSE_PHI */
+};
+
+static const char *debug_module_name[DEBUG_MODULE_MAX] = {
+	NULL,
+	"DEBUG_MAIN",
+	"DEBUG_INPUT_BFD",
+	"DEBUG_INPUT_DIS",
+	"DEBUG_OUTPUT",
+	"DEBUG_EXE",
+	"DEBUG_ANALYSE",
+	"DEBUG_ANALYSE_PATHS",
+	"DEBUG_ANALYSE_PHI",
+};
+
+/* Asynchronous debug output, turned on by --debug-async.
+ * debug_print_out() formats each message into the ring and returns,
+ * and debug_ring_worker() writes the ring out to stderr.
+ * A writer only waits if the ring is full, so nothing is dropped.
+ */
+#define DEBUG_RING_SIZE 0x100000	/* Power of 2 */
+#define DEBUG_LINE_SIZE 0x1000
+
+struct debug_ring_s {
+	char *buffer;
+	size_t head;	/* Bytes written so far. & (DEBUG_RING_SIZE - 1) for the offset */
+	size_t tail;	/* Bytes written out so far */
+	int running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+static struct debug_ring_s debug_ring;
+
+static void *debug_ring_worker(void *arg)
 {
-	va_list ap;
-	va_start(ap, format);
-	switch (module) {
-	case DEBUG_MAIN:
-		if (level <= debug_dis64) {
-			dprintf(STDERR_FILENO, "DEBUG_MAIN,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
-		}
-		break;
-	case DEBUG_INPUT_BFD:
-		if (level <= debug_input_bfd) {
-			dprintf(STDERR_FILENO, "DEBUG_INPUT_BFD,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+	size_t head;
+	size_t tail;
+	size_t offset;
+	size_t size;
+	ssize_t written;
+
+	pthread_mutex_lock(&debug_ring.lock);
+	while (1) {
+		while (debug_ring.running && (debug_ring.head == debug_ring.tail)) {
+			pthread_cond_wait(&debug_ring.not_empty, &debug_ring.lock);
 		}
-		break;
-	case DEBUG_INPUT_DIS:
-		if (level <= debug_input_dis) {
-			dprintf(STDERR_FILENO, "DEBUG_INPUT_DIS,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		if (debug_ring.head == debug_ring.tail) {
+			/* Stopped, and all written out */
+			break;
 		}
-		break;
-	case DEBUG_EXE:
-		if (level <= debug_exe) {
-			dprintf(STDERR_FILENO, "DEBUG_EXE,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		head = debug_ring.head;
+		tail = debug_ring.tail;
+		/* Writers only add after head, so tail to head can be written out unlocked */
+		pthread_mutex_unlock(&debug_ring.lock);
+		while (tail < head) {
+			offset = tail & (DEBUG_RING_SIZE - 1);
+			size = head - tail;
+			if (size > DEBUG_RING_SIZE - offset) {
+				size = DEBUG_RING_SIZE - offset;
+			}
+			written = write(STDERR_FILENO, &(debug_ring.buffer[offset]), size);
+			if (written <= 0) {
+				/* Nowhere to report it. Skip it */
+				written = size;
+			}
+			tail += written;
 		}
-		break;
-	case DEBUG_ANALYSE:
-		if (level <= debug_analyse) {
-			dprintf(STDERR_FILENO, "DEBUG_ANALYSE,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		pthread_mutex_lock(&debug_ring.lock);
+		debug_ring.tail = tail;
+		pthread_cond_broadcast(&debug_ring.not_full);
+	}
+	pthread_mutex_unlock(&debug_ring.lock);
+	return NULL;
+}
+
+static void debug_ring_write(const char *line, size_t size)
+{
+	size_t offset;
+	size_t length;
+
+	pthread_mutex_lock(&debug_ring.lock);
+	while ((DEBUG_RING_SIZE - (debug_ring.head - debug_ring.tail)) < size) {
+		pthread_cond_wait(&debug_ring.not_full, &debug_ring.lock);
+	}
+	while (size) {
+		offset = debug_ring.head & (DEBUG_RING_SIZE - 1);
+		length = size;
+		if (length > DEBUG_RING_SIZE - offset) {
+			length = DEBUG_RING_SIZE - offset;
+		}
+		memcpy(&(debug_ring.buffer[offset]), line, length);
+		debug_ring.head += length;
+		line += length;
+		size -= length;
+	}
+	pthread_cond_signal(&debug_ring.not_empty);
+	pthread_mutex_unlock(&debug_ring.lock);
+}
+
+/* Writes out what is left in the ring. Registered with atexit() */
+void debug_ring_stop(void)
+{
+	if (!debug_ring.running) {
+		return;
+	}
+	pthread_mutex_lock(&debug_ring.lock);
+	debug_ring.running = 0;
+	pthread_cond_signal(&debug_ring.not_empty);
+	pthread_mutex_unlock(&debug_ring.lock);
+	pthread_join(debug_ring.thread, NULL);
+	free(debug_ring.buffer);
+	debug_ring.buffer = NULL;
+}
+
+int debug_ring_start(void)
+{
+	if (debug_ring.running) {
+		return 0;
+	}
+	debug_ring.buffer = malloc(DEBUG_RING_SIZE);
+	if (!debug_ring.buffer) {
+		return 1;
+	}
+	debug_ring.head = 0;
+	debug_ring.tail = 0;
+	pthread_mutex_init(&debug_ring.lock, NULL);
+	pthread_cond_init(&debug_ring.not_empty, NULL);
+	pthread_cond_init(&debug_ring.not_full, NULL);
+	debug_ring.running = 1;
+	if (pthread_create(&debug_ring.thread, NULL, debug_ring_worker, NULL)) {
+		debug_ring.running = 0;
+		free(debug_ring.buffer);
+		debug_ring.buffer = NULL;
+		return 1;
+	}
+	atexit(debug_ring_stop);
+	return 0;
+}
+
+/* list is module:level[,module:level...]. module is the name without DEBUG_,
+ * in either case, or "all". E.g. "all:0,analyse:1"
+ */
+int debug_level_parse(const char *list)
+{
+	const char *name = list;
+	char *end;
+	size_t length;
+	int level;
+	int module;
+
+	while (*name) {
+		length = strcspn(name, ":");
+		if (name[length] != ':') {
+			return 1;
 		}
-		break;
-	case DEBUG_ANALYSE_PATHS:
-		if (level <= debug_analyse_paths) {
-			dprintf(STDERR_FILENO, "DEBUG_ANALYSE_PATHS,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		level = strtol(&name[length + 1], &end, 0);
+		if ((end == &name[length + 1]) || ((*end != ',') && (*end != 0))) {
+			return 1;
 		}
-		break;
-	case DEBUG_ANALYSE_PHI:
-		if (level <= debug_analyse_phi) {
-			dprintf(STDERR_FILENO, "DEBUG_ANALYSE_PHI,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		if ((length == 3) && !strncasecmp(name, "all", 3)) {
+			for (module = 1; module < DEBUG_MODULE_MAX; module++) {
+				debug_level[module] = level;
+			}
+		} else {
+			for (module = 1; module < DEBUG_MODULE_MAX; module++) {
+				if ((strlen(debug_module_name[module]) == length + 6) &&
+					!strncasecmp(&debug_module_name[module][6], name, length)) {
+					break;
+				}
+			}
+			if (module >= DEBUG_MODULE_MAX) {
+				return 1;
+			}
+			debug_level[module] = level;
 		}
-		break;
-	case DEBUG_OUTPUT:
-		if (level <= debug_output) {
-			dprintf(STDERR_FILENO, "DEBUG_OUTPUT,0x%x:", level);
-			vdprintf(STDERR_FILENO, format, ap);
+		name = end;
+		if (*name == ',') {
+			name++;
 		}
-		break;
-	default:
+	}
+	return 0;
+}
+
+/* Only reached through the debug_print() macro, once the level has been checked */
+void debug_print_out(int module, int level, const char *format, ...)
+{
+	char line[DEBUG_LINE_SIZE];
+	va_list ap;
+	int size;
+	int tmp;
+
+	if ((module <= 0) || (module >= DEBUG_MODULE_MAX)) {
 		printf("DEBUG Failed: Module 0x%x\n", module);
 		exit(1);
-		break;
 	}
+	va_start(ap, format);
+	if (!debug_ring.running) {
+		dprintf(STDERR_FILENO, "%s,0x%x:", debug_module_name[module], level);
+		vdprintf(STDERR_FILENO, format, ap);
+		va_end(ap);
+		return;
+	}
+	size = snprintf(line, DEBUG_LINE_SIZE, "%s,0x%x:", debug_module_name[module], level);
+	tmp = vsnprintf(&line[size], DEBUG_LINE_SIZE - size, format, ap);
 	va_end(ap);
+	if (tmp > 0) {
+		size += tmp;
+	}
+	if (size >= DEBUG_LINE_SIZE) {
+		/* Truncated */
+		size = DEBUG_LINE_SIZE - 1;
+	}
+	debug_ring_write(line, size);
 }
 
-#define AST_SIZE 300
 /* Params order:
  * int test30(int64_t param_reg0040, int64_t param_reg0038, int64_t param_reg0018, int64_t param_reg0010, int64_t param_reg0050, int64_t param_reg0058, int64_t param_stack0008, int64_t param_stack0010)
  */
@@ -153,12 +311,7 @@ void debug_print(int module, int level, const char *format, ...)
  * so that a single list can store all program flow.
  */
 // struct inst_log_entry_s inst_log_entry[INST_LOG_ENTRY_SIZE];
-// int search_back_seen[INST_LOG_ENTRY_SIZE];
 
-/* Used to keep record of where we have been before.
- * Used to identify program flow, branches, and joins.
- */
-int memory_used[MEMORY_USED_SIZE];
 /* Used to keep a non bfd version of the relocation entries */
 int memory_relocation[MEMORY_USED_SIZE];
 
@@ -516,8 +669,11 @@ int external_entry_points_init(struct external_entry_point_s *external_entry_poi
 				calloc(MEMORY_REG_SIZE, sizeof(struct memory_s));
 			external_entry_points[n].process_state.memory_data =
 				calloc(MEMORY_DATA_SIZE, sizeof(struct memory_s));
+			/* Used to keep record of where we have been before.
+			 * Used to identify program flow, branches, and joins.
+			 */
 			external_entry_points[n].process_state.memory_used =
-				calloc(MEMORY_USED_SIZE, sizeof(int));
+				memory_used_init(bf_get_code_size(handle_void));
 			//memory_text = external_entry_points[n].process_state.memory_text;
 			memory_stack = external_entry_points[n].process_state.memory_stack;
 			memory_reg = external_entry_points[n].process_state.memory_reg;
@@ -537,22 +693,6 @@ int external_entry_points_init(struct external_entry_point_s *external_entry_poi
 	return tmp;
 }
 
-int find_empty_ast_entry(struct ast_entry_s *ast_entry, int *entry)
-{
-	int found;
-	int n;
-
-	found = 0;
-	for (n = 0; n < 100; n++) {
-		if (!ast_entry[n].type) {
-			found = 1;
-			*entry = n;
-			break;
-		}
-	}
-	return found;
-}
-
 int print_ast_container(struct ast_container_s *ast_container)
 {
 	int n;
@@ -574,586 +714,6 @@ int print_ast_container(struct ast_container_s *ast_container)
 	return 0;
 }
 
-int is_member_of_loop(struct control_flow_node_s *nodes, int loop_node, int test_node) {
-	int n;
-	int found = 0;
-
-	for (n = 0; n < nodes[test_node].member_of_loop_size; n++) {
-		if (loop_node == nodes[test_node].member_of_loop[n]) {
-			found = 1;
-			break;
-		}
-	}
-	return found;
-}
-
-/* Convert Control flow graph to Abstract syntax tree */
-/* One list with just a list of Type, Index pairs.
- * The Type will be one of:
- *	Node: A particular Node
- *	Container: For another list of types. Type, Index pairs.
- *	If: For a if...then...else contruct. Contains the Node for the if expression, then Containers for True, and False paths.
- *	Loop: For a loop contruct. A loop has First Node, and Subsequent Nodes in the loop body.
- *		Later Loop will be converted to for() or while().
- */
-int cfg_to_ast(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size, struct ast_s *ast, int start_node)
-{
-	struct ast_container_s *ast_container;
-	struct ast_if_then_else_s *ast_if_then_else;
-	struct ast_if_then_goto_s *ast_if_then_goto;
-	struct ast_loop_s *ast_loop;
-	struct ast_loop_then_else_s *ast_loop_then_else;
-	struct ast_loop_container_s *ast_loop_container;
-	struct ast_entry_s *ast_entry;
-	int found;
-	int n;
-	//int m;
-	int entry;
-	int type;
-	int node;
-	int node_end;
-	int container_index = 0;
-	int if_then_else_index = 0;
-	int if_then_goto_index = 0;
-	int loop_index = 0;
-	int loop_then_else_index = 0;
-	int loop_container_index = 0;
-	int index;
-	int length;
-	int tmp;
-	int tmp_entry = 0;
-	int link_goto = 0;
-	int link_norm = 1;
-	int ret = 0;
-
-	ast_container = ast->ast_container;
-	ast_if_then_else = ast->ast_if_then_else;
-	ast_if_then_goto = ast->ast_if_then_goto;
-	ast_loop = ast->ast_loop;
-	ast_loop_then_else = ast->ast_loop_then_else;
-	ast_loop_container = ast->ast_loop_container;
-	ast_entry = ast->ast_entry;
-	container_index = ast->container_size;
-	if_then_else_index = ast->if_then_else_size;
-	if_then_goto_index = ast->if_then_goto_size;
-	loop_index = ast->loop_size;
-	loop_then_else_index = ast->loop_then_else_size;
-	loop_container_index = ast->loop_container_size;
-
-	ast_entry[0].type = AST_TYPE_CONTAINER;
-	ast_entry[0].sub_type = 0; /* for normal container */
-	ast_entry[0].index = container_index;
-	ast_entry[0].sub_index = 0;
-	ast_entry[0].node = start_node;
-	ast_entry[0].node_end = 0;
-	if (container_index >= AST_SIZE) { 
-		debug_print(DEBUG_MAIN, 1, "container_index too large 0\n");
-		ret = 1;
-		goto exit_cfg_to_ast;
-	}
-	ast->ast_container[container_index].start_node = start_node;
-	container_index++;
-	if (container_index >= AST_SIZE) { 
-		debug_print(DEBUG_MAIN, 1, "container_index too large 0\n");
-		ret = 1;
-		goto exit_cfg_to_ast;
-	}
-
-	do {
-		found = 0;
-		for (n = 0; n < AST_SIZE; n++) {
-			if (ast_entry[n].type) {
-				found = 1;
-				entry = n;
-				break;
-			}
-		}
-		if (!found) {
-			break;
-		}
-		debug_print(DEBUG_MAIN, 1, "BEFORE ast_entry entry = 0x%x\n", entry);
-		debug_print(DEBUG_MAIN, 1, "ast_type = 0x%x\n", ast_entry[entry].type);
-		debug_print(DEBUG_MAIN, 1, "ast_index = 0x%x\n", ast_entry[entry].index);
-		debug_print(DEBUG_MAIN, 1, "ast_sub_index = 0x%x\n", ast_entry[entry].sub_index);
-		debug_print(DEBUG_MAIN, 1, "ast_node = 0x%x\n", ast_entry[entry].node);
-		debug_print(DEBUG_MAIN, 1, "ast_node_end = 0x%x\n", ast_entry[entry].node_end);
-
-		node = ast_entry[entry].node;
-		node_end = ast_entry[entry].node_end;
-		type = AST_TYPE_EMPTY;
-		if (nodes[node].type == NODE_TYPE_IF_THEN_ELSE) {
-			type = AST_TYPE_IF_THEN_ELSE;
-		} else if (nodes[node].type == NODE_TYPE_IF_THEN_GOTO) {
-			type = AST_TYPE_IF_THEN_GOTO;
-		} else if (nodes[node].type == NODE_TYPE_LOOP) {
-			type = AST_TYPE_LOOP;
-		} else if (nodes[node].type == NODE_TYPE_LOOP_THEN_ELSE) {
-			type = AST_TYPE_LOOP_THEN_ELSE;
-		} else {
-			type = AST_TYPE_NODE;
-		};
-		debug_print(DEBUG_MAIN, 1, "new_node_end = 0x%x\n", node_end);
-		debug_print(DEBUG_MAIN, 1, "AST: Type = 0x%x\n", type);
-		switch (type) {
-		case AST_TYPE_IF_THEN_ELSE:
-			index = ast_entry[entry].index;
-			if (ast_entry[entry].type != AST_TYPE_CONTAINER) {
-				debug_print(DEBUG_MAIN, 1, "failed type != 2\n");
-				exit(1);
-			}
-			length = ast_container[index].length;
-			if (0 == length) {
-				ast_container[index].object = malloc(sizeof(struct ast_type_index_s));
-				ast_container[index].length = 1;
-			} else {
-				tmp = length + 1;
-				ast_container[index].object = realloc(ast_container[index].object, tmp * sizeof(struct ast_type_index_s));
-				ast_container[index].length = tmp;
-			}
-			ast_container[index].object[length].type = type;
-			ast_container[index].object[length].index = if_then_else_index;
-			ast_if_then_else[if_then_else_index].expression_node.type = AST_TYPE_NODE;
-			ast_if_then_else[if_then_else_index].expression_node.index = node;
-			/* Handle the if_then path */
-			if (!(nodes[node].next_size)) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[0].node == nodes[node].if_tail) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[0].is_loop_edge) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "Creating if_then container 0x%x\n", container_index);
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_CONTAINER;
-				ast_if_then_else[if_then_else_index].if_then.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[0].node;
-				ast_entry[tmp_entry].node_end = nodes[node].if_tail;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 1\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			/* Handle the if_else path */
-			if (!(nodes[node].next_size)) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[1].node == nodes[node].if_tail) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[1].is_loop_edge) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "Creating if_else container 0x%x\n", container_index);
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_CONTAINER;
-				ast_if_then_else[if_then_else_index].if_else.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[1].node;
-				ast_entry[tmp_entry].node_end = nodes[node].if_tail;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 2\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-
-			if (nodes[node].if_tail == ast_entry[entry].node_end) {
-				ast_entry[entry].type = AST_TYPE_EMPTY;
-			} else {
-				ast_entry[entry].sub_index = ast_container[index].length;
-				ast_entry[entry].node = nodes[node].if_tail;
-			}
-
-			if_then_else_index++;
-			if (if_then_else_index >= AST_SIZE) {
-				debug_print(DEBUG_MAIN, 1, "if_then_else_index too large\n");
-				ret = 1;
-				goto exit_cfg_to_ast;
-			}
-			break;
-		case AST_TYPE_IF_THEN_GOTO:
-			index = ast_entry[entry].index;
-			if (ast_entry[entry].type != AST_TYPE_CONTAINER) {
-				debug_print(DEBUG_MAIN, 1, "AST_TYPE_IF_THEN_GOTO:failed type != 2\n");
-				exit(1);
-			}
-			length = ast_container[index].length;
-			if (0 == length) {
-				ast_container[index].object = malloc(sizeof(struct ast_type_index_s));
-				ast_container[index].length = 1;
-			} else {
-				tmp = length + 1;
-				ast_container[index].object = realloc(ast_container[index].object, tmp * sizeof(struct ast_type_index_s));
-				ast_container[index].length = tmp;
-			}
-			ast_container[index].object[length].type = type;
-			ast_container[index].object[length].index = if_then_goto_index;
-			ast_if_then_goto[if_then_goto_index].parent.type = AST_TYPE_CONTAINER;
-			ast_if_then_goto[if_then_goto_index].parent.index = index;
-			ast_if_then_goto[if_then_goto_index].parent.offset = length; /* Point to the parent that points to us */
-
-			ast_if_then_goto[if_then_goto_index].expression_node.type = AST_TYPE_NODE;
-			ast_if_then_goto[if_then_goto_index].expression_node.index = node;
-
-			if (nodes[node].link_next[0].is_loop_exit) {
-				link_goto = 0;
-				link_norm = 1;
-			} else if (nodes[node].link_next[1].is_loop_exit) {
-				link_goto = 1;
-				link_norm = 0;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "FAILED: No is_exit entry in IF_THEN_GOTO\n");
-				exit(1);
-			}
-			/* Only handle the is_exit path.
-			 * There is not "else" path with a if_then_goto
-			 */
-			if (!(nodes[node].next_size)) {
-				ast_if_then_goto[if_then_goto_index].if_then_goto.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[link_goto].node == nodes[node].if_tail) {
-				ast_if_then_goto[if_then_goto_index].if_then_goto.type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "Creating if_then container 0x%x\n", container_index);
-				ast_if_then_goto[if_then_goto_index].if_then_goto.type = AST_TYPE_CONTAINER;
-				ast_if_then_goto[if_then_goto_index].if_then_goto.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[link_goto].node;
-				ast_entry[tmp_entry].node_end = nodes[node].if_tail;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 3\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			/* FIXME: Fix case where link_norm is a loop edge, and link_goto does not exit the loop */
-			ast_entry[entry].sub_index = ast_container[index].length;
-			ast_entry[entry].node = nodes[node].link_next[link_norm].node;
-			if (ast_entry[entry].sub_type == 1) {
-				if (!is_member_of_loop(nodes, node, ast_entry[entry].node)) {
-					int exit_index = ast_entry[entry].index;
-					debug_print(DEBUG_MAIN, 1, "parent = 0x%x, 0x%"PRIx64", 0x%x\n",
-						ast_container[ast_entry[entry].index].parent.type,
-						ast_container[ast_entry[entry].index].parent.index,
-						ast_container[ast_entry[entry].index].parent.offset);
-					ast_entry[entry].type = ast_container[exit_index].parent.type;
-					ast_entry[entry].sub_type = ast_container[exit_index].sub_type;
-					ast_entry[entry].index = ast_container[exit_index].parent.index;
-					ast_entry[entry].sub_index = ast_container[exit_index].parent.offset;
-					ast_entry[entry].node = nodes[node].link_next[link_goto].node;
-					ast_entry[entry].node_end = ast_container[exit_index].length;
-				}
-			} else if (ast_entry[entry].node == ast_entry[entry].node_end) {
-				ast_entry[entry].type = AST_TYPE_EMPTY;
-			}
-
-			if_then_goto_index++;
-			if (if_then_goto_index >= AST_SIZE) {
-				debug_print(DEBUG_MAIN, 1, "if_then_goto_index too large\n");
-				ret = 1;
-				goto exit_cfg_to_ast;
-			}
-			break;
-		case AST_TYPE_NODE:
-			index = ast_entry[entry].index;
-			if (ast_entry[entry].type != AST_TYPE_CONTAINER) {
-				debug_print(DEBUG_MAIN, 1, "AST_TYPE_NODE failed type != 2\n");
-				exit(1);
-			}
-			length = ast_container[index].length;
-			if (0 == length) {
-				ast_container[index].object = malloc(sizeof(struct ast_type_index_s));
-				ast_container[index].length = 1;
-			} else {
-				tmp = length + 1;
-				ast_container[index].object = realloc(ast_container[index].object, tmp * sizeof(struct ast_type_index_s));
-				ast_container[index].length = tmp;
-			}
-			ast_container[index].object[length].type = type;
-			ast_container[index].object[length].index = node;
-			if (nodes[node].next_size > 0) {
-				ast_entry[entry].sub_index = ast_container[index].length;
-				ast_entry[entry].node = nodes[node].link_next[0].node;
-				if (ast_entry[entry].node == ast_entry[entry].node_end) {
-					ast_entry[entry].type = AST_TYPE_EMPTY;
-				}
-			} else {
-				ast_entry[entry].type = AST_TYPE_EMPTY;
-			}
-			break;
-		case AST_TYPE_LOOP:
-			/* node_end will == loop_head node. */
-			/* This is valid no matter how many loop edges there are */
-			debug_print(DEBUG_MAIN, 1, "AST_TYPE_LOOP type = 0x%x, node = 0x%x\n", type, node);
-			index = ast_entry[entry].index;
-			if (ast_entry[entry].type != AST_TYPE_CONTAINER) {
-				debug_print(DEBUG_MAIN, 1, "failed type != 2\n");
-				exit(1);
-			}
-			ast_loop[loop_index].first_node.type = AST_TYPE_NODE;
-			ast_loop[loop_index].first_node.index = node;
-			length = ast_container[index].length;
-			if (0 == length) {
-				ast_container[index].object = malloc(sizeof(struct ast_type_index_s));
-				ast_container[index].length = 1;
-			} else {
-				tmp = length + 1;
-				ast_container[index].object = realloc(ast_container[index].object, tmp * sizeof(struct ast_type_index_s));
-				ast_container[index].length = tmp;
-			}
-			ast_container[index].object[length].type = type;
-			ast_container[index].object[length].index = loop_index;
-			//ast_loop[loop_index].expression_node.type = AST_TYPE_NODE;
-			//ast_loop[loop_index].expression_node.index = node;
-			/* Default to an empty body. This covers the edge to self case */
-			ast_loop[loop_index].body.type = AST_TYPE_EMPTY;
-			ast_loop[loop_index].body.index = 0;
-
-			if (nodes[node].link_next[0].is_normal) {
-				debug_print(DEBUG_MAIN, 1, "Creating loop container 0x%x\n", container_index);
-				ast_loop[loop_index].body.type = AST_TYPE_CONTAINER;
-				ast_loop[loop_index].body.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[0].node;
-				ast_entry[tmp_entry].node_end = node;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 4\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			if (nodes[node].link_next[1].is_normal) {
-				debug_print(DEBUG_MAIN, 1, "Creating loop container 0x%x\n", container_index);
-				ast_loop[loop_index].body.type = AST_TYPE_CONTAINER;
-				ast_loop[loop_index].body.index = container_index;
-				/* FIXME: Only add this if the container first node != if_tail */
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[1].node;
-				ast_entry[tmp_entry].node_end = node;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 5 node = 0x%x, if_tail = 0x%x\n", node, nodes[node].if_tail);
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			ast_entry[entry].sub_index = ast_container[index].length;
-			ast_entry[entry].node = nodes[node].if_tail;
-
-			loop_index++;
-			if (loop_index >= AST_SIZE) { 
-				debug_print(DEBUG_MAIN, 1, "loop_index too large\n");
-				ret = 1;
-				goto exit_cfg_to_ast;
-			}
-			break;
-		case AST_TYPE_LOOP_THEN_ELSE:
-			/* FIXME: Need to expand this into two containers.
-			 *	A LOOP Container and an if_then_else container.
-			 */
-			index = ast_entry[entry].index;
-			if (ast_entry[entry].type != AST_TYPE_CONTAINER) {
-				debug_print(DEBUG_MAIN, 1, "failed type != 2\n");
-				exit(1);
-			}
-			length = ast_container[index].length;
-			if (0 == length) {
-				ast_container[index].object = malloc(sizeof(struct ast_type_index_s));
-				ast_container[index].length = 1;
-				debug_print(DEBUG_MAIN, 1, "Add object 0x%x to container 0x%x\n", ast_container[index].length - 1, index);
-			} else {
-				tmp = length + 1;
-				ast_container[index].object = realloc(ast_container[index].object, tmp * sizeof(struct ast_type_index_s));
-				ast_container[index].length = tmp;
-				debug_print(DEBUG_MAIN, 1, "Add object 0x%x to container 0x%x\n", ast_container[index].length - 1, index);
-			}
-			/* Create two containers. The loop_container, and inside the loop_container, the if_then_else */
-			ast_container[index].object[length].type = AST_TYPE_CONTAINER;
-			ast_container[index].object[length].index = container_index;
-			debug_print(DEBUG_MAIN, 1, "ast_container[0x%x].object[0x%x] set to AST_TYPE_CONTAINER and index = 0x%x\n",
-				index, length, container_index);
-			debug_print(DEBUG_MAIN, 1, "JCD: container_index 0x%x, index 0x%x, length 0x%x  container_length 0x%x\n",
-				container_index, index, length, ast_container[index].length);
-			ast_container[index + 1].object = malloc(sizeof(struct ast_type_index_s));
-			ast_container[index + 1].length = 1;
-			debug_print(DEBUG_MAIN, 1, "Add object 0x%x to container 0x%x\n", ast_container[index + 1].length - 1, index + 1);
-			ast_container[index + 1].object[0].type = AST_TYPE_IF_THEN_ELSE;
-			ast_container[index + 1].sub_type = 1;
-			ast_container[index + 1].object[0].index = if_then_else_index;
-			ast_container[index + 1].length = 1;
-			ast_container[index + 1].start_node = node;
-			ast_container[index + 1].parent.type = AST_TYPE_CONTAINER;
-			ast_container[index + 1].parent.index = index;
-			ast_container[index + 1].parent.offset = length; /* Point to the parent that points to us */
-			debug_print(DEBUG_MAIN, 1, "ast_container[0x%x].object[0x%x] set to AST_TYPE_IF_THEN_ELSE and index = 0x%x\n",
-				index + 1, 0, if_then_else_index);
-			debug_print(DEBUG_MAIN, 1, "ast_container[0x%x].parent set to AST_TYPE_CONTAINER, 0x%x, 0x%x\n",
-				index + 1, index, ast_container[index].length);
-			container_index++;
-			if (container_index >= AST_SIZE) { 
-				debug_print(DEBUG_MAIN, 1, "container_index too large 2\n");
-				ret = 1;
-				goto exit_cfg_to_ast;
-			}
-			ast_if_then_else[if_then_else_index].parent.type = AST_TYPE_CONTAINER;
-			ast_if_then_else[if_then_else_index].parent.index = index + 1 ;
-			ast_if_then_else[if_then_else_index].parent.offset = 0; /* Point to the parent that points to us */
-			ast_if_then_else[if_then_else_index].expression_node.type = AST_TYPE_NODE;
-			ast_if_then_else[if_then_else_index].expression_node.index = node;
-			/* Handle the loop_then path */
-			if (!(nodes[node].next_size)) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[0].node == nodes[node].if_tail) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[0].is_loop_edge) {
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "Creating loop_then container 0x%x\n", container_index);
-				ast_if_then_else[if_then_else_index].if_then.type = AST_TYPE_CONTAINER;
-				ast_if_then_else[if_then_else_index].if_then.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[0].node;
-				ast_entry[tmp_entry].node_end = nodes[node].if_tail;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 3\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			/* Handle the loop_else path */
-			if (!(nodes[node].next_size)) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[1].node == nodes[node].if_tail) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else if (nodes[node].link_next[1].is_loop_edge) {
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "Creating loop_else container 0x%x\n", container_index);
-				ast_if_then_else[if_then_else_index].if_else.type = AST_TYPE_CONTAINER;
-				ast_if_then_else[if_then_else_index].if_else.index = container_index;
-				tmp = find_empty_ast_entry(ast_entry, &tmp_entry);
-				ast_entry[tmp_entry].type = AST_TYPE_CONTAINER;
-				ast_entry[tmp_entry].sub_type = 0; /* for normal container */
-				ast_entry[tmp_entry].index = container_index;
-				ast_entry[tmp_entry].sub_index = 0;
-				ast_entry[tmp_entry].node = nodes[node].link_next[1].node;
-				ast_entry[tmp_entry].node_end = nodes[node].if_tail;
-				container_index++;
-				if (container_index >= AST_SIZE) { 
-					debug_print(DEBUG_MAIN, 1, "container_index too large 2\n");
-					ret = 1;
-					goto exit_cfg_to_ast;
-				}
-			}
-			if (!is_member_of_loop(nodes, node, nodes[node].if_tail)) {
-//			if (nodes[node].if_tail == ast_entry[entry].node_end) {
-				debug_print(DEBUG_MAIN, 1, "JCD: loop_container_node NOT 0x%x, 0x%x\n", node, nodes[node].if_tail);
-				ast_entry[entry].type = AST_TYPE_EMPTY;
-			} else {
-				debug_print(DEBUG_MAIN, 1, "JCD: loop_container_node = 0x%x\n", nodes[node].if_tail);
-				ast_entry[entry].type = AST_TYPE_CONTAINER;
-				ast_entry[entry].sub_type = 1; /* for LOOP container */
-				ast_entry[entry].index = index + 1;
-				ast_entry[entry].sub_index = ast_container[index + 1].length;
-				ast_entry[entry].node = nodes[node].if_tail;
-				ast_entry[entry].node_end = 0; /* Unknown */
-			}
-			/* Fixme, set this to the end of the if_then_else bit,
-			 * and check that it is still inside the loop_container */
-			//ast_entry[entry].type = AST_TYPE_EMPTY;
-
-			if_then_else_index++;
-			if (if_then_else_index >= AST_SIZE) {
-				debug_print(DEBUG_MAIN, 1, "if_then_else_index too large\n");
-				ret = 1;
-				goto exit_cfg_to_ast;
-			}
-#if 0
-			loop_container_index++;
-			if (loop_container_index >= AST_SIZE) {
-				debug_print(DEBUG_MAIN, 1, "loop_container_index too large\n");
-				exit(1);
-			}
-#endif
-			break;
-		case AST_TYPE_LOOP_CONTAINER:
-			debug_print(DEBUG_MAIN, 1, "UNHANDLED LOOP_CONTAINER = 0x%x\n", type);
-			break;
-		default:
-			debug_print(DEBUG_MAIN, 1, "UNHANDLED type = 0x%x\n", type);
-			ast_entry[entry].type = AST_TYPE_EMPTY;
-			break;
-		}
-
-		debug_print(DEBUG_MAIN, 1, "AFTER ast_entry entry = 0x%x\n", entry);
-		debug_print(DEBUG_MAIN, 1, "ast_type = 0x%x\n", ast_entry[entry].type);
-		debug_print(DEBUG_MAIN, 1, "ast_index = 0x%x\n", ast_entry[entry].index);
-		debug_print(DEBUG_MAIN, 1, "ast_sub_index = 0x%x\n", ast_entry[entry].sub_index);
-		debug_print(DEBUG_MAIN, 1, "ast_node = 0x%x\n", ast_entry[entry].node);
-		debug_print(DEBUG_MAIN, 1, "ast_node_end = 0x%x\n", ast_entry[entry].node_end);
-
-	} while(1);
-exit_cfg_to_ast:
-#if 0
-	if (container_index >= AST_SIZE) {
-		container_index = AST_SIZE - 1;
-	}
-	if (if_then_else_index >= AST_SIZE) {
-		exit(1);
-		if_then_else_index = AST_SIZE - 1;
-	}
-	if (if_then_goto_index >= AST_SIZE) {
-		exit(1);
-		if_then_goto_index = AST_SIZE - 1;
-	}
-	if (loop_index >= AST_SIZE) {
-		exit(1);
-		loop_index = AST_SIZE - 1;
-	}
-	if (loop_then_else_index >= AST_SIZE) {
-		exit(1);
-		loop_then_else_index = AST_SIZE - 1;
-	}
-	if (loop_container_index >= AST_SIZE) {
-		exit(1);
-		loop_container_index = AST_SIZE - 1;
-	}
-#endif
-	ast->container_size = container_index;
-	ast->if_then_else_size = if_then_else_index;
-	ast->if_then_goto_size = if_then_goto_index;
-	ast->loop_size = loop_index;
-	ast->loop_then_else_size = loop_then_else_index;
-	ast->loop_container_size = loop_container_index;
-	return ret;
-}
-
 int print_ast(struct self_s *self, struct ast_s *ast) {
 	struct ast_container_s *ast_container = ast->ast_container;
 	struct ast_if_then_else_s *ast_if_then_else = ast->ast_if_then_else;
@@ -1173,9 +733,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 	debug_print(DEBUG_MAIN, 1, "AST OUTPUT\n");
 	for (m = 0; m < container_index; m++) {
 		debug_print(DEBUG_MAIN, 1, "ast_container[%d]", m);
-		if (m >= AST_SIZE) {
-			break;
-		}
 		print_ast_container(&ast_container[m]);
 	}
 	for (m = 0; m < if_then_else_index; m++) {
@@ -1184,9 +741,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 			ast_if_then_else[m].parent.type,
 			ast_if_then_else[m].parent.index,
 			ast_if_then_else[m].parent.offset);
-		if (m >= AST_SIZE) {
-			break;
-		}
 		type = ast_if_then_else[m].expression_node.type;
 		switch (type) {
 		case AST_TYPE_EMPTY:
@@ -1248,9 +802,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 			ast_if_then_goto[m].parent.type,
 			ast_if_then_goto[m].parent.index,
 			ast_if_then_goto[m].parent.offset);
-		if (m >= AST_SIZE) {
-			break;
-		}
 		type = ast_if_then_goto[m].expression_node.type;
 		switch (type) {
 		case AST_TYPE_EMPTY:
@@ -1263,9 +814,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 		case AST_TYPE_CONTAINER:
 			debug_print(DEBUG_MAIN, 1, "ast_if_then_goto[%d].expression_node\n", m);
 			tmp = ast_if_then_goto[m].expression_node.index;
-			if (tmp >= AST_SIZE) {
-				break;
-			}
 			print_ast_container(&ast_container[tmp]);
 			break;
 		default:
@@ -1284,9 +832,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 		case AST_TYPE_CONTAINER:
 			debug_print(DEBUG_MAIN, 1, "ast_if_then_goto[%d].if_then_goto\n", m);
 			tmp = ast_if_then_goto[m].if_then_goto.index;
-			if (tmp >= AST_SIZE) {
-				break;
-			}
 			print_ast_container(&ast_container[tmp]);
 			break;
 		default:
@@ -1296,20 +841,11 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 	}
 	for (m = 0; m < loop_index; m++) {
 		debug_print(DEBUG_MAIN, 1, "ast_loop[%d].body\n", m);
-		if (m >= AST_SIZE) {
-			break;
-		}
 		tmp = ast_loop[m].body.index;
-		if (tmp >= AST_SIZE) {
-			break;
-		}
 		print_ast_container(&ast_container[tmp]);
 	}
 	for (m = 0; m < loop_then_else_index; m++) {
 		int type;
-		if (m >= AST_SIZE) {
-			break;
-		}
 		type = ast_loop_then_else[m].expression_node.type;
 		switch (type) {
 		case AST_TYPE_EMPTY:
@@ -1322,9 +858,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 		case AST_TYPE_CONTAINER:
 			debug_print(DEBUG_MAIN, 1, "ast_loop_then_else[%d].expression_node\n", m);
 			tmp = ast_loop_then_else[m].expression_node.index;
-			if (tmp >= AST_SIZE) {
-				break;
-			}
 			print_ast_container(&ast_container[tmp]);
 			break;
 		default:
@@ -1343,9 +876,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 		case AST_TYPE_CONTAINER:
 			debug_print(DEBUG_MAIN, 1, "ast_loop_then_else[%d].loop_then\n", m);
 			tmp = ast_loop_then_else[m].loop_then.index;
-			if (tmp >= AST_SIZE) {
-				break;
-			}
 			print_ast_container(&ast_container[tmp]);
 			break;
 		default:
@@ -1364,9 +894,6 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 		case AST_TYPE_CONTAINER:
 			debug_print(DEBUG_MAIN, 1, "ast_loop_then_else[%d].loop_else\n", m);
 			tmp = ast_loop_then_else[m].loop_else.index;
-			if (tmp >= AST_SIZE) {
-				break;
-			}
 			print_ast_container(&ast_container[tmp]);
 			break;
 		default:
@@ -1377,6 +904,11 @@ int print_ast(struct self_s *self, struct ast_s *ast) {
 	return 0;
 }
 
+static struct node_used_register_s *node_used_register(struct control_flow_node_s *node, int reg)
+{
+	return &(node->used_register[REG_DENSE(reg)]);
+}
+
 /* Search the used register table for the value ID to use. */
 int get_value_id_from_node_reg(struct self_s *self, int entry_point, int node, int reg, int *value_id)
 {
@@ -1394,7 +926,7 @@ int get_value_id_from_node_reg(struct self_s *self, int entry_point, int node, i
 		printf("get_value:value_id:0x%x\n", *value_id);
 		return 0;
 	}
-	inst = nodes[node].used_register[reg].dst;
+	inst = node_used_register(&nodes[node], reg)->dst;
 	printf("inst:0x%x\n", inst);
 	inst_log1 = &inst_log_entry[inst];
 	instruction =  &inst_log1->instruction;
@@ -1473,6 +1005,7 @@ int output_cfg_dot(struct self_s *self,
 	int nodes_size = external_entry_points[entry_point].nodes_size;
 	char *filename;
 	int fd;
+	struct string_s string;
 	int node;
 	int tmp;
 	int n;
@@ -1497,8 +1030,9 @@ int output_cfg_dot(struct self_s *self,
 		return 1;
 	}
 	debug_print(DEBUG_MAIN, 1, ".dot fd=%d\n", fd);
+	string_init(&string, fd);
 	debug_print(DEBUG_MAIN, 1, "writing out dot to file\n");
-	tmp = dprintf(fd, "digraph code {\n"
+	tmp = string_printf(&string, "digraph code {\n"
 		"\tgraph [bgcolor=white];\n"
 		"\tnode [color=lightgray, style=filled shape=box"
 		" fontname=\"%s\" fontsize=\"8\"];\n", font);
@@ -1529,57 +1063,57 @@ int output_cfg_dot(struct self_s *self,
 		} else {
 			name = "";
 		}
-		tmp = dprintf(fd, " \"Node:0x%08x\" ["
+		tmp = string_printf(&string, " \"Node:0x%08x\" ["
                                         "URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s",
                                         node,
 					node, "lightgray", node, name);
 		if (external_entry_points[entry_point].params_size > 0) {
 			char buffer[1024];
-			tmp = dprintf(fd, "(");
+			tmp = string_printf(&string, "(");
 			for (n = 0; n < external_entry_points[entry_point].params_size; n++) {
 				int label_index;
 				label_index = external_entry_points[entry_point].params[n];
 				tmp = label_to_string(&external_entry_points[entry_point].labels[label_index], buffer, 1023);
-				dprintf(fd, "%s", buffer);
+				string_printf(&string, "%s", buffer);
 				if (n + 1 < external_entry_points[entry_point].params_size) {
-					tmp = dprintf(fd, ", ");
+					tmp = string_printf(&string, ", ");
 				}
 			}
-			tmp = dprintf(fd, ")");
+			tmp = string_printf(&string, ")");
 		}
-		tmp = dprintf(fd, "\\l");
-		tmp = dprintf(fd, "type = 0x%x\\l",
+		tmp = string_printf(&string, "\\l");
+		tmp = string_printf(&string, "type = 0x%x\\l",
 				nodes[node].type);
 		if (nodes[node].if_tail) {
-			tmp = dprintf(fd, "if_tail = 0x%x\\l",
+			tmp = string_printf(&string, "if_tail = 0x%x\\l",
 				nodes[node].if_tail);
 		}
 		if (nodes[node].phi_size) {
 			for (n = 0; n < nodes[node].phi_size; n++) {
-				tmp = dprintf(fd, "phi[%d] = REG0x%x:0x%x ",
+				tmp = string_printf(&string, "phi[%d] = REG0x%x:0x%x ",
 					n, nodes[node].phi[n].reg, nodes[node].phi[n].value_id);
 				for (m = 0; m < nodes[node].phi[n].phi_node_size; m++) {
 					//tmp = get_value_id_from_node_reg(self, nodes[node].entry_point, nodes[node].phi[n].phi_node[m].node, nodes[node].phi[n].reg, &value_id);
-					tmp = dprintf(fd, "FPN:0x%x:SN:0x%x:L:0x%x, ",
+					tmp = string_printf(&string, "FPN:0x%x:SN:0x%x:L:0x%x, ",
 						nodes[node].phi[n].phi_node[m].first_prev_node,
 						nodes[node].phi[n].phi_node[m].node,
 						nodes[node].phi[n].phi_node[m].value_id);
 				}
 #if 0
 				for (m = 0; m < nodes[node].path_size; m++) {
-					tmp = dprintf(fd, "P0x%x:FPN:0x%x:SN:0x%x, ",
+					tmp = string_printf(&string, "P0x%x:FPN:0x%x:SN:0x%x, ",
 						nodes[node].phi[n].path_node[m].path,
 						nodes[node].phi[n].path_node[m].first_prev_node,
 						nodes[node].phi[n].path_node[m].node);
 				}
 				for (m = 0; m < nodes[node].looped_path_size; m++) {
-					tmp = dprintf(fd, "LP0x%x:FPN:0x%x:SN:0x%x, ",
+					tmp = string_printf(&string, "LP0x%x:FPN:0x%x:SN:0x%x, ",
 						nodes[node].phi[n].looped_path_node[m].path,
 						nodes[node].phi[n].looped_path_node[m].first_prev_node,
 						nodes[node].phi[n].looped_path_node[m].node);
 				}
 #endif
-				tmp = dprintf(fd, "\\l");
+				tmp = string_printf(&string, "\\l");
 			}
 		}
 		n = nodes[node].inst_start;
@@ -1588,21 +1122,21 @@ int output_cfg_dot(struct self_s *self,
 			inst_log1 =  &inst_log_entry[n];
 			instruction =  &inst_log1->instruction;
 			//tmp = write_inst(self, fd, instruction, n, NULL);
-			//tmp = dprintf(fd, "\\l");
+			//tmp = string_printf(&string, "\\l");
 			printf("output_cfg:Inst 0x%x: label1 = 0x%"PRIx64", label2 = 0x%"PRIx64", label3 = 0x%"PRIx64"\n",
 				n,
 				inst_log1->value1.value_id,
 				inst_log1->value2.value_id,
 				inst_log1->value3.value_id);
-			tmp = output_inst_in_c(self, process_state, fd, n, label_redirect, labels, "\\l");
-			//tmp = dprintf(fd, "\\l\n");
-			if (inst_log1->node_end || !(inst_log1->next_size)) {
+			tmp = output_inst_in_c(self, process_state, &string, n, label_redirect, labels, "\\l");
+			//tmp = string_printf(&string, "\\l\n");
+			if (INST_LOG_NODE_END(self, n) || !(inst_log1->next_size)) {
 				block_end = 1;
 			} else {
 				n = inst_log1->next[0];
 			}
 		} while (!block_end);
-		tmp = dprintf(fd, "\"];\n");
+		tmp = string_printf(&string, "\"];\n");
 		for (n = 0; n < nodes[node].next_size; n++) {
 			char *label;
 			if (nodes[node].next_size < 2) {
@@ -1611,7 +1145,7 @@ int output_cfg_dot(struct self_s *self,
 				} else {
 					color = "blue";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color);
 			} else if (nodes[node].next_size == 2) {
 				if (1 == nodes[node].link_next[n].is_loop_edge) {
@@ -1626,16 +1160,17 @@ int output_cfg_dot(struct self_s *self,
 				} else {
 					label = "true";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color, label);
 			} else {
 				/* next_size > 2 */
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
 					node, nodes[node].link_next[n].node, color, n);
 			}
 		}
 	}
-	tmp = dprintf(fd, "}\n");
+	tmp = string_printf(&string, "}\n");
+	string_free(&string);
 	close(fd);
 	return 0;
 }
@@ -1645,6 +1180,7 @@ int output_cfg_dot_basic(struct self_s *self, struct control_flow_node_s *nodes,
 	struct external_entry_point_s *external_entry_points = self->external_entry_points;
 	char *filename;
 	int fd;
+	struct string_s string;
 	int node;
 	int tmp;
 	int n;
@@ -1662,8 +1198,9 @@ int output_cfg_dot_basic(struct self_s *self, struct control_flow_node_s *nodes,
 		return 1;
 	}
 	debug_print(DEBUG_MAIN, 1, ".dot fd=%d\n", fd);
+	string_init(&string, fd);
 	debug_print(DEBUG_MAIN, 1, "writing out dot to file\n");
-	tmp = dprintf(fd, "digraph code {\n"
+	tmp = string_printf(&string, "digraph code {\n"
 		"\tgraph [bgcolor=white];\n"
 		"\tnode [color=lightgray, style=filled shape=box"
 		" fontname=\"%s\" fontsize=\"8\"];\n", font);
@@ -1679,17 +1216,17 @@ int output_cfg_dot_basic(struct self_s *self, struct control_flow_node_s *nodes,
 		} else {
 			name = "";
 		}
-		tmp = dprintf(fd, " \"Node:0x%08x\" ["
+		tmp = string_printf(&string, " \"Node:0x%08x\" ["
                                         "URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s\\l",
                                         node,
 					node, "lightgray", node, name);
-		tmp = dprintf(fd, "type = 0x%x\\l",
+		tmp = string_printf(&string, "type = 0x%x\\l",
 				nodes[node].type);
 		if (nodes[node].if_tail) {
-			tmp = dprintf(fd, "if_tail = 0x%x\\l",
+			tmp = string_printf(&string, "if_tail = 0x%x\\l",
 				nodes[node].if_tail);
 		}
-		tmp = dprintf(fd, "\"];\n");
+		tmp = string_printf(&string, "\"];\n");
 
 		for (n = 0; n < nodes[node].next_size; n++) {
 			char *label;
@@ -1699,7 +1236,7 @@ int output_cfg_dot_basic(struct self_s *self, struct control_flow_node_s *nodes,
 				} else {
 					color = "blue";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color);
 			} else if (nodes[node].next_size == 2) {
 				if (1 == nodes[node].link_next[n].is_loop_edge) {
@@ -1714,16 +1251,17 @@ int output_cfg_dot_basic(struct self_s *self, struct control_flow_node_s *nodes,
 				} else {
 					label = "true";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color, label);
 			} else {
 				/* next_size > 2 */
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
 					node, nodes[node].link_next[n].node, color, n);
 			}
 		}
 	}
-	tmp = dprintf(fd, "}\n");
+	tmp = string_printf(&string, "}\n");
+	string_free(&string);
 	close(fd);
 	return 0;
 }
@@ -1732,6 +1270,7 @@ int output_cfg_dot_basic2(struct self_s *self, struct external_entry_point_s *ex
 {
 	char *filename;
 	int fd;
+	struct string_s string;
 	int node;
 	int nodes_size = external_entry_point->nodes_size;
 	struct control_flow_node_s *nodes = external_entry_point->nodes;
@@ -1751,8 +1290,9 @@ int output_cfg_dot_basic2(struct self_s *self, struct external_entry_point_s *ex
 		return 1;
 	}
 	debug_print(DEBUG_MAIN, 1, ".dot fd=%d\n", fd);
+	string_init(&string, fd);
 	debug_print(DEBUG_MAIN, 1, "writing out dot to file\n");
-	tmp = dprintf(fd, "digraph code {\n"
+	tmp = string_printf(&string, "digraph code {\n"
 		"\tgraph [bgcolor=white];\n"
 		"\tnode [color=lightgray, style=filled shape=box"
 		" fontname=\"%s\" fontsize=\"8\"];\n", font);
@@ -1768,17 +1308,17 @@ int output_cfg_dot_basic2(struct self_s *self, struct external_entry_point_s *ex
 		} else {
 			name = "";
 		}
-		tmp = dprintf(fd, " \"Node:0x%08x\" ["
+		tmp = string_printf(&string, " \"Node:0x%08x\" ["
                                         "URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s\\l",
                                         node,
 					node, "lightgray", node, name);
-		tmp = dprintf(fd, "type = 0x%x\\l",
+		tmp = string_printf(&string, "type = 0x%x\\l",
 				external_entry_point->nodes[node].type);
 		if (external_entry_point->nodes[node].if_tail) {
-			tmp = dprintf(fd, "if_tail = 0x%x\\l",
+			tmp = string_printf(&string, "if_tail = 0x%x\\l",
 				external_entry_point->nodes[node].if_tail);
 		}
-		tmp = dprintf(fd, "\"];\n");
+		tmp = string_printf(&string, "\"];\n");
 
 		for (n = 0; n < external_entry_point->nodes[node].next_size; n++) {
 			char *label;
@@ -1788,7 +1328,7 @@ int output_cfg_dot_basic2(struct self_s *self, struct external_entry_point_s *ex
 				} else {
 					color = "blue";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color);
 			} else if (nodes[node].next_size == 2) {
 				if (1 == nodes[node].link_next[n].is_loop_edge) {
@@ -1803,22 +1343,24 @@ int output_cfg_dot_basic2(struct self_s *self, struct external_entry_point_s *ex
 				} else {
 					label = "true";
 				}
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"%s\"];\n",
 					node, nodes[node].link_next[n].node, color, label);
 			} else {
 				/* next_size > 2 */
-				tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
+				tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\" label=\"0x%x\"];\n",
 					node, nodes[node].link_next[n].node, color, n);
 			}
 		}
 	}
-	tmp = dprintf(fd, "}\n");
+	tmp = string_printf(&string, "}\n");
+	string_free(&string);
 	close(fd);
 	return 0;
 }
 
-int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_node_s *nodes, int *node_size)
+int output_ast_dot(struct self_s *self, struct ast_s *ast, struct external_entry_point_s *external_entry_point)
 {
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
 	struct ast_container_s *ast_container = ast->ast_container;
 	struct ast_if_then_else_s *ast_if_then_else = ast->ast_if_then_else;
 	struct ast_if_then_goto_s *ast_if_then_goto = ast->ast_if_then_goto;
@@ -1835,6 +1377,7 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 	int loop_container_index = ast->loop_container_size;
 	char *filename;
 	int fd;
+	struct string_s string;
 	int start_node;
 	int tmp;
 	int index;
@@ -1844,76 +1387,78 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 	const char *font = "graph.font";
 	const char *color;
 	const char *name;
-	filename = "test-ast.dot";
+
+	filename = calloc(1024, sizeof(char));
+	tmp = snprintf(filename, 1024, "./cfg/ast-%s.dot", external_entry_point->name);
 
 	fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
 	if (fd < 0) {
 		debug_print(DEBUG_MAIN, 1, "Failed to open file %s, error=%d\n", filename, fd);
+		free(filename);
 		return 1;
 	}
+	free(filename);
 	debug_print(DEBUG_MAIN, 1, ".dot fd=%d\n", fd);
+	string_init(&string, fd);
 	debug_print(DEBUG_MAIN, 1, "writing out dot to file\n");
-	tmp = dprintf(fd, "digraph code {\n"
+	tmp = string_printf(&string, "digraph code {\n"
 		"\tgraph [bgcolor=white];\n"
 		"\tnode [color=lightgray, style=filled shape=box"
 		" fontname=\"%s\" fontsize=\"8\"];\n", font);
 	for (n = 0; n < container_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		start_node = ast_container[n].start_node;
 		if (start_node && nodes[start_node].entry_point) {
 			name = external_entry_points[nodes[start_node].entry_point - 1].name;
 		} else {
 			name = "";
 		}
-		tmp = dprintf(fd, " \"Container:0x%08x\" ["
+		tmp = string_printf(&string, " \"Container:0x%08x\" ["
                                         "URL=\"Container:0x%08x\" color=\"%s\", label=\"Container:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		name = "";
 		for (m = 0; m < ast_container[n].length; m++) {
 			index = ast_container[n].object[m].index;
 			switch (ast_container[n].object[m].type) {
 			case AST_TYPE_NODE:
-				tmp = dprintf(fd, " \"Node:0x%08x\" ["
+				tmp = string_printf(&string, " \"Node:0x%08x\" ["
                                         "URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s\\l",
                                         index,
 					index, "lightgray", index, name);
-				tmp = dprintf(fd, "\"]\n");
+				tmp = string_printf(&string, "\"]\n");
 				color = "red";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_CONTAINER:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_LOOP_CONTAINER:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"Loop_Container:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"Loop_Container:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_IF_THEN_ELSE:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_IF_THEN_GOTO:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"if_then_goto:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"if_then_goto:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_LOOP:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_LOOP_THEN_ELSE:
 				color = "blue";
-				tmp = dprintf(fd, "\"Container:0x%08x\" -> \"loop_then_else:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Container:0x%08x\" -> \"loop_then_else:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			default:
@@ -1922,59 +1467,56 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		}
 	}
 	for (n = 0; n < loop_container_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		start_node = ast_loop_container[n].start_node;
 		if (start_node && nodes[start_node].entry_point) {
 			name = external_entry_points[nodes[start_node].entry_point - 1].name;
 		} else {
 			name = "";
 		}
-		tmp = dprintf(fd, " \"Loop_Container:0x%08x\" ["
+		tmp = string_printf(&string, " \"Loop_Container:0x%08x\" ["
                                         "URL=\"Loop_Container:0x%08x\" color=\"%s\", label=\"Loop_Container:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		name = "";
 		for (m = 0; m < ast_loop_container[n].length; m++) {
 			index = ast_loop_container[n].object[m].index;
 			switch (ast_loop_container[n].object[m].type) {
 			case AST_TYPE_NODE:
-				tmp = dprintf(fd, " \"Node:0x%08x\" ["
+				tmp = string_printf(&string, " \"Node:0x%08x\" ["
                                         "URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s\\l",
                                         index,
 					index, "lightgray", index, name);
-				tmp = dprintf(fd, "\"]\n");
+				tmp = string_printf(&string, "\"]\n");
 				color = "red";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_CONTAINER:
 				break;
 			case AST_TYPE_LOOP_CONTAINER:
 				color = "blue";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"Loop_container:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"Loop_container:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_IF_THEN_ELSE:
 				color = "blue";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_IF_THEN_GOTO:
 				color = "blue";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"if_then_goto:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"if_then_goto:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_LOOP:
 				color = "blue";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			case AST_TYPE_LOOP_THEN_ELSE:
 				color = "blue";
-				tmp = dprintf(fd, "\"Loop_Container:0x%08x\" -> \"loop_then_else:0x%08x\" [color=\"%s\"];\n",
+				tmp = string_printf(&string, "\"Loop_Container:0x%08x\" -> \"loop_then_else:0x%08x\" [color=\"%s\"];\n",
 					n, index, color);
 				break;
 			default:
@@ -1983,25 +1525,22 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		}
 	}
 	for (n = 0; n < if_then_else_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		name = "";
-		tmp = dprintf(fd, " \"if_then_else:0x%08x\" ["
+		tmp = string_printf(&string, " \"if_then_else:0x%08x\" ["
                                         "URL=\"if_then_else:0x%08x\" color=\"%s\", label=\"if_then_else:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		index = ast_if_then_else[n].expression_node.index;
 		switch (ast_if_then_else[n].expression_node.type) {
 		case AST_TYPE_NODE:
 			color = "gold";
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "gold";
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2011,12 +1550,12 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		switch (ast_if_then_else[n].if_then.type) {
 		case AST_TYPE_NODE:
 			color = "green";
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "green";
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2027,13 +1566,13 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		case AST_TYPE_NODE:
 			color = "red";
 			debug_print(DEBUG_MAIN, 1, "if_then_else:0x%x TYPE_NODE \n", n);
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "red";
 			debug_print(DEBUG_MAIN, 1, "if_then_else:0x%x TYPE_CONTAINER \n", n);
-			tmp = dprintf(fd, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2042,25 +1581,22 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		}
 	}
 	for (n = 0; n < if_then_goto_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		name = "";
-		tmp = dprintf(fd, " \"if_then_goto:0x%08x\" ["
+		tmp = string_printf(&string, " \"if_then_goto:0x%08x\" ["
                                         "URL=\"if_then_goto:0x%08x\" color=\"%s\", label=\"if_then_goto:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		index = ast_if_then_goto[n].expression_node.index;
 		switch (ast_if_then_goto[n].expression_node.type) {
 		case AST_TYPE_NODE:
 			color = "gold";
-			tmp = dprintf(fd, "\"if_then_goto:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_goto:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "gold";
-			tmp = dprintf(fd, "\"if_then_goto:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_goto:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2070,12 +1606,12 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		switch (ast_if_then_goto[n].if_then_goto.type) {
 		case AST_TYPE_NODE:
 			color = "green";
-			tmp = dprintf(fd, "\"if_then_goto:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_goto:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "green";
-			tmp = dprintf(fd, "\"if_then_goto:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"if_then_goto:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2083,44 +1619,41 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		}
 	}
 	for (n = 0; n < loop_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		name = "";
-		tmp = dprintf(fd, " \"loop:0x%08x\" ["
+		tmp = string_printf(&string, " \"loop:0x%08x\" ["
                                         "URL=\"loop:0x%08x\" color=\"%s\", label=\"loop:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		index = ast_loop[n].first_node.index;
-		tmp = dprintf(fd, " \"Node:0x%08x\" ["
+		tmp = string_printf(&string, " \"Node:0x%08x\" ["
 			"URL=\"Node:0x%08x\" color=\"%s\", label=\"Node:0x%08x:%s\\l",
 			index,
 			index, "lightgray", index, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		color = "gold";
-		tmp = dprintf(fd, "\"loop:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+		tmp = string_printf(&string, "\"loop:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 			n, index, color);
 		index = ast_loop[n].body.index;
 		switch (ast_loop[n].body.type) {
 		case AST_TYPE_NODE:
 			color = "red";
-			tmp = dprintf(fd, "\"loop:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "red";
-			tmp = dprintf(fd, "\"loop:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_IF_THEN_ELSE:
 			color = "blue";
-			tmp = dprintf(fd, "\"loop:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop:0x%08x\" -> \"if_then_else:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_LOOP:
 			color = "blue";
-			tmp = dprintf(fd, "\"loop:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop:0x%08x\" -> \"loop:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2128,25 +1661,22 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		}
 	}
 	for (n = 0; n < loop_then_else_index; n++) {
-		if (n >= AST_SIZE) {
-			break;
-		}
 		name = "";
-		tmp = dprintf(fd, " \"loop_then_else:0x%08x\" ["
+		tmp = string_printf(&string, " \"loop_then_else:0x%08x\" ["
                                         "URL=\"loop_then_else:0x%08x\" color=\"%s\", label=\"loop_then_else:0x%08x:%s\\l",
                                         n,
 					n, "lightgray", n, name);
-		tmp = dprintf(fd, "\"]\n");
+		tmp = string_printf(&string, "\"]\n");
 		index = ast_loop_then_else[n].expression_node.index;
 		switch (ast_loop_then_else[n].expression_node.type) {
 		case AST_TYPE_NODE:
 			color = "gold";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "gold";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2156,12 +1686,12 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		switch (ast_loop_then_else[n].loop_then.type) {
 		case AST_TYPE_NODE:
 			color = "green";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "green";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2171,12 +1701,12 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 		switch (ast_loop_then_else[n].loop_else.type) {
 		case AST_TYPE_NODE:
 			color = "red";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		case AST_TYPE_CONTAINER:
 			color = "red";
-			tmp = dprintf(fd, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
+			tmp = string_printf(&string, "\"loop_then_else:0x%08x\" -> \"Container:0x%08x\" [color=\"%s\"];\n",
 				n, index, color);
 			break;
 		default:
@@ -2186,11 +1716,12 @@ int output_ast_dot(struct self_s *self, struct ast_s *ast, struct control_flow_n
 #if 0
 	for (n = 0; n < nodes[node].next_size; n++) {
 		color = "blue";
-		tmp = dprintf(fd, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
+		tmp = string_printf(&string, "\"Node:0x%08x\" -> \"Node:0x%08x\" [color=\"%s\"];\n",
 			node, nodes[node].link_next[n].node, color);
 	}
 #endif
-	tmp = dprintf(fd, "}\n");
+	tmp = string_printf(&string, "}\n");
+	string_free(&string);
 	close(fd);
 	return 0;
 }
@@ -2203,13 +1734,15 @@ int init_node_used_register_table(struct self_s *self, struct control_flow_node_
 			/* Only output nodes that are valid */
 			continue;
 		}
-		nodes[node].used_register = calloc(MAX_REG, sizeof(struct node_used_register_s));
+		nodes[node].used_register = calloc(REG_DENSE_MAX, sizeof(struct node_used_register_s));
 	}
 	return 0;
 }
 
 int print_node_used_register_table(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
 {
+	struct reg_set_s seen;
+	struct node_used_register_s *used;
 	int node;
 	int n;
 
@@ -2218,44 +1751,79 @@ int print_node_used_register_table(struct self_s *self, struct control_flow_node
 			/* Only output nodes that are valid */
 			continue;
 		}
-		for (n = 0; n < MAX_REG; n++) {
-			if (nodes[node].used_register[n].seen) {
-				debug_print(DEBUG_MAIN, 1, "node 0x%x:node_used_reg 0x%x:seen=0x%x, size=0x%x, src=0x%x, dst=0x%x, src_first=0x%x, value_id=0x%x, node=0x%x, label=0x%x\n",
-					node,
-					n,
-					nodes[node].used_register[n].seen,
-					nodes[node].used_register[n].size,
-					nodes[node].used_register[n].src,
-					nodes[node].used_register[n].dst,
-					nodes[node].used_register[n].src_first,
-					nodes[node].used_register[n].src_first_value_id,
-					nodes[node].used_register[n].src_first_node,
-					nodes[node].used_register[n].src_first_label);
-			}
+		for (n = 0; n < REG_SET_WORDS; n++) {
+			seen.word[n] = nodes[node].reg_use.word[n] | nodes[node].reg_def.word[n];
+		}
+		for (n = reg_set_next(&seen, 1); n >= 0; n = reg_set_next(&seen, n + 1)) {
+			used = &(nodes[node].used_register[n]);
+			debug_print(DEBUG_MAIN, 1, "node 0x%x:node_used_reg 0x%x:seen=0x%x, size=0x%x, src=0x%x, dst=0x%x, src_first=0x%x, value_id=0x%x, node=0x%x, label=0x%x\n",
+				node,
+				reg_dense_reg[n],
+				REG_SET_TEST_DENSE(&nodes[node].reg_use, n) ? 1 : 2,
+				used->size,
+				used->src,
+				used->dst,
+				used->src_first,
+				used->src_first_value_id,
+				used->src_first_node,
+				used->src_first_label);
 		}
 	}
 	return 0;
 }
 
+/* The first access of a register in a node decides if it is SRC first, in reg_use.
+ * The caller records the access in .src, or .dst.
+ */
+static void node_used_register_read(struct control_flow_node_s *node, int reg, int size, int inst)
+{
+	struct node_used_register_s *used = node_used_register(node, reg);
+
+	if (!REG_SET_TEST(&node->reg_use, reg) && !REG_SET_TEST(&node->reg_def, reg)) {
+		REG_SET_ADD(&node->reg_use, reg);
+		used->size = size;
+		used->src_first = inst;
+		debug_print(DEBUG_MAIN, 1, "Set1\n");
+	}
+}
+
+static void node_used_register_write(struct control_flow_node_s *node, int reg, int size, int inst)
+{
+	struct node_used_register_s *used = node_used_register(node, reg);
+
+	used->dst = inst;
+	if (!REG_SET_TEST(&node->reg_use, reg) && !REG_SET_TEST(&node->reg_def, reg)) {
+		used->size = size;
+		debug_print(DEBUG_MAIN, 1, "Set2\n");
+	}
+	REG_SET_ADD(&node->reg_def, reg);
+}
+
+/* Fills the used_register table, and reg_use and reg_def, of each node */
 int fill_node_used_register_table(struct self_s *self, struct control_flow_node_s *nodes, int nodes_size)
 {
 	int node;
 	int inst;
-	struct inst_log_entry_s *inst_log1;
-	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct instruction_s *instruction;
+	struct inst_log_hot_s *hot = self->inst_log_hot;
+	struct instruction_hot_s *instruction;
+	struct function_summary_s *summary;
+	struct control_flow_node_s *this_node;
+	int reg;
+	int n;
 
 	for (node = 1; node < nodes_size; node++) {
 		if (!nodes[node].valid) {
 			/* Only output nodes that are valid */
 			continue;
 		}
+		this_node = &(nodes[node]);
+		memset(&this_node->reg_use, 0, sizeof(struct reg_set_s));
+		memset(&this_node->reg_def, 0, sizeof(struct reg_set_s));
 		inst = nodes[node].inst_start;
 		debug_print(DEBUG_MAIN, 1, "In Block:0x%x\n", node);
 		do {
 			debug_print(DEBUG_MAIN, 1, "inst:0x%x\n", inst);
-			inst_log1 = &inst_log_entry[inst];
-			instruction =  &inst_log1->instruction;
+			instruction =  &hot->instruction[inst];
 			switch (instruction->opcode) {
 			case NOP:
 				/* Nothing to do */
@@ -2265,14 +1833,9 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				/* If SRC and DST in same instruction, let SRC dominate. */
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect != IND_DIRECT)) {
@@ -2282,13 +1845,8 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->dstA.index].dst = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen2:0x%"PRIx64", DST\n", instruction->dstA.index);
-					if (nodes[node].used_register[instruction->dstA.index].seen == 0) {
-						nodes[node].used_register[instruction->dstA.index].seen = 2;
-						nodes[node].used_register[instruction->dstA.index].size = instruction->dstA.value_size;
-						debug_print(DEBUG_MAIN, 1, "Set2\n");
-					}
+					node_used_register_write(this_node, instruction->dstA.index, instruction->dstA.value_size, inst);
 				}
 				break;
 			/* DSTA, SRCA, SRCB == DSTA */
@@ -2296,14 +1854,9 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				/* If SRC and DST in same instruction, let SRC dominate. */
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect != IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect != IND_DIRECT)) {
@@ -2313,13 +1866,8 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->dstA.index].dst = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen2:0x%"PRIx64", DST\n", instruction->dstA.index);
-					if (nodes[node].used_register[instruction->dstA.index].seen == 0) {
-						nodes[node].used_register[instruction->dstA.index].seen = 2;
-						nodes[node].used_register[instruction->dstA.index].size = instruction->dstA.value_size;
-						debug_print(DEBUG_MAIN, 1, "Set2\n");
-					}
+					node_used_register_write(this_node, instruction->dstA.index, instruction->dstA.value_size, inst);
 				}
 				break;
 			/* DSTA, SRCA, SRCB == DSTA */
@@ -2327,26 +1875,16 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				/* If SRC and DST in same instruction, let SRC dominate. */
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect != IND_DIRECT)) {
 					/* This is a special case, where the dst register is indirect, so actually a src. */
-					nodes[node].used_register[instruction->dstA.index].src = inst;
+					node_used_register(this_node, instruction->dstA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1D:0x%"PRIx64", DST\n", instruction->dstA.index);
-					if (nodes[node].used_register[instruction->dstA.index].seen == 0) {
-						nodes[node].used_register[instruction->dstA.index].seen = 1;
-						nodes[node].used_register[instruction->dstA.index].size = instruction->dstA.value_size;
-						nodes[node].used_register[instruction->dstA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1D\n");
-					}
+					node_used_register_read(this_node, instruction->dstA.index, instruction->dstA.value_size, inst);
 				}
 
 				if ((instruction->dstA.store == STORE_REG) &&
@@ -2375,35 +1913,21 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 			case ICMP:
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcA.index].dst = inst;
+					/* Read first, then written, as srcA is also the dst here */
 					debug_print(DEBUG_MAIN, 1, "Seen1A:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1A\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
+					node_used_register_write(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				if ((instruction->srcB.store == STORE_REG) &&
 					(instruction->srcB.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcB.index].src = inst;
+					node_used_register(this_node, instruction->srcB.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1B:0x%"PRIx64" SRC\n", instruction->srcB.index);
-					if (nodes[node].used_register[instruction->srcB.index].seen == 0) {
-						nodes[node].used_register[instruction->srcB.index].seen = 1;
-						nodes[node].used_register[instruction->srcB.index].size = instruction->srcB.value_size;
-						nodes[node].used_register[instruction->srcB.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1B\n");
-					}
+					node_used_register_read(this_node, instruction->srcB.index, instruction->srcB.value_size, inst);
 				}
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->dstA.index].dst = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen2:0x%"PRIx64", DST\n", instruction->dstA.index);
-					if (nodes[node].used_register[instruction->dstA.index].seen == 0) {
-						nodes[node].used_register[instruction->dstA.index].seen = 2;
-						nodes[node].used_register[instruction->dstA.index].size = instruction->dstA.value_size;
-						debug_print(DEBUG_MAIN, 1, "Set2\n");
-					}
+					node_used_register_write(this_node, instruction->dstA.index, instruction->dstA.value_size, inst);
 				}
 				break;
 
@@ -2415,40 +1939,31 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
 					/* CMP and TEST do not have a dst */
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1A:0x%"PRIx64", SRCA\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1A\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				if ((instruction->srcB.store == STORE_REG) &&
 					(instruction->srcB.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcB.index].src = inst;
+					node_used_register(this_node, instruction->srcB.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1B:0x%"PRIx64", SRCB\n", instruction->srcB.index);
-					if (nodes[node].used_register[instruction->srcB.index].seen == 0) {
-						nodes[node].used_register[instruction->srcB.index].seen = 1;
-						nodes[node].used_register[instruction->srcB.index].size = instruction->srcB.value_size;
-						nodes[node].used_register[instruction->srcB.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1B\n");
-					}
+					node_used_register_read(this_node, instruction->srcB.index, instruction->srcB.value_size, inst);
 				}
 				break;
 
 			/* DSTA = EAX, SRCN = parameters */
 			case CALL:
-				/* FIXME: TODO params */
+				summary = call_graph_summary(self, call_graph_target(self, inst));
+				for (n = 0; summary && (n < summary->params_size); n++) {
+					reg = reg_params_order[n];
+					node_used_register(this_node, reg)->src = inst;
+					debug_print(DEBUG_MAIN, 1, "CALL Seen1:0x%x, PARAM\n", reg);
+					node_used_register_read(this_node, reg, 64, inst);
+				}
 				if ((instruction->dstA.store == STORE_REG) &&
 					(instruction->dstA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->dstA.index].dst = inst;
 					debug_print(DEBUG_MAIN, 1, "CALL Seen2:0x%"PRIx64", DST\n", instruction->dstA.index);
-					if (nodes[node].used_register[instruction->dstA.index].seen == 0) {
-						nodes[node].used_register[instruction->dstA.index].seen = 2;
-						nodes[node].used_register[instruction->dstA.index].size = instruction->dstA.value_size;
-						debug_print(DEBUG_MAIN, 1, "Set2\n");
-					}
+					node_used_register_write(this_node, instruction->dstA.index, instruction->dstA.value_size, inst);
 				}
 				break;
 
@@ -2460,27 +1975,17 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
 					/* CMP and TEST do not have a dst */
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1A:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1A\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 			/* DSTA = nothing, SRCA, SRCB = nothing */
 			case RET:
 				if ((instruction->srcA.store == STORE_REG) &&
 					(instruction->srcA.indirect == IND_DIRECT)) {
-					nodes[node].used_register[instruction->srcA.index].src = inst;
+					node_used_register(this_node, instruction->srcA.index)->src = inst;
 					debug_print(DEBUG_MAIN, 1, "Seen1:0x%"PRIx64", SRC\n", instruction->srcA.index);
-					if (nodes[node].used_register[instruction->srcA.index].seen == 0) {
-						nodes[node].used_register[instruction->srcA.index].seen = 1;
-						nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-						nodes[node].used_register[instruction->srcA.index].src_first = inst;
-						debug_print(DEBUG_MAIN, 1, "Set1\n");
-					}
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				break;
 			/* DSTA = nothing, SRCN = nothing */
@@ -2489,13 +1994,10 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 			 * Eventually it will be the label for the index */
 			case JMPT:
 				if ((instruction->srcA.store == STORE_REG) &&
-					(instruction->srcA.indirect == IND_DIRECT) &&
-					(nodes[node].used_register[instruction->srcA.index].seen == 0)) {
+					(instruction->srcA.indirect == IND_DIRECT)) {
 					/* TODO: Add register src index here */
 					debug_print(DEBUG_MAIN, 1, "Seen1:0x%"PRIx64" SET\n", instruction->srcA.index);
-					nodes[node].used_register[instruction->srcA.index].seen = 1;
-					nodes[node].used_register[instruction->srcA.index].size = instruction->srcA.value_size;
-					nodes[node].used_register[instruction->srcA.index].src_first = inst;
+					node_used_register_read(this_node, instruction->srcA.index, instruction->srcA.value_size, inst);
 				}
 				break;
 			default:
@@ -2503,11 +2005,12 @@ int fill_node_used_register_table(struct self_s *self, struct control_flow_node_
 				return 1;
 				break;
 			}
-		if (!inst_log1->node_end) {
-			inst = inst_log1->next[0];
+		if (!hot->node_end[inst]) {
+			inst = hot->next[inst];
+		} else {
+			break;
 		}
-
-        	} while (!(inst_log1->node_end));
+        	} while (1);
 	}
 	return 0;
 }
@@ -2672,12 +2175,11 @@ int fill_node_phi_dst(struct self_s *self, struct control_flow_node_s *nodes, in
 			/* No previous join node found */
 			continue;
 		}
-		for (n = 0; n < MAX_REG; n++) {
-			if (nodes[node].used_register[n].seen == 1) {
-				debug_print(DEBUG_ANALYSE_PHI, 1, "Adding register 0x%x to phi_node 0x%x\n", n, phi_node);
-				tmp = add_phi_to_node(&(nodes[phi_node]), n);
-				debug_print(DEBUG_ANALYSE_PHI, 1, "Adding register 0x%x to phi_node 0x%x, status = %d\n", n, phi_node, tmp);
-			}
+		for (n = reg_set_next(&nodes[node].reg_use, 1); n >= 0;
+			n = reg_set_next(&nodes[node].reg_use, n + 1)) {
+			debug_print(DEBUG_ANALYSE_PHI, 1, "Adding register 0x%x to phi_node 0x%x\n", reg_dense_reg[n], phi_node);
+			tmp = add_phi_to_node(&(nodes[phi_node]), reg_dense_reg[n]);
+			debug_print(DEBUG_ANALYSE_PHI, 1, "Adding register 0x%x to phi_node 0x%x, status = %d\n", reg_dense_reg[n], phi_node, tmp);
 		}
 	}
 	return 0;
@@ -2710,7 +2212,7 @@ int find_phi_src_node_reg(struct self_s *self, struct control_flow_node_s *nodes
 		}
 		if (tmp == 0) {
 			/* Check used_registers of the prev_node. tmp2 points to the last instruction in the node/block */
-			tmp2 = nodes[tmp_node].used_register[reg].dst;
+			tmp2 = node_used_register(&nodes[tmp_node], reg)->dst;
 			if (node <= 4) {
 				debug_print(DEBUG_ANALYSE_PHI, 1, "phi_src:tmp = 0x%x, tmp2 = 0x%x, prev_path = 0x%x, prev_step = 0x%x, prev_node = 0x%x\n", tmp, tmp2, prev_path, prev_step, prev_node);
 				}
@@ -2900,7 +2402,7 @@ int fill_phi_src_value_id(struct self_s *self, struct control_flow_node_s *nodes
 					reg = nodes[node].phi[n].reg;
 					/* FIXME: What to do if node_source == 0 ? */
 					if (node_source > 0) {
-						inst = nodes[node_source].used_register[reg].dst;
+						inst = node_used_register(&nodes[node_source], reg)->dst;
 						if (inst == 0) {
 							/* Use the node_source phi instead. */
 							for (l = 0; l < nodes[node_source].phi_size; l++) {
@@ -3067,8 +2569,8 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 	struct external_entry_point_s *external_entry_point = &(self->external_entry_points[entry_point]);
 	struct control_flow_node_s *nodes = external_entry_point->nodes;
 	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct label_redirect_s *label_redirect = external_entry_point->label_redirect;
-	struct label_s *labels = external_entry_point->labels;
+	struct label_redirect_s *label_redirect;
+	struct label_s *labels;
 	int m;
 	struct inst_log_entry_s *inst_log1;
 	struct instruction_s *instruction;
@@ -3082,16 +2584,26 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 	int found = 0, ret = 1;
 	int reg_tracker[MAX_REG];
 	debug_print(DEBUG_MAIN, 1, "assign_labels_to_src() node 0x%x\n", node);
-	/* Initialise the reg_tracker at each node */
-	for (m = 0; m < MAX_REG; m++) {
-		if (nodes[node].used_register[m].seen == 1) {
-			reg_tracker[m] = nodes[node].used_register[m].src_first_value_id;
-			debug_print(DEBUG_MAIN, 1, "Node 0x%x: reg 0x%x given value_id = 0x%x\n", node, m,
-				reg_tracker[m]);
-		} else {
-			reg_tracker[m] = 0;
-			//debug_print(DEBUG_MAIN, 1, "Node 0x%x: reg 0x%x given value_id no value\n", node, m);
+	/* At most two new labels per instruction. Make room before taking the pointers */
+	m = 0;
+	inst = nodes[node].inst_start;
+	do {
+		m++;
+		if ((inst == nodes[node].inst_end) || (0 == inst_log_entry[inst].next_size)) {
+			break;
 		}
+		inst = inst_log_entry[inst].next[0];
+	} while (1);
+	label_redirect_reserve(external_entry_point, variable_id + (2 * m));
+	label_redirect = external_entry_point->label_redirect;
+	labels = external_entry_point->labels;
+	/* Initialise the reg_tracker at each node */
+	memset(reg_tracker, 0, sizeof(reg_tracker));
+	for (m = reg_set_next(&nodes[node].reg_use, 1); m >= 0;
+		m = reg_set_next(&nodes[node].reg_use, m + 1)) {
+		reg_tracker[reg_dense_reg[m]] = nodes[node].used_register[m].src_first_value_id;
+		debug_print(DEBUG_MAIN, 1, "Node 0x%x: reg 0x%x given value_id = 0x%x\n", node, reg_dense_reg[m],
+			reg_tracker[reg_dense_reg[m]]);
 	}
 
 	inst = nodes[node].inst_start;
@@ -3126,7 +2638,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3200,7 +2712,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3266,13 +2778,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 									inst_log1->value1.indirect_value_id);
 
 								debug_print(DEBUG_MAIN, 1, "variable_id = 0x%"PRIx64"\n", variable_id);
-								if (variable_id >= 10000) {
-									debug_print(DEBUG_MAIN, 1, "variable_id overrun 10000 limit. Trying to write to %d\n",
-											variable_id);
-									exit(1);
-								}
-
-								external_entry_point->label_redirect[variable_id].redirect = variable_id;
+								label_redirect_init(label_redirect, variable_id);
 								external_entry_point->labels[variable_id].scope = label.scope;
 								external_entry_point->labels[variable_id].type = label.type;
 								external_entry_point->labels[variable_id].value = label.value;
@@ -3352,7 +2858,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3425,7 +2931,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value2.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3507,7 +3013,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3570,7 +3076,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value2.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3656,7 +3162,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3703,7 +3209,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value2.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3775,7 +3281,7 @@ int assign_labels_to_src(struct self_s *self, int entry_point, int node)
 				}
 				
 				inst_log1->value1.value_id = variable_id;
-				label_redirect[variable_id].redirect = variable_id;
+				label_redirect_init(label_redirect, variable_id);
 				labels[variable_id].scope = label.scope;
 				labels[variable_id].type = label.type;
 				labels[variable_id].lab_pointer += label.lab_pointer;
@@ -3861,8 +3367,8 @@ int redirect_mov_reg_reg_labels(struct self_s *self, struct external_entry_point
 
 				value_id = inst_log1->value1.value_id;
 				value_id3 = inst_log1->value3.value_id;
-				/* Use the redirect as the source in case the source value_id has previously been redirected */
-				label_redirect[value_id3].redirect = label_redirect[value_id].redirect;
+				/* Join the sets, so anything already redirected to either follows too */
+				label_redirect_union(label_redirect, value_id3, value_id);
 			/* MOV imm,reg */
 			} else if ((IND_DIRECT == instruction->srcA.indirect) &&
 				(STORE_DIRECT == instruction->srcA.store) &&
@@ -3871,8 +3377,8 @@ int redirect_mov_reg_reg_labels(struct self_s *self, struct external_entry_point
 
 				value_id = inst_log1->value1.value_id;
 				value_id3 = inst_log1->value3.value_id;
-				/* Use the redirect as the source in case the source value_id has previously been redirected */
-				label_redirect[value_id3].redirect = label_redirect[value_id].redirect;
+				/* Join the sets, so anything already redirected to either follows too */
+				label_redirect_union(label_redirect, value_id3, value_id);
 			} 
 			break;
 		default:
@@ -3923,6 +3429,7 @@ int change_add_to_gep1(struct self_s *self, struct external_entry_point_s *exter
 			if ((labels[value_id1].lab_pointer > 0) ||
 				(labels[value_id2].lab_pointer > 0)) {
 				instruction->opcode = GEP1;
+				inst_log_hot_update(self, inst);
 			}
 			break;
 		case SUB:
@@ -3931,6 +3438,7 @@ int change_add_to_gep1(struct self_s *self, struct external_entry_point_s *exter
 			if ((labels[value_id1].lab_pointer > 0) &&
 				(labels[value_id2].lab_pointer == 0)) {
 				instruction->opcode = GEP1;
+				inst_log_hot_update(self, inst);
 				labels[value_id2].value = -labels[value_id2].value;
 			}
 			break;
@@ -4057,16 +3565,15 @@ int substitute_inst(struct self_s *self, int inst, int new_inst)
 		inst_log_entry[inst].instruction.dstA.relocated;
 	inst_log_entry[new_inst].instruction.dstA.value_size =
 		inst_log_entry[inst].instruction.dstA.value_size;
+	/* The tables are refreshed by the next inst_edit_commit() */
+	inst_edit_changed(self, new_inst);
 	return 0;
 }
 
 
 int build_flag_dependency_table(struct self_s *self)
 {
-	struct inst_log_entry_s *inst_log1;
-	struct inst_log_entry_s *inst_log1_flags;
-	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct instruction_s *instruction;
+	struct inst_log_hot_s *hot;
 	int l,n;
 	int found;
 	int tmp;
@@ -4076,61 +3583,60 @@ int build_flag_dependency_table(struct self_s *self)
 	for (n = 1; n < inst_max; n++) {
 		self->flag_result_users[n] = 0;
 	}
+	if (!self->inst_log_hot) {
+		inst_log_hot_build(self);
+	}
+	/* Only index into hot. The inserts below may realloc its arrays. */
+	hot = self->inst_log_hot;
+	/* One forward pass finds the flag setting inst for every user.
+	 * The inserts below keep it up to date.
+	 */
+	flag_reach_build(self);
 
 	for (n = 1; n < inst_max; n++) {
-		inst_log1 =  &inst_log_entry[n];
-		instruction =  &inst_log1->instruction;
-		switch (instruction->opcode) {
+		switch (hot->instruction[n].opcode) {
 		case RCR:
 		case RCL:
 		case ADC:
 		case SBB:
 		case IF:
-			debug_print(DEBUG_MAIN, 1, "flag user inst 0x%x OP:0x%x\n", n, instruction->opcode);
-			found = 0;
-			tmp = 30; /* Limit the scan backwards */
-			inst_log1_flags =  inst_log1;
-			do {
-				if (inst_log1_flags->prev > 0) {
-					l = inst_log1_flags->prev[0];
-				} else {
-					break;
-				}
-				tmp--;
-				inst_log1_flags =  &inst_log_entry[l];
-				debug_print(DEBUG_MAIN, 1, "Previous opcode 0x%x\n", inst_log1_flags->instruction.opcode);
-				debug_print(DEBUG_MAIN, 1, "Previous flags 0x%x\n", inst_log1_flags->instruction.flags);
-				if (1 == inst_log1_flags->instruction.flags) {
-					found = 1;
-				}
-				debug_print(DEBUG_MAIN, 1, "Previous flags instruction size 0x%x\n", inst_log1_flags->prev_size);
-				tmp--;
-			} while ((0 == found) && (0 < tmp) && (0 != l));
-			if (found == 0) {
-				debug_print(DEBUG_MAIN, 1, "Previous flags instruction not found. found=%d, tmp=%d, l=0x%x\n", found, tmp, l);
+			debug_print(DEBUG_MAIN, 1, "flag user inst 0x%x OP:0x%x\n", n, hot->instruction[n].opcode);
+			l = flag_reach_producer(self, n);
+			if ((0 == l) && (FLAG_REACH_JOIN == self->flag_reach->producer[n])) {
+				/* Different flags meet here. Keep to the prev[0] path */
+				l = flag_reach_first_prev(self, n);
+				debug_print(DEBUG_MAIN, 1, "Flags reach inst 0x%x from more than one inst. Using 0x%x from the prev[0] path\n",
+					n, l);
+			}
+			if (0 == l) {
+				debug_print(DEBUG_MAIN, 1, "Previous flags instruction not found. inst=0x%x\n", n);
 				return 1;
 			} else {
-				debug_print(DEBUG_MAIN, 1, "Previous flags instruction found. found=%d, tmp=%d, l=0x%x n=0x%x\n", found, tmp, l, n);
+				debug_print(DEBUG_MAIN, 1, "Previous flags instruction found. l=0x%x n=0x%x\n", l, n);
 				if (self->flag_result_users[l] > 0) {
-					if ((inst_log_entry[l].instruction.opcode != CMP) &&
-						(inst_log_entry[l].instruction.opcode != TEST)) {
+					if ((hot->instruction[l].opcode != CMP) &&
+						(hot->instruction[l].opcode != TEST)) {
 						debug_print(DEBUG_MAIN, 1, "TOO MANY FLAGGED NON CMP/TEST. Opcode = 0x%x, Node = 0x%x\n",
-							inst_log_entry[l].instruction.opcode,
-							inst_log_entry[l].node_member);
+							hot->instruction[l].opcode,
+							hot->node_member[l]);
 						exit(1);
 					}
-					if (inst_log_entry[l].instruction.opcode == TEST) {
+					if (hot->instruction[l].opcode == TEST) {
 						debug_print(DEBUG_MAIN, 1, "FIXME: Too many TEST. Inst = 0x%x Opcode = 0x%x\n",
 							l,
-							inst_log_entry[l].instruction.opcode);
+							hot->instruction[l].opcode);
 					}
 					
 					/* Use "before" because after will cause a race condition */
-					tmp = insert_nop_before(self, l, &new_inst);
+					tmp = inst_edit_insert_before(self, l, &new_inst);
+					if (tmp) {
+						debug_print(DEBUG_MAIN, 1, "Failed to insert a copy of flags inst 0x%x\n", l);
+						return 1;
+					}
 					/* copy CMP/TEST into it */
-					tmp = substitute_inst(self, l, new_inst);
+					substitute_inst(self, l, new_inst);
 					self->flag_dependency[n] = new_inst;
-					self->flag_dependency_opcode[n] = inst_log1_flags->instruction.opcode;
+					self->flag_dependency_opcode[n] = hot->instruction[l].opcode;
 					self->flag_result_users[new_inst]++;
 					if (new_inst > 0xe20) {
 						debug_print(DEBUG_MAIN, 1, "ADDING NEW INST 0x%x, flagged = 0x%x, flag_dep_size = 0x%x\n",
@@ -4138,7 +3644,7 @@ int build_flag_dependency_table(struct self_s *self)
 					}
 				} else {		
 					self->flag_dependency[n] = l;
-					self->flag_dependency_opcode[n] = inst_log1_flags->instruction.opcode;
+					self->flag_dependency_opcode[n] = hot->instruction[l].opcode;
 					self->flag_result_users[l]++;
 					if (l > 0xe20) {
 						debug_print(DEBUG_MAIN, 1, "ADDING FLAGGED 0x%x, flagged = 0x%x, flag_dep_size = 0x%x\n",
@@ -4151,6 +3657,7 @@ int build_flag_dependency_table(struct self_s *self)
 			break;
 		}
 	}
+	inst_edit_commit(self);
 	found = 0;
 	for (n = 1; n < inst_max; n++) {
 		if (self->flag_result_users[n] > 1) {
@@ -4158,7 +3665,7 @@ int build_flag_dependency_table(struct self_s *self)
 			found = 1;
 		}
 		if (self->flag_result_users[n] > 0) {
-			debug_print(DEBUG_MAIN, 1, "FLAG RESULT USED. inst 0x%x:0x%x opcode=0x%x\n", n, self->flag_result_users[n], inst_log_entry[n].instruction.opcode);
+			debug_print(DEBUG_MAIN, 1, "FLAG RESULT USED. inst 0x%x:0x%x opcode=0x%x\n", n, self->flag_result_users[n], hot->instruction[n].opcode);
 		}
 
 	}
@@ -4326,6 +3833,8 @@ int fix_flag_dependency_instructions(struct self_s *self)
 			exit(1);
 			break;
 		case SBB:
+			/* The match reads, and case 5 rewrites, the edges. So link in the edits so far */
+			inst_edit_commit(self);
 			tmp = matcher_sbb(self, n, &sbb_match, &next1, &next2, &next3, &flags_result_used);
 			debug_print(DEBUG_MAIN, 1, "SBB: match 0x%x\n", sbb_match);
 			if (self->flag_result_users[n] > 0) {
@@ -4437,6 +3946,10 @@ int fix_flag_dependency_instructions(struct self_s *self)
 				inst_log_entry[next2].instruction.dstA.relocated = 0;
 				inst_log_entry[next2].instruction.dstA.value_size = reg_size;
 				inst_log_entry[next2].value3.value_scope =  2;
+				inst_edit_changed(self, new_inst);
+				inst_edit_changed(self, next1);
+				inst_edit_changed(self, next2);
+				inst_edit_changed(self, next3);
 				debug_print(DEBUG_MAIN, 1, "flag: SBB 5 handled\n");
 				break;
 			case 3:
@@ -4498,7 +4011,7 @@ int fix_flag_dependency_instructions(struct self_s *self)
 				//	exit (1);
 				//}
 				/* Change TEST,IF to AND,ICMP,BC */
-				tmp = insert_nop_after(self, self->flag_dependency[n], &new_inst);
+				tmp = inst_edit_insert_after(self, self->flag_dependency[n], &new_inst);
 				reg_size = inst_log1_flags->instruction.srcA.value_size;
 				inst_log1_flags->instruction.opcode = rAND;
 				inst_log1_flags->instruction.flags = 0;
@@ -4539,7 +4052,7 @@ int fix_flag_dependency_instructions(struct self_s *self)
 				debug_print(DEBUG_MAIN, 1, "Pair of instructions adjusted. inst 0x%x:0x%x\n", n, self->flag_dependency[n]);
 				break;
 			case rAND:
-				tmp = insert_nop_after(self, self->flag_dependency[n], &new_inst);
+				tmp = inst_edit_insert_after(self, self->flag_dependency[n], &new_inst);
 				reg = inst_log1_flags->instruction.dstA.index;
 				reg_size = inst_log1_flags->instruction.dstA.value_size;
 
@@ -4574,7 +4087,7 @@ int fix_flag_dependency_instructions(struct self_s *self)
 				debug_print(DEBUG_MAIN, 1, "Pair of instructions adjusted. inst 0x%x:0x%x\n", n, self->flag_dependency[n]);
 				break;
 			case SUB:
-				tmp = insert_nop_before(self, self->flag_dependency[n], &new_inst);
+				tmp = inst_edit_insert_before(self, self->flag_dependency[n], &new_inst);
 				reg = inst_log1_flags->instruction.dstA.index;
 				reg_size = inst_log1_flags->instruction.dstA.value_size;
 				tmp = substitute_inst(self, self->flag_dependency[n], new_inst);
@@ -4603,7 +4116,7 @@ int fix_flag_dependency_instructions(struct self_s *self)
 				tmp = inst_log1->instruction.srcA.index;
 				if ((tmp == EQUAL) || (tmp == NOT_EQUAL)) {
 					int inst = self->flag_dependency[n];
-					tmp = insert_nop_after(self, inst, &new_inst);
+					tmp = inst_edit_insert_after(self, inst, &new_inst);
 					reg = inst_log1_flags->instruction.dstA.index;
 					reg_size = inst_log1_flags->instruction.dstA.value_size;
 
@@ -4665,8 +4178,13 @@ int fix_flag_dependency_instructions(struct self_s *self)
 			exit(1);
 			break;
 		}
+		/* The pair has been rewritten in place */
+		inst_edit_changed(self, prev);
+		inst_edit_changed(self, n);
 	}
-	return 0;
+	/* Link in all the inserted instructions in one go */
+	tmp = inst_edit_commit(self);
+	return tmp;
 }
 
 int print_flag_dependency_table(struct self_s *self)
@@ -4680,119 +4198,29 @@ int print_flag_dependency_table(struct self_s *self)
 	return 0;
 }	
 
+/* Insert a NOP before inst and link it in at once.
+ * Use inst_edit_insert_before() and one inst_edit_commit() for a batch of them.
+ */
 int insert_nop_before(struct self_s *self, int inst, int *new_inst)
 {
-	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct inst_log_entry_s *inst_log1 = &inst_log_entry[inst];
-	struct inst_log_entry_s *inst_log1_previous;
-	struct inst_log_entry_s *inst_log1_new;
-	int l,m,n;
-	int inst_new;
-
-	inst_new = inst_log;
-	inst_log1_new = &inst_log_entry[inst_new];
-	inst_log++;
-	self->flag_dependency = realloc(self->flag_dependency, (inst_log) * sizeof(int));
-	self->flag_dependency[inst_log - 1] = 0;
-	self->flag_dependency_opcode = realloc(self->flag_dependency_opcode, (inst_log) * sizeof(int));
-	self->flag_dependency_opcode[inst_log - 1] = 0;
-	self->flag_result_users = realloc(self->flag_result_users, (inst_log) * sizeof(int));
-	self->flag_result_users[inst_log - 1] = 0;
-	debug_print(DEBUG_MAIN, 1, "INFO: Insert nop before: Old dep size = 0x%x, new dep size = 0x%"PRIx64"\n", self->flag_dependency_size, inst_log);
-	debug_print(DEBUG_MAIN, 1, "INFO: Setting flag_result_users[0x%"PRIx64"] = 0\n", inst_log - 1);
-	self->flag_dependency_size = inst_log;
+	int tmp;
 
-	inst_log1_new->instruction.opcode = NOP;
-        inst_log1_new->instruction.flags = 0;
-	if (inst_log1->prev_size) {
-		inst_log1_new->prev = calloc(inst_log1->prev_size, sizeof(int));
-		inst_log1_new->prev_size = inst_log1->prev_size;
-		for (n = 0; n < inst_log1->prev_size; n++) {
-			inst_log1_new->prev[n] = inst_log1->prev[n];
-			if (inst_log1->prev[n] == 0) {
-				debug_print(DEBUG_MAIN, 1, "ERROR: Insert nop before first instruction not yet supported. Case 0\n");
-				/* Move the entry point. Should never get here */
-				exit(1);
-			}
-			inst_log1_previous = &inst_log_entry[inst_log1->prev[n]];
-			for (m = 0; m < inst_log1_previous->next_size; m++) {
-				if (inst_log1_previous->next[m] == inst) {
-					inst_log1_previous->next[m] = inst_new;
-				}
-			}
-		}
-	} else {
-		for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-			if ((self->external_entry_points[l].valid != 0) &&
-				(self->external_entry_points[l].type == 1) &&
-				(self->external_entry_points[l].inst_log == inst)) {
-					self->external_entry_points[l].inst_log = inst_new;
-				debug_print(DEBUG_MAIN, 1, "fixing entry point[0x%x] from 0x%x to 0x%x\n",
-					l, inst, inst_new);
-			}
-		}
-	}
-	inst_log1_new->next = calloc(1, sizeof(int));
-	inst_log1_new->next_size = 1;
-	inst_log1_new->next[0] = inst;
-	if (0 == inst_log1->prev_size) {
-		inst_log1->prev = calloc(1, sizeof(int));
+	tmp = inst_edit_insert_before(self, inst, new_inst);
+	if (tmp) {
+		return tmp;
 	}
-	inst_log1->prev_size = 1;
-	inst_log1->prev[0] = inst_new;
-	*new_inst = inst_new;
-
-	return 0;
+	return inst_edit_commit(self);
 }
 
 int insert_nop_after(struct self_s *self, int inst, int *new_inst)
 {
-	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-	struct inst_log_entry_s *inst_log1 = &inst_log_entry[inst];
-	struct inst_log_entry_s *inst_log1_next;
-	struct inst_log_entry_s *inst_log1_new;
-	int m,n;
-	int inst_new;
-
-	inst_new = inst_log;
-	if (inst_log1->next_size > 1) {
-		debug_print(DEBUG_MAIN, 1, "insert_nop_after: FAILED Inst 0x%x\n", inst);
-		return 1;
-	}
-	inst_log1_new = &inst_log_entry[inst_log];
-	inst_log++;
-	self->flag_dependency = realloc(self->flag_dependency, (inst_log) * sizeof(int));
-	self->flag_dependency[inst_log - 1] = 0;
-	self->flag_dependency_opcode = realloc(self->flag_dependency_opcode, (inst_log) * sizeof(int));
-	self->flag_dependency_opcode[inst_log - 1] = 0;
-	self->flag_result_users = realloc(self->flag_result_users, (inst_log) * sizeof(int));
-	self->flag_result_users[inst_log - 1] = 0;
-	debug_print(DEBUG_MAIN, 1, "INFO: Insert nop after: Old dep size = 0x%x, new dep size = 0x%"PRIx64"\n", self->flag_dependency_size, inst_log);
-	self->flag_dependency_size = inst_log;
+	int tmp;
 
-	inst_log1_new->instruction.opcode = NOP;
-        inst_log1_new->instruction.flags = 0;
-	if (inst_log1->next_size) {
-		inst_log1_new->next = calloc(inst_log1->next_size, sizeof(int));
-		inst_log1_new->next_size = inst_log1->next_size;
-		for (n = 0; n < inst_log1->next_size; n++) {
-			inst_log1_new->next[n] = inst_log1->next[n];
-			inst_log1_next = &inst_log_entry[inst_log1->next[n]];
-			for (m = 0; m < inst_log1_next->prev_size; m++) {
-				if (inst_log1_next->prev[m] == inst) {
-					inst_log1_next->prev[m] = inst_new;
-				}
-			}
-		}
+	tmp = inst_edit_insert_after(self, inst, new_inst);
+	if (tmp) {
+		return tmp;
 	}
-	inst_log1_new->prev = calloc(1, sizeof(int));
-	inst_log1_new->prev_size = 1;
-	inst_log1_new->prev[0] = inst;
-	inst_log1->next_size = 1;
-	inst_log1->next[0] = inst_new;
-	*new_inst = inst_new;
-
-	return 0;
+	return inst_edit_commit(self);
 }
 
 int create_function_node_members(struct self_s *self, struct external_entry_point_s *external_entry_point)
@@ -4803,7 +4231,6 @@ int create_function_node_members(struct self_s *self, struct external_entry_poin
 	int member_nodes_size;
 	int *member_nodes;
 	int *node_list;
-	int found = 0;
 	int count = 1;
 	int node;
 	int next_node;
@@ -4814,27 +4241,35 @@ int create_function_node_members(struct self_s *self, struct external_entry_poin
 		int valid;
 	};
 	struct mid_node_s *mid_node;
+	int mid_node_size = 1;	/* Slots in use, valid or not */
+	int mid_node_max = 100;
 
-	
+	/* The function's nodes are numbered in the order they are taken from mid_node,
+	 * lowest slot first, and a next node goes in the lowest free slot.
+	 * The slots grow when they are all valid, instead of failing at 100.
+	 */
 	node_list = calloc(global_nodes_size + 1, sizeof(int));
-	mid_node = calloc(100, sizeof(struct mid_node_s));
+	mid_node = calloc(mid_node_max, sizeof(struct mid_node_s));
+	if (!node_list || !mid_node) {
+		printf("Failed in create_function_node_members(). calloc failed.\n");
+		exit(1);
+	}
 
 	mid_node[0].node = external_entry_point->start_node;
 	mid_node[0].valid = 1;
 
 	do {
-		for (n = 0; n < 100; n++) {
+		for (n = 0; n < mid_node_size; n++) {
 			if (mid_node[n].valid == 1) {
 				node = mid_node[n].node;
 				mid_node[n].valid = 0;
 				break;
 			}
 		}
-		if (n == 100) {
+		if (n == mid_node_size) {
 			/* finished */
-			found = 1;
 			break;
-		}	
+		}
 		if (node_list[node] == 0) {
 			node_list[node] = count;
 			count++;
@@ -4842,20 +4277,27 @@ int create_function_node_members(struct self_s *self, struct external_entry_poin
 		for (n = 0; n < global_nodes[node].next_size; n++) {
 			next_node = global_nodes[node].link_next[n].node;
 			if (node_list[next_node] == 0) {
-				for (m = 0; m < 100; m++) {
+				for (m = 0; m < mid_node_size; m++) {
 					if (mid_node[m].valid == 0) {
-						mid_node[m].node = next_node;
-						mid_node[m].valid = 1;
 						break;
 					}
 				}
-				if (m == 100) {
-					printf("Failed in create_function_node_members(). No free mid_nodes.\n");
-					exit(1);
+				if (m == mid_node_max) {
+					mid_node_max *= 2;
+					mid_node = realloc(mid_node, mid_node_max * sizeof(struct mid_node_s));
+					if (!mid_node) {
+						printf("Failed in create_function_node_members(). realloc failed.\n");
+						exit(1);
+					}
+				}
+				if (m == mid_node_size) {
+					mid_node_size++;
 				}
+				mid_node[m].node = next_node;
+				mid_node[m].valid = 1;
 			}
 		}
-	} while (found == 0);
+	} while (1);
 	member_nodes = calloc(count, sizeof(int));
 	member_nodes_size = count;
 	for (n = 1; n <= global_nodes_size; n++) {
@@ -4887,6 +4329,7 @@ int create_function_node_members(struct self_s *self, struct external_entry_poin
 	}
 	free(mid_node);
 	free(node_list);
+	inst_node_set_function(self, external_entry_point - self->external_entry_points);
 #if 0
 	printf("function: %s\n", external_entry_point->name);
 	for (n = 1; n < member_nodes_size; n++) {
@@ -5119,120 +4562,488 @@ int assign_id_label_dst(struct self_s *self, int function, int n, struct inst_lo
 	return ret;
 }
 
-int fill_reg_dependency_table(struct self_s *self, struct external_entry_point_s *external_entry_point, int n)
+/* The writes of reg that reach the start of node n, from the def-use index.
+ * One write: used gets its value_id and returns 0.
+ * Returns 1 if none reach, so reg is a param, or if there are several, with no phi to join them.
+ */
+int fill_reg_dependency_reaching(struct self_s *self, struct external_entry_point_s *external_entry_point, int n, int reg, struct node_used_register_s *used)
+{
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	uint64_t size;
+	uint64_t *inst_list;
+	int node;
+	int inst;
+	int tmp;
+
+	tmp = def_use_reaching(self, external_entry_point->def_use, 1, reg, 0,
+		nodes[n].inst_start, &size, &inst_list);
+	if (tmp || !size) {
+		free(inst_list);
+		return 1;
+	}
+	if (size > 1) {
+		debug_print(DEBUG_MAIN, 1, "FIXME: Node 0x%x: reg 0x%x: 0x%"PRIx64" writes reach, but no phi\n",
+			n, reg, size);
+		free(inst_list);
+		return 1;
+	}
+	inst = inst_list[0];
+	free(inst_list);
+	used->src_first_value_id = inst_log_entry[inst].value3.value_id;
+	used->src_first_label = 2;
+	used->src_first_node = 0;
+	for (node = 1; node < external_entry_point->nodes_size; node++) {
+		tmp = nodes[node].inst_start;
+		while (tmp != inst && tmp != nodes[node].inst_end && inst_log_entry[tmp].next_size) {
+			tmp = inst_log_entry[tmp].next[0];
+		}
+		if (tmp == inst) {
+			used->src_first_node = node;
+			break;
+		}
+	}
+	debug_print(DEBUG_MAIN, 1, "Node 0x%x: reg 0x%x: def-use write at inst 0x%x, node 0x%x, value_id = 0x%x\n",
+		n, reg, inst, used->src_first_node, used->src_first_value_id);
+	return 0;
+}
+
+/* reg_reach is the table from build_node_reg_reach() */
+int fill_reg_dependency_table(struct self_s *self, struct external_entry_point_s *external_entry_point, int n, int *reg_reach)
 {
 	/* n is the requested node */
 	struct control_flow_node_s *nodes = external_entry_point->nodes;
 	int nodes_size = external_entry_point->nodes_size;
+	struct node_used_register_s *used;
 	int m;
+	int reg;
 	int tmp;
 
-	for (m = 0; m < MAX_REG; m++) {
+	for (m = reg_set_next(&nodes[n].reg_use, 1); m >= 0;
+		m = reg_set_next(&nodes[n].reg_use, m + 1)) {
 		int value_id;
-		if (1 == nodes[n].used_register[m].seen) {
-			int node;
-			int found = 0;
-			debug_print(DEBUG_MAIN, 1, "Node 0x%x: Reg Used src:0x%x\n", n, m);
-			tmp = find_reg_in_phi_list(self, nodes, nodes_size, n, m, &value_id);
+		int node;
+		reg = reg_dense_reg[m];
+		used = &(nodes[n].used_register[m]);
+		debug_print(DEBUG_MAIN, 1, "Node 0x%x: Reg Used src:0x%x\n", n, reg);
+		tmp = find_reg_in_phi_list(self, nodes, nodes_size, n, reg, &value_id);
+		if (!tmp) {
+			used->src_first_value_id = value_id;
+			used->src_first_node = n;
+			used->src_first_label = 1;
+			debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in phi. value_id = 0x%x\n", reg, value_id);
+			continue;
+		}
+		/* The last write, or phi, of the reg along the previous nodes */
+		node = reg_reach[(n * REG_DENSE_MAX) + m];
+		debug_print(DEBUG_MAIN, 1, "Reaching node 0x%x\n", node);
+		if (node && nodes[node].used_register[m].dst) {
+			struct inst_log_entry_s *inst_log1;
+			struct instruction_s *instruction;
+			struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+			inst_log1 =  &inst_log_entry[nodes[node].used_register[m].dst];
+			instruction =  &inst_log1->instruction;
+			/* FIXME: Handle indirect */
+			/* Indirect should never happen for registers */
+			if ((instruction->dstA.store == STORE_REG) &&
+				(instruction->dstA.indirect == IND_DIRECT)) {
+				tmp = inst_log1->value3.value_id;
+			} else {
+				printf("BAD DST\n");
+				exit(1);
+			}
+			used->src_first_value_id = tmp;
+			used->src_first_node = node;
+			used->src_first_label = 2;
+			debug_print(DEBUG_MAIN, 1, "Reg DST found 0x%x\n", nodes[node].used_register[m].dst);
+			debug_print(DEBUG_MAIN, 1, "node 0x%x, reg 0x%x\n", node, reg);
+			debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
+				used->src_first_value_id,
+				used->src_first_node,
+				used->src_first_label);
+			continue;
+		}
+		if (node) {
+			tmp = find_reg_in_phi_list(self, nodes, nodes_size, node, reg, &value_id);
 			if (!tmp) {
-				nodes[n].used_register[m].src_first_value_id = value_id;
-				nodes[n].used_register[m].src_first_node = n;
-				nodes[n].used_register[m].src_first_label = 1;
-				debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in phi. value_id = 0x%x\n", m, value_id);
+				used->src_first_value_id = value_id;
+				used->src_first_node = node;
+				used->src_first_label = 1;
+				debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in previous 0x%x phi. value_id = 0x%x\n", reg, node, value_id);
+				debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
+					used->src_first_value_id,
+					used->src_first_node,
+					used->src_first_label);
 				continue;
 			}
-			/* Start searching previous nodes for used_register and phi */
-			node = n;
-			debug_print(DEBUG_MAIN, 1, "Previous size 0x%x\n", nodes[node].prev_size);
-			if (nodes[node].prev_size > 0) {
-				debug_print(DEBUG_MAIN, 1, "Previous node 0x%x\n", nodes[node].prev_node[0]);
+		}
+
+		/* reg_reach found no write or phi. Before calling it a param, ask the
+		 * def-use index if a write of the reg reaches the node anyway.
+		 */
+		tmp = fill_reg_dependency_reaching(self, external_entry_point, n, reg, used);
+		if (!tmp) {
+			continue;
+		}
+
+		/* All other searches failed, must be a param */
+		/* Build the param to label pointer tables, and use it to not duplicate param labels. */
+		tmp = external_entry_point->param_reg_label[reg];
+		if (0 == tmp) {
+			used->src_first_value_id = external_entry_point->variable_id;
+			used->src_first_node = 0;
+			used->src_first_label = 3;
+			label_redirect_reserve(external_entry_point, external_entry_point->variable_id + 1);
+			label_redirect_init(external_entry_point->label_redirect, external_entry_point->variable_id);
+			external_entry_point->labels[external_entry_point->variable_id].scope = 2;
+			external_entry_point->labels[external_entry_point->variable_id].type = 1;
+			external_entry_point->labels[external_entry_point->variable_id].lab_pointer = 1;
+			external_entry_point->labels[external_entry_point->variable_id].value = reg;
+			external_entry_point->labels[external_entry_point->variable_id].size_bits = used->size;
+			external_entry_point->param_reg_label[reg] = external_entry_point->variable_id;
+			debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in param, label_id = 0x%x\n", reg, external_entry_point->variable_id);
+			debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
+				used->src_first_value_id,
+				used->src_first_node,
+				used->src_first_label);
+			external_entry_point->variable_id++;
+		} else {
+			used->src_first_value_id = tmp;
+			used->src_first_node = 0;
+			used->src_first_label = 3;
+			debug_print(DEBUG_MAIN, 1, "Found duplicate reg 0x%x in param, label_id = 0x%x\n", reg, tmp);
+			debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
+				used->src_first_value_id,
+				used->src_first_node,
+				used->src_first_label);
+		}
+	}
+	return 0;
+}
+
+/* Give each value of the function a label, and settle the labels.
+ * Only reads the callee summaries, so it runs as soon as they are final,
+ * one function at a time, and the output follows straight after.
+ */
+int function_assign_labels(struct self_s *self, int l)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
+	struct inst_log_entry_s *inst_log1;
+	struct instruction_s *instruction;
+	int *reg_reach;
+	int n;
+	int m;
+	int tmp;
+
+	/************************************************************
+	 * This bit assigned a variable ID and label to each assignment (dst).
+	 ************************************************************/
+	/* Grows with variable_id */
+	label_redirect_reserve(&external_entry_points[l], 0x1000);
+	external_entry_points[l].variable_id = 0x100;
+
+	/* Init special labels */
+	/* param_stack0000 == EIP on the stack */
+	label_redirect_init(external_entry_points[l].label_redirect, 3);
+	external_entry_points[l].labels[3].scope = 2;
+	external_entry_points[l].labels[3].type = 2;
+	external_entry_points[l].labels[3].value = 0;
+	external_entry_points[l].labels[3].size_bits = 64;
+	external_entry_points[l].labels[3].lab_pointer = 1;
+
+	debug_print(DEBUG_MAIN, 1, "NAME DST: 0x%x:%s\n",
+		l, external_entry_points[l].name);
+	for (n = 0; n < MEMORY_STACK_SIZE; n++) {
+		if (external_entry_points[l].process_state.memory_stack[n].valid == 1) {
+			debug_print(DEBUG_MAIN, 1, "0x%x:memory_stack[%d].start_address = 0x%"PRIx64"\n",
+				l, n, external_entry_points[l].process_state.memory_stack[n].start_address);
+		}
+	}
+	for (n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!(external_entry_points[l].nodes[n].valid)) {
+			continue;
+		}
+		debug_print(DEBUG_ANALYSE, 1, "e1_node[0x%x]_start = inst 0x%x\n", n, external_entry_points[l].nodes[n].inst_start);
+		debug_print(DEBUG_ANALYSE, 1, "e1_node[0x%x]_end = inst 0x%x\n", n, external_entry_points[l].nodes[n].inst_end);
+	}
+
+	for(m = 1; m < external_entry_points[l].nodes_size; m++) {
+		int next;
+		if (!(external_entry_points[l].nodes[m].valid)) {
+			continue;
+		}
+		next = external_entry_points[l].nodes[m].inst_start;
+		do {
+			struct label_s label;
+			n = next;
+			inst_log1 =  &inst_log_entry[n];
+			instruction =  &inst_log1->instruction;
+			/* returns 0 for id and label set. 1 for error */
+			debug_print(DEBUG_MAIN, 1, "label address = %p\n", &label);
+			tmp  = assign_id_label_dst(self, l, n, inst_log1, &label);
+			debug_print(DEBUG_MAIN, 1, "value to log_to_label:inst = 0x%x: 0x%x, 0x%"PRIx64", 0x%x, 0x%x, 0x%"PRIx64", 0x%"PRIx64", 0x%"PRIx64"\n",
+				n,
+				instruction->dstA.indirect,
+				instruction->dstA.index,
+				instruction->dstA.relocated,
+				inst_log1->value3.value_scope,
+				inst_log1->value3.value_id,
+				inst_log1->value3.indirect_offset_value,
+				inst_log1->value3.indirect_value_id);
+
+			if (!tmp) {
+				debug_print(DEBUG_MAIN, 1, "variable_id = %x\n", external_entry_points[l].variable_id);
+				label_redirect_reserve(&external_entry_points[l], external_entry_points[l].variable_id + 1);
+				label_redirect_init(external_entry_points[l].label_redirect, external_entry_points[l].variable_id);
+				external_entry_points[l].labels[external_entry_points[l].variable_id].scope = label.scope;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].type = label.type;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].value = label.value;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].size_bits = label.size_bits;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].lab_pointer += label.lab_pointer;
+				external_entry_points[l].variable_id++;
+			} else {
+				debug_print(DEBUG_MAIN, 1, "assign_id_label_dst() failed\n");
+				exit(1);
+			}
+
+			if (inst_log1->next_size) {
+				next = inst_log1->next[0];
+			} else if (n != external_entry_points[l].nodes[m].inst_end) {
+				debug_print(DEBUG_MAIN, 1, "DST inst 0x%x, l = 0x%x, m = 0x%x next failure. No inst_end!!! inst_end1 = 0x%x, inst_end2 = 0x%x\n",
+					n, l, m, external_entry_points[l].nodes[m].inst_end, external_entry_points[l].nodes[m - 1].inst_end);
+				exit(1);
 			}
-			while ((nodes[node].prev_size > 0) && (nodes[node].prev_node[0] != 0)) {
-				node = nodes[node].prev_node[0];
-				debug_print(DEBUG_MAIN, 1, "Previous nodes 0x%x\n", node);
-				if (nodes[node].used_register[m].dst) {
-					struct inst_log_entry_s *inst_log1;
-					struct instruction_s *instruction;
-					struct inst_log_entry_s *inst_log_entry = self->inst_log_entry;
-					inst_log1 =  &inst_log_entry[nodes[node].used_register[m].dst];
-					instruction =  &inst_log1->instruction;
-					/* FIXME: Handle indirect */
-					/* Indirect should never happen for registers */
-					if ((instruction->dstA.store == STORE_REG) &&
-						(instruction->dstA.indirect == IND_DIRECT)) {
-						tmp = inst_log1->value3.value_id;
-					} else {
-						printf("BAD DST\n");
-						exit(1);
-					}
-					nodes[n].used_register[m].src_first_value_id = tmp;
-					nodes[n].used_register[m].src_first_node = node;
-					nodes[n].used_register[m].src_first_label = 2;
-					debug_print(DEBUG_MAIN, 1, "Reg DST found 0x%x\n", nodes[node].used_register[m].dst);
-					debug_print(DEBUG_MAIN, 1, "node 0x%x, m 0x%x\n", node, m);
-					debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
-						nodes[n].used_register[m].src_first_value_id,
-						nodes[n].used_register[m].src_first_node,
-						nodes[n].used_register[m].src_first_label);
-
-					found = 1;
-					break;
-				}
-				tmp = find_reg_in_phi_list(self, nodes, nodes_size, node, m, &value_id);
-				if (!tmp) {
-					nodes[n].used_register[m].src_first_value_id = value_id;
-					nodes[n].used_register[m].src_first_node = node;
-					nodes[n].used_register[m].src_first_label = 1;
-					debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in previous 0x%x phi. value_id = 0x%x\n", m, node, value_id);
-					debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
-						nodes[n].used_register[m].src_first_value_id,
-						nodes[n].used_register[m].src_first_node,
-						nodes[n].used_register[m].src_first_label);
-					found = 1;
-					break;
-				}
+		} while (n != external_entry_points[l].nodes[m].inst_end);
+	}
+
+	/* Assign labels to PHI instructions dst */
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!(external_entry_points[l].nodes[n].valid)) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		printf("JCD: scanning node phi 0x%x\n", n);
+		if (external_entry_points[l].nodes[n].phi_size) {
+			printf("JCD: phi insts found at node 0x%x\n", n);
+			for (m = 0; m < external_entry_points[l].nodes[n].phi_size; m++) {
+				external_entry_points[l].nodes[n].phi[m].value_id = external_entry_points[l].variable_id;
+				label_redirect_reserve(&external_entry_points[l], external_entry_points[l].variable_id + 1);
+				label_redirect_init(external_entry_points[l].label_redirect, external_entry_points[l].variable_id);
+				external_entry_points[l].labels[external_entry_points[l].variable_id].scope = 1;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].type = 1;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].lab_pointer = 0;
+				external_entry_points[l].labels[external_entry_points[l].variable_id].value = external_entry_points[l].variable_id;
+				external_entry_points[l].variable_id++;
 			}
-				
+		}
+	}
 
-			if (!found) {
-				/* All other searches failed, must be a param */
-				/* Build the param to label pointer tables, and use it to not duplicate param labels. */
-				tmp = external_entry_point->param_reg_label[m];
-				if (0 == tmp) {
-					nodes[n].used_register[m].src_first_value_id = external_entry_point->variable_id;
-					nodes[n].used_register[m].src_first_node = 0;
-					nodes[n].used_register[m].src_first_label = 3;
-					external_entry_point->label_redirect[external_entry_point->variable_id].redirect = external_entry_point->variable_id;
-					external_entry_point->labels[external_entry_point->variable_id].scope = 2;
-					external_entry_point->labels[external_entry_point->variable_id].type = 1;
-					external_entry_point->labels[external_entry_point->variable_id].lab_pointer = 1;
-					external_entry_point->labels[external_entry_point->variable_id].value = m;
-					external_entry_point->labels[external_entry_point->variable_id].size_bits =  nodes[n].used_register[m].size;
-					external_entry_point->param_reg_label[m] = external_entry_point->variable_id;
-					debug_print(DEBUG_MAIN, 1, "Found reg 0x%x in param, label_id = 0x%x\n", m, external_entry_point->variable_id);
-					debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
-						nodes[n].used_register[m].src_first_value_id,
-						nodes[n].used_register[m].src_first_node,
-						nodes[n].used_register[m].src_first_label);
-					external_entry_point->variable_id++;
-				} else {
-					nodes[n].used_register[m].src_first_value_id = tmp;
-					nodes[n].used_register[m].src_first_node = 0;
-					nodes[n].used_register[m].src_first_label = 3;
-					debug_print(DEBUG_MAIN, 1, "Found duplicate reg 0x%x in param, label_id = 0x%x\n", m, tmp);
-					debug_print(DEBUG_MAIN, 1, "value_id = 0x%x, node = 0x%x, label = 0x%x\n",
-						nodes[n].used_register[m].src_first_value_id,
-						nodes[n].used_register[m].src_first_node,
-						nodes[n].used_register[m].src_first_label);
+	/* TODO: add code to process the used_registers to identify registers
+	 * that are assigned dst in a previous node or function param
+	 */
+
+	/* The SSA nodes and phis are in place. Index where each register and stack slot
+	 * is written, for the reads that reg_reach has no write or phi for.
+	 * Freed by function_analysis_free().
+	 */
+	tmp = def_use_build(self, &external_entry_points[l]);
+
+	/* Fill in the reg dependency table.
+	 * reg_reach gives the node of the last write, or phi, of each register before each node,
+	 * so each register read first in a node is looked up, not walked back to.
+	 */
+	reg_reach = build_node_reg_reach(external_entry_points[l].nodes, external_entry_points[l].nodes_size);
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!external_entry_points[l].nodes[n].valid) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		tmp = fill_reg_dependency_table(self, &external_entry_points[l], n, reg_reach);
+		if (tmp) {
+			printf("fill_reg_dependency_table() failed\n");
+			exit(1);
+		}
+	}
+	free(reg_reach);
+
+	/* print node_used_register_table */
+	tmp = print_node_used_register_table(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
+	if (tmp) {
+		debug_print(DEBUG_MAIN, 1, "FIXME: print node used register table failed\n");
+		exit(1);
+	}
+
+	for (m = 0; m < MAX_REG; m++) {
+		if (external_entry_points[l].param_reg_label[m]) {
+			debug_print(DEBUG_MAIN, 1, "Entry Point 0x%x: Found reg 0x%x as param label 0x%x\n", l, m,
+				external_entry_points[l].param_reg_label[m]);
+		}
+	}
+	/* Enter value id/label id of param into phi with src node 0. */
+	tmp = fill_phi_src_value_id(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
+	tmp = fill_phi_dst_size_from_src_size(self, l);
+
+	/* Assign labels to instructions src */
+	/* TODO: WIP: Work in progress */
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!external_entry_points[l].nodes[n].valid) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		tmp = assign_labels_to_src(self, l, n);
+		if (tmp) {
+			printf("assign_labels_to_src() failed\n");
+			exit(1);
+		}
+	}
+	/* turn "MOV reg, reg" into a NOP from the SSA perspective. Make the dst = src label */
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!external_entry_points[l].nodes[n].valid) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		tmp = redirect_mov_reg_reg_labels(self, &external_entry_points[l], n);
+		if (tmp) {
+			printf("redirect_mov_reg_reg() failed\n");
+			exit(1);
+		}
+	}
+	/* No more label merges after this. Resolve them all once, for output */
+	label_redirect_canonicalize(&external_entry_points[l]);
+	/* Change ADD to GEP1 where the ADD involves pointers */
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!external_entry_points[l].nodes[n].valid) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		tmp = change_add_to_gep1(self, &external_entry_points[l], n);
+		if (tmp) {
+			printf("change_add_to_gep1() failed\n");
+			exit(1);
+		}
+	}
+	/* Discover pointer types */
+	for(n = 1; n < external_entry_points[l].nodes_size; n++) {
+		if (!external_entry_points[l].nodes[n].valid) {
+			/* Only output nodes that are valid */
+			continue;
+		}
+		tmp = discover_pointer_types(self, &external_entry_points[l], n);
+		if (tmp) {
+			printf("discover_pointer_types() failed\n");
+			exit(1);
+		}
+	}
+	external_entry_points[l].labels[0].lab_pointer = 1; /* EIP */
+	external_entry_points[l].labels[1].lab_pointer = 1; /* ESP */
+	external_entry_points[l].labels[2].lab_pointer = 1; /* EBP */
+	return 0;
+}
+
+/* Sort the params of the function to the correct order.
+ * Returns 1 for a param with an invalid label.
+ */
+int function_sort_params(struct self_s *self, int l)
+{
+	struct external_entry_point_s *external_entry_points = self->external_entry_points;
+	int n;
+	int m;
+	int tmp;
+
+	for (m = 0; m < REG_PARAMS_ORDER_MAX; m++) {
+		struct label_s *label;
+		for (n = 0; n < external_entry_points[l].params_size; n++) {
+			uint64_t tmp_param;
+			tmp = external_entry_points[l].params[n];
+			debug_print(DEBUG_MAIN, 1, "JCD5: labels 0x%x, params_size=%d\n", tmp, external_entry_points[l].params_size);
+			if (tmp >= external_entry_points[l].variable_id) {
+				debug_print(DEBUG_MAIN, 1, "Invalid entry point 0x%x, l=%d, m=%d, n=%d, params_size=%d\n",
+					tmp, l, m, n, external_entry_points[l].params_size);
+				return 1;
+			}
+			label = &(external_entry_points[l].labels[tmp]);
+			debug_print(DEBUG_MAIN, 1, "JCD5: labels 0x%x\n", external_entry_points[l].params[n]);
+			debug_print(DEBUG_MAIN, 1, "JCD5: label=%p, l=%d, m=%d, n=%d\n", label, l, m, n);
+			debug_print(DEBUG_MAIN, 1, "reg_params_order = 0x%x,", reg_params_order[m]);
+			debug_print(DEBUG_MAIN, 1, " label->value = 0x%"PRIx64"\n", label->value);
+			if ((label->scope == 2) &&
+				(label->type == 1) &&
+				(label->value == reg_params_order[m])) {
+				/* Swap params */
+				/* FIXME: How to handle the case of params_size <= n or m */
+				if (n != m) {
+					debug_print(DEBUG_MAIN, 1, "JCD4: swapping n=0x%x and m=0x%x\n", n, m);
+					tmp = external_entry_points[l].params_size;
+					if ((m >= tmp || n >= tmp)) {
+						external_entry_points[l].params_size++;
+						external_entry_points[l].params =
+							realloc(external_entry_points[l].params, external_entry_points[l].params_size * sizeof(int));
+						/* FIXME: Need to get label right */
+						external_entry_points[l].params[external_entry_points[l].params_size - 1] =
+							external_entry_points[l].variable_id;
+						label_redirect_reserve(&external_entry_points[l], external_entry_points[l].variable_id + 1);
+						external_entry_points[l].variable_id++;
+					}
+					tmp_param = external_entry_points[l].params[n];
+					external_entry_points[l].params[n] =
+						external_entry_points[l].params[m];
+					external_entry_points[l].params[m] = tmp_param;
 				}
 			}
 		}
 	}
+	debug_print(DEBUG_MAIN, 1, "name = %s\n", external_entry_points[l].name);
+	debug_print(DEBUG_MAIN, 1, "params size = 0x%x\n", external_entry_points[l].params_size);
+	for (n = 0; n < external_entry_points[l].params_size; n++) {
+		debug_print(DEBUG_MAIN, 1, "params = 0x%x\n", external_entry_points[l].params[n]);
+	}
 	return 0;
 }
 
+/* Free the tables that were only needed to analyse the function, once its
+ * C and .dot output is written.
+ * memory_used is only read by the execution, and by --hexdump before this.
+ * Left alone: labels, params, locals and the nodes with their phi lists, for the
+ * llvm_export_submit() workers, which may still be building the function.
+ * The node path and looped_path lists are left too, as create_function_node_members()
+ * copies them from the global nodes.
+ */
+int function_analysis_free(struct self_s *self, struct external_entry_point_s *external_entry_point)
+{
+	struct control_flow_node_s *nodes = external_entry_point->nodes;
+	int node;
+	int n;
 
-
+	for (n = 0; n < external_entry_point->paths_size; n++) {
+		free(external_entry_point->paths[n].path);
+	}
+	free(external_entry_point->paths);
+	external_entry_point->paths = NULL;
+	external_entry_point->paths_size = 0;
+	for (n = 0; n < external_entry_point->loops_size; n++) {
+		free(external_entry_point->loops[n].list);
+	}
+	free(external_entry_point->loops);
+	external_entry_point->loops = NULL;
+	external_entry_point->loops_size = 0;
+	for (node = 1; node < external_entry_point->nodes_size; node++) {
+		free(nodes[node].used_register);
+		nodes[node].used_register = NULL;
+		for (n = 0; n < nodes[node].phi_size; n++) {
+			free(nodes[node].phi[n].path_node);
+			nodes[node].phi[n].path_node = NULL;
+			nodes[node].phi[n].path_node_size = 0;
+			free(nodes[node].phi[n].looped_path_node);
+			nodes[node].phi[n].looped_path_node = NULL;
+			nodes[node].phi[n].looped_path_node_size = 0;
+		}
+	}
+	def_use_free(external_entry_point);
+	memory_used_free(external_entry_point->process_state.memory_used);
+	external_entry_point->process_state.memory_used = NULL;
+	return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -5247,13 +5058,27 @@ int main(int argc, char *argv[])
 	uint32_t arch;
 	uint64_t mach;
 	int fd;
+	struct string_s string;
 	int tmp;
 	int err;
 	const char *file = "test.obj";
+	const char *llvm_path = NULL;
+	const char *llvm_passes = NULL;
+	struct llvm_export_s *llvm_exporter = NULL;
+	int hexdump = 0;
+	const char *stats_path = NULL;
+	const char *trace_path = NULL;
+	const char *cache_path = NULL;
+	struct string_s function_string;
+	struct string_s *out;
+	uint64_t cache_base;
+	const char *cached;
+	size_t cached_size;
+	int stats_phase = -1;
+	int stats_function = -1;
 //	size_t inst_size = 0;
 //	uint64_t reloc_size = 0;
 	int l, m;
-	struct instruction_s *instruction;
 //	struct instruction_s *instruction_prev;
 	struct inst_log_entry_s *inst_log1;
 //	struct inst_log_entry_s *inst_log1_prev;
@@ -5269,15 +5094,13 @@ int main(int argc, char *argv[])
 	struct memory_s *memory_stack;
 	struct memory_s *memory_reg;
 	struct memory_s *memory_data;
-	int *memory_used;
+	struct memory_used_s *memory_used;
 	struct relocation_s *relocations;
 	struct external_entry_point_s *external_entry_points;
 	struct control_flow_node_s *nodes;
 	int nodes_size;
 	struct path_s *paths;
 	int paths_size = 300000;
-	struct loop_s *loops;
-	int loops_size = 2000;
 	struct ast_s *ast;
 	int *section_number_mapping;
 	struct reloc_table_s *reloc_table;
@@ -5289,15 +5112,55 @@ int main(int argc, char *argv[])
 
 	debug_print(DEBUG_MAIN, 1, "Hello loops 0x%x\n", 2000);
 
-	if (argc != 2) {
+	for (n = 1; n < argc - 1; n++) {
+		if (!strncmp(argv[n], "--llvm=", 7)) {
+			llvm_path = &argv[n][7];
+		} else if (!strncmp(argv[n], "--llvm-passes=", 14)) {
+			llvm_passes = &argv[n][14];
+		} else if (!strncmp(argv[n], "--debug=", 8)) {
+			if (debug_level_parse(&argv[n][8])) {
+				break;
+			}
+		} else if (!strcmp(argv[n], "--debug-async")) {
+			if (debug_ring_start()) {
+				debug_print(DEBUG_MAIN, 1, "--debug-async: could not start the debug thread\n");
+			}
+		} else if (!strcmp(argv[n], "--hexdump")) {
+			hexdump = 1;
+		} else if (!strcmp(argv[n], "--stats=json")) {
+			stats_path = "stats.json";
+		} else if (!strncmp(argv[n], "--stats=json:", 13)) {
+			stats_path = &argv[n][13];
+		} else if (!strncmp(argv[n], "--cache=", 8)) {
+			cache_path = &argv[n][8];
+		} else if (!strcmp(argv[n], "--trace")) {
+			trace_path = "trace.json";
+		} else if (!strncmp(argv[n], "--trace=", 8)) {
+			trace_path = &argv[n][8];
+		} else {
+			break;
+		}
+	}
+	if (n != argc - 1) {
 		debug_print(DEBUG_MAIN, 1, "Syntax error\n");
-		debug_print(DEBUG_MAIN, 1, "Usage: dis64 filename\n");
+		debug_print(DEBUG_MAIN, 1, "Usage: dis64 [--llvm=file [--llvm-passes=list]] [--debug=list] [--debug-async] [--hexdump] [--stats=json[:file]] [--trace[=file]] [--cache=file] filename\n");
 		debug_print(DEBUG_MAIN, 1, "Where \"filename\" is the input .o file\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--llvm=file\" writes the LLVM IR of every function to one .bc file\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--llvm-passes=list\" runs LLVM passes on it first, e.g. \"default\" or \"mem2reg,instcombine\"\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--debug=module:level,...\" sets the debug level of each module, e.g. \"all:0,analyse:1\"\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--debug-async\" writes debug output from a separate thread\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--hexdump\" prints the .text, .data and .rodata sections\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--stats=json\" writes the time and counters of each phase to stats.json, or file\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--trace\" writes a trace event timeline of the phases and functions to trace.json, or file\n");
+		debug_print(DEBUG_MAIN, 1, "and \"--cache=file\" keeps the output of each function in file, and reuses it for the functions that did not change\n");
 		exit(1);
 	}
-	file = argv[1];
+	file = argv[n];
 
-	self = malloc(sizeof(struct self_s));
+	self = calloc(1, sizeof(struct self_s));
+	if (stats_path || trace_path) {
+		stats_open(self);
+	}
 	expression = malloc(1000); /* Buffer for if expressions */
 
 	handle_void = bf_test_open_file(file);
@@ -5326,10 +5189,12 @@ int main(int argc, char *argv[])
 	memset(inst, 0, inst_size);
 	bf_copy_code_section(handle_void, inst, inst_size);
 	debug_print(DEBUG_MAIN, 1, "dis:.text Data at %p, size=0x%"PRIx64"\n", inst, inst_size);
-	for (n = 0; n < inst_size; n++) {
-		printf("0x%02x", inst[n]);
+	if (hexdump) {
+		for (n = 0; n < inst_size; n++) {
+			printf("0x%02x", inst[n]);
+		}
+		printf("\n");
 	}
-	printf("\n");
 
 	data_size = bf_get_data_size(handle_void);
 	data = malloc(data_size);
@@ -5337,10 +5202,12 @@ int main(int argc, char *argv[])
 	memset(data, 0, data_size);
 	bf_copy_data_section(handle_void, data, data_size);
 	debug_print(DEBUG_MAIN, 1, "dis:.data Data at %p, size=0x%"PRIx64"\n", data, data_size);
-	for (n = 0; n < data_size; n++) {
-		debug_print(DEBUG_MAIN, 1,  "0x%02x", data[n]);
+	if (hexdump) {
+		for (n = 0; n < data_size; n++) {
+			debug_print(DEBUG_MAIN, 1,  "0x%02x", data[n]);
+		}
+		debug_print(DEBUG_MAIN, 1, "\n");
 	}
-	debug_print(DEBUG_MAIN, 1, "\n");
 
 	rodata_size = bf_get_rodata_size(handle_void);
 	rodata = malloc(rodata_size);
@@ -5348,10 +5215,12 @@ int main(int argc, char *argv[])
 	memset(rodata, 0, rodata_size);
 	bf_copy_rodata_section(handle_void, rodata, rodata_size);
 	debug_print(DEBUG_MAIN, 1, "dis:.rodata Data at %p, size=0x%"PRIx64"\n", rodata, rodata_size);
-	for (n = 0; n < rodata_size; n++) {
-		debug_print(DEBUG_MAIN, 1,  "0x%02x", rodata[n]);
+	if (hexdump) {
+		for (n = 0; n < rodata_size; n++) {
+			debug_print(DEBUG_MAIN, 1,  "0x%02x", rodata[n]);
+		}
+		debug_print(DEBUG_MAIN, 1, "\n");
 	}
-	debug_print(DEBUG_MAIN, 1, "\n");
 
 	inst_log_entry = calloc(INST_LOG_ENTRY_SIZE, sizeof(struct inst_log_entry_s));
 	relocations =  calloc(RELOCATION_SIZE, sizeof(struct relocation_s));
@@ -5367,7 +5236,6 @@ int main(int argc, char *argv[])
 	self->external_entry_points = external_entry_points;
 	self->entry_point = calloc(ENTRY_POINTS_SIZE, sizeof(struct entry_point_s));
 	self->entry_point_list_length = ENTRY_POINTS_SIZE;
-//	self->search_back_seen = calloc(INST_LOG_ENTRY_SIZE, sizeof(int));
 	self->ll_inst = (void *)calloc(1, sizeof(struct instruction_low_level_s));
 	LLVMInitializeX86TargetInfo();
 	LLVMInitializeX86TargetMC();
@@ -5386,10 +5254,12 @@ int main(int argc, char *argv[])
 	memset(data, 0, data_size);
 	bf_copy_data_section(handle_void, data, data_size);
 	debug_print(DEBUG_MAIN, 1, "dis:.data Data at %p, size=0x%"PRIx64"\n", data, data_size);
-	for (n = 0; n < data_size; n++) {
-		debug_print(DEBUG_MAIN, 1, " 0x%02x", data[n]);
+	if (hexdump) {
+		for (n = 0; n < data_size; n++) {
+			debug_print(DEBUG_MAIN, 1, " 0x%02x", data[n]);
+		}
+		debug_print(DEBUG_MAIN, 1, "\n");
 	}
-	debug_print(DEBUG_MAIN, 1, "\n");
 
 	bf_get_reloc_table_code_section(handle_void);
 	
@@ -5471,6 +5341,23 @@ int main(int argc, char *argv[])
 			reloc_table[n].symbol_value);
 	}
 #endif			
+	/* The functions served from the cache get type 3, so the phases up to
+	 * the output skip them. See summary_cache.c
+	 */
+	if (cache_path) {
+		stats_phase = stats_begin(self, "summary_cache", -1);
+		summary_cache_open(self, cache_path, llvm_path != NULL);
+		cache_base = summary_cache_hash(SUMMARY_CACHE_FNV_BASIS, data, data_size);
+		cache_base = summary_cache_hash(cache_base, rodata, rodata_size);
+		cache_base = summary_cache_hash_relocs(cache_base, bf_get_reloc_table_data(handle_void),
+			bf_get_reloc_table_data_size(handle_void));
+		cache_base = summary_cache_hash_relocs(cache_base, bf_get_reloc_table_rodata(handle_void),
+			bf_get_reloc_table_rodata_size(handle_void));
+		summary_cache_keys(self, cache_base, inst, inst_size, reloc_table, reloc_table_size);
+		summary_cache_select(self);
+		stats_end(self, stats_phase);
+	}
+	stats_phase = stats_begin(self, "decode_execute", -1);
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if ((external_entry_points[l].valid != 0) &&
 			(external_entry_points[l].type == 1)) {  /* 1 == Implemented in this .o file */
@@ -5478,6 +5365,7 @@ int main(int argc, char *argv[])
 			struct entry_point_s *entry_point = self->entry_point;
 			
 			debug_print(DEBUG_MAIN, 1, "Start function block: %s:0x%"PRIx64"\n", external_entry_points[l].name, external_entry_points[l].value);	
+			stats_function = stats_begin(self, "decode_execute", l);
 			process_state = &external_entry_points[l].process_state;
 			memory_text = process_state->memory_text;
 			memory_stack = process_state->memory_stack;
@@ -5497,6 +5385,7 @@ int main(int argc, char *argv[])
 			entry_point[0].eip_init_value = memory_reg[2].init_value;
 			entry_point[0].eip_offset_value = memory_reg[2].offset_value;
 			entry_point[0].previous_instuction = 0;
+			entry_point[0].snapshot = NULL;
 
 			print_mem(memory_reg, 1);
 			debug_print(DEBUG_MAIN, 1, "LOGS: inst_log = 0x%"PRIx64"\n", inst_log);
@@ -5507,6 +5396,14 @@ int main(int argc, char *argv[])
 					/* Update EIP */
 					//debug_print(DEBUG_MAIN, 1, "entry:%d\n",n);
 					if (entry_point[n].used) {
+						/* Only pay for the restore if the path is going to be executed.
+						 * If it was already, process_block() just links it in.
+						 */
+						if (entry_point[n].snapshot &&
+							(entry_point[n].eip_offset_value < inst_size) &&
+							(0 == memory_used_get(memory_used, entry_point[n].eip_offset_value))) {
+							process_state_restore(process_state, entry_point[n].snapshot);
+						}
 						memory_reg[0].init_value = entry_point[n].esp_init_value;
 						memory_reg[0].offset_value = entry_point[n].esp_offset_value;
 						memory_reg[1].init_value = entry_point[n].ebp_init_value;
@@ -5523,11 +5420,14 @@ int main(int argc, char *argv[])
 							debug_print(DEBUG_MAIN, 1, "process_block failed\n");
 							return err;
 						}
+						process_state_snapshot_put(entry_point[n].snapshot);
+						entry_point[n].snapshot = NULL;
 						entry_point[n].used = 0;
 					}
 				}
 			} while (not_finished);	
 			external_entry_points[l].inst_log_end = inst_log - 1;
+			stats_end(self, stats_function);
 			debug_print(DEBUG_MAIN, 1, "LOGS: inst_log_end = 0x%"PRIx64"\n", inst_log);
 		}
 	}
@@ -5541,6 +5441,7 @@ int main(int argc, char *argv[])
 	}
 */
 	//inst_log--;
+	stats_end(self, stats_phase);
 	debug_print(DEBUG_MAIN, 1, "EXE FINISHED\n");
 	debug_print(DEBUG_MAIN, 1, "Instructions=%"PRId64", entry_point_list_length=%"PRId64"\n",
 		inst_log,
@@ -5550,18 +5451,23 @@ int main(int argc, char *argv[])
 	//inst_log--;
 
 	print_dis_instructions(self);
+	stats_phase = stats_begin(self, "tidy", -1);
 	debug_print(DEBUG_MAIN, 1, "start tidy\n");
 	tmp = tidy_inst_log(self);
+	stats_end(self, stats_phase);
 	print_dis_instructions(self);
+	stats_phase = stats_begin(self, "flag_dependency", -1);
 	self->flag_dependency = calloc(inst_log, sizeof(int));
 	self->flag_dependency_opcode = calloc(inst_log, sizeof(int));
 	self->flag_result_users = calloc(inst_log, sizeof(int));
 	self->flag_dependency_size = inst_log;
+	self->flag_dependency_max = inst_log;
 	debug_print(DEBUG_MAIN, 1, "got here I-0\n");
 	debug_print(DEBUG_MAIN, 1, "INFO: flag_dep_size initialised to 0x%"PRIx64"\n", inst_log);
 	if (inst_log > 0xe2c) {
 		debug_print(DEBUG_MAIN, 1, "INFO: flag_result_users 0xe2c = 0x%x\n", self->flag_result_users[0xe2c]);
 	}
+	tmp = inst_log_hot_build(self);
 	debug_print(DEBUG_MAIN, 1, "start build_flag_dependency_table\n");
 	tmp = build_flag_dependency_table(self);
 	debug_print(DEBUG_MAIN, 1, "got here I-1\n");
@@ -5582,7 +5488,9 @@ int main(int argc, char *argv[])
 	}
 	//tmp = insert_nop_after(self, 4);
 	print_dis_instructions(self);
+	stats_end(self, stats_phase);
 	/* Build the control flow nodes from the instructions. */
+	stats_phase = stats_begin(self, "node_build", -1);
 	tmp = build_control_flow_nodes(self, nodes, &nodes_size);
 	self->nodes_size = nodes_size;
 	tmp = print_control_flow_nodes(self, nodes, nodes_size);
@@ -5622,6 +5530,7 @@ int main(int argc, char *argv[])
 			tmp = create_function_node_members(self, &external_entry_points[l]);
 		}
 	}
+	stats_end(self, stats_phase);
 	
 	tmp = output_cfg_dot_basic(self, nodes, nodes_size);
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
@@ -5640,28 +5549,12 @@ int main(int argc, char *argv[])
 	for (n = 0; n < paths_size; n++) {
 		paths[n].path = calloc(1000, sizeof(int));
 	}
-	loops = calloc(loops_size, sizeof(struct loop_s));
-
-	for (n = 0; n < loops_size; n++) {
-		loops[n].list = calloc(1000, sizeof(int));
-	}
 
+	/* The ast tables grow as build_function_ast() needs them */
 	ast = calloc(1, sizeof(struct ast_s));
-	ast->ast_container = calloc(AST_SIZE, sizeof(struct ast_container_s));
-	ast->ast_if_then_else = calloc(AST_SIZE, sizeof(struct ast_if_then_else_s));
-	ast->ast_if_then_goto = calloc(AST_SIZE, sizeof(struct ast_if_then_goto_s));
-	ast->ast_loop = calloc(AST_SIZE, sizeof(struct ast_loop_s));
-	ast->ast_loop_container = calloc(AST_SIZE, sizeof(struct ast_loop_container_s));
-	ast->ast_loop_then_else = calloc(AST_SIZE, sizeof(struct ast_loop_then_else_s));
-	ast->ast_entry = calloc(AST_SIZE, sizeof(struct ast_entry_s));
-	ast->container_size = 0;
-	ast->if_then_else_size = 0;
-	ast->if_then_goto_size = 0;
-	ast->loop_size = 0;
-	ast->loop_container_size = 0;
-	ast->loop_then_else_size = 0;
 
 
+	stats_phase = stats_begin(self, "paths", -1);
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 //	for (l = 17; l < 19; l++) {
 //	for (l = 37; l < 38; l++) {
@@ -5671,10 +5564,10 @@ int main(int argc, char *argv[])
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
 			debug_print(DEBUG_MAIN, 1, "Starting external entry point %d:%s\n", l, external_entry_points[l].name);
 			int paths_used = 0;
-			int loops_used = 0;
 			int *multi_ret = NULL;
 			int multi_ret_size;
 
+			stats_function = stats_begin(self, "paths", l);
 			for (n = 0; n < paths_size; n++) {
 				paths[n].used = 0;
 				paths[n].path_prev = 0;
@@ -5683,11 +5576,6 @@ int main(int argc, char *argv[])
 				paths[n].type = PATH_TYPE_UNKNOWN;
 				paths[n].loop_head = 0;
 			}
-			for (n = 0; n < loops_size; n++) {
-				loops[n].size = 0;
-				loops[n].head = 0;
-				loops[n].nest = 0;
-			}
 
 			tmp = build_control_flow_paths(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size,
 				paths, &paths_size, &paths_used, 1);
@@ -5723,8 +5611,13 @@ int main(int argc, char *argv[])
 			};
 			//tmp = print_control_flow_paths(self, paths, &paths_size);
 
-			tmp = build_control_flow_loops(self, paths, &paths_size, loops, &loops_size);
-			tmp = build_control_flow_loops_node_members(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size, loops, &loops_size);
+			stats_end(self, stats_function);
+
+			stats_function = stats_begin(self, "loops", l);
+			tmp = build_control_flow_loop_forest(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size,
+				&(external_entry_points[l].loops), &(external_entry_points[l].loops_size));
+			stats_end(self, stats_function);
+			stats_function = stats_begin(self, "paths", l);
 			tmp = build_node_paths(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size, paths, &paths_size, l + 1);
 
 			external_entry_points[l].paths_size = paths_used;
@@ -5748,25 +5641,11 @@ int main(int argc, char *argv[])
 				}
 
 			}
-			for (n = 0; n < loops_size; n++) {
-				if (loops[n].size != 0) {
-					loops_used = n + 1;
-				}
-			}
-			debug_print(DEBUG_MAIN, 1, "loops_used = 0x%x\n", loops_used);
-			external_entry_points[l].loops_size = loops_used;
-			external_entry_points[l].loops = calloc(loops_used, sizeof(struct loop_s));
-			for (n = 0; n < loops_used; n++) {
-				external_entry_points[l].loops[n].head = loops[n].head;
-				external_entry_points[l].loops[n].size = loops[n].size;
-				external_entry_points[l].loops[n].nest = loops[n].nest;
-				external_entry_points[l].loops[n].list = calloc(loops[n].size, sizeof(int));
-				for (m = 0; m  < loops[n].size; m++) {
-					external_entry_points[l].loops[n].list[m] = loops[n].list[m];
-				}
-			}
+			stats_end(self, stats_function);
+			debug_print(DEBUG_MAIN, 1, "loops_size = 0x%x\n", external_entry_points[l].loops_size);
 		}
 	}
+	stats_end(self, stats_phase);
 	debug_print(DEBUG_MAIN, 1, "got here 2\n");
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
@@ -5775,6 +5654,7 @@ int main(int argc, char *argv[])
 		}
 	}
 	/* Node specific processing */
+	stats_phase = stats_begin(self, "dominance", -1);
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
 			debug_print(DEBUG_MAIN, 1, "got here 2a\n");
@@ -5786,11 +5666,9 @@ int main(int argc, char *argv[])
 			debug_print(DEBUG_MAIN, 1, "got here 2d\n");
 			//tmp = build_control_flow_depth(self, nodes, &nodes_size,
 			//		paths, &paths_size, &paths_used, external_entry_points[l].start_node);
-			tmp = build_control_flow_loops_multi_exit(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size,
-				external_entry_points[l].loops, external_entry_points[l].loops_size);
-			debug_print(DEBUG_MAIN, 1, "got here 2e\n");
 		}
 	}
+	stats_end(self, stats_phase);
 	debug_print(DEBUG_MAIN, 1, "got here 3\n");
 
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
@@ -5843,28 +5721,20 @@ int main(int argc, char *argv[])
 		}
 	}
 
-//	Doing this after SSA now.
-#if 0
-//      Don't bother with the AST output for now 
-//	tmp = output_cfg_dot(self, nodes, nodes_size);
+	/* Control flow graph to Abstract syntax tree. One function at a time, reusing the tables */
+	stats_phase = stats_begin(self, "ast", -1);
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-//	for (l = 0; l < 21; l++) {
-//	for (l = 21; l < 22; l++) {
-//	for (l = 4; l < 5; l++) {
-//		if (l == 21) continue;
-
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			/* Control flow graph to Abstract syntax tree */
-			debug_print(DEBUG_MAIN, 1, "cfg_to_ast. external entry point %d:%s\n", l, external_entry_points[l].name);
-			external_entry_points[l].start_ast_container = ast->container_size;
-			tmp = cfg_to_ast(self, nodes, &nodes_size, ast, external_entry_points[l].start_node);
+			debug_print(DEBUG_MAIN, 1, "build_function_ast. external entry point %d:%s\n", l, external_entry_points[l].name);
+			stats_function = stats_begin(self, "ast", l);
+			tmp = ast_reset(ast);
+			external_entry_points[l].start_ast_container = build_function_ast(self, &external_entry_points[l], ast);
 			tmp = print_ast(self, ast);
+			tmp = output_ast_dot(self, ast, &external_entry_points[l]);
+			stats_end(self, stats_function);
 		}
 	}
-	tmp = output_ast_dot(self, ast, nodes, &nodes_size);
-	/* FIXME */
-	//goto end_main;
-#endif
+	stats_end(self, stats_phase);
 
 #if 1
 
@@ -5895,6 +5765,14 @@ int main(int argc, char *argv[])
 	 * 2 = DST first
 	 * If SRC and DST in same instruction, set SRC first.
 	 ****************************************************************/
+	/* Callee summaries first, so a CALL can use the params of its target */
+	stats_phase = stats_begin(self, "call_graph", -1);
+	tmp = call_graph_build(self);
+	/* The functions served from the cache keep the summary they had */
+	tmp = summary_cache_summaries(self);
+	tmp = call_graph_summarise(self, 0);
+	stats_end(self, stats_phase);
+	stats_phase = stats_begin(self, "used_register", -1);
 	/* FIXME: TODO convert nodes to external_entry_points[l].nodes */
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
@@ -5910,6 +5788,7 @@ int main(int argc, char *argv[])
 			}
 		}
 	}
+	stats_end(self, stats_phase);
 	/* print node_used_register_table */
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
@@ -5922,6 +5801,7 @@ int main(int argc, char *argv[])
 	}
 
 
+	stats_phase = stats_begin(self, "phi", -1);
 	/****************************************************************
 	 * This section deals with building the initial PHI DST instructions
 	 * Create a PHI instruction for each entry in the node_used_register table,
@@ -5959,290 +5839,13 @@ int main(int argc, char *argv[])
 			tmp = fill_phi_node_list(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
 		}
 	}
-	/************************************************************
-	 * This section deals with starting true SSA.
-	 * This bit sets the valid_id to 0 for both dst and src.
-	 ************************************************************/
-	for (n = 1; n < inst_log; n++) {
-		inst_log1 =  &inst_log_entry[n];
-		inst_log1->value1.value_id = 0;
-		inst_log1->value1.indirect_value_id = 0;
-		inst_log1->value2.value_id = 0;
-		inst_log1->value2.indirect_value_id = 0;
-		inst_log1->value3.value_id = 0;
-		inst_log1->value3.indirect_value_id = 0;
-	}
-	
-	/************************************************************
-	 * This bit assigned a variable ID and label to each assignment (dst).
-	 ************************************************************/
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			external_entry_points[l].label_redirect = calloc(10000, sizeof(struct label_redirect_s));
-			external_entry_points[l].labels = calloc(10000, sizeof(struct label_s));
-			external_entry_points[l].variable_id = 0x100;
-
-			/* Init special labels */
-			/* param_stack0000 == EIP on the stack */
-			external_entry_points[l].label_redirect[3].redirect = 3;
-			external_entry_points[l].labels[3].scope = 2;
-			external_entry_points[l].labels[3].type = 2;
-			external_entry_points[l].labels[3].value = 0;
-			external_entry_points[l].labels[3].size_bits = 64;
-			external_entry_points[l].labels[3].lab_pointer = 1;
-
-			debug_print(DEBUG_MAIN, 1, "NAME DST: 0x%x:%s\n",
-				l, external_entry_points[l].name);
-			for (n = 0; n < MEMORY_STACK_SIZE; n++) {
-				if (external_entry_points[l].process_state.memory_stack[n].valid == 1) {
-					debug_print(DEBUG_MAIN, 1, "0x%x:memory_stack[%d].start_address = 0x%"PRIx64"\n",
-						l, n, external_entry_points[l].process_state.memory_stack[n].start_address);
-				}
-			}
-			for (n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!(external_entry_points[l].nodes[n].valid)) {
-					continue;
-				}
-				debug_print(DEBUG_ANALYSE, 1, "e1_node[0x%x]_start = inst 0x%x\n", n, external_entry_points[l].nodes[n].inst_start);
-				debug_print(DEBUG_ANALYSE, 1, "e1_node[0x%x]_end = inst 0x%x\n", n, external_entry_points[l].nodes[n].inst_end);
-			}
-
-			for(m = 1; m < external_entry_points[l].nodes_size; m++) {
-				int next;
-				if (!(external_entry_points[l].nodes[m].valid)) {
-					continue;
-				}
-				next = external_entry_points[l].nodes[m].inst_start;
-				do {
-					struct label_s label;
-					n = next;
-					inst_log1 =  &inst_log_entry[n];
-					instruction =  &inst_log1->instruction;
-					/* returns 0 for id and label set. 1 for error */
-					debug_print(DEBUG_MAIN, 1, "label address = %p\n", &label);
-					tmp  = assign_id_label_dst(self, l, n, inst_log1, &label);
-					debug_print(DEBUG_MAIN, 1, "value to log_to_label:inst = 0x%x: 0x%x, 0x%"PRIx64", 0x%x, 0x%x, 0x%"PRIx64", 0x%"PRIx64", 0x%"PRIx64"\n",
-						n,
-						instruction->dstA.indirect,
-						instruction->dstA.index,
-						instruction->dstA.relocated,
-						inst_log1->value3.value_scope,
-						inst_log1->value3.value_id,
-						inst_log1->value3.indirect_offset_value,
-						inst_log1->value3.indirect_value_id);
-
-					if (!tmp) {
-						debug_print(DEBUG_MAIN, 1, "variable_id = %x\n", external_entry_points[l].variable_id);
-						if (external_entry_points[l].variable_id >= 10000) {
-							debug_print(DEBUG_MAIN, 1, "variable_id overrun 10000 limit. Trying to write to %d\n", external_entry_points[l].variable_id);
-							exit(1);
-						}
-						external_entry_points[l].label_redirect[external_entry_points[l].variable_id].redirect = external_entry_points[l].variable_id;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].scope = label.scope;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].type = label.type;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].value = label.value;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].size_bits = label.size_bits;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].lab_pointer += label.lab_pointer;
-						external_entry_points[l].variable_id++;
-					} else {
-						debug_print(DEBUG_MAIN, 1, "assign_id_label_dst() failed\n");
-						exit(1);
-					}
-						
-					if (inst_log1->next_size) {
-						next = inst_log1->next[0];
-					} else if (n != external_entry_points[l].nodes[m].inst_end) {
-						debug_print(DEBUG_MAIN, 1, "DST inst 0x%x, l = 0x%x, m = 0x%x next failure. No inst_end!!! inst_end1 = 0x%x, inst_end2 = 0x%x\n",
-							n, l, m, external_entry_points[l].nodes[m].inst_end, external_entry_points[l].nodes[m - 1].inst_end);
-						exit(1);
-					}
-				} while (n != external_entry_points[l].nodes[m].inst_end);
-			}
-		}
-	}
-
-#if 0
-	for (n = 0x100; n < 0x130; n++) {
-		struct label_s *label;
-		tmp = label_redirect[n].redirect;
-		label = &labels[tmp];
-		printf("Label 0x%x:", n);
-		tmp = output_label(label, stdout);
-		printf("\n");
-	}
-#endif
-	/* Assign labels to PHI instructions dst */
-
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!(external_entry_points[l].nodes[n].valid)) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				printf("JCD: scanning node phi 0x%x\n", n);
-				if (external_entry_points[l].nodes[n].phi_size) {
-					printf("JCD: phi insts found at node 0x%x\n", n);
-					for (m = 0; m < external_entry_points[l].nodes[n].phi_size; m++) {
-						external_entry_points[l].nodes[n].phi[m].value_id = external_entry_points[l].variable_id;
-						external_entry_points[l].label_redirect[external_entry_points[l].variable_id].redirect = external_entry_points[l].variable_id;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].scope = 1;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].type = 1;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].lab_pointer = 0;
-						external_entry_points[l].labels[external_entry_points[l].variable_id].value = external_entry_points[l].variable_id;
-						external_entry_points[l].variable_id++;
-					}
-				}
-			}
-		}
-	}
-
-	/* TODO: add code to process the used_registers to identify registers
-	 * that are assigned dst in a previous node or function param
-	 */
-
-	/* Fill in the reg dependency table */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!external_entry_points[l].nodes[n].valid) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				tmp = fill_reg_dependency_table(self, &external_entry_points[l], n);
-				if (tmp) {
-					printf("fill_reg_dependency_table() failed\n");
-					exit(1);
-				}
-			}
-		}
-	}
-
-	/* print node_used_register_table */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			tmp = print_node_used_register_table(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
-			if (tmp) {
-				debug_print(DEBUG_MAIN, 1, "FIXME: print node used register table failed\n");
-				exit(1);
-			}
-		}
-	}
-
-
-
-
-#if 0
-	for (n = 1; n <= nodes_size; n++) {
-		for (m = 0; m < MAX_REG; m++) {
-			if (nodes[n].used_register[m].seen) {
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].seen = 0x%x\n", n, m, 
-					nodes[n].used_register[m].seen);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].size = 0x%x\n", n, m, 
-					nodes[n].used_register[m].size);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].src = 0x%x\n", n, m, 
-					nodes[n].used_register[m].src);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].dst = 0x%x\n", n, m, 
-					nodes[n].used_register[m].dst);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].src_fist_value_id = 0x%x\n", n, m, 
-					nodes[n].used_register[m].src_first_value_id);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].src_fist_node = 0x%x\n", n, m, 
-					nodes[n].used_register[m].src_first_node);
-				debug_print(DEBUG_MAIN, 1, "node[0x%x].user_register[0x%x].src_fist_label = 0x%x\n", n, m, 
-					nodes[n].used_register[m].src_first_label);
-			}
-		}
-	}
-#endif
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		for (m = 0; m < MAX_REG; m++) {
-			if (self->external_entry_points[l].param_reg_label[m]) {
-				debug_print(DEBUG_MAIN, 1, "Entry Point 0x%x: Found reg 0x%x as param label 0x%x\n", l, m,
-					self->external_entry_points[l].param_reg_label[m]);
-			}
-		}
-	}
-	/* Enter value id/label id of param into phi with src node 0. */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			tmp = fill_phi_src_value_id(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
-		}
-	}
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			tmp = fill_phi_dst_size_from_src_size(self, l);
-		}
-	}
-	/* Enter value id/label id of param into phi with src node 0. */
-	/* TODO */
-
-	/* Assign labels to instructions src */
-	/* TODO: WIP: Work in progress */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!external_entry_points[l].nodes[n].valid) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				tmp = assign_labels_to_src(self, l, n);
-				if (tmp) {
-					printf("assign_labels_to_src() failed\n");
-					exit(1);
-				}
-			}
-		}
-	}
-	/* turn "MOV reg, reg" into a NOP from the SSA perspective. Make the dst = src label */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!external_entry_points[l].nodes[n].valid) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				tmp = redirect_mov_reg_reg_labels(self, &external_entry_points[l], n);
-				if (tmp) {
-					printf("redirect_mov_reg_reg() failed\n");
-					exit(1);
-				}
-			}
-		}
-	}
-	/* Change ADD to GEP1 where the ADD involves pointers */
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!external_entry_points[l].nodes[n].valid) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				tmp = change_add_to_gep1(self, &external_entry_points[l], n);
-				if (tmp) {
-					printf("change_add_to_gep1() failed\n");
-					exit(1);
-				}
-			}
-		}
-	}
-	/* Discover pointer types */
+	/* Register liveness, and which registers are written on some path to each node. */
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			for(n = 1; n < external_entry_points[l].nodes_size; n++) {
-				if (!external_entry_points[l].nodes[n].valid) {
-					/* Only output nodes that are valid */
-					continue;
-				}
-				tmp = discover_pointer_types(self, &external_entry_points[l], n);
-				if (tmp) {
-					printf("discover_pointer_types() failed\n");
-					exit(1);
-				}
-			}
+			tmp = build_node_reg_liveness(self, external_entry_points[l].nodes, external_entry_points[l].nodes_size);
 		}
 	}
-
-	print_dis_instructions(self);
+	stats_end(self, stats_phase);
 #if 0
 	for (n = 0x100; n < 0x130; n++) {
 		struct label_s *label;
@@ -6263,14 +5866,8 @@ int main(int argc, char *argv[])
 //	label_redirect = calloc(self->local_counter + 1, sizeof(struct label_redirect_s));
 //	labels = calloc(self->local_counter + 1, sizeof(struct label_s));
 //	debug_print(DEBUG_MAIN, 1, "JCD6: self->local_counter=%d\n", self->local_counter);
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if (external_entry_points[l].valid && external_entry_points[l].type == 1) {
-			external_entry_points[l].labels[0].lab_pointer = 1; /* EIP */
-			external_entry_points[l].labels[1].lab_pointer = 1; /* ESP */
-			external_entry_points[l].labels[2].lab_pointer = 1; /* EBP */
-		}
-	}
 #if 0	
+	/* The def-use index is built per function by function_assign_labels() */
 	/* n <= inst_log verified to be correct limit */
 	for (n = 1; n <= inst_log; n++) {
 		struct label_s label;
@@ -6520,8 +6117,6 @@ int main(int argc, char *argv[])
 		uint64_t value_id2;
 		uint64_t size;
 		uint64_t *inst_list;
-		uint64_t mid_start_size;
-		struct mid_start_s *mid_start;
 
 		size = 0;
 		inst_log1 =  &inst_log_entry[n];
@@ -6551,14 +6146,7 @@ int main(int argc, char *argv[])
 					return 1;
 				}
 				if (0 < inst_log1->prev_size) {
-					mid_start = calloc(inst_log1->prev_size, sizeof(struct mid_start_s));
-					mid_start_size = inst_log1->prev_size;
-					for (l = 0; l < inst_log1->prev_size; l++) {
-						mid_start[l].mid_start = inst_log1->prev[l];
-						mid_start[l].valid = 1;
-						debug_print(DEBUG_MAIN, 1, "mid_start added 0x%"PRIx64" at 0x%x\n", mid_start[l].mid_start, l);
-					}
-					tmp = search_back_local_reg_stack(self, mid_start_size, mid_start, 1, inst_log1->instruction.srcA.index, 0, &size, self->search_back_seen, &inst_list);
+					tmp = def_use_reaching(self, def_use_of_inst(self, n), 1, inst_log1->instruction.srcA.index, 0, n, &size, &inst_list);
 					if (tmp) {
 						debug_print(DEBUG_MAIN, 1, "SSA search_back Failed at inst_log 0x%x\n", n);
 						return 1;
@@ -6614,8 +6202,6 @@ int main(int argc, char *argv[])
 		uint64_t value_id1;
 		uint64_t size;
 		uint64_t *inst_list;
-		uint64_t mid_start_size;
-		struct mid_start_s *mid_start;
 
 		size = 0;
 		inst_log1 =  &inst_log_entry[n];
@@ -6657,14 +6243,7 @@ int main(int argc, char *argv[])
 					return 1;
 				}
 				if (0 < inst_log1->prev_size) {
-					mid_start = calloc(inst_log1->prev_size, sizeof(struct mid_start_s));
-					mid_start_size = inst_log1->prev_size;
-					for (l = 0; l < inst_log1->prev_size; l++) {
-						mid_start[l].mid_start = inst_log1->prev[l];
-						mid_start[l].valid = 1;
-						debug_print(DEBUG_MAIN, 1, "mid_start added 0x%"PRIx64" at 0x%x\n", mid_start[l].mid_start, l);
-					}
-					tmp = search_back_local_reg_stack(self, mid_start_size, mid_start, 2, inst_log1->value1.indirect_init_value, inst_log1->value1.indirect_offset_value, &size, self->search_back_seen, &inst_list);
+					tmp = def_use_reaching(self, def_use_of_inst(self, n), 2, inst_log1->value1.indirect_init_value, inst_log1->value1.indirect_offset_value, n, &size, &inst_list);
 					if (tmp) {
 						debug_print(DEBUG_MAIN, 1, "SSA search_back Failed at inst_log 0x%x\n", n);
 						return 1;
@@ -6779,52 +6358,6 @@ int main(int argc, char *argv[])
 		}
 	}
 #endif
-	/***************************************************
-	 * This section sorts the external entry point params to the correct order
-	 ***************************************************/
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		for (m = 0; m < REG_PARAMS_ORDER_MAX; m++) {
-			struct label_s *label;
-			for (n = 0; n < external_entry_points[l].params_size; n++) {
-				uint64_t tmp_param;
-				tmp = external_entry_points[l].params[n];
-				debug_print(DEBUG_MAIN, 1, "JCD5: labels 0x%x, params_size=%d\n", tmp, external_entry_points[l].params_size);
-				if (tmp >= external_entry_points[l].variable_id) {
-					debug_print(DEBUG_MAIN, 1, "Invalid entry point 0x%x, l=%d, m=%d, n=%d, params_size=%d\n",
-						tmp, l, m, n, external_entry_points[l].params_size);
-					return 0;
-				}
-				label = &(external_entry_points[l].labels[tmp]);
-				debug_print(DEBUG_MAIN, 1, "JCD5: labels 0x%x\n", external_entry_points[l].params[n]);
-				debug_print(DEBUG_MAIN, 1, "JCD5: label=%p, l=%d, m=%d, n=%d\n", label, l, m, n);
-				debug_print(DEBUG_MAIN, 1, "reg_params_order = 0x%x,", reg_params_order[m]);
-				debug_print(DEBUG_MAIN, 1, " label->value = 0x%"PRIx64"\n", label->value);
-				if ((label->scope == 2) &&
-					(label->type == 1) &&
-					(label->value == reg_params_order[m])) {
-					/* Swap params */
-					/* FIXME: How to handle the case of params_size <= n or m */
-					if (n != m) {
-						debug_print(DEBUG_MAIN, 1, "JCD4: swapping n=0x%x and m=0x%x\n", n, m);
-						tmp = external_entry_points[l].params_size;
-						if ((m >= tmp || n >= tmp)) { 
-							external_entry_points[l].params_size++;
-							external_entry_points[l].params =
-								realloc(external_entry_points[l].params, external_entry_points[l].params_size * sizeof(int));
-							/* FIXME: Need to get label right */
-							external_entry_points[l].params[external_entry_points[l].params_size - 1] =
-								external_entry_points[l].variable_id;
-							external_entry_points[l].variable_id++;
-						}
-						tmp_param = external_entry_points[l].params[n];
-						external_entry_points[l].params[n] =
-							external_entry_points[l].params[m];
-						external_entry_points[l].params[m] = tmp_param;
-					}
-				}
-			}
-		}
-	}
 
 
 
@@ -6844,8 +6377,6 @@ int main(int argc, char *argv[])
 		uint64_t *inst_list;
 		struct extension_call_s *call;
 		struct external_entry_point_s *external_entry_point;
-		uint64_t mid_start_size;
-		struct mid_start_s *mid_start;
 
 		size = 0;
 		inst_log1 =  &inst_log_entry[n];
@@ -6878,26 +6409,17 @@ int main(int argc, char *argv[])
 					debug_print(DEBUG_MAIN, 1, "search_back ended\n");
 					return 1;
 				}
-				if (0 < inst_log1->prev_size) {
-					mid_start = calloc(inst_log1->prev_size, sizeof(struct mid_start_s));
-					mid_start_size = inst_log1->prev_size;
-					for (l = 0; l < inst_log1->prev_size; l++) {
-						mid_start[l].mid_start = inst_log1->prev[l];
-						mid_start[l].valid = 1;
-						debug_print(DEBUG_MAIN, 1, "mid_start added 0x%"PRIx64" at 0x%x\n", mid_start[l].mid_start, l);
-					}
-				}
 				/* param_regXXX */
 				if ((2 == label->scope) &&
 					(1 == label->type)) {
 					debug_print(DEBUG_MAIN, 1, "PARAM: Searching for REG0x%"PRIx64":0x%"PRIx64" + label->value(0x%"PRIx64")\n", inst_log1->value1.init_value, inst_log1->value1.offset_value, label->value);
-					tmp = search_back_local_reg_stack(self, mid_start_size, mid_start, 1, label->value, 0, &size, self->search_back_seen, &inst_list);
+					tmp = def_use_reaching(self, def_use_of_inst(self, n), 1, label->value, 0, n, &size, &inst_list);
 					debug_print(DEBUG_MAIN, 1, "search_backJCD1: tmp = %d\n", tmp);
 				} else {
 				/* param_stackXXX */
 				/* SP value held in value1 */
 					debug_print(DEBUG_MAIN, 1, "PARAM: Searching for SP(0x%"PRIx64":0x%"PRIx64") + label->value(0x%"PRIx64") - 8\n", inst_log1->value1.init_value, inst_log1->value1.offset_value, label->value);
-					tmp = search_back_local_reg_stack(self, mid_start_size, mid_start, 2, inst_log1->value1.init_value, inst_log1->value1.offset_value + label->value - 8, &size, self->search_back_seen, &inst_list);
+					tmp = def_use_reaching(self, def_use_of_inst(self, n), 2, inst_log1->value1.init_value, inst_log1->value1.offset_value + label->value - 8, n, &size, &inst_list);
 				/* FIXME: Some renaming of local vars will also be needed if size > 1 */
 				}
 				if (tmp) {
@@ -7044,24 +6566,25 @@ int main(int argc, char *argv[])
 
 #endif
 
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if ((external_entry_points[l].valid) && (external_entry_points[l].type == 1)) {
-			debug_print(DEBUG_MAIN, 1, "name = %s\n", external_entry_points[l].name);
-			debug_print(DEBUG_MAIN, 1, "params size = 0x%x\n", external_entry_points[l].params_size);
-			for (n = 0; n < external_entry_points[l].params_size; n++) {
-				debug_print(DEBUG_MAIN, 1, "params = 0x%x\n", external_entry_points[l].params[n]);
-			}
-		}
-	}
-
-	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
-		if ((external_entry_points[l].valid) && (external_entry_points[l].type == 1)) {
-			tmp = output_cfg_dot(self, external_entry_points[l].label_redirect, external_entry_points[l].labels, l);
-		}
-	}
 	/***************************************************
-	 * This section deals with outputting the .c file.
+	 * This section labels each function, and then writes it out to the .c file,
+	 * and a .dot file. The callee summaries are final, so each function is done
+	 * in turn, and the tables only needed to analyse it are freed after its output.
 	 ***************************************************/
+	stats_phase = stats_begin(self, "labels_output", -1);
+	/************************************************************
+	 * This section deals with starting true SSA.
+	 * This bit sets the valid_id to 0 for both dst and src.
+	 ************************************************************/
+	for (n = 1; n < inst_log; n++) {
+		inst_log1 =  &inst_log_entry[n];
+		inst_log1->value1.value_id = 0;
+		inst_log1->value1.indirect_value_id = 0;
+		inst_log1->value2.value_id = 0;
+		inst_log1->value2.indirect_value_id = 0;
+		inst_log1->value3.value_id = 0;
+		inst_log1->value3.indirect_value_id = 0;
+	}
 	filename = "test.c";
 	fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
 	if (fd < 0) {
@@ -7069,12 +6592,23 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 	debug_print(DEBUG_MAIN, 1, ".c fd=%d\n", fd);
+	string_init(&string, fd);
 	debug_print(DEBUG_MAIN, 1, "writing out to file\n");
-	tmp = dprintf(fd, "#include <stdint.h>\n\n");
+	tmp = string_printf(&string, "#include <stdint.h>\n\n");
 	debug_print(DEBUG_MAIN, 1, "PRINTING MEMORY_DATA\n");
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		struct process_state_s *process_state;
-		if (external_entry_points[l].valid) {
+		if (external_entry_points[l].valid && (external_entry_points[l].type == 3)) {
+			/* Not executed this time, so its memory_data is not filled in */
+			summary_cache_text(self, l, SUMMARY_CACHE_DATA, &cached, &cached_size);
+			tmp = string_cat(&string, (char *)cached, cached_size);
+		} else if (external_entry_points[l].valid) {
+			/* Kept apart as well, for the cache */
+			out = &string;
+			if (self->summary_cache && (external_entry_points[l].type == 1)) {
+				string_init(&function_string, -1);
+				out = &function_string;
+			}
 			process_state = &external_entry_points[l].process_state;
 			memory_data = process_state->memory_data;
 			for (n = 0; n < 4; n++) {
@@ -7086,23 +6620,35 @@ int main(int argc, char *argv[])
 						debug_print(DEBUG_MAIN, 1, "int *data%04"PRIx64" = &data%04"PRIx64"\n",
 							memory_data[n].start_address,
 							memory_data[n].init_value);
-						tmp = dprintf(fd, "int *data%04"PRIx64" = &data%04"PRIx64";\n",
+						tmp = string_printf(out, "int *data%04"PRIx64" = &data%04"PRIx64";\n",
 							memory_data[n].start_address,
 							memory_data[n].init_value);
 					} else {
 						debug_print(DEBUG_MAIN, 1, "int data%04"PRIx64" = 0x%04"PRIx64"\n",
 							memory_data[n].start_address,
 							memory_data[n].init_value);
-						tmp = dprintf(fd, "int data%04"PRIx64" = 0x%"PRIx64";\n",
+						tmp = string_printf(out, "int data%04"PRIx64" = 0x%"PRIx64";\n",
 							memory_data[n].start_address,
 							memory_data[n].init_value);
 					}
 				}
 			}
+			if (out != &string) {
+				tmp = string_cat(&string, out->string, out->len);
+				summary_cache_set_text(self, l, SUMMARY_CACHE_DATA, out->string, out->len);
+				string_free(out);
+			}
 		}
 	}
-	tmp = dprintf(fd, "\n");
+	tmp = string_printf(&string, "\n");
 	debug_print(DEBUG_MAIN, 1, "\n");
+	if (llvm_path) {
+		/* Each function is submitted once its output is written. Linked after the loop */
+		llvm_exporter = llvm_export_begin(self, llvm_path, 0, llvm_passes);
+		if (!llvm_exporter) {
+			debug_print(DEBUG_MAIN, 1, "llvm_export_begin failed\n");
+		}
+	}
 #if 0
 	for (n = 0; n < 100; n++) {
 		param_present[n] = 0;
@@ -7140,6 +6686,18 @@ int main(int argc, char *argv[])
 					external_entry_points[l].inst_log,
 					external_entry_points[l].inst_log_end);
 		}
+		if (external_entry_points[l].valid &&
+			external_entry_points[l].type == 3) {
+			/* Served from the cache. Its text and bitcode are as last time */
+			stats_function = stats_begin(self, "c_output", l);
+			summary_cache_text(self, l, SUMMARY_CACHE_C, &cached, &cached_size);
+			tmp = string_cat(&string, (char *)cached, cached_size);
+			stats_end(self, stats_function);
+			if (llvm_exporter) {
+				llvm_export_submit(llvm_exporter, l);
+			}
+			continue;
+		}
 		if (external_entry_points[l].valid &&
 			external_entry_points[l].type == 1) {
 			struct process_state_s *process_state;
@@ -7147,8 +6705,28 @@ int main(int argc, char *argv[])
 			
 			process_state = &external_entry_points[l].process_state;
 
-			tmp = dprintf(fd, "\n");
-			output_function_name(fd, &external_entry_points[l]);
+			stats_function = stats_begin(self, "labels", l);
+			tmp = function_assign_labels(self, l);
+			if (!tmp) {
+				tmp = function_sort_params(self, l);
+			}
+			stats_end(self, stats_function);
+			if (tmp) {
+				debug_print(DEBUG_MAIN, 1, "%s: labels failed, not output\n",
+					external_entry_points[l].name);
+				continue;
+			}
+
+			stats_function = stats_begin(self, "c_output", l);
+			/* With a cache, the function is written to function_string first, to keep a copy */
+			out = &string;
+			if (self->summary_cache) {
+				string_init(&function_string, -1);
+				out = &function_string;
+			}
+			tmp = output_cfg_dot(self, external_entry_points[l].label_redirect, external_entry_points[l].labels, l);
+			tmp = string_printf(out, "\n");
+			output_function_name(out, &external_entry_points[l]);
 			tmp_state = 0;
 			for (m = 0; m < REG_PARAMS_ORDER_MAX; m++) {
 				struct label_s *label;
@@ -7160,15 +6738,15 @@ int main(int argc, char *argv[])
 						(label->type == 1) &&
 						(label->value == reg_params_order[m])) {
 						if (tmp_state > 0) {
-							dprintf(fd, ", ");
+							string_printf(out, ", ");
 						}
-						dprintf(fd, "int%"PRId64"_t ",
+						string_printf(out, "int%"PRId64"_t ",
 							label->size_bits);
 						if (label->lab_pointer) {
-							dprintf(fd, "*");
+							string_printf(out, "*");
 						}
 						tmp = label_to_string(label, buffer, 1023);
-						dprintf(fd, "%s", buffer);
+						string_printf(out, "%s", buffer);
 						tmp_state++;
 					}
 				}
@@ -7182,35 +6760,35 @@ int main(int argc, char *argv[])
 					continue;
 				}
 				if (tmp_state > 0) {
-					dprintf(fd, ", ");
+					string_printf(out, ", ");
 				}
-				dprintf(fd, "int%"PRId64"_t ",
+				string_printf(out, "int%"PRId64"_t ",
 					label->size_bits);
 				if (label->lab_pointer) {
-					dprintf(fd, "*");
+					string_printf(out, "*");
 				}
 				tmp = label_to_string(label, buffer, 1023);
-				dprintf(fd, "%s", buffer);
+				string_printf(out, "%s", buffer);
 				tmp_state++;
 			}
-			tmp = dprintf(fd, ")\n{\n");
+			tmp = string_printf(out, ")\n{\n");
 			for (n = 0; n < external_entry_points[l].locals_size; n++) {
 				struct label_s *label;
 				char buffer[1024];
 				label = &(external_entry_points[l].labels[external_entry_points[l].locals[n]]);
-				dprintf(fd, "\tint%"PRId64"_t ",
+				string_printf(out, "\tint%"PRId64"_t ",
 					label->size_bits);
 				if (label->lab_pointer) {
-					dprintf(fd, "*");
+					string_printf(out, "*");
 				}
 				tmp = label_to_string(label, buffer, 1023);
-				dprintf(fd, "%s", buffer);
-				dprintf(fd, ";\n");
+				string_printf(out, "%s", buffer);
+				string_printf(out, ";\n");
 			}
-			dprintf(fd, "\n");
+			string_printf(out, "\n");
 					
 			tmp = output_function_body(self, process_state,
-				fd,
+				out,
 				external_entry_points[l].inst_log,
 				external_entry_points[l].inst_log_end,
 				external_entry_points[l].label_redirect,
@@ -7218,13 +6796,37 @@ int main(int argc, char *argv[])
 			if (tmp) {
 				return 1;
 			}
+			if (out != &string) {
+				tmp = string_cat(&string, out->string, out->len);
+				summary_cache_set_text(self, l, SUMMARY_CACHE_C, out->string, out->len);
+				string_free(out);
+				summary_cache_add(self, l);
+			}
+			/* string_printf() writes out each 64KiB, so no flush per function */
+			stats_end(self, stats_function);
+			if (llvm_exporter) {
+				/* The IR is built by the export workers while the next function is labelled */
+				llvm_export_submit(llvm_exporter, l);
+			}
+			if (hexdump) {
+				debug_print(DEBUG_MAIN, 1, "memory_used: %s\n", external_entry_points[l].name);
+				for (n = 0; n < inst_size; n++) {
+					debug_print(DEBUG_MAIN, 1, "0x%04x: %d\n", n,
+						memory_used_get(external_entry_points[l].process_state.memory_used, n));
+				}
+			}
+			tmp = function_analysis_free(self, &external_entry_points[l]);
 //   This code is not doing anything, so comment it out
 //			for (n = external_entry_points[l].inst_log; n <= external_entry_points[l].inst_log_end; n++) {
 //			}			
 		}
 	}
 
+	string_free(&string);
 	close(fd);
+	stats_end(self, stats_phase);
+
+	print_dis_instructions(self);
 
 	for (l = 0; l < EXTERNAL_ENTRY_POINTS_MAX; l++) {
 		if (external_entry_points[l].valid &&
@@ -7235,12 +6837,26 @@ int main(int argc, char *argv[])
 		}
 	}
 	//tmp = llvm_export(self);
+	if (llvm_exporter) {
+		/* Waits for the functions still being built, and links them */
+		stats_phase = stats_begin(self, "llvm_export", -1);
+		tmp = llvm_export_end(llvm_exporter);
+		stats_end(self, stats_phase);
+		if (tmp) {
+			debug_print(DEBUG_MAIN, 1, "llvm_export_end failed\n");
+		}
+	}
+	if (cache_path) {
+		/* After the LLVM export, as the workers add the bitcode of each function */
+		stats_phase = stats_begin(self, "summary_cache_write", -1);
+		tmp = summary_cache_close(self);
+		stats_end(self, stats_phase);
+	}
+	inst_node_free(self);
+	inst_log_hot_free(self);
 
 	bf_test_close_file(handle_void);
 	print_mem(memory_reg, 1);
-	for (n = 0; n < inst_size; n++) {
-		debug_print(DEBUG_MAIN, 1, "0x%04x: %d\n", n, memory_used[n]);
-	}
 	debug_print(DEBUG_MAIN, 1, "PRINTING MEMORY_DATA\n");
 	for (n = 0; n < 4; n++) {
 		print_mem(memory_data, n);
@@ -7278,6 +6894,13 @@ int main(int argc, char *argv[])
 	}
 #endif
 //end_main:
+	if (stats_path) {
+		tmp = stats_write_json(self, stats_path);
+	}
+	if (trace_path) {
+		tmp = stats_write_trace(self, trace_path);
+	}
+	stats_close(self);
 	debug_print(DEBUG_MAIN, 1, "END - FINISHED PROCESSING\n");
 	return 0;
 }
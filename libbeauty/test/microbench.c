@@ -0,0 +1,531 @@
+/*
+ *  Copyright (C) 2004-2014 The libbeauty Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Microbenchmarks of the hot paths, one at a time, outside of dis64.
+ *	search_store(), add_new_store()	A memory_s table of --size stores
+ *	is_subset()			Sorted node lists of --size entries, a hit and a miss
+ *	build_control_flow_paths()	A chain of if/else diamonds, 2^depth paths
+ *	tidy_inst_log()			--size instructions with duplicate next[] and prev[]
+ *	decode + convert_ll_inst_to_rtl()	A mix of common instructions, --size times
+ * Given a .o file, also:
+ *	bf_relocated_code()		Every offset of .text
+ *	decode + convert_ll_inst_to_rtl()	All of .text, with its relocations
+ * Each is run --iterations times. The min and median ns per operation are printed,
+ * so a change to one of these can be measured before and after.
+ */
+
+#define __STDC_LIMIT_MACROS
+#define __STDC_CONSTANT_MACROS
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <llvm-c/Disassembler.h>
+#include <llvm-c/Target.h>
+#include "instruction_low_level.h"
+#include "decode_inst.h"
+#include <rev.h>
+#include <dis.h>
+#include <convert_ll_inst_to_rtl.h>
+
+uint8_t *inst;
+size_t inst_size = 0;
+uint8_t *data;
+size_t data_size = 0;
+uint8_t *rodata;
+size_t rodata_size = 0;
+char *dis_flags_table[] = { " ", "f" };
+uint64_t inst_log = 1;	/* Pointer to the current free instruction log entry. */
+
+/* Nothing, so the debug_print() calls cost what they cost in a quiet dis64 run */
+int debug_level[DEBUG_MODULE_MAX] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/* Only reached through the debug_print() macro, once the level has been checked */
+void debug_print_out(int module, int level, const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+}
+
+#define MICROBENCH_ITERATIONS_MAX 1000
+/* build_control_flow_paths() has room for 1000 pending branches */
+#define MICROBENCH_PATHS_DEPTH_MAX 10
+#define MICROBENCH_PATHS_SIZE 300000
+
+/* The same as dis64, without the printing */
+int disassemble(struct self_s *self, struct dis_instructions_s *dis_instructions, uint8_t *base_address, uint64_t buffer_size, uint64_t offset)
+{
+	struct instruction_low_level_s *ll_inst = (struct instruction_low_level_s *)self->ll_inst;
+	LLVMDecodeAsmX86_64Ref da = self->decode_asm;
+	int tmp;
+
+	ll_inst->opcode = 0;
+	ll_inst->srcA.kind = KIND_EMPTY;
+	ll_inst->srcB.kind = KIND_EMPTY;
+	ll_inst->dstA.kind = KIND_EMPTY;
+	tmp = LLVMInstructionDecodeAsmX86_64(da, base_address,
+		buffer_size, offset,
+		ll_inst);
+	if (tmp) {
+		return 1;
+	}
+	dis_instructions->instruction_number = 0;
+	dis_instructions->bytes_used = 0;
+	tmp = convert_ll_inst_to_rtl(self, ll_inst, dis_instructions);
+	if (tmp) {
+		return 1;
+	}
+	return 0;
+}
+
+static uint64_t microbench_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int microbench_cmp(const void *a, const void *b)
+{
+	uint64_t sample_a = *(const uint64_t *)a;
+	uint64_t sample_b = *(const uint64_t *)b;
+
+	if (sample_a < sample_b) {
+		return -1;
+	}
+	return (sample_a > sample_b);
+}
+
+/* sample[] is ns per iteration, each of ops operations */
+static int microbench_report(int out, const char *name, const char *input, uint64_t ops, uint64_t *sample, int iterations)
+{
+	if (!ops) {
+		ops = 1;
+	}
+	qsort(sample, iterations, sizeof(uint64_t), microbench_cmp);
+	dprintf(out, "%-28s %-12s %10"PRIu64" %12.1f %12.1f\n",
+		name, input, ops,
+		(double)sample[0] / ops,
+		(double)sample[(iterations - 1) / 2] / ops);
+	return 0;
+}
+
+static int microbench_store(int out, int size, int iterations)
+{
+	struct memory_s *memory;
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	uint64_t found = 0;
+	int iteration;
+	int n;
+
+	memory = calloc(size + 1, sizeof(struct memory_s));
+	if (!memory) {
+		printf("microbench_store: calloc failed\n");
+		exit(1);
+	}
+	for (iteration = 0; iteration < iterations; iteration++) {
+		memset(memory, 0, (size + 1) * sizeof(struct memory_s));
+		start = microbench_clock();
+		for (n = 0; n < size; n++) {
+			add_new_store(memory, n * 8, 64);
+		}
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "add_new_store", "synthetic", size, sample, iterations);
+
+	for (iteration = 0; iteration < iterations; iteration++) {
+		start = microbench_clock();
+		for (n = 0; n < size; n++) {
+			/* Spread over the table, not in the order added */
+			if (search_store(memory, ((n * 7919) % size) * 8, 64)) {
+				found++;
+			}
+		}
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "search_store", "synthetic", size, sample, iterations);
+	free(memory);
+	return (found != (uint64_t)size * iterations);
+}
+
+static int microbench_is_subset(int out, int size, int iterations)
+{
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	int *a;
+	int *b;
+	int result = 0;
+	int iteration;
+	int n;
+
+	a = calloc(size + 1, sizeof(int));
+	b = calloc(size + 1, sizeof(int));
+	if (!a || !b) {
+		printf("microbench_is_subset: calloc failed\n");
+		exit(1);
+	}
+	/* a is every other entry of b */
+	for (n = 0; n < size; n++) {
+		b[n] = n + 1;
+		a[n / 2] = (n & ~1) + 1;
+	}
+	for (iteration = 0; iteration < iterations; iteration++) {
+		start = microbench_clock();
+		result |= is_subset(size / 2, a, size, b);
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "is_subset", "hit", size, sample, iterations);
+
+	/* The last entry is missing, so it all has to be searched */
+	a[size / 2 - 1] = size + 1;
+	for (iteration = 0; iteration < iterations; iteration++) {
+		start = microbench_clock();
+		result |= is_subset(size / 2, a, size, b);
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "is_subset", "miss", size, sample, iterations);
+	free(a);
+	free(b);
+	return (result != 2);
+}
+
+/* Node 1 branches to 2 and 3, which both go to 4, which branches to 5 and 6 ... */
+static int microbench_paths(int out, struct self_s *self, int depth, int iterations)
+{
+	struct control_flow_node_s *nodes;
+	struct path_s *paths;
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	int nodes_size = depth * 3 + 2;
+	int paths_size = MICROBENCH_PATHS_SIZE;
+	int paths_used = 0;
+	int iteration;
+	int node;
+	int n;
+
+	nodes = calloc(nodes_size, sizeof(struct control_flow_node_s));
+	paths = calloc(paths_size, sizeof(struct path_s));
+	if (!nodes || !paths) {
+		printf("microbench_paths: calloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < paths_size; n++) {
+		paths[n].path = calloc(1000, sizeof(int));
+		if (!paths[n].path) {
+			printf("microbench_paths: calloc failed\n");
+			exit(1);
+		}
+	}
+	for (n = 0; n < depth; n++) {
+		node = n * 3 + 1;
+		nodes[node].valid = 1;
+		nodes[node].next_size = 2;
+		nodes[node].link_next = calloc(2, sizeof(struct node_link_s));
+		nodes[node].link_next[0].node = node + 1;
+		nodes[node].link_next[1].node = node + 2;
+		nodes[node + 1].valid = 1;
+		nodes[node + 1].next_size = 1;
+		nodes[node + 1].link_next = calloc(1, sizeof(struct node_link_s));
+		nodes[node + 1].link_next[0].node = node + 3;
+		nodes[node + 2].valid = 1;
+		nodes[node + 2].next_size = 1;
+		nodes[node + 2].link_next = calloc(1, sizeof(struct node_link_s));
+		nodes[node + 2].link_next[0].node = node + 3;
+	}
+	nodes[depth * 3 + 1].valid = 1;
+
+	for (iteration = 0; iteration < iterations; iteration++) {
+		for (n = 0; n < paths_size; n++) {
+			paths[n].used = 0;
+			paths[n].path_prev = 0;
+			paths[n].path_prev_index = 0;
+			paths[n].path_size = 0;
+			paths[n].type = PATH_TYPE_UNKNOWN;
+			paths[n].loop_head = 0;
+		}
+		start = microbench_clock();
+		build_control_flow_paths(self, nodes, nodes_size, paths, &paths_size, &paths_used, 1);
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "build_control_flow_paths", "synthetic", paths_used, sample, iterations);
+
+	for (n = 0; n < nodes_size; n++) {
+		free(nodes[n].link_next);
+	}
+	for (n = 0; n < paths_size; n++) {
+		free(paths[n].path);
+	}
+	free(nodes);
+	free(paths);
+	return (paths_used != (1 << depth));
+}
+
+static int microbench_tidy_inst_log(int out, struct self_s *self, int size, int iterations)
+{
+	struct inst_log_entry_s *inst_log_entry;
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	int wrong = 0;
+	int iteration;
+	int n;
+
+	inst_log_entry = calloc(size + 2, sizeof(struct inst_log_entry_s));
+	if (!inst_log_entry) {
+		printf("microbench_tidy_inst_log: calloc failed\n");
+		exit(1);
+	}
+	self->inst_log_entry = inst_log_entry;
+	inst_log = size + 1;
+	for (iteration = 0; iteration < iterations; iteration++) {
+		/* tidy_inst_log() changes the lists, so make them again.
+		 * It frees the prev of inst 1, a lone 0, and leaves it NULL. realloc() of NULL is a malloc().
+		 */
+		for (n = 1; n <= size; n++) {
+			inst_log_entry[n].next_size = 3;
+			inst_log_entry[n].next = realloc(inst_log_entry[n].next, 3 * sizeof(int));
+			inst_log_entry[n].prev_size = 2;
+			inst_log_entry[n].prev = realloc(inst_log_entry[n].prev, 2 * sizeof(int));
+			if (!inst_log_entry[n].next || !inst_log_entry[n].prev) {
+				printf("microbench_tidy_inst_log: realloc failed\n");
+				exit(1);
+			}
+			inst_log_entry[n].next[0] = n + 1;
+			inst_log_entry[n].next[1] = n + 1;
+			inst_log_entry[n].next[2] = n + 2;
+			inst_log_entry[n].prev[0] = n - 1;
+			inst_log_entry[n].prev[1] = n - 1;
+		}
+		start = microbench_clock();
+		tidy_inst_log(self);
+		sample[iteration] = microbench_clock() - start;
+		/* Each duplicate is gone: next = {n + 1, n + 2}, prev = {n - 1}, and inst 1 has no prev */
+		for (n = 1; n <= size; n++) {
+			if ((inst_log_entry[n].next_size != 2) ||
+				(inst_log_entry[n].next[0] != n + 1) ||
+				(inst_log_entry[n].next[1] != n + 2)) {
+				wrong++;
+			}
+			if (n == 1) {
+				if (inst_log_entry[n].prev_size || inst_log_entry[n].prev) {
+					wrong++;
+				}
+			} else if ((inst_log_entry[n].prev_size != 1) ||
+				(inst_log_entry[n].prev[0] != n - 1)) {
+				wrong++;
+			}
+		}
+	}
+	microbench_report(out, "tidy_inst_log", "synthetic", size, sample, iterations);
+	if (wrong) {
+		dprintf(out, "tidy_inst_log: 0x%x wrong next or prev lists\n", wrong);
+	}
+	for (n = 1; n <= size; n++) {
+		free(inst_log_entry[n].next);
+		free(inst_log_entry[n].prev);
+	}
+	free(inst_log_entry);
+	self->inst_log_entry = NULL;
+	inst_log = 1;
+	return (wrong != 0);
+}
+
+/* Decode and convert buffer from start to end, as process_block() would */
+static int microbench_decode(int out, struct self_s *self, const char *input, uint8_t *buffer, uint64_t buffer_size, int iterations)
+{
+	struct dis_instructions_s dis_instructions;
+	struct instruction_low_level_s *ll_inst = (struct instruction_low_level_s *)self->ll_inst;
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	uint64_t offset;
+	uint64_t ops = 0;
+	int iteration;
+
+	for (iteration = 0; iteration < iterations; iteration++) {
+		ops = 0;
+		start = microbench_clock();
+		for (offset = 0; offset < buffer_size; ) {
+			ops++;
+			if (disassemble(self, &dis_instructions, buffer, buffer_size, offset) ||
+				!ll_inst->octets) {
+				/* Not code. Step over a byte */
+				offset++;
+				continue;
+			}
+			offset += ll_inst->octets;
+		}
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "decode_convert", input, ops, sample, iterations);
+	return 0;
+}
+
+static int microbench_relocated_code(int out, void *handle_void, uint8_t *code, uint64_t code_size, int iterations)
+{
+	struct reloc_table_s *reloc_table_entry;
+	uint64_t sample[MICROBENCH_ITERATIONS_MAX];
+	uint64_t start;
+	uint64_t offset;
+	int iteration;
+
+	for (iteration = 0; iteration < iterations; iteration++) {
+		start = microbench_clock();
+		for (offset = 0; offset < code_size; offset++) {
+			bf_relocated_code(handle_void, code, offset, 4, &reloc_table_entry);
+		}
+		sample[iteration] = microbench_clock() - start;
+	}
+	microbench_report(out, "bf_relocated_code", "file", code_size, sample, iterations);
+	return 0;
+}
+
+/* push, mov, load, store, add, cmp, jcc, sub, call, leave, ret */
+static uint8_t microbench_code[] = {
+	0x55,
+	0x48, 0x89, 0xe5,
+	0x48, 0x83, 0xec, 0x10,
+	0x89, 0x7d, 0xfc,
+	0x8b, 0x45, 0xfc,
+	0x83, 0xc0, 0x01,
+	0x3b, 0x45, 0xf8,
+	0x7e, 0x05,
+	0xe8, 0x00, 0x00, 0x00, 0x00,
+	0xc9,
+	0xc3,
+};
+
+int main(int argc, char *argv[])
+{
+	struct self_s *self;
+	uint8_t *buffer;
+	uint64_t buffer_size;
+	void *handle_void = NULL;
+	const char *file = NULL;
+	int iterations = 10;
+	int size = 1000;
+	int depth;
+	int failed = 0;
+	int out;
+	int fd;
+	int n;
+
+	for (n = 1; n < argc; n++) {
+		if (!strncmp(argv[n], "--iterations=", 13)) {
+			iterations = atoi(&argv[n][13]);
+		} else if (!strncmp(argv[n], "--size=", 7)) {
+			size = atoi(&argv[n][7]);
+		} else if ((argv[n][0] != '-') && !file) {
+			file = argv[n];
+		} else {
+			iterations = 0;
+			break;
+		}
+	}
+	if ((iterations < 1) || (iterations > MICROBENCH_ITERATIONS_MAX) || (size < 2)) {
+		printf("Usage: microbench [--iterations=10] [--size=1000] [file.o]\n");
+		printf("Prints the min and median ns per operation of each hot path\n");
+		exit(1);
+	}
+	depth = 1;
+	while (((2 << depth) <= size) && (depth < MICROBENCH_PATHS_DEPTH_MAX)) {
+		depth++;
+	}
+
+	self = calloc(1, sizeof(struct self_s));
+	self->ll_inst = (void *)calloc(1, sizeof(struct instruction_low_level_s));
+	if (!self->ll_inst) {
+		printf("microbench: calloc failed\n");
+		exit(1);
+	}
+	LLVMInitializeX86TargetInfo();
+	LLVMInitializeX86TargetMC();
+	LLVMInitializeX86AsmParser();
+	LLVMInitializeX86Disassembler();
+	self->decode_asm = LLVMNewDecodeAsmX86_64();
+	if (!self->decode_asm || LLVMSetupDecodeAsmX86_64(self->decode_asm)) {
+		printf("LLVMSetupDecodeAsmX86_64() failed\n");
+		exit(1);
+	}
+
+	/* convert_ll_inst_to_rtl() printf()s. Keep that, but off the terminal */
+	fflush(stdout);
+	out = dup(1);
+	fd = open("/dev/null", O_WRONLY);
+	if ((out < 0) || (fd < 0)) {
+		printf("microbench: cannot open /dev/null\n");
+		exit(1);
+	}
+	dup2(fd, 1);
+	close(fd);
+
+	dprintf(out, "%-28s %-12s %10s %12s %12s\n", "benchmark", "input", "ops", "min_ns/op", "median_ns/op");
+	failed |= microbench_store(out, size, iterations);
+	failed |= microbench_is_subset(out, size, iterations);
+	failed |= microbench_paths(out, self, depth, iterations);
+	failed |= microbench_tidy_inst_log(out, self, size, iterations);
+
+	buffer_size = sizeof(microbench_code) * size;
+	buffer = malloc(buffer_size);
+	if (!buffer) {
+		dprintf(out, "microbench: malloc failed\n");
+		exit(1);
+	}
+	for (n = 0; n < size; n++) {
+		memcpy(&buffer[n * sizeof(microbench_code)], microbench_code, sizeof(microbench_code));
+	}
+	failed |= microbench_decode(out, self, "synthetic", buffer, buffer_size, iterations);
+	free(buffer);
+
+	if (file) {
+		handle_void = bf_test_open_file(file);
+		if (!handle_void) {
+			dprintf(out, "%s: failed to find or recognise file\n", file);
+			exit(1);
+		}
+		inst_size = bf_get_code_size(handle_void);
+		inst = malloc(inst_size);
+		if (!inst) {
+			dprintf(out, "microbench: malloc failed\n");
+			exit(1);
+		}
+		memset(inst, 0, inst_size);
+		bf_copy_code_section(handle_void, inst, inst_size);
+		self->handle_void = handle_void;
+		failed |= microbench_relocated_code(out, handle_void, inst, inst_size, iterations);
+		failed |= microbench_decode(out, self, "file", inst, inst_size, iterations);
+		self->handle_void = NULL;
+		free(inst);
+		bf_test_close_file(handle_void);
+	}
+	if (failed) {
+		dprintf(out, "microbench: a benchmark gave the wrong result\n");
+	}
+	free(self->ll_inst);
+	free(self);
+	return failed;
+}
@@ -104,15 +104,20 @@ uint64_t inst_log = 1;	/* Pointer to the current free instruction log entry. */
 #define DEBUG_ANALYSE_PATHS 7
 #define DEBUG_ANALYSE_PHI 8
 
-/* debug: 0 = no debug output. >= 1 is more debug output */
-int debug_dis64 = 1;
-int debug_input_bfd = 1;
-int debug_input_dis = 1;
-int debug_exe = 1;
-int debug_analyse = 1;
-int debug_analyse_paths = 1;
-int debug_analyse_phi = 1;
-int debug_output = 1;
+/* debug: 0 = no debug output. >= 1 is more debug output. Indexed by DEBUG_MAIN etc. */
+int debug_level[DEBUG_MODULE_MAX] = { 0, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+static const char *debug_module_name[DEBUG_MODULE_MAX] = {
+	NULL,
+	"DEBUG_MAIN",
+	"DEBUG_INPUT_BFD",
+	"DEBUG_INPUT_DIS",
+	"DEBUG_OUTPUT",
+	"DEBUG_EXE",
+	"DEBUG_ANALYSE",
+	"DEBUG_ANALYSE_PATHS",
+	"DEBUG_ANALYSE_PHI",
+};
 
 struct test_data_s {
 	int	valid;
@@ -567,64 +572,18 @@ struct test_data_s test_data[] = {
 
 #define test_data_no sizeof(test_data) / sizeof(struct test_data_s)
 
-void debug_print(int module, int level, const char *format, ...)
+/* Only reached through the debug_print() macro, once the level has been checked */
+void debug_print_out(int module, int level, const char *format, ...)
 {
 	va_list ap;
-	va_start(ap, format);
-	switch (module) {
-	case DEBUG_MAIN:
-		if (level <= debug_dis64) {
-			fprintf(stderr, "DEBUG_MAIN,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_INPUT_BFD:
-		if (level <= debug_input_bfd) {
-			fprintf(stderr, "DEBUG_INPUT_BFD,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_INPUT_DIS:
-		if (level <= debug_input_dis) {
-			fprintf(stderr, "DEBUG_INPUT_DIS,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_EXE:
-		if (level <= debug_exe) {
-			fprintf(stderr, "DEBUG_EXE,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_ANALYSE:
-		if (level <= debug_analyse) {
-			fprintf(stderr, "DEBUG_ANALYSE,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_ANALYSE_PATHS:
-		if (level <= debug_analyse_paths) {
-			fprintf(stderr, "DEBUG_ANALYSE_PATHS,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_ANALYSE_PHI:
-		if (level <= debug_analyse_phi) {
-			fprintf(stderr, "DEBUG_ANALYSE_PHI,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	case DEBUG_OUTPUT:
-		if (level <= debug_output) {
-			fprintf(stderr, "DEBUG_OUTPUT,0x%x:", level);
-			vfprintf(stderr, format, ap);
-		}
-		break;
-	default:
+
+	if ((module <= 0) || (module >= DEBUG_MODULE_MAX)) {
 		printf("DEBUG Failed: Module 0x%x\n", module);
 		exit(1);
-		break;
 	}
+	va_start(ap, format);
+	fprintf(stderr, "%s,0x%x:", debug_module_name[module], level);
+	vfprintf(stderr, format, ap);
 	va_end(ap);
 }
 